@@ -1,5 +1,9 @@
 #include "apps/SceneEditorApp.hpp"
 #include "apps/RMResearchApp.hpp"
+#include "apps/SceneStorageBenchmark.hpp"
+#include "apps/SpatialIndexBenchmark.hpp"
+#include "apps/LightBinningBenchmark.hpp"
+#include "apps/OcclusionCullingBenchmark.hpp"
 
 // std
 #include <cstdlib>
@@ -12,7 +16,7 @@ int main(int argc, char* argv[])
     {
         if (argc > 1) {
             std::string argument_str(argv[1]);
-            int argument_number = atoi(argv[2]);
+            int argument_number = argc > 2 ? atoi(argv[2]) : 0;
 
             if (argument_str == "--scene") {
                 SceneEditorApp app{argument_number};
@@ -22,6 +26,56 @@ int main(int argc, char* argv[])
                 RMResearchApp app{argument_number};
                 app.run();
             }
+            else if (argument_str == "--benchmark") {
+                // --benchmark [frames] [recording threads] [point lights]: instanced grid scene, prints draw calls,
+                // CPU recording time and frame time of the forward and deferred shading paths.
+                // 0 recording threads measures 1, 2, 4, ... up to the maximum, with and without instancing,
+                // and prints recording time per count
+                int recordingThreads = argc > 3 ? atoi(argv[3]) : 1;
+                int pointLights = argc > 4 ? atoi(argv[4]) : 0;
+                SceneEditorApp app{SceneEditorApp::BENCHMARK_SCENE, argument_number > 0 ? argument_number : 1000,
+                    recordingThreads, pointLights};
+                app.run();
+            }
+            else if (argument_str == "--headless") {
+                // --headless [scene] [frames] [output]: renders the scene without a window or surface and saves
+                // the last frame (PNG for *.png, raw RGBA8 otherwise)
+                SceneEditorApp::HeadlessOptions headless;
+                headless.frames = argc > 3 ? atoi(argv[3]) : 60;
+                headless.outputPath = argc > 4 ? argv[4] : "frame.png";
+                if (headless.frames <= 0)
+                    headless.frames = 1;
+                SceneEditorApp app{argument_number, 0, 1, 0, headless};
+                app.run();
+            }
+            else if (argument_str == "--headless-benchmark") {
+                // --headless-benchmark [frames] [recording threads] [point lights]: --benchmark without a window
+                int recordingThreads = argc > 3 ? atoi(argv[3]) : 1;
+                int pointLights = argc > 4 ? atoi(argv[4]) : 0;
+                SceneEditorApp app{SceneEditorApp::BENCHMARK_SCENE, argument_number > 0 ? argument_number : 1000,
+                    recordingThreads, pointLights, SceneEditorApp::HeadlessOptions{}};
+                app.run();
+            }
+            else if (argument_str == "--scene-storage-benchmark") {
+                // CPU-only: legacy unordered_map scene walk vs per-component pools at 10k/100k/1M objects
+                SceneStorageBenchmark benchmark{};
+                benchmark.run();
+            }
+            else if (argument_str == "--bvh-benchmark") {
+                // CPU-only: BVH frustum/sphere/AABB/ray queries vs linear scans at 10k/100k/1M objects
+                SpatialIndexBenchmark benchmark{};
+                benchmark.run();
+            }
+            else if (argument_str == "--light-binning-benchmark") {
+                // CPU-only: clustered light assignment vs brute-force light/cluster tests at 100..8000 lights
+                LightBinningBenchmark benchmark{};
+                benchmark.run();
+            }
+            else if (argument_str == "--occlusion-benchmark") {
+                // CPU-only: software occluder rasterisation and box tests at 30..30k occluder triangles
+                OcclusionCullingBenchmark benchmark{};
+                benchmark.run();
+            }
         }
         else {
             SceneEditorApp app{};
@@ -0,0 +1,112 @@
+#include "LightBinningBenchmark.hpp"
+
+#include "../renderer/Camera.hpp"
+#include "../renderer/LightBinner.hpp"
+#include "../renderer/LightClusters.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int ITERATIONS = 50;
+
+    using Clock = std::chrono::steady_clock;
+
+    double microsecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // cluster bounds in view space, the same construction as in WrpLightBinner::setProjection
+    void clusterBounds(const glm::mat4& projection, float near, float far, uint32_t x, uint32_t y, uint32_t z,
+        glm::vec3& outMin, glm::vec3& outMax)
+    {
+        const float z0 = near * std::pow(far / near, static_cast<float>(z) / WrpLightBinner::CLUSTERS_Z);
+        const float z1 = near * std::pow(far / near, static_cast<float>(z + 1) / WrpLightBinner::CLUSTERS_Z);
+        auto range = [z0, z1](float ndc0, float ndc1, float scale) {
+            return glm::vec2{std::min(ndc0 * z0, ndc0 * z1) / scale, std::max(ndc1 * z0, ndc1 * z1) / scale};
+        };
+        const glm::vec2 xRange = range(-1.f + 2.f * x / WrpLightBinner::CLUSTERS_X,
+            -1.f + 2.f * (x + 1) / WrpLightBinner::CLUSTERS_X, projection[0][0]);
+        const glm::vec2 yRange = range(-1.f + 2.f * y / WrpLightBinner::CLUSTERS_Y,
+            -1.f + 2.f * (y + 1) / WrpLightBinner::CLUSTERS_Y, projection[1][1]);
+        outMin = {xRange.x, yRange.x, z0};
+        outMax = {xRange.y, yRange.y, z1};
+    }
+}
+
+void LightBinningBenchmark::run()
+{
+    constexpr float NEAR_PLANE = .1f;
+    constexpr float FAR_PLANE = 100.f;
+    WrpCamera camera{};
+    camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, NEAR_PLANE, FAR_PLANE);
+    camera.setViewTarget({0.f, -10.f, -40.f}, {0.f, 0.f, 0.f});
+
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-100.f, 100.f};
+    std::uniform_real_distribution<float> intensity{.5f, 5.f};
+
+    std::printf("%8s | %12s | %14s | %12s | %15s | %8s\n",
+        "lights", "assignments", "per cluster", "binned, us", "brute force, us", "speedup");
+    for (uint32_t lightCount : {100u, 500u, 1000u, 2000u, 4000u, 8000u})
+    {
+        std::vector<glm::vec4> lights(lightCount);
+        for (auto& light : lights)
+        {
+            const float radius = std::sqrt(intensity(random) / WrpLightClusters::LIGHT_CUTOFF);
+            light = {position(random), position(random) * .05f, position(random) * .5f + 50.f, radius};
+        }
+
+        WrpLightBinner binner{};
+        binner.setProjection(camera.getProjection(), NEAR_PLANE, FAR_PLANE);
+        binner.assign(camera.getView(), lights); // warm-up
+        auto start = Clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            binner.assign(camera.getView(), lights);
+        const double binnedTime = microsecondsSince(start) / ITERATIONS;
+
+        // every light against every cluster AABB
+        std::vector<glm::vec4> viewLights(lightCount);
+        std::vector<std::vector<uint32_t>> bruteForce(WrpLightBinner::CLUSTER_COUNT);
+        start = Clock::now();
+        for (uint32_t i = 0; i < lightCount; i++)
+            viewLights[i] = glm::vec4(glm::vec3(camera.getView() * glm::vec4(glm::vec3(lights[i]), 1.f)), lights[i].w);
+        for (uint32_t z = 0; z < WrpLightBinner::CLUSTERS_Z; z++)
+        for (uint32_t y = 0; y < WrpLightBinner::CLUSTERS_Y; y++)
+        for (uint32_t x = 0; x < WrpLightBinner::CLUSTERS_X; x++)
+        {
+            glm::vec3 boxMin, boxMax;
+            clusterBounds(camera.getProjection(), NEAR_PLANE, FAR_PLANE, x, y, z, boxMin, boxMax);
+            auto& list = bruteForce[(z * WrpLightBinner::CLUSTERS_Y + y) * WrpLightBinner::CLUSTERS_X + x];
+            for (uint32_t i = 0; i < lightCount; i++)
+            {
+                const glm::vec3 center{viewLights[i]};
+                const glm::vec3 offset = glm::clamp(center, boxMin, boxMax) - center;
+                if (glm::dot(offset, offset) <= viewLights[i].w * viewLights[i].w)
+                    list.push_back(i);
+            }
+        }
+        const double bruteForceTime = microsecondsSince(start);
+
+        // the binner may only drop lights whose projected bounds miss the tile or slice
+        bool missing = false;
+        const auto& indices = binner.getLightIndices();
+        for (uint32_t cluster = 0; cluster < WrpLightBinner::CLUSTER_COUNT && !missing; cluster++)
+        {
+            const glm::uvec2 range = binner.getClusters()[cluster];
+            for (uint32_t i = range.x; i < range.x + range.y; i++)
+                missing |= !std::binary_search(bruteForce[cluster].begin(), bruteForce[cluster].end(), indices[i]);
+        }
+
+        std::printf("%8u | %12zu | %14.1f | %12.1f | %15.1f | %7.1fx%s\n", lightCount, indices.size(),
+            double(indices.size()) / WrpLightBinner::CLUSTER_COUNT, binnedTime, bruteForceTime,
+            bruteForceTime / binnedTime, missing ? "  LIGHTS NOT IN BRUTE FORCE LISTS" : "");
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/*
+ * CPU benchmark of clustered light assignment (WrpLightBinner), no window or Vulkan device is created.
+ * Random point lights with influence radii as computed by WrpLightClusters are binned into the froxel grid
+ * of a fixed camera at 100 to 8000 lights; the binning time is compared with a brute-force test
+ * of every light against every cluster, whose per-cluster lists must contain the binned ones.
+ */
+class LightBinningBenchmark
+{
+public:
+    void run();
+};
@@ -0,0 +1,156 @@
+#include "OcclusionCullingBenchmark.hpp"
+
+#include "../renderer/Camera.hpp"
+#include "../renderer/Culling.hpp"
+#include "../renderer/OcclusionBuffer.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr int ITERATIONS = 50;
+    constexpr uint32_t PANELS_X = 5;
+    constexpr uint32_t PANELS_Y = 3;
+    constexpr uint32_t BOX_COUNT = 20000;
+    constexpr float WALL_DEPTH = 10.f;
+
+    using Clock = std::chrono::steady_clock;
+
+    double microsecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // panel facing the camera, split into segments x segments quads
+    std::vector<glm::vec3> panelTriangles(const glm::vec2& min, const glm::vec2& max, uint32_t segments)
+    {
+        std::vector<glm::vec3> triangles;
+        const glm::vec2 step = (max - min) / static_cast<float>(segments);
+        for (uint32_t y = 0; y < segments; y++)
+        for (uint32_t x = 0; x < segments; x++)
+        {
+            const glm::vec2 p0 = min + step * glm::vec2(x, y);
+            const glm::vec2 p1 = p0 + step;
+            triangles.insert(triangles.end(), {
+                {p0.x, p0.y, WALL_DEPTH}, {p1.x, p0.y, WALL_DEPTH}, {p1.x, p1.y, WALL_DEPTH},
+                {p0.x, p0.y, WALL_DEPTH}, {p1.x, p1.y, WALL_DEPTH}, {p0.x, p1.y, WALL_DEPTH}});
+        }
+        return triangles;
+    }
+
+    // screen rectangle of the box in NDC (all corners are in front of the camera in this scene)
+    void projectBox(const glm::mat4& viewProjection, const WrpAabb& box, glm::vec2& outMin, glm::vec2& outMax)
+    {
+        outMin = glm::vec2{std::numeric_limits<float>::max()};
+        outMax = glm::vec2{std::numeric_limits<float>::lowest()};
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            const glm::vec4 clip = viewProjection * glm::vec4(
+                corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z, 1.f);
+            const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            outMin = glm::min(outMin, ndc);
+            outMax = glm::max(outMax, ndc);
+        }
+    }
+}
+
+void OcclusionCullingBenchmark::run()
+{
+    WrpCamera camera{};
+    camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, .1f, 100.f);
+    camera.setViewTarget({0.f, 0.f, 0.f}, {0.f, 0.f, 1.f});
+    const glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+
+    // 3.5 x 2.5 panels with .5 gaps, the boxes behind the gaps stay visible
+    std::vector<WrpAabb> panels;
+    for (uint32_t y = 0; y < PANELS_Y; y++)
+    for (uint32_t x = 0; x < PANELS_X; x++)
+    {
+        const glm::vec2 center{(static_cast<float>(x) - (PANELS_X - 1) * .5f) * 4.f, (static_cast<float>(y) - (PANELS_Y - 1) * .5f) * 3.f};
+        panels.push_back({glm::vec3(center - glm::vec2(1.75f, 1.25f), WALL_DEPTH), glm::vec3(center + glm::vec2(1.75f, 1.25f), WALL_DEPTH)});
+    }
+
+    // random boxes behind the wall, only those inside the view frustum are tested
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> positionX{-25.f, 25.f};
+    std::uniform_real_distribution<float> positionY{-12.f, 12.f};
+    std::uniform_real_distribution<float> positionZ{WALL_DEPTH + 1.f, 60.f};
+    const WrpFrustumCuller frustum{camera};
+    std::vector<WrpAabb> boxes;
+    for (uint32_t i = 0; i < BOX_COUNT; i++)
+    {
+        const glm::vec3 center{positionX(random), positionY(random), positionZ(random)};
+        const WrpAabb box{center - glm::vec3(.15f), center + glm::vec3(.15f)};
+        if (frustum.testSphere(box.boundingSphere()))
+            boxes.push_back(box);
+    }
+
+    // exact reference: the projected box rectangle lies inside one projected panel (the panels don't touch),
+    // with the tolerance of half a buffer pixel for the errors
+    const glm::vec2 halfPixel{1.f / WrpOcclusionBuffer::WIDTH, 1.f / WrpOcclusionBuffer::HEIGHT};
+    std::vector<uint8_t> covered(boxes.size(), 0);
+    std::vector<uint8_t> coveredWithTolerance(boxes.size(), 0);
+    for (const auto& panel : panels)
+    {
+        glm::vec2 panelMin, panelMax;
+        projectBox(viewProjection, panel, panelMin, panelMax);
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            glm::vec2 boxMin, boxMax;
+            projectBox(viewProjection, boxes[i], boxMin, boxMax);
+            if (glm::all(glm::greaterThanEqual(boxMin, panelMin)) && glm::all(glm::lessThanEqual(boxMax, panelMax)))
+                covered[i] = 1;
+            if (glm::all(glm::greaterThanEqual(boxMin, panelMin - halfPixel)) && glm::all(glm::lessThanEqual(boxMax, panelMax + halfPixel)))
+                coveredWithTolerance[i] = 1;
+        }
+    }
+    const size_t referenceOccluded = std::count(covered.begin(), covered.end(), 1);
+
+    std::printf("%zu boxes in the view frustum, %zu behind the panels, %ux%u depth buffer\n", boxes.size(),
+        referenceOccluded, WrpOcclusionBuffer::WIDTH, WrpOcclusionBuffer::HEIGHT);
+    std::printf("%10s | %13s | %12s | %12s | %10s | %8s\n",
+        "triangles", "rasterize, us", "test, us", "per box, ns", "occluded", "errors");
+    for (uint32_t segments : {1u, 4u, 12u, 32u})
+    {
+        std::vector<std::vector<glm::vec3>> occluders;
+        for (const auto& panel : panels)
+            occluders.push_back(panelTriangles(glm::vec2(panel.min), glm::vec2(panel.max), segments));
+
+        WrpOcclusionBuffer buffer{};
+        auto rasterize = [&]() {
+            buffer.begin(viewProjection);
+            for (const auto& occluder : occluders)
+                buffer.addOccluder(glm::mat4{1.f}, occluder);
+            buffer.rasterize();
+        };
+        rasterize(); // warm-up
+        auto start = Clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            rasterize();
+        const double rasterizeTime = microsecondsSince(start) / ITERATIONS;
+
+        std::vector<uint8_t> occluded(boxes.size(), 0);
+        start = Clock::now();
+        for (int iteration = 0; iteration < ITERATIONS; iteration++)
+            for (size_t i = 0; i < boxes.size(); i++)
+                occluded[i] = buffer.isOccluded(boxes[i]) ? 1 : 0;
+        const double testTime = microsecondsSince(start) / ITERATIONS;
+
+        size_t occludedCount = 0;
+        size_t errors = 0;
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            occludedCount += occluded[i];
+            errors += occluded[i] && !coveredWithTolerance[i];
+        }
+
+        std::printf("%10u | %13.1f | %12.1f | %12.1f | %4zu (%2.0f%%) | %8zu%s\n", buffer.getTriangleCount(),
+            rasterizeTime, testTime, testTime * 1000.0 / boxes.size(), occludedCount,
+            100.0 * occludedCount / std::max<size_t>(referenceOccluded, 1), errors, errors ? "  VISIBLE BOXES CULLED" : "");
+    }
+}
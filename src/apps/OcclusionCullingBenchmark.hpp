@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ * CPU benchmark of software occlusion culling (WrpOcclusionBuffer), no window or Vulkan device is created.
+ * A wall of 15 panels with gaps between them is rasterised at several tessellation levels (30 to ~30k triangles),
+ * and 20k random boxes behind it are tested against the depth buffer. Rasterisation and test times are printed
+ * together with the number of occluded boxes; the result is compared with an exact test of the projected box
+ * rectangles against the projected panels, a box culled more than half a buffer pixel away from a panel is an error.
+ */
+class OcclusionCullingBenchmark
+{
+public:
+    void run();
+};
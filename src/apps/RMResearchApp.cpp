@@ -4,8 +4,23 @@
 #include "../renderer/systems/SimpleRenderSystem.hpp"
 #include "../renderer/systems/TextureRenderSystem.hpp"
 #include "../renderer/systems/PointLightSystem.hpp"
+#include "../renderer/systems/DeferredLightingSystem.hpp"
+#include "../renderer/systems/UpscaleSystem.hpp"
 #include "../renderer/Buffer.hpp"
+#include "../renderer/InstanceBuffer.hpp"
+#include "../renderer/IndirectDrawBuffer.hpp"
+#include "../renderer/GpuCulling.hpp"
+#include "../renderer/CommandRecorder.hpp"
+#include "../renderer/TransformCache.hpp"
+#include "../renderer/LightClusters.hpp"
+#include "../renderer/OcclusionCulling.hpp"
+#include "../renderer/GBuffer.hpp"
+#include "../renderer/DynamicResolution.hpp"
+#include "../renderer/GpuTimer.hpp"
+#include "../renderer/RenderGraph.hpp"
 #include "../renderer/Camera.hpp"
+#include "../renderer/JobSystem.hpp"
+#include "../renderer/ShaderWatcher.hpp"
 #include "./common/KeyboardMovementController.hpp"
 
 // libs
@@ -19,9 +34,11 @@
 
 // std
 #include <stdexcept>
+#include <algorithm>
 #include <cassert>
 #include <array>
 #include <chrono>
+#include <iostream>
 #include <numeric>
 
 #define MAX_FRAME_TIME 0.5f
@@ -32,6 +49,7 @@ RMResearchApp::RMResearchApp(int preloadScene)
     globalPool = WrpDescriptorPool::Builder(wrpDevice)
         .setMaxSets(wrpRenderer.getSwapChainImageCount())
         .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, wrpRenderer.getSwapChainImageCount())
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * wrpRenderer.getSwapChainImageCount())
         .build();
 
     loadScene();
@@ -55,9 +73,42 @@ void RMResearchApp::run()
         uboBuffers[i]->map();
     }
 
+    // Per-frame storage buffers with instance transforms (model and normal matrices)
+    WrpInstanceBuffer instanceBuffer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Per-frame indirect draw commands and per-draw material data for multi-draw indirect submission
+    WrpIndirectDrawBuffer indirectDrawBuffer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Compute frustum culling that fills the indirect draw buffers on the GPU (RenderingSettings::gpuCulling)
+    WrpGpuCulling gpuCulling{wrpDevice, wrpRenderer.getSwapChainImageCount(), instanceBuffer, indirectDrawBuffer};
+    // Per-thread command pools for recording scene draws into secondary command buffers in parallel
+    WrpCommandRecorder commandRecorder{wrpDevice, wrpRenderer, wrpRenderer.getSwapChainImageCount()};
+    // World matrices of scene objects, recomputed only for transforms changed since the previous frame
+    WrpTransformCache transformCache{};
+    // Per-frame point lights and their per-cluster lists for clustered forward shading
+    WrpLightClusters lightClusters{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Low-resolution software depth buffer of the largest occluders for CPU occlusion culling
+    WrpOcclusionCuller occlusionCuller{};
+    // Frame passes and their transient images: barriers and image memory are derived from declared reads and writes
+    WrpRenderGraph renderGraph{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Surface attributes of the scene for the deferred shading path (RenderingSettings::deferredShading)
+    WrpGBuffer gBuffer{wrpDevice};
+    // Offscreen scene target whose resolution follows the measured GPU frame time (RenderingSettings::dynamicResolution),
+    // also used at full resolution as the FXAA input (RenderingSettings::fxaa)
+    WrpDynamicResolution dynamicResolution{wrpDevice, wrpRenderer.getSwapChainImageFormat(),
+        wrpRenderer.getSwapChainDepthFormat(), wrpRenderer.getMsaaSampleCount()};
+    // GPU frame time from timestamp queries, feeds the dynamic resolution controller;
+    // marks split it into the scene, post-process and GUI parts
+    WrpGpuTimer gpuTimer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+
     // Global Descriptor Set Layout for the entire app
     auto globalDescriptorSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
         .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS, 1)
+        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+        .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+        .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
         .build();
 
     // Getting Descriptor Sets from pool
@@ -65,11 +116,27 @@ void RMResearchApp::run()
     for (int i = 0; i < globalDescriptorSets.size(); ++i)
     {
         VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo(); // инфа о буфере для дескриптора
+        VkDescriptorBufferInfo instanceBufferInfo = instanceBuffer.descriptorInfo(i);
+        VkDescriptorBufferInfo drawDataBufferInfo = indirectDrawBuffer.drawDataDescriptorInfo(i);
+        VkDescriptorBufferInfo visibleInstancesInfo = instanceBuffer.visibleInstancesDescriptorInfo(i);
+        VkDescriptorBufferInfo drawRemapInfo = indirectDrawBuffer.drawRemapDescriptorInfo(i);
+        VkDescriptorBufferInfo pointLightsInfo = lightClusters.lightsDescriptorInfo(i);
+        VkDescriptorBufferInfo lightClustersInfo = lightClusters.clustersDescriptorInfo(i);
+        VkDescriptorBufferInfo lightIndicesInfo = lightClusters.lightIndicesDescriptorInfo(i);
 
         WrpDescriptorWriter(*globalDescriptorSetLayout, *globalPool)
             .writeBuffer(0, &bufferInfo)
+            .writeBuffer(1, &instanceBufferInfo)
+            .writeBuffer(2, &drawDataBufferInfo)
+            .writeBuffer(3, &visibleInstancesInfo)
+            .writeBuffer(4, &drawRemapInfo)
+            .writeBuffer(5, &pointLightsInfo)
+            .writeBuffer(6, &lightClustersInfo)
+            .writeBuffer(7, &lightIndicesInfo)
             .build(globalDescriptorSets[i]);
     }
+    // light buffers grow on demand, their descriptors are rewritten when a frame slot's buffers are recreated
+    std::vector<uint32_t> lightBufferGenerations(globalDescriptorSets.size(), 0);
 
     WrpCamera camera{};
     // default camera transform
@@ -80,28 +147,56 @@ void RMResearchApp::run()
     auto cameraObject = SceneObject::createSceneObject("Camera");
     cameraObject.transform.translation = {0.f, 0.f, -4.f};
     cameraObject.transform.rotation = {.0f, .0f, .0f};
-    sceneObjects.emplace(cameraObject.getId(), std::move(cameraObject));
+    sceneObjects.add(std::move(cameraObject));
     KeyboardMovementController cameraController{};
 
     RenderingSettings renderingSettings{1, 0};
-    FrameInfo frameInfo{0, 0, nullptr, camera, nullptr, sceneObjects, renderingSettings};
+    renderingSettings.msaaSamples = wrpRenderer.getMsaaSampleCount();
+    renderingSettings.minSampleShading = wrpRenderer.getMinSampleShading();
+    RenderStats renderStats{};
+    FrameInfo frameInfo{0, 0, nullptr, camera, nullptr, sceneObjects, renderingSettings, renderStats, instanceBuffer,
+        indirectDrawBuffer, transformCache, lightClusters, occlusionCuller};
+
+    // Shader hot-reload: changed shaders are recompiled in background and pipelines are swapped at the frame boundary
+    WrpShaderWatcher shaderWatcher{};
 
+    // Системы ставят сборку своих пайплайнов в очередь WrpJobSystem и сразу возвращают управление,
+    // заранее собираются только варианты для текущих настроек, остальные - при первом использовании
+    auto startupBegin = std::chrono::high_resolution_clock::now();
+    bool firstFrameRendered = false;
     SimpleRenderSystem simpleRenderSystem{
         wrpDevice,
         wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer.getRenderPass()
     };
     TextureRenderSystem textureRenderSystem{
         wrpDevice,
         wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer.getRenderPass(),
         frameInfo
     };
     PointLightSystem pointLightSystem{
         wrpDevice,
-        wrpRenderer.getSwapChainRenderPass(),
+        wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout()
     };
+    DeferredLightingSystem deferredLightingSystem{
+        wrpDevice,
+        wrpRenderer,
+        globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer
+    };
+    UpscaleSystem upscaleSystem{
+        wrpDevice,
+        wrpRenderer,
+        dynamicResolution
+    };
+    simpleRenderSystem.prefetchPipelines(renderingSettings);
+    textureRenderSystem.prefetchPipelines(renderingSettings);
+    deferredLightingSystem.prefetchPipelines(renderingSettings);
+    upscaleSystem.prefetchPipelines(renderingSettings);
 
     RMResearchGUI appGUI{
         wrpWindow,
@@ -113,6 +208,7 @@ void RMResearchApp::run()
         sceneObjects,
         renderingSettings
     };
+    appGUI.maxRecordingThreads = static_cast<int>(commandRecorder.getMaxThreads());
 
     auto currentTime = std::chrono::high_resolution_clock::now();
 
@@ -138,13 +234,68 @@ void RMResearchApp::run()
         camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
         // frame rendering
+        auto changedShaders = shaderWatcher.pollChangedShaders();
+        if (!changedShaders.empty())
+        {
+            simpleRenderSystem.reloadShaders(shaderWatcher, changedShaders);
+            textureRenderSystem.reloadShaders(shaderWatcher, changedShaders);
+            pointLightSystem.reloadShaders(shaderWatcher, changedShaders);
+            deferredLightingSystem.reloadShaders(shaderWatcher, changedShaders);
+            upscaleSystem.reloadShaders(shaderWatcher, changedShaders);
+        }
+
+        // a new MSAA sample count recreates the swap chain render pass, the scene target and the GUI pipeline
+        // between frames; pipeline variants of the systems are keyed by the sample count and follow by themselves
+        if (wrpRenderer.setMultisampling(static_cast<VkSampleCountFlagBits>(renderingSettings.msaaSamples),
+            renderingSettings.minSampleShading))
+        {
+            dynamicResolution.setSampleCount(wrpRenderer.getMsaaSampleCount());
+            appGUI.setRenderPass(wrpRenderer.getSwapChainRenderPass(), wrpRenderer.getMsaaSampleCount());
+        }
+
         if (auto commandBuffer = wrpRenderer.beginFrame()) // beginFrame() will return nullptr if SwapChain recreation is needed
         {
+            appGUI.shaderErrors = shaderWatcher.getErrors();
             appGUI.newFrame(); // tell imgui that we're starting a new frame
 
             int frameIndex = wrpRenderer.getFrameIndex();
             FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera,
-                globalDescriptorSets[frameIndex], sceneObjects, renderingSettings};
+                globalDescriptorSets[frameIndex], sceneObjects, renderingSettings, renderStats, instanceBuffer,
+                indirectDrawBuffer, transformCache, lightClusters, occlusionCuller};
+            renderStats = {};
+            // the frame slot's fence has been waited on, so GPU culling results of its previous use are readable
+            gpuCulling.collectResults(frameIndex, renderStats);
+            const float gpuFrameMs = gpuTimer.collectResults(frameIndex);
+            renderStats.gpuFrameMs = std::max(gpuFrameMs, 0.f);
+            // intervals between the marks below: scene, post-process, GUI
+            if (gpuTimer.getIntervalsMs().size() == 3)
+            {
+                renderStats.gpuSceneMs = gpuTimer.getIntervalsMs()[0];
+                renderStats.gpuPostProcessMs = gpuTimer.getIntervalsMs()[1];
+            }
+            gpuTimer.begin(commandBuffer, frameIndex);
+            instanceBuffer.beginFrame(frameIndex, renderingSettings.gpuCulling);
+            indirectDrawBuffer.beginFrame(frameIndex, renderingSettings.gpuCulling);
+            commandRecorder.beginFrame(frameIndex);
+            // the graph is described anew every frame, its images follow the swap chain extent
+            // (the swap chain may have been recreated in beginFrame)
+            renderGraph.beginFrame(frameIndex);
+            if (renderingSettings.deferredShading)
+                gBuffer.declareAttachments(renderGraph, wrpRenderer.getSwapChainExtent());
+            // with dynamic resolution the scene is rendered into the top left part of the offscreen target,
+            // with FXAA alone - into the whole target
+            const bool useSceneTarget = renderingSettings.dynamicResolution || renderingSettings.fxaa;
+            if (useSceneTarget)
+            {
+                dynamicResolution.declareAttachments(renderGraph, wrpRenderer.getSwapChainExtent());
+                dynamicResolution.update(gpuFrameMs, renderingSettings);
+                frameInfo.renderExtent = dynamicResolution.getRenderExtent();
+                renderStats.resolutionScale = dynamicResolution.getScale();
+            }
+            else
+            {
+                frameInfo.renderExtent = wrpRenderer.getSwapChainExtent();
+            }
 
             // UPDATE SECTION
             GlobalUbo ubo{};
@@ -157,21 +308,163 @@ void RMResearchApp::run()
             ubo.roughness = appGUI.roughness;
             ubo.indexOfRefraction = appGUI.indexOfRefraction;
             pointLightSystem.update(frameInfo, ubo);
+            // the global set of this frame slot is not bound yet, so it can still be updated
+            if (lightBufferGenerations[frameIndex] != lightClusters.getBufferGeneration(frameIndex))
+            {
+                VkDescriptorBufferInfo pointLightsInfo = lightClusters.lightsDescriptorInfo(frameIndex);
+                VkDescriptorBufferInfo lightIndicesInfo = lightClusters.lightIndicesDescriptorInfo(frameIndex);
+                WrpDescriptorWriter(*globalDescriptorSetLayout, *globalPool)
+                    .writeBuffer(5, &pointLightsInfo)
+                    .writeBuffer(7, &lightIndicesInfo)
+                    .overwrite(globalDescriptorSets[frameIndex]);
+                lightBufferGenerations[frameIndex] = lightClusters.getBufferGeneration(frameIndex);
+            }
             uboBuffers[frameIndex]->writeToBuffer(&ubo);
+            transformCache.update(sceneObjects);
+            renderStats.transformsUpdated = transformCache.getUpdatedCount();
+            // the occlusion buffer is only used by CPU culling, the systems test objects against it in prepareSceneObjects
+            if (renderingSettings.occlusionCulling && !renderingSettings.gpuCulling)
+                occlusionCuller.rasterizeOccluders(camera, sceneObjects, transformCache, renderStats);
+            else
+                occlusionCuller.disable();
 
             // RENDER SECTION
-            wrpRenderer.beginSwapChainRenderPass(commandBuffer, appGUI.clearColor);
+            // Culling and indirect commands are prepared before the render pass, since compute dispatches can't be recorded inside it
+            auto recordBegin = std::chrono::high_resolution_clock::now();
+            simpleRenderSystem.prepareSceneObjects(frameInfo);
+            textureRenderSystem.prepareSceneObjects(frameInfo);
+            if (renderingSettings.gpuCulling)
+                gpuCulling.dispatch(commandBuffer, frameIndex, camera, renderingSettings.verifyGpuCulling);
+
+            // With several recording threads the whole render pass is recorded into secondary command buffers
+            const bool parallelRecording = renderingSettings.recordingThreads > 1;
+            const VkSubpassContents subpassContents =
+                parallelRecording ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+            // Opaque scene objects, recorded inline or into secondary buffers of the current render pass
+            auto renderSceneObjects = [&]() {
+                std::vector<VkCommandBuffer> sceneCommandBuffers;
+                if (parallelRecording)
+                {
+                    sceneCommandBuffers = simpleRenderSystem.renderSceneObjects(frameInfo, commandRecorder);
+                    auto textureCommandBuffers = textureRenderSystem.renderSceneObjects(frameInfo, commandRecorder);
+                    sceneCommandBuffers.insert(sceneCommandBuffers.end(),
+                        textureCommandBuffers.begin(), textureCommandBuffers.end());
+                }
+                else
+                {
+                    simpleRenderSystem.renderSceneObjects(frameInfo);
+                    textureRenderSystem.renderSceneObjects(frameInfo);
+                }
+                return sceneCommandBuffers;
+            };
 
-            // Order of objects render is matter, because we need to ensure that we rendered
+            std::vector<VkCommandBuffer> secondaryCommandBuffers;
+            // ends the main thread's secondary buffer of the current render pass and executes all of its secondary buffers
+            auto executeSecondaryCommandBuffers = [&]() {
+                if (!parallelRecording)
+                    return;
+                commandRecorder.endSecondary(frameInfo.commandBuffer);
+                secondaryCommandBuffers.push_back(frameInfo.commandBuffer);
+                // the primary buffer executes secondary buffers in the order they were returned
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                    secondaryCommandBuffers.data());
+                secondaryCommandBuffers.clear();
+            };
+            // Scene draws of the current render pass: opaque objects, or the deferred light pass over the G-buffer,
+            // then point lights. Order of objects render is matter, because we need to ensure that we rendered
             // fully opaque objects (like textured models) before rendering translucent objects (like point lights)
-            simpleRenderSystem.renderSceneObjects(frameInfo);
-            textureRenderSystem.renderSceneObjects(frameInfo);
-            pointLightSystem.render(frameInfo);
-            appGUI.setupGUI();
-            appGUI.render(commandBuffer);
+            auto renderScene = [&]() {
+                if (!renderingSettings.deferredShading)
+                    secondaryCommandBuffers = renderSceneObjects();
+                // point lights and GUI are recorded on the main thread into one more secondary buffer
+                if (parallelRecording)
+                    frameInfo.commandBuffer = commandRecorder.beginSecondary();
+                if (renderingSettings.deferredShading)
+                    deferredLightingSystem.render(frameInfo);
+                pointLightSystem.render(frameInfo);
+            };
 
-            wrpRenderer.endSwapChainRenderPass(commandBuffer);
+            // The passes below are recorded by renderGraph.execute in the order they are added,
+            // with the layout transitions and barriers between them derived from their reads and writes.
+            // Deferred shading: the scene is rendered into the G-buffer first, and the light pass replaces the scene draws
+            if (renderingSettings.deferredShading)
+            {
+                auto gBufferPass = renderGraph.addPass("G-buffer", [&](VkCommandBuffer passCommandBuffer) {
+                    gBuffer.beginRenderPass(passCommandBuffer, frameInfo.renderExtent, subpassContents);
+                    commandRecorder.setRenderPass(gBuffer.getRenderPass(), gBuffer.getFramebuffer(), frameInfo.renderExtent);
+                    auto gBufferCommandBuffers = renderSceneObjects();
+                    if (!gBufferCommandBuffers.empty())
+                        vkCmdExecuteCommands(passCommandBuffer, static_cast<uint32_t>(gBufferCommandBuffers.size()),
+                            gBufferCommandBuffers.data());
+                    commandRecorder.setRenderPass(VK_NULL_HANDLE, VK_NULL_HANDLE, {});
+                    gBuffer.endRenderPass(passCommandBuffer);
+                });
+                gBuffer.writeAttachments(gBufferPass);
+            }
+
+            // Dynamic resolution or FXAA: the scene goes into the offscreen target, and the swap chain render pass
+            // only upscales/antialiases it and draws the GUI at full resolution
+            if (useSceneTarget)
+            {
+                auto scenePass = renderGraph.addPass("Scene", [&](VkCommandBuffer passCommandBuffer) {
+                    dynamicResolution.beginRenderPass(passCommandBuffer, appGUI.clearColor, subpassContents);
+                    commandRecorder.setRenderPass(dynamicResolution.getRenderPass(), dynamicResolution.getFramebuffer(),
+                        frameInfo.renderExtent);
+                    renderScene();
+                    executeSecondaryCommandBuffers();
+                    dynamicResolution.endRenderPass(passCommandBuffer);
+                    gpuTimer.mark(passCommandBuffer, frameIndex);
+                    commandRecorder.setRenderPass(VK_NULL_HANDLE, VK_NULL_HANDLE, {});
+                });
+                dynamicResolution.writeAttachments(scenePass);
+                if (renderingSettings.deferredShading)
+                    gBuffer.readAttachments(scenePass);
+            }
+
+            // The swap chain image is presented, so this pass is never culled
+            auto swapChainPass = renderGraph.addPass("Swap chain", [&](VkCommandBuffer passCommandBuffer) {
+                wrpRenderer.beginSwapChainRenderPass(passCommandBuffer, appGUI.clearColor, subpassContents);
+                if (useSceneTarget)
+                {
+                    if (parallelRecording)
+                        frameInfo.commandBuffer = commandRecorder.beginSecondary();
+                    upscaleSystem.render(frameInfo);
+                }
+                else
+                {
+                    renderScene();
+                    // the main thread's buffer is executed after the scene buffers, so the mark follows the scene draws
+                    gpuTimer.mark(frameInfo.commandBuffer, frameIndex);
+                }
+                gpuTimer.mark(frameInfo.commandBuffer, frameIndex);
+                renderStats.recordTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - recordBegin).count();
+                appGUI.renderStats = renderStats;
+                appGUI.renderGraphStats = renderGraph.getStats();
+                appGUI.setupGUI();
+                appGUI.render(frameInfo.commandBuffer);
+
+                executeSecondaryCommandBuffers();
+
+                wrpRenderer.endSwapChainRenderPass(passCommandBuffer);
+            });
+            swapChainPass.setSideEffect();
+            if (useSceneTarget)
+                dynamicResolution.readSceneColor(swapChainPass);
+            else if (renderingSettings.deferredShading)
+                gBuffer.readAttachments(swapChainPass);
+
+            renderGraph.execute(commandBuffer);
+            gpuTimer.end(commandBuffer, frameIndex);
             wrpRenderer.endFrame();
+
+            if (!firstFrameRendered)
+            {
+                firstFrameRendered = true;
+                std::cout << "First frame recorded in " << std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - startupBegin).count() << " ms after render systems creation ("
+                    << WrpJobSystem::instance().getWorkerCount() << " worker threads)" << std::endl;
+            }
         }
     }
 
@@ -182,13 +475,11 @@ void RMResearchApp::loadScene()
 {
     std::shared_ptr<WrpModel> sphere = WrpModel::createModelFromObjMtl(wrpDevice, ENGINE_DIR"models/Sphere_64x32.obj");
     auto sphereObj = SceneObject::createSceneObject("Sphere_64x32");
-    sphereObj.model = sphere;
     sphereObj.transform.translation = {0.f, 0.f, 0.f};
     sphereObj.transform.scale = glm::vec3(1.f, 1.f, 1.f);
     sphereObj.transform.rotation = glm::vec3(0.f, 0.f, 0.f);
-    sceneObjects.emplace(sphereObj.getId(), std::move(sphereObj));
+    sceneObjects.add(std::move(sphereObj), sphere);
 
-    SceneObject pointLight = SceneObject::makePointLight(80.f, 0.001f, glm::vec3{1.f, 1.f, 1.f});
-    pointLight.transform.translation = {2.f, 0.f, 0.f};
-    sceneObjects.emplace(pointLight.getId(), std::move(pointLight));
+    const SceneObject::id_t pointLightId = sceneObjects.addPointLight(80.f, 0.001f, glm::vec3{1.f, 1.f, 1.f});
+    sceneObjects.at(pointLightId).transform.translation = {2.f, 0.f, 0.f};
 }
@@ -4,7 +4,7 @@
 #include "../renderer/Device.hpp"
 #include "../renderer/Renderer.hpp"
 #include "../renderer/Descriptors.hpp"
-#include "../renderer/SceneObject.hpp"
+#include "../renderer/Scene.hpp"
 
 // std
 #include <memory>
@@ -33,5 +33,5 @@ private:
     WrpRenderer wrpRenderer{ wrpWindow, wrpDevice };
 
     std::unique_ptr<WrpDescriptorPool> globalPool{};
-    SceneObject::Map sceneObjects;
+    WrpScene sceneObjects;
 };
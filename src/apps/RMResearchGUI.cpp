@@ -2,6 +2,7 @@
 
 #include "../src/renderer/Device.hpp"
 #include "../src/renderer/Window.hpp"
+#include "../src/renderer/SpirvCache.hpp"
 
 // libs
 #include <imgui.h>
@@ -20,8 +21,8 @@
 RMResearchGUI::RMResearchGUI(
     WrpWindow& window, WrpDevice& device, VkRenderPass renderPass,
     uint32_t imageCount, WrpCamera& camera, KeyboardMovementController& kmc,
-    SceneObject::Map& sceneObjects, RenderingSettings& renderingSettings)
-    : wrpDevice{device}, camera{camera}, kmc{kmc}, sceneObjects{sceneObjects},
+    WrpScene& sceneObjects, RenderingSettings& renderingSettings)
+    : wrpDevice{device}, imageCount{imageCount}, camera{camera}, kmc{kmc}, sceneObjects{sceneObjects},
     renderingSettings{renderingSettings}
 {
     VkInstance instance = device.getInstance();
@@ -70,24 +71,36 @@ RMResearchGUI::RMResearchGUI(
     // Setup Platform/Renderer backends
     // Initialize imgui for vulkan
     ImGui_ImplGlfw_InitForVulkan(window.getGLFWwindow(), true);
+    initVulkanBackend(renderPass, static_cast<VkSampleCountFlagBits>(renderingSettings.msaaSamples));
+}
+
+void RMResearchGUI::initVulkanBackend(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+{
     ImGui_ImplVulkan_InitInfo init_info = {};
-    init_info.Instance = device.getInstance();
-    init_info.PhysicalDevice = device.getPhysicalDevice();
-    init_info.Device = device.device();
-    init_info.QueueFamily = device.getGraphicsQueueFamily();
-    init_info.Queue = device.graphicsQueue();
+    init_info.Instance = wrpDevice.getInstance();
+    init_info.PhysicalDevice = wrpDevice.getPhysicalDevice();
+    init_info.Device = wrpDevice.device();
+    init_info.QueueFamily = wrpDevice.getGraphicsQueueFamily();
+    init_info.Queue = wrpDevice.graphicsQueue();
     init_info.DescriptorPool = descriptorPool;
     init_info.RenderPass = renderPass;
     init_info.MinImageCount = 2;
     init_info.ImageCount = imageCount;
-    init_info.MSAASamples = wrpDevice.getMaxUsableMSAASampleCount();
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.MSAASamples = msaaSamples;
+    init_info.PipelineCache = wrpDevice.getPipelineCache();
     init_info.Allocator = VK_NULL_HANDLE;
     init_info.CheckVkResultFn = check_vk_result;
     ImGui_ImplVulkan_Init(&init_info);
     ImGui_ImplVulkan_CreateFontsTexture();
 }
 
+void RMResearchGUI::setRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+{
+    // the backend's pipeline is created for a fixed sample count, so it is rebuilt along with the font texture
+    ImGui_ImplVulkan_Shutdown();
+    initVulkanBackend(renderPass, msaaSamples);
+}
+
 RMResearchGUI::~RMResearchGUI()
 {
     ImGui_ImplVulkan_Shutdown();
@@ -132,6 +145,41 @@ void RMResearchGUI::setupMainSettingsPanel()
     {
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
             1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        const PipelineCacheStats& pipelineStats = wrpDevice.getPipelineCacheStats();
+        ImGui::Text("Pipelines: %u created in %.2f ms (%s cache)", pipelineStats.pipelinesCreated.load(),
+            pipelineStats.totalCreationTimeMs(), pipelineStats.warmStart ? "warm" : "cold");
+        const SpirvCacheStats& spirvStats = SpirvCache::instance().getStats();
+        ImGui::Text("SPIR-V cache: %u hits, %u misses, %.2f ms compile time saved", spirvStats.hits.load(),
+            spirvStats.misses.load(), spirvStats.compileTimeSavedMs());
+        ImGui::Text("Culling: %u visible / %u culled objects, %u culled submeshes", renderStats.objectsVisible,
+            renderStats.objectsCulled, renderStats.subMeshesCulled);
+        ImGui::Text("Triangles: %llu drawn, %llu culled", static_cast<unsigned long long>(renderStats.trianglesVisible),
+            static_cast<unsigned long long>(renderStats.trianglesCulled));
+        ImGui::Text("Draw calls: %u (%u instances), recorded in %.3f ms", renderStats.drawCalls,
+            renderStats.instances, renderStats.recordTimeMs);
+        ImGui::Text("Transforms: %u matrices updated", renderStats.transformsUpdated);
+        ImGui::Text("Lights: %u point lights, %u cluster assignments, binned in %.3f ms",
+            renderStats.pointLights, renderStats.lightAssignments, renderStats.lightBinningMs);
+        ImGui::Text("Occlusion: %u occluders (%u triangles) in %.3f ms, %u objects / %u submeshes occluded",
+            renderStats.occludersRasterized, renderStats.occluderTriangles, renderStats.occlusionMs,
+            renderStats.objectsOccluded, renderStats.subMeshesOccluded);
+        ImGui::Text("GPU frame: %.3f ms, resolution scale %.0f%%", renderStats.gpuFrameMs,
+            renderStats.resolutionScale * 100.f);
+        ImGui::Text("AA: MSAA %dx%s: scene %.3f ms, post-process %.3f ms", renderingSettings.msaaSamples,
+            renderingSettings.fxaa ? " + FXAA" : "", renderStats.gpuSceneMs, renderStats.gpuPostProcessMs);
+        const float megabyte = 1024.f * 1024.f;
+        ImGui::Text("Render graph: %u passes (%u culled), %u barriers, %u transient images: %.1f MB (%.1f MB saved by aliasing)",
+            renderGraphStats.passes, renderGraphStats.passesCulled, renderGraphStats.barriers, renderGraphStats.images,
+            renderGraphStats.allocatedBytes / megabyte, (renderGraphStats.imageBytes - renderGraphStats.allocatedBytes) / megabyte);
+        for (const auto& pass : renderGraphStats.passTimings)
+            ImGui::BulletText("%s: %.3f ms", pass.name.c_str(), pass.gpuMs);
+
+        for (const auto& error : shaderErrors)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.f, .35f, .35f, 1.f));
+            ImGui::TextWrapped("Shader reload failed (%s):\n%s", error.pipelineName.c_str(), error.message.c_str());
+            ImGui::PopStyleColor();
+        }
 
         // 1 collapsing header
         if (ImGui::CollapsingHeader("Scene Rendering Settings", ImGuiTreeNodeFlags_DefaultOpen))
@@ -167,6 +215,42 @@ void RMResearchGUI::setupMainSettingsPanel()
             ImGui::RadioButton("Wireframe", &renderingSettings.polygonFillMode, 1); ImGui::SameLine();
             ImGui::RadioButton("Point", &renderingSettings.polygonFillMode, 2);
 
+            ImGui::Checkbox("GPU culling", &renderingSettings.gpuCulling); ImGui::SameLine();
+            ImGui::Checkbox("Verify GPU culling", &renderingSettings.verifyGpuCulling);
+            ImGui::SliderInt("Recording threads", &renderingSettings.recordingThreads, 1, maxRecordingThreads);
+            ImGui::Checkbox("Instancing", &renderingSettings.instancing);
+            ImGui::Checkbox("Deferred shading", &renderingSettings.deferredShading); ImGui::SameLine();
+            ImGui::Checkbox("Occlusion culling (CPU)", &renderingSettings.occlusionCulling);
+            ImGui::Checkbox("Dynamic resolution", &renderingSettings.dynamicResolution);
+            if (renderingSettings.dynamicResolution)
+            {
+                ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
+                ImGui::SliderFloat("Target GPU frame time (ms)", &renderingSettings.targetFrameMs, 4.f, 50.f);
+                ImGui::SliderFloat("Min resolution scale", &renderingSettings.minResolutionScale, .25f, 1.f);
+                ImGui::SliderFloat("Max resolution scale", &renderingSettings.maxResolutionScale, .25f, 1.f);
+                if (!renderingSettings.fxaa)
+                    ImGui::SliderFloat("Sharpness", &renderingSettings.sharpness, 0.f, 1.f);
+                ImGui::PopItemWidth();
+            }
+
+            ImGui::Text("MSAA samples");
+            for (int samples = 1; samples <= 8; samples *= 2)
+            {
+                if (samples > wrpDevice.getMaxUsableMSAASampleCount())
+                    break;
+                if (samples > 1)
+                    ImGui::SameLine();
+                ImGui::RadioButton(samples == 1 ? "Off" : (std::to_string(samples) + "x").c_str(),
+                    &renderingSettings.msaaSamples, samples);
+            }
+            if (renderingSettings.msaaSamples > 1)
+            {
+                ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
+                ImGui::SliderFloat("Sample shading", &renderingSettings.minSampleShading, 0.f, 1.f);
+                ImGui::PopItemWidth();
+            }
+            ImGui::Checkbox("FXAA", &renderingSettings.fxaa);
+
             ImGui::Text("Clear Color");
             ImGui::ColorEdit3("##Clear Color", (float*)&clearColor);
         }
@@ -176,15 +260,15 @@ void RMResearchGUI::setupMainSettingsPanel()
         {
             ImGui::Dummy(ImVec2(40.0f, 0.0f)); ImGui::SameLine();
             if (ImGui::Button("Behind"))
-                sceneObjects.at(1).transform.translation = {0.0f, 0.0f, 2.0f};
+                sceneObjects.at(1).transform.setTranslation(glm::vec3{0.0f, 0.0f, 2.0f});
             if (ImGui::Button("Left"))
-                sceneObjects.at(1).transform.translation = {-2.0f, 0.0f, 0.0f}; ImGui::SameLine();
+                sceneObjects.at(1).transform.setTranslation(glm::vec3{-2.0f, 0.0f, 0.0f}); ImGui::SameLine();
             ImGui::Dummy(ImVec2(50.0f, 0.0f)); ImGui::SameLine();
             if (ImGui::Button("Right"))
-                sceneObjects.at(1).transform.translation = {2.0f, 0.0f, 0.0f};
+                sceneObjects.at(1).transform.setTranslation(glm::vec3{2.0f, 0.0f, 0.0f});
             ImGui::Dummy(ImVec2(40.0f, 0.0f)); ImGui::SameLine();
             if (ImGui::Button("Front"))
-                sceneObjects.at(1).transform.translation = {0.0f, 0.0f, -2.0f};
+                sceneObjects.at(1).transform.setTranslation(glm::vec3{0.0f, 0.0f, -2.0f});
         }
 
         // 3 collapsing header
@@ -225,36 +309,40 @@ void RMResearchGUI::enumerateObjectsInTheScene()
         }
 
         // Create "Inspect Object" window for chosed type of scene object
-        if (sceneObjects[pickedItemSceneObjectsList].pointLight != nullptr) {
-            inspectObject(sceneObjects[pickedItemSceneObjectsList], true);
-        }
-        else {
-            inspectObject(sceneObjects[pickedItemSceneObjectsList], false);
+        auto picked = sceneObjects.find(pickedItemSceneObjectsList);
+        if (picked != sceneObjects.end()) {
+            auto pointLight = sceneObjects.pointLights().find(picked->first);
+            inspectObject(picked->second,
+                pointLight != sceneObjects.pointLights().end() ? &pointLight->second : nullptr);
         }
     }
     ImGui::End();
 }
 
-void RMResearchGUI::inspectObject(SceneObject& object, bool isPointLight)
+void RMResearchGUI::inspectObject(SceneObject& object, PointLightComponent* pointLight)
 {
     ImGui::SetNextWindowPos(ImVec2{5, 510}, ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowSize(ImVec2{350, 315}, ImGuiCond_FirstUseEver);
 
     if (ImGui::Begin("Inspector")) {
         if (ImGui::CollapsingHeader("Transform Component", ImGuiTreeNodeFlags_DefaultOpen)) {
-            ImGui::DragFloat3("Position", glm::value_ptr(object.transform.translation), 0.02f);
-            ImGui::DragFloat3("Scale", glm::value_ptr(object.transform.scale), 0.02f);
-            ImGui::DragFloat3("Rotation", glm::value_ptr(object.transform.rotation), 0.02f);
+            // the cached world matrix is recomputed only for transforms marked dirty
+            bool transformChanged = ImGui::DragFloat3("Position", glm::value_ptr(object.transform.translation), 0.02f);
+            transformChanged |= ImGui::DragFloat3("Scale", glm::value_ptr(object.transform.scale), 0.02f);
+            transformChanged |= ImGui::DragFloat3("Rotation", glm::value_ptr(object.transform.rotation), 0.02f);
+            if (transformChanged)
+                object.transform.markDirty();
         }
 
         renderTransformGizmo(object.transform); // render object's gizmo along with its inspector tool
 
-        if (isPointLight) {
+        if (pointLight != nullptr) {
             if (ImGui::CollapsingHeader("PointLight Component", ImGuiTreeNodeFlags_DefaultOpen)) {
-                ImGui::SliderFloat("Light intensity", &object.pointLight->lightIntensity, .0f, 100.0f);
-                ImGui::SliderFloat("Light radius", &object.transform.scale.x, 0.01f, 5.0f);
+                ImGui::SliderFloat("Light intensity", &pointLight->lightIntensity, .0f, 100.0f);
+                if (ImGui::SliderFloat("Light radius", &object.transform.scale.x, 0.01f, 5.0f))
+                    object.transform.markDirty();
                 ImGui::ColorEdit3("Light color", (float*)&object.color);
-                ImGui::Checkbox("Demo Carousel Enabled", &object.pointLight->carouselEnabled);
+                ImGui::Checkbox("Demo Carousel Enabled", &pointLight->carouselEnabled);
             }
         }
     }
@@ -311,7 +399,7 @@ void RMResearchGUI::renderTransformGizmo(TransformComponent& transform)
 
     ImGuiIO& io = ImGui::GetIO();
     ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
-    ImGuizmo::Manipulate(glm::value_ptr(camera.getView()), glm::value_ptr(guizmoProj), currentGizmoOperation,
+    const bool manipulated = ImGuizmo::Manipulate(glm::value_ptr(camera.getView()), glm::value_ptr(guizmoProj), currentGizmoOperation,
         currentGizmoMode, glm::value_ptr(modelMat), glm::value_ptr(deltaMat), nullptr);
 
     /*if (transform.parent != nullptr) {
@@ -329,6 +417,8 @@ void RMResearchGUI::renderTransformGizmo(TransformComponent& transform)
 
     ImGuizmo::DecomposeMatrixToComponents(glm::value_ptr(modelMat), glm::value_ptr(transform.translation),
         glm::value_ptr(empty), glm::value_ptr(transform.scale));
+    if (manipulated)
+        transform.markDirty();
 
     // Преобразование градусов в радианы.
     // todo: поворот дёргается. нужен фикс
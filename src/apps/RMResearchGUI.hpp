@@ -2,10 +2,12 @@
 
 #include "../src/renderer/Device.hpp"
 #include "../src/renderer/Window.hpp"
-#include "../src/renderer/SceneObject.hpp"
+#include "../src/renderer/Scene.hpp"
 #include "../src/renderer/Camera.hpp"
 #include "./common/KeyboardMovementController.hpp"
 #include "../src/renderer/FrameInfo.hpp"
+#include "../src/renderer/ShaderWatcher.hpp"
+#include "../src/renderer/RenderGraph.hpp"
 
 // libs
 #include <imgui.h>
@@ -28,7 +30,7 @@ class RMResearchGUI {
 public:
     RMResearchGUI(WrpWindow& window, WrpDevice& device, VkRenderPass renderPass,
         uint32_t imageCount, WrpCamera& camera, KeyboardMovementController& kmc,
-        SceneObject::Map& sceneObjects, RenderingSettings& renderingSettings);
+        WrpScene& sceneObjects, RenderingSettings& renderingSettings);
     ~RMResearchGUI();
 
     RMResearchGUI() = default;
@@ -37,6 +39,14 @@ public:
     void newFrame();
     void setupGUI();
     void render(VkCommandBuffer commandBuffer);
+    // Must be called between frames after the swap chain render pass was recreated with another MSAA sample count
+    void setRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
+
+    // Shader hot-reload compilation errors (the last good pipelines keep rendering)
+    std::vector<ShaderReloadError> shaderErrors;
+    RenderStats renderStats{};
+    WrpRenderGraph::Stats renderGraphStats{};
+    int maxRecordingThreads = 1; // upper bound of the "Recording threads" slider
 
     // Fields controlled by tools
     float directionalLightIntensity = 0.0f;
@@ -52,9 +62,10 @@ public:
     glm::vec3 pointLightColor{1, 1, 1};
 
 private:
+    void initVulkanBackend(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
     void setupMainSettingsPanel();
     void enumerateObjectsInTheScene();
-    void inspectObject(SceneObject& object, bool isPointLight);
+    void inspectObject(SceneObject& object, PointLightComponent* pointLight);
     void renderTransformGizmo(TransformComponent& transform);
 
     int pickedItemSceneObjectsList = 1;
@@ -63,9 +74,10 @@ private:
     bool enableGizmo = true;
 
     WrpDevice& wrpDevice;
+    uint32_t imageCount;
     WrpCamera& camera;
     KeyboardMovementController& kmc;
-    SceneObject::Map& sceneObjects;
+    WrpScene& sceneObjects;
     RenderingSettings& renderingSettings;
 
     VkDescriptorPool descriptorPool; // ImGui's descriptor pool
@@ -4,8 +4,24 @@
 #include "../renderer/systems/SimpleRenderSystem.hpp"
 #include "../renderer/systems/TextureRenderSystem.hpp"
 #include "../renderer/systems/PointLightSystem.hpp"
+#include "../renderer/systems/DeferredLightingSystem.hpp"
+#include "../renderer/systems/UpscaleSystem.hpp"
 #include "../renderer/Buffer.hpp"
+#include "../renderer/InstanceBuffer.hpp"
+#include "../renderer/IndirectDrawBuffer.hpp"
+#include "../renderer/GpuCulling.hpp"
+#include "../renderer/CommandRecorder.hpp"
+#include "../renderer/TransformCache.hpp"
+#include "../renderer/LightClusters.hpp"
+#include "../renderer/OcclusionCulling.hpp"
+#include "../renderer/GBuffer.hpp"
+#include "../renderer/DynamicResolution.hpp"
+#include "../renderer/GpuTimer.hpp"
+#include "../renderer/RenderGraph.hpp"
 #include "../renderer/Camera.hpp"
+#include "../renderer/JobSystem.hpp"
+#include "../renderer/ShaderWatcher.hpp"
+#include "../renderer/Utils.hpp"
 #include "./common/KeyboardMovementController.hpp"
 
 // libs
@@ -19,25 +35,37 @@
 
 // std
 #include <stdexcept>
+#include <algorithm>
 #include <cassert>
 #include <array>
 #include <chrono>
+#include <iostream>
 #include <numeric>
+#include <random>
 
 #define MAX_FRAME_TIME 0.5f
 
-SceneEditorApp::SceneEditorApp(int preloadScene)
+SceneEditorApp::SceneEditorApp(int preloadScene, int benchmarkFrames, int recordingThreads, int benchmarkLights,
+    std::optional<HeadlessOptions> headless)
+    : headless{std::move(headless)},
+    wrpWindow{this->headless ? nullptr : std::make_unique<WrpWindow>(WIDTH, HEIGHT, "Vulkan Renderer")},
+    wrpDevice{wrpWindow.get()},
+    wrpRenderer{wrpWindow.get(), wrpDevice, VkExtent2D{WIDTH, HEIGHT}},
+    benchmarkFrames{benchmarkFrames}, recordingThreads{recordingThreads}, benchmarkLights{benchmarkLights}
 {
     // global descriptor pool designed for the entire app 
     globalPool = WrpDescriptorPool::Builder(wrpDevice)
         .setMaxSets(wrpRenderer.getSwapChainImageCount())
         .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, wrpRenderer.getSwapChainImageCount())
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * wrpRenderer.getSwapChainImageCount())
         .build();
 
     if (preloadScene == 1) {
         loadScene1();
     } else if (preloadScene == 2) {
         loadScene2();
+    } else if (preloadScene == BENCHMARK_SCENE) {
+        loadBenchmarkScene();
     }
 }
 
@@ -60,9 +88,42 @@ void SceneEditorApp::run()
         uboBuffers[i]->map();
     }
 
+    // Per-frame storage buffers with instance transforms (model and normal matrices)
+    WrpInstanceBuffer instanceBuffer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Per-frame indirect draw commands and per-draw material data for multi-draw indirect submission
+    WrpIndirectDrawBuffer indirectDrawBuffer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Compute frustum culling that fills the indirect draw buffers on the GPU (RenderingSettings::gpuCulling)
+    WrpGpuCulling gpuCulling{wrpDevice, wrpRenderer.getSwapChainImageCount(), instanceBuffer, indirectDrawBuffer};
+    // Per-thread command pools for recording scene draws into secondary command buffers in parallel
+    WrpCommandRecorder commandRecorder{wrpDevice, wrpRenderer, wrpRenderer.getSwapChainImageCount()};
+    // World matrices of scene objects, recomputed only for transforms changed since the previous frame
+    WrpTransformCache transformCache{};
+    // Per-frame point lights and their per-cluster lists for clustered forward shading
+    WrpLightClusters lightClusters{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Low-resolution software depth buffer of the largest occluders for CPU occlusion culling
+    WrpOcclusionCuller occlusionCuller{};
+    // Frame passes and their transient images: barriers and image memory are derived from declared reads and writes
+    WrpRenderGraph renderGraph{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+    // Surface attributes of the scene for the deferred shading path (RenderingSettings::deferredShading)
+    WrpGBuffer gBuffer{wrpDevice};
+    // Offscreen scene target whose resolution follows the measured GPU frame time (RenderingSettings::dynamicResolution),
+    // also used at full resolution as the FXAA input (RenderingSettings::fxaa)
+    WrpDynamicResolution dynamicResolution{wrpDevice, wrpRenderer.getSwapChainImageFormat(),
+        wrpRenderer.getSwapChainDepthFormat(), wrpRenderer.getMsaaSampleCount()};
+    // GPU frame time from timestamp queries, feeds the dynamic resolution controller;
+    // marks split it into the scene, post-process and GUI parts
+    WrpGpuTimer gpuTimer{wrpDevice, wrpRenderer.getSwapChainImageCount()};
+
     // Global Descriptor Set Layout for the entire app
     auto globalDescriptorSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
         .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS, 1)
+        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+        .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+        .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
+        .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1)
         .build();
 
     // Getting Descriptor Sets from pool
@@ -70,11 +131,27 @@ void SceneEditorApp::run()
     for (int i = 0; i < globalDescriptorSets.size(); ++i)
     {
         VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo(); // инфа о буфере для дескриптора
+        VkDescriptorBufferInfo instanceBufferInfo = instanceBuffer.descriptorInfo(i);
+        VkDescriptorBufferInfo drawDataBufferInfo = indirectDrawBuffer.drawDataDescriptorInfo(i);
+        VkDescriptorBufferInfo visibleInstancesInfo = instanceBuffer.visibleInstancesDescriptorInfo(i);
+        VkDescriptorBufferInfo drawRemapInfo = indirectDrawBuffer.drawRemapDescriptorInfo(i);
+        VkDescriptorBufferInfo pointLightsInfo = lightClusters.lightsDescriptorInfo(i);
+        VkDescriptorBufferInfo lightClustersInfo = lightClusters.clustersDescriptorInfo(i);
+        VkDescriptorBufferInfo lightIndicesInfo = lightClusters.lightIndicesDescriptorInfo(i);
 
         WrpDescriptorWriter(*globalDescriptorSetLayout, *globalPool)
             .writeBuffer(0, &bufferInfo)
+            .writeBuffer(1, &instanceBufferInfo)
+            .writeBuffer(2, &drawDataBufferInfo)
+            .writeBuffer(3, &visibleInstancesInfo)
+            .writeBuffer(4, &drawRemapInfo)
+            .writeBuffer(5, &pointLightsInfo)
+            .writeBuffer(6, &lightClustersInfo)
+            .writeBuffer(7, &lightIndicesInfo)
             .build(globalDescriptorSets[i]);
     }
+    // light buffers grow on demand, their descriptors are rewritten when a frame slot's buffers are recreated
+    std::vector<uint32_t> lightBufferGenerations(globalDescriptorSets.size(), 0);
 
     WrpCamera camera{};
     // default camera transform
@@ -84,47 +161,149 @@ void SceneEditorApp::run()
     // SceneObject for the editor camera 
     auto cameraObject = SceneObject::createSceneObject("Camera");
     cameraObject.transform.rotation = {.0f, .0f, .0f};
-    sceneObjects.emplace(cameraObject.getId(), std::move(cameraObject));
+    sceneObjects.add(std::move(cameraObject));
     KeyboardMovementController cameraController{};
+    if (benchmarkFrames > 0)
+    {
+        // fixed camera above the benchmark grid, so that runs are comparable
+        cameraObject.transform.translation = {0.f, -12.f, -10.f};
+        cameraObject.transform.rotation = {-.6f, 0.f, 0.f};
+    }
 
     RenderingSettings renderingSettings{1, 0};
-    FrameInfo frameInfo{0, 0, nullptr, camera, nullptr, sceneObjects, renderingSettings};
-
+    renderingSettings.msaaSamples = wrpRenderer.getMsaaSampleCount();
+    renderingSettings.minSampleShading = wrpRenderer.getMinSampleShading();
+    renderingSettings.recordingThreads = std::clamp(recordingThreads, 1, static_cast<int>(commandRecorder.getMaxThreads()));
+    RenderStats renderStats{};
+    FrameInfo frameInfo{0, 0, nullptr, camera, nullptr, sceneObjects, renderingSettings, renderStats, instanceBuffer,
+        indirectDrawBuffer, transformCache, lightClusters, occlusionCuller};
+
+    // Shader hot-reload: changed shaders are recompiled in background and pipelines are swapped at the frame boundary
+    WrpShaderWatcher shaderWatcher{};
+
+    // Системы ставят сборку своих пайплайнов в очередь WrpJobSystem и сразу возвращают управление,
+    // заранее собираются только варианты для текущих настроек, остальные - при первом использовании
+    auto startupBegin = std::chrono::high_resolution_clock::now();
+    bool firstFrameRendered = false;
     SimpleRenderSystem simpleRenderSystem{
         wrpDevice,
         wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer.getRenderPass()
     };
     TextureRenderSystem textureRenderSystem{
         wrpDevice,
         wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer.getRenderPass(),
         frameInfo
     };
     PointLightSystem pointLightSystem{
         wrpDevice,
-        wrpRenderer.getSwapChainRenderPass(),
+        wrpRenderer,
         globalDescriptorSetLayout->getDescriptorSetLayout()
     };
+    DeferredLightingSystem deferredLightingSystem{
+        wrpDevice,
+        wrpRenderer,
+        globalDescriptorSetLayout->getDescriptorSetLayout(),
+        gBuffer
+    };
+    UpscaleSystem upscaleSystem{
+        wrpDevice,
+        wrpRenderer,
+        dynamicResolution
+    };
+    simpleRenderSystem.prefetchPipelines(renderingSettings);
+    textureRenderSystem.prefetchPipelines(renderingSettings);
+    deferredLightingSystem.prefetchPipelines(renderingSettings);
+    upscaleSystem.prefetchPipelines(renderingSettings);
 
     SceneEditorGUI appGUI{
-        wrpWindow,
+        wrpWindow.get(),
         wrpDevice,
         wrpRenderer.getSwapChainRenderPass(),
         wrpRenderer.getSwapChainImageCount(),
         camera,
         cameraController,
         sceneObjects,
+        transformCache,
         renderingSettings
     };
+    appGUI.maxRecordingThreads = static_cast<int>(commandRecorder.getMaxThreads());
 
     auto currentTime = std::chrono::high_resolution_clock::now();
 
-    // MAIN LOOP
-    while (!wrpWindow.shouldClose())
+    // Benchmark mode accumulates per-frame stats over benchmarkFrames frames of the forward path,
+    // then repeats them with deferred shading and exits. With recordingThreads == 0 both paths are measured
+    // for 1, 2, 4, ... and the maximum number of recording threads, with instancing and without it (a draw per object,
+    // so that recording has real work to split), and a summary of recording times is printed
+    struct BenchmarkPhase
+    {
+        bool instancing;
+        bool deferredShading;
+        int recordingThreads;
+        double recordTimeMs = 0.0; // per frame, filled when the phase ends
+    };
+    std::vector<BenchmarkPhase> benchmarkPhases;
+    {
+        const int maxThreads = static_cast<int>(commandRecorder.getMaxThreads());
+        std::vector<int> threadCounts{renderingSettings.recordingThreads};
+        if (recordingThreads == 0)
+        {
+            threadCounts.clear();
+            for (int threads = 1; threads < maxThreads; threads *= 2)
+                threadCounts.push_back(threads);
+            threadCounts.push_back(maxThreads);
+        }
+        for (int threads : threadCounts)
+        {
+            benchmarkPhases.push_back({true, false, threads});
+            benchmarkPhases.push_back({true, true, threads});
+            if (recordingThreads == 0)
+            {
+                benchmarkPhases.push_back({false, false, threads});
+                benchmarkPhases.push_back({false, true, threads});
+            }
+        }
+    }
+    size_t benchmarkPhase = 0;
+    if (benchmarkFrames > 0)
     {
-        glfwPollEvents(); // Process glfw events from queue
+        renderingSettings.instancing = benchmarkPhases[0].instancing;
+        renderingSettings.recordingThreads = benchmarkPhases[0].recordingThreads;
+    }
+    int benchmarkFramesRendered = 0;
+    double benchmarkRecordTimeMs = 0.0;
+    uint64_t benchmarkDrawCalls = 0;
+    uint64_t benchmarkInstances = 0;
+    auto benchmarkBegin = currentTime;
+    bool benchmarkWarmupFrame = false; // set when switching phases, the first deferred frame builds its pipelines
+    auto printBenchmark = [&]() {
+        float totalMs = std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - benchmarkBegin).count();
+        std::cout << "[Benchmark] " << (renderingSettings.deferredShading ? "deferred" : "forward") << " shading, "
+            << (renderingSettings.instancing ? "instanced" : "not instanced") << ", "
+            << sceneObjects.size() << " scene objects, " << lightClusters.getLightCount() << " point lights, "
+            << benchmarkFramesRendered << " frames\n"
+            << "[Benchmark] frame time: " << totalMs / benchmarkFramesRendered << " ms\n"
+            << "[Benchmark] CPU recording time: " << benchmarkRecordTimeMs / benchmarkFramesRendered << " ms/frame ("
+            << renderingSettings.recordingThreads << " recording threads)\n"
+            << "[Benchmark] draw calls: " << benchmarkDrawCalls / benchmarkFramesRendered << " per frame, "
+            << benchmarkInstances / benchmarkFramesRendered << " instances per frame" << std::endl;
+    };
+
+    // Headless mode renders a fixed number of frames (or until the benchmark breaks out of the loop)
+    int framesRendered = 0;
+    auto keepRunning = [&]() {
+        if (wrpWindow)
+            return !wrpWindow->shouldClose();
+        return headless->frames <= 0 || framesRendered < headless->frames;
+    };
 
+    // MAIN LOOP
+    while (keepRunning())
+    {
         // calculating frameTime and currentTime 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -133,8 +312,17 @@ void SceneEditorApp::run()
         // Max frame time bound. For example, frameTime can become too long when window are in resizing mode.
         frameTime = glm::min(frameTime, MAX_FRAME_TIME);
 
-        // Move/rotate camera corresponding to the input
-        cameraController.moveInPlaneXZ(wrpWindow.getGLFWwindow(), frameTime, cameraObject);
+        if (wrpWindow)
+        {
+            glfwPollEvents(); // Process glfw events from queue
+            // Move/rotate camera corresponding to the input
+            cameraController.moveInPlaneXZ(wrpWindow->getGLFWwindow(), frameTime, cameraObject);
+        }
+        else
+        {
+            // a fixed time step keeps headless runs reproducible
+            frameTime = 1.f / 60.f;
+        }
         camera.setViewYXZ(cameraObject.transform.translation, cameraObject.transform.rotation);
 
         float aspect = wrpRenderer.getAspectRatio();
@@ -142,13 +330,68 @@ void SceneEditorApp::run()
         camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
         // frame rendering
+        auto changedShaders = shaderWatcher.pollChangedShaders();
+        if (!changedShaders.empty())
+        {
+            simpleRenderSystem.reloadShaders(shaderWatcher, changedShaders);
+            textureRenderSystem.reloadShaders(shaderWatcher, changedShaders);
+            pointLightSystem.reloadShaders(shaderWatcher, changedShaders);
+            deferredLightingSystem.reloadShaders(shaderWatcher, changedShaders);
+            upscaleSystem.reloadShaders(shaderWatcher, changedShaders);
+        }
+
+        // a new MSAA sample count recreates the swap chain render pass, the scene target and the GUI pipeline
+        // between frames; pipeline variants of the systems are keyed by the sample count and follow by themselves
+        if (wrpRenderer.setMultisampling(static_cast<VkSampleCountFlagBits>(renderingSettings.msaaSamples),
+            renderingSettings.minSampleShading))
+        {
+            dynamicResolution.setSampleCount(wrpRenderer.getMsaaSampleCount());
+            appGUI.setRenderPass(wrpRenderer.getSwapChainRenderPass(), wrpRenderer.getMsaaSampleCount());
+        }
+
         if (auto commandBuffer = wrpRenderer.beginFrame()) // beginFrame() will return nullptr if SwapChain recreation is needed
         {
+            appGUI.shaderErrors = shaderWatcher.getErrors();
             appGUI.newFrame(); // tell imgui that we're starting a new frame
 
             int frameIndex = wrpRenderer.getFrameIndex();
             FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera,
-                globalDescriptorSets[frameIndex], sceneObjects, renderingSettings};
+                globalDescriptorSets[frameIndex], sceneObjects, renderingSettings, renderStats, instanceBuffer,
+                indirectDrawBuffer, transformCache, lightClusters, occlusionCuller};
+            renderStats = {};
+            // the frame slot's fence has been waited on, so GPU culling results of its previous use are readable
+            gpuCulling.collectResults(frameIndex, renderStats);
+            const float gpuFrameMs = gpuTimer.collectResults(frameIndex);
+            renderStats.gpuFrameMs = std::max(gpuFrameMs, 0.f);
+            // intervals between the marks below: scene, post-process, GUI
+            if (gpuTimer.getIntervalsMs().size() == 3)
+            {
+                renderStats.gpuSceneMs = gpuTimer.getIntervalsMs()[0];
+                renderStats.gpuPostProcessMs = gpuTimer.getIntervalsMs()[1];
+            }
+            gpuTimer.begin(commandBuffer, frameIndex);
+            instanceBuffer.beginFrame(frameIndex, renderingSettings.gpuCulling);
+            indirectDrawBuffer.beginFrame(frameIndex, renderingSettings.gpuCulling);
+            commandRecorder.beginFrame(frameIndex);
+            // the graph is described anew every frame, its images follow the swap chain extent
+            // (the swap chain may have been recreated in beginFrame)
+            renderGraph.beginFrame(frameIndex);
+            if (renderingSettings.deferredShading)
+                gBuffer.declareAttachments(renderGraph, wrpRenderer.getSwapChainExtent());
+            // with dynamic resolution the scene is rendered into the top left part of the offscreen target,
+            // with FXAA alone - into the whole target
+            const bool useSceneTarget = renderingSettings.dynamicResolution || renderingSettings.fxaa;
+            if (useSceneTarget)
+            {
+                dynamicResolution.declareAttachments(renderGraph, wrpRenderer.getSwapChainExtent());
+                dynamicResolution.update(gpuFrameMs, renderingSettings);
+                frameInfo.renderExtent = dynamicResolution.getRenderExtent();
+                renderStats.resolutionScale = dynamicResolution.getScale();
+            }
+            else
+            {
+                frameInfo.renderExtent = wrpRenderer.getSwapChainExtent();
+            }
 
             // UPDATE SECTION
             GlobalUbo ubo{};
@@ -161,26 +404,223 @@ void SceneEditorApp::run()
             ubo.roughness = appGUI.roughness;
             ubo.indexOfRefraction = appGUI.indexOfRefraction;
             pointLightSystem.update(frameInfo, ubo);
+            // the global set of this frame slot is not bound yet, so it can still be updated
+            if (lightBufferGenerations[frameIndex] != lightClusters.getBufferGeneration(frameIndex))
+            {
+                VkDescriptorBufferInfo pointLightsInfo = lightClusters.lightsDescriptorInfo(frameIndex);
+                VkDescriptorBufferInfo lightIndicesInfo = lightClusters.lightIndicesDescriptorInfo(frameIndex);
+                WrpDescriptorWriter(*globalDescriptorSetLayout, *globalPool)
+                    .writeBuffer(5, &pointLightsInfo)
+                    .writeBuffer(7, &lightIndicesInfo)
+                    .overwrite(globalDescriptorSets[frameIndex]);
+                lightBufferGenerations[frameIndex] = lightClusters.getBufferGeneration(frameIndex);
+            }
             uboBuffers[frameIndex]->writeToBuffer(&ubo);
             uboBuffers[frameIndex]->flush();
+            transformCache.update(sceneObjects);
+            renderStats.transformsUpdated = transformCache.getUpdatedCount();
+            // the occlusion buffer is only used by CPU culling, the systems test objects against it in prepareSceneObjects
+            if (renderingSettings.occlusionCulling && !renderingSettings.gpuCulling)
+                occlusionCuller.rasterizeOccluders(camera, sceneObjects, transformCache, renderStats);
+            else
+                occlusionCuller.disable();
 
             // RENDER SECTION
-            wrpRenderer.beginSwapChainRenderPass(commandBuffer, appGUI.clearColor);
-
-            // Order of objects render is matter, because we need to ensure that we rendered
+            // Culling and indirect commands are prepared before the render pass, since compute dispatches can't be recorded inside it
+            auto recordBegin = std::chrono::high_resolution_clock::now();
+            simpleRenderSystem.prepareSceneObjects(frameInfo);
+            textureRenderSystem.prepareSceneObjects(frameInfo);
+            if (renderingSettings.gpuCulling)
+                gpuCulling.dispatch(commandBuffer, frameIndex, camera, renderingSettings.verifyGpuCulling);
+
+            // With several recording threads the whole render pass is recorded into secondary command buffers
+            const bool parallelRecording = renderingSettings.recordingThreads > 1;
+            const VkSubpassContents subpassContents =
+                parallelRecording ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+            // Opaque scene objects, recorded inline or into secondary buffers of the current render pass
+            auto renderSceneObjects = [&]() {
+                std::vector<VkCommandBuffer> sceneCommandBuffers;
+                if (parallelRecording)
+                {
+                    sceneCommandBuffers = simpleRenderSystem.renderSceneObjects(frameInfo, commandRecorder);
+                    auto textureCommandBuffers = textureRenderSystem.renderSceneObjects(frameInfo, commandRecorder);
+                    sceneCommandBuffers.insert(sceneCommandBuffers.end(),
+                        textureCommandBuffers.begin(), textureCommandBuffers.end());
+                }
+                else
+                {
+                    simpleRenderSystem.renderSceneObjects(frameInfo);
+                    textureRenderSystem.renderSceneObjects(frameInfo);
+                }
+                return sceneCommandBuffers;
+            };
+
+            std::vector<VkCommandBuffer> secondaryCommandBuffers;
+            // ends the main thread's secondary buffer of the current render pass and executes all of its secondary buffers
+            auto executeSecondaryCommandBuffers = [&]() {
+                if (!parallelRecording)
+                    return;
+                commandRecorder.endSecondary(frameInfo.commandBuffer);
+                secondaryCommandBuffers.push_back(frameInfo.commandBuffer);
+                // the primary buffer executes secondary buffers in the order they were returned
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                    secondaryCommandBuffers.data());
+                secondaryCommandBuffers.clear();
+            };
+            // Scene draws of the current render pass: opaque objects, or the deferred light pass over the G-buffer,
+            // then point lights. Order of objects render is matter, because we need to ensure that we rendered
             // fully opaque objects (like textured models) before rendering translucent objects (like point lights)
-            simpleRenderSystem.renderSceneObjects(frameInfo);
-            textureRenderSystem.renderSceneObjects(frameInfo);
-            pointLightSystem.render(frameInfo);
-            appGUI.setupGUI();
-            appGUI.render(commandBuffer);
+            auto renderScene = [&]() {
+                if (!renderingSettings.deferredShading)
+                    secondaryCommandBuffers = renderSceneObjects();
+                // point lights and GUI are recorded on the main thread into one more secondary buffer
+                if (parallelRecording)
+                    frameInfo.commandBuffer = commandRecorder.beginSecondary();
+                if (renderingSettings.deferredShading)
+                    deferredLightingSystem.render(frameInfo);
+                pointLightSystem.render(frameInfo);
+            };
+
+            // The passes below are recorded by renderGraph.execute in the order they are added,
+            // with the layout transitions and barriers between them derived from their reads and writes.
+            // Deferred shading: the scene is rendered into the G-buffer first, and the light pass replaces the scene draws
+            if (renderingSettings.deferredShading)
+            {
+                auto gBufferPass = renderGraph.addPass("G-buffer", [&](VkCommandBuffer passCommandBuffer) {
+                    gBuffer.beginRenderPass(passCommandBuffer, frameInfo.renderExtent, subpassContents);
+                    commandRecorder.setRenderPass(gBuffer.getRenderPass(), gBuffer.getFramebuffer(), frameInfo.renderExtent);
+                    auto gBufferCommandBuffers = renderSceneObjects();
+                    if (!gBufferCommandBuffers.empty())
+                        vkCmdExecuteCommands(passCommandBuffer, static_cast<uint32_t>(gBufferCommandBuffers.size()),
+                            gBufferCommandBuffers.data());
+                    commandRecorder.setRenderPass(VK_NULL_HANDLE, VK_NULL_HANDLE, {});
+                    gBuffer.endRenderPass(passCommandBuffer);
+                });
+                gBuffer.writeAttachments(gBufferPass);
+            }
 
-            wrpRenderer.endSwapChainRenderPass(commandBuffer);
+            // Dynamic resolution or FXAA: the scene goes into the offscreen target, and the swap chain render pass
+            // only upscales/antialiases it and draws the GUI at full resolution
+            if (useSceneTarget)
+            {
+                auto scenePass = renderGraph.addPass("Scene", [&](VkCommandBuffer passCommandBuffer) {
+                    dynamicResolution.beginRenderPass(passCommandBuffer, appGUI.clearColor, subpassContents);
+                    commandRecorder.setRenderPass(dynamicResolution.getRenderPass(), dynamicResolution.getFramebuffer(),
+                        frameInfo.renderExtent);
+                    renderScene();
+                    executeSecondaryCommandBuffers();
+                    dynamicResolution.endRenderPass(passCommandBuffer);
+                    gpuTimer.mark(passCommandBuffer, frameIndex);
+                    commandRecorder.setRenderPass(VK_NULL_HANDLE, VK_NULL_HANDLE, {});
+                });
+                dynamicResolution.writeAttachments(scenePass);
+                if (renderingSettings.deferredShading)
+                    gBuffer.readAttachments(scenePass);
+            }
+
+            // The swap chain image is presented, so this pass is never culled
+            auto swapChainPass = renderGraph.addPass("Swap chain", [&](VkCommandBuffer passCommandBuffer) {
+                wrpRenderer.beginSwapChainRenderPass(passCommandBuffer, appGUI.clearColor, subpassContents);
+                if (useSceneTarget)
+                {
+                    if (parallelRecording)
+                        frameInfo.commandBuffer = commandRecorder.beginSecondary();
+                    upscaleSystem.render(frameInfo);
+                }
+                else
+                {
+                    renderScene();
+                    // the main thread's buffer is executed after the scene buffers, so the mark follows the scene draws
+                    gpuTimer.mark(frameInfo.commandBuffer, frameIndex);
+                }
+                gpuTimer.mark(frameInfo.commandBuffer, frameIndex);
+                renderStats.recordTimeMs = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - recordBegin).count();
+                appGUI.renderStats = renderStats;
+                appGUI.renderGraphStats = renderGraph.getStats();
+                appGUI.setupGUI();
+                appGUI.render(frameInfo.commandBuffer);
+
+                executeSecondaryCommandBuffers();
+
+                wrpRenderer.endSwapChainRenderPass(passCommandBuffer);
+            });
+            swapChainPass.setSideEffect();
+            if (useSceneTarget)
+                dynamicResolution.readSceneColor(swapChainPass);
+            else if (renderingSettings.deferredShading)
+                gBuffer.readAttachments(swapChainPass);
+
+            renderGraph.execute(commandBuffer);
+            gpuTimer.end(commandBuffer, frameIndex);
             wrpRenderer.endFrame();
+            framesRendered++;
+
+            if (!firstFrameRendered)
+            {
+                firstFrameRendered = true;
+                std::cout << "First frame recorded in " << std::chrono::duration<float, std::chrono::milliseconds::period>(
+                    std::chrono::high_resolution_clock::now() - startupBegin).count() << " ms after render systems creation ("
+                    << WrpJobSystem::instance().getWorkerCount() << " worker threads)" << std::endl;
+                benchmarkBegin = std::chrono::high_resolution_clock::now();
+            }
+            else if (benchmarkWarmupFrame)
+            {
+                benchmarkWarmupFrame = false;
+                benchmarkBegin = std::chrono::high_resolution_clock::now();
+            }
+            else if (benchmarkFrames > 0)
+            {
+                // the first frame is skipped, it includes pipelines creation
+                benchmarkRecordTimeMs += renderStats.recordTimeMs;
+                benchmarkDrawCalls += renderStats.drawCalls;
+                benchmarkInstances += renderStats.instances;
+                if (++benchmarkFramesRendered == benchmarkFrames)
+                {
+                    printBenchmark();
+                    benchmarkPhases[benchmarkPhase].recordTimeMs = benchmarkRecordTimeMs / benchmarkFramesRendered;
+                    if (++benchmarkPhase == benchmarkPhases.size())
+                    {
+                        if (recordingThreads == 0)
+                        {
+                            std::cout << "[Benchmark] CPU recording time by recording threads, ms/frame "
+                                "(instanced forward / deferred, not instanced forward / deferred):\n";
+                            for (size_t i = 0; i + 3 < benchmarkPhases.size(); i += 4)
+                            {
+                                std::cout << "[Benchmark]   " << benchmarkPhases[i].recordingThreads << ": "
+                                    << benchmarkPhases[i].recordTimeMs << " / " << benchmarkPhases[i + 1].recordTimeMs << ", "
+                                    << benchmarkPhases[i + 2].recordTimeMs << " / " << benchmarkPhases[i + 3].recordTimeMs
+                                    << "\n";
+                            }
+                            std::cout << std::flush;
+                        }
+                        break;
+                    }
+                    // the same frames with the next shading path, instancing mode or number of recording threads
+                    renderingSettings.instancing = benchmarkPhases[benchmarkPhase].instancing;
+                    renderingSettings.deferredShading = benchmarkPhases[benchmarkPhase].deferredShading;
+                    renderingSettings.recordingThreads = benchmarkPhases[benchmarkPhase].recordingThreads;
+                    benchmarkWarmupFrame = true;
+                    benchmarkFramesRendered = 0;
+                    benchmarkRecordTimeMs = 0.0;
+                    benchmarkDrawCalls = 0;
+                    benchmarkInstances = 0;
+                }
+            }
         }
     }
 
     vkDeviceWaitIdle(wrpDevice.device());
+
+    if (headless && !headless->outputPath.empty())
+    {
+        std::vector<uint8_t> pixels;
+        wrpRenderer.readLastFrame(pixels);
+        const VkExtent2D extent = wrpRenderer.getSwapChainExtent();
+        writeImageFile(headless->outputPath, extent.width, extent.height, pixels);
+        std::cout << "Headless: " << framesRendered << " frames rendered, the last one is saved to "
+            << headless->outputPath << std::endl;
+    }
 }
 
 void SceneEditorApp::loadScene1()
@@ -189,31 +629,28 @@ void SceneEditorApp::loadScene1()
     std::shared_ptr<WrpModel> vikingRoom = WrpModel::createModelFromObjTexture(
         wrpDevice, ENGINE_DIR"models/viking_room.obj", MODELS_DIR"textures/viking_room.png");
     auto vikingRoomObj = SceneObject::createSceneObject("VikingRoom");
-    vikingRoomObj.model = vikingRoom;
     vikingRoomObj.transform.translation = {.0f, .0f, 0.f};
     vikingRoomObj.transform.scale = glm::vec3(1.f, 1.f, 1.f);
     vikingRoomObj.transform.rotation = glm::vec3(1.57f, 2.f, 0.f);
-    sceneObjects.emplace(vikingRoomObj.getId(), std::move(vikingRoomObj));
+    sceneObjects.add(std::move(vikingRoomObj), vikingRoom);
 
     // Sponza model
     std::shared_ptr<WrpModel> sponza = WrpModel::createModelFromObjMtl(wrpDevice, "../../../models/sponza.obj");
     auto sponzaObj = SceneObject::createSceneObject("Sponza");
-    sponzaObj.model = sponza;
     sponzaObj.transform.translation = {-3.f, 1.0f, -2.f};
     sponzaObj.transform.scale = glm::vec3(0.01f, 0.01f, 0.01f);
     sponzaObj.transform.rotation = glm::vec3(3.15f, 0.f, 0.f);
-    sceneObjects.emplace(sponzaObj.getId(), std::move(sponzaObj));
+    sceneObjects.add(std::move(sponzaObj), sponza);
 }
 
 void SceneEditorApp::loadScene2()
 {
     std::shared_ptr<WrpModel> bunny = WrpModel::createModelFromObjMtl(wrpDevice, "../../../models/bunny.obj");
     auto bunnyObj = SceneObject::createSceneObject();
-    bunnyObj.model = bunny;
     bunnyObj.transform.translation = {0.f, 0.f, 0.f};
     bunnyObj.transform.scale = glm::vec3(0.4f, 0.4f, 0.4f);
     bunnyObj.transform.rotation = glm::vec3(3.15f, 0.f, 0.f);
-    sceneObjects.emplace(bunnyObj.getId(), std::move(bunnyObj));
+    sceneObjects.add(std::move(bunnyObj), bunny);
 
     const int gridX = 5;
     const int gridY = 5;
@@ -227,20 +664,66 @@ void SceneEditorApp::loadScene2()
         {
             if (count == modelsToPlacePointLight)
             {
-                auto pointLight = SceneObject::makePointLight();
-                pointLight.pointLight->carouselEnabled = true;
-                pointLight.transform.translation = {i, -1.5f, j};
-                sceneObjects.emplace(pointLight.getId(), std::move(pointLight));
+                const SceneObject::id_t pointLightId = sceneObjects.addPointLight();
+                sceneObjects.pointLights().at(pointLightId).carouselEnabled = true;
+                sceneObjects.at(pointLightId).transform.translation = {i, -1.5f, j};
                 count = 0;
             }
             bunnyObj = SceneObject::createSceneObject();
-            bunnyObj.model = bunny;
             bunnyObj.transform.translation = {i, 0.f, j};
             bunnyObj.transform.scale = glm::vec3(0.4f, 0.4f, 0.4f);
             bunnyObj.transform.rotation = glm::vec3(3.15f, 0.f, 0.f);
-            sceneObjects.emplace(bunnyObj.getId(), std::move(bunnyObj));
+            sceneObjects.add(std::move(bunnyObj), bunny);
 
             ++count;
         }
     }
 }
+
+// Grid of 100x100 instances of the same model to measure draw calls and CPU recording time (--benchmark).
+// With instancing the grid is a few draws split into instance ranges per recording thread,
+// without it (RenderingSettings::instancing) every bunny is a draw of its own
+void SceneEditorApp::loadBenchmarkScene()
+{
+    std::shared_ptr<WrpModel> bunny = WrpModel::createModelFromObjMtl(wrpDevice, "../../../models/bunny.obj");
+
+    const int gridX = 100;
+    const int gridZ = 100;
+    const float spacing = .6f;
+    for (int i = 0; i < gridX; i++)
+    {
+        // every row is a parent node, so moving it moves the whole row; culling does not depend on the
+        // hierarchy, the BVH over per-object world bounds rejects the bunnies outside the view
+        auto rowObj = SceneObject::createSceneObject("Row");
+        rowObj.transform.translation = {(i - gridX / 2) * spacing, 0.f, 0.f};
+        rowObj.transform.scale = glm::vec3(1.f, 1.f, 1.f);
+        rowObj.transform.rotation = glm::vec3(0.f, 0.f, 0.f);
+        const SceneObject::id_t rowId = rowObj.getId();
+        sceneObjects.add(std::move(rowObj));
+
+        for (int j = 0; j < gridZ; j++)
+        {
+            auto bunnyObj = SceneObject::createSceneObject();
+            bunnyObj.setParent(rowId);
+            bunnyObj.transform.translation = {0.f, 0.f, j * spacing};
+            bunnyObj.transform.scale = glm::vec3(0.2f, 0.2f, 0.2f);
+            bunnyObj.transform.rotation = glm::vec3(3.15f, 0.f, 0.f);
+            sceneObjects.add(std::move(bunnyObj), bunny);
+        }
+    }
+
+    const SceneObject::id_t pointLightId = sceneObjects.addPointLight(30.f);
+    sceneObjects.at(pointLightId).transform.translation = {0.f, -5.f, gridZ * spacing / 2};
+
+    // small colored lights just above the grid (--benchmark [frames] [threads] [point lights]),
+    // fixed seed so that forward and deferred runs and repeated runs see the same scene
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> unit{0.f, 1.f};
+    for (int i = 0; i < benchmarkLights; i++)
+    {
+        const glm::vec3 color{.3f + .7f * unit(random), .3f + .7f * unit(random), .3f + .7f * unit(random)};
+        const SceneObject::id_t lightId = sceneObjects.addPointLight(.5f + 1.5f * unit(random), .05f, color);
+        sceneObjects.at(lightId).transform.translation = {
+            (unit(random) - .5f) * gridX * spacing, -.3f - .5f * unit(random), unit(random) * gridZ * spacing};
+    }
+}
@@ -4,10 +4,12 @@
 #include "../renderer/Device.hpp"
 #include "../renderer/Renderer.hpp"
 #include "../renderer/Descriptors.hpp"
-#include "../renderer/SceneObject.hpp"
+#include "../renderer/Scene.hpp"
 
 // std
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 class SceneEditorApp
@@ -16,7 +18,18 @@ public:
     static constexpr int WIDTH = 1600;
     static constexpr int HEIGHT = 1000;
 
-    SceneEditorApp(int preloadScene = 0);
+    static constexpr int BENCHMARK_SCENE = 3;
+
+    // Rendering without a window or surface (CI, benchmarks on machines without a display): WIDTH x HEIGHT frames go
+    // into offscreen images, the GUI is disabled and the camera stays where the scene put it
+    struct HeadlessOptions
+    {
+        int frames = 0;         // frames to render, 0 - until the benchmark finishes
+        std::string outputPath; // the last frame is saved here (PNG for *.png, raw RGBA8 otherwise), empty - not saved
+    };
+
+    SceneEditorApp(int preloadScene = 0, int benchmarkFrames = 0, int recordingThreads = 1, int benchmarkLights = 0,
+        std::optional<HeadlessOptions> headless = std::nullopt);
     ~SceneEditorApp();
 
     // RAII
@@ -28,12 +41,19 @@ public:
 private:
     void loadScene1();
     void loadScene2();
+    void loadBenchmarkScene();
+
+    std::optional<HeadlessOptions> headless;
 
     // Fields are initializing from top to bottom and destroying from bottom to top
-    WrpWindow wrpWindow{ WIDTH, HEIGHT, "Vulkan Renderer" };
-    WrpDevice wrpDevice{ wrpWindow };
-    WrpRenderer wrpRenderer{ wrpWindow, wrpDevice };
+    std::unique_ptr<WrpWindow> wrpWindow; // nullptr in headless mode
+    WrpDevice wrpDevice;
+    WrpRenderer wrpRenderer;
 
     std::unique_ptr<WrpDescriptorPool> globalPool{};
-    SceneObject::Map sceneObjects;
+    WrpScene sceneObjects;
+
+    int benchmarkFrames = 0; // > 0 - run this many frames, print stats and exit
+    int recordingThreads = 1; // initial RenderingSettings::recordingThreads, 0 - the benchmark sweeps thread counts
+    int benchmarkLights = 0; // extra point lights scattered over the benchmark grid
 };
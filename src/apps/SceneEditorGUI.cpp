@@ -2,6 +2,7 @@
 
 #include "../src/renderer/Device.hpp"
 #include "../src/renderer/Window.hpp"
+#include "../src/renderer/SpirvCache.hpp"
 
 // libs
 #include <imgui.h>
@@ -18,12 +19,15 @@
 #include <filesystem>
 
 SceneEditorGUI::SceneEditorGUI(
-    WrpWindow& window, WrpDevice& device, VkRenderPass renderPass,
+    WrpWindow* window, WrpDevice& device, VkRenderPass renderPass,
     uint32_t imageCount, WrpCamera& camera, KeyboardMovementController& kmc,
-    SceneObject::Map& sceneObjects, RenderingSettings& renderingSettings)
-    : wrpDevice{device}, camera{camera}, kmc{kmc}, sceneObjects{sceneObjects},
-    renderingSettings{renderingSettings}
+    WrpScene& sceneObjects, WrpTransformCache& transformCache, RenderingSettings& renderingSettings)
+    : wrpDevice{device}, imageCount{imageCount}, camera{camera}, kmc{kmc}, sceneObjects{sceneObjects}, transformCache{transformCache},
+    renderingSettings{renderingSettings}, enabled{window != nullptr}
 {
+    if (!enabled)
+        return;
+
     VkInstance instance = device.getInstance();
     // custom vulkan function loader to support volk library
     ImGui_ImplVulkan_LoadFunctions([](const char* functionName, void* vulkanInstance) {
@@ -69,27 +73,45 @@ SceneEditorGUI::SceneEditorGUI(
 
     // Setup Platform/Renderer backends
     // Initialize imgui for vulkan
-    ImGui_ImplGlfw_InitForVulkan(window.getGLFWwindow(), true);
+    ImGui_ImplGlfw_InitForVulkan(window->getGLFWwindow(), true);
+    initVulkanBackend(renderPass, static_cast<VkSampleCountFlagBits>(renderingSettings.msaaSamples));
+}
+
+void SceneEditorGUI::initVulkanBackend(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+{
     ImGui_ImplVulkan_InitInfo init_info = {};
-    init_info.Instance = device.getInstance();
-    init_info.PhysicalDevice = device.getPhysicalDevice();
-    init_info.Device = device.device();
-    init_info.QueueFamily = device.getGraphicsQueueFamily();
-    init_info.Queue = device.graphicsQueue();
+    init_info.Instance = wrpDevice.getInstance();
+    init_info.PhysicalDevice = wrpDevice.getPhysicalDevice();
+    init_info.Device = wrpDevice.device();
+    init_info.QueueFamily = wrpDevice.getGraphicsQueueFamily();
+    init_info.Queue = wrpDevice.graphicsQueue();
     init_info.DescriptorPool = descriptorPool;
     init_info.RenderPass = renderPass;
     init_info.MinImageCount = 2;
     init_info.ImageCount = imageCount;
-    init_info.MSAASamples = wrpDevice.getMaxUsableMSAASampleCount();
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.MSAASamples = msaaSamples;
+    init_info.PipelineCache = wrpDevice.getPipelineCache();
     init_info.Allocator = VK_NULL_HANDLE;
     init_info.CheckVkResultFn = check_vk_result;
     ImGui_ImplVulkan_Init(&init_info);
     ImGui_ImplVulkan_CreateFontsTexture();
 }
 
+void SceneEditorGUI::setRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+{
+    if (!enabled)
+        return;
+
+    // the backend's pipeline is created for a fixed sample count, so it is rebuilt along with the font texture
+    ImGui_ImplVulkan_Shutdown();
+    initVulkanBackend(renderPass, msaaSamples);
+}
+
 SceneEditorGUI::~SceneEditorGUI()
 {
+    if (!enabled)
+        return;
+
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -98,6 +120,9 @@ SceneEditorGUI::~SceneEditorGUI()
 
 void SceneEditorGUI::newFrame()
 {
+    if (!enabled)
+        return;
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -108,6 +133,9 @@ void SceneEditorGUI::newFrame()
 // command buffer the necessary draw commands
 void SceneEditorGUI::render(VkCommandBuffer commandBuffer)
 {
+    if (!enabled)
+        return;
+
     ImGui::Render();
     ImDrawData* drawdata = ImGui::GetDrawData();
     ImGui_ImplVulkan_RenderDrawData(drawdata, commandBuffer);
@@ -115,6 +143,9 @@ void SceneEditorGUI::render(VkCommandBuffer commandBuffer)
 
 void SceneEditorGUI::setupGUI()
 {
+    if (!enabled)
+        return;
+
     // this function may include DockSpace layout creation in the future
     setupAllWindows();
 }
@@ -125,10 +156,33 @@ void SceneEditorGUI::setupAllWindows()
     if (showImGuiDemoWindow) { ImGui::ShowDemoWindow(&showImGuiDemoWindow); }
 
     setupMainSettingsPanel();
+    pickObjectUnderCursor();
     enumerateObjectsInTheScene();
     setupObjectCreationPanel();
 }
 
+void SceneEditorGUI::pickObjectUnderCursor()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    if (!ImGui::IsMouseClicked(ImGuiMouseButton_Left) || io.WantCaptureMouse || ImGuizmo::IsOver()) {
+        return;
+    }
+
+    // unproject the cursor at the near and far planes (Vulkan NDC: y goes down like the screen, depth in [0, 1])
+    const glm::vec2 ndc{2.f * io.MousePos.x / io.DisplaySize.x - 1.f, 2.f * io.MousePos.y / io.DisplaySize.y - 1.f};
+    const glm::mat4 inverseViewProjection = glm::inverse(camera.getProjection() * camera.getView());
+    const glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, 0.f, 1.f);
+    const glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.f, 1.f);
+    const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    const glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+    SceneObject::id_t id;
+    float distance;
+    if (transformCache.raycast(origin, direction, id, distance)) {
+        pickedItemSceneObjectsList = static_cast<int>(id);
+    }
+}
+
 void SceneEditorGUI::setupMainSettingsPanel()
 {
     ImGui::SetNextWindowPos(ImVec2{.0f, .0f}, ImGuiCond_FirstUseEver);
@@ -139,6 +193,41 @@ void SceneEditorGUI::setupMainSettingsPanel()
     {
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
             1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        const PipelineCacheStats& pipelineStats = wrpDevice.getPipelineCacheStats();
+        ImGui::Text("Pipelines: %u created in %.2f ms (%s cache)", pipelineStats.pipelinesCreated.load(),
+            pipelineStats.totalCreationTimeMs(), pipelineStats.warmStart ? "warm" : "cold");
+        const SpirvCacheStats& spirvStats = SpirvCache::instance().getStats();
+        ImGui::Text("SPIR-V cache: %u hits, %u misses, %.2f ms compile time saved", spirvStats.hits.load(),
+            spirvStats.misses.load(), spirvStats.compileTimeSavedMs());
+        ImGui::Text("Culling: %u visible / %u culled objects, %u culled submeshes", renderStats.objectsVisible,
+            renderStats.objectsCulled, renderStats.subMeshesCulled);
+        ImGui::Text("Triangles: %llu drawn, %llu culled", static_cast<unsigned long long>(renderStats.trianglesVisible),
+            static_cast<unsigned long long>(renderStats.trianglesCulled));
+        ImGui::Text("Draw calls: %u (%u instances), recorded in %.3f ms", renderStats.drawCalls,
+            renderStats.instances, renderStats.recordTimeMs);
+        ImGui::Text("Transforms: %u matrices updated", renderStats.transformsUpdated);
+        ImGui::Text("Lights: %u point lights, %u cluster assignments, binned in %.3f ms",
+            renderStats.pointLights, renderStats.lightAssignments, renderStats.lightBinningMs);
+        ImGui::Text("Occlusion: %u occluders (%u triangles) in %.3f ms, %u objects / %u submeshes occluded",
+            renderStats.occludersRasterized, renderStats.occluderTriangles, renderStats.occlusionMs,
+            renderStats.objectsOccluded, renderStats.subMeshesOccluded);
+        ImGui::Text("GPU frame: %.3f ms, resolution scale %.0f%%", renderStats.gpuFrameMs,
+            renderStats.resolutionScale * 100.f);
+        ImGui::Text("AA: MSAA %dx%s: scene %.3f ms, post-process %.3f ms", renderingSettings.msaaSamples,
+            renderingSettings.fxaa ? " + FXAA" : "", renderStats.gpuSceneMs, renderStats.gpuPostProcessMs);
+        const float megabyte = 1024.f * 1024.f;
+        ImGui::Text("Render graph: %u passes (%u culled), %u barriers, %u transient images: %.1f MB (%.1f MB saved by aliasing)",
+            renderGraphStats.passes, renderGraphStats.passesCulled, renderGraphStats.barriers, renderGraphStats.images,
+            renderGraphStats.allocatedBytes / megabyte, (renderGraphStats.imageBytes - renderGraphStats.allocatedBytes) / megabyte);
+        for (const auto& pass : renderGraphStats.passTimings)
+            ImGui::BulletText("%s: %.3f ms", pass.name.c_str(), pass.gpuMs);
+
+        for (const auto& error : shaderErrors)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.f, .35f, .35f, 1.f));
+            ImGui::TextWrapped("Shader reload failed (%s):\n%s", error.pipelineName.c_str(), error.message.c_str());
+            ImGui::PopStyleColor();
+        }
 
         // 1 collapsing header
         if (ImGui::CollapsingHeader("Scene Rendering Settings", ImGuiTreeNodeFlags_DefaultOpen))
@@ -174,6 +263,42 @@ void SceneEditorGUI::setupMainSettingsPanel()
             ImGui::RadioButton("Wireframe", &renderingSettings.polygonFillMode, 1); ImGui::SameLine();
             ImGui::RadioButton("Point", &renderingSettings.polygonFillMode, 2);
 
+            ImGui::Checkbox("GPU culling", &renderingSettings.gpuCulling); ImGui::SameLine();
+            ImGui::Checkbox("Verify GPU culling", &renderingSettings.verifyGpuCulling);
+            ImGui::SliderInt("Recording threads", &renderingSettings.recordingThreads, 1, maxRecordingThreads);
+            ImGui::Checkbox("Instancing", &renderingSettings.instancing);
+            ImGui::Checkbox("Deferred shading", &renderingSettings.deferredShading); ImGui::SameLine();
+            ImGui::Checkbox("Occlusion culling (CPU)", &renderingSettings.occlusionCulling);
+            ImGui::Checkbox("Dynamic resolution", &renderingSettings.dynamicResolution);
+            if (renderingSettings.dynamicResolution)
+            {
+                ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
+                ImGui::SliderFloat("Target GPU frame time (ms)", &renderingSettings.targetFrameMs, 4.f, 50.f);
+                ImGui::SliderFloat("Min resolution scale", &renderingSettings.minResolutionScale, .25f, 1.f);
+                ImGui::SliderFloat("Max resolution scale", &renderingSettings.maxResolutionScale, .25f, 1.f);
+                if (!renderingSettings.fxaa)
+                    ImGui::SliderFloat("Sharpness", &renderingSettings.sharpness, 0.f, 1.f);
+                ImGui::PopItemWidth();
+            }
+
+            ImGui::Text("MSAA samples");
+            for (int samples = 1; samples <= 8; samples *= 2)
+            {
+                if (samples > wrpDevice.getMaxUsableMSAASampleCount())
+                    break;
+                if (samples > 1)
+                    ImGui::SameLine();
+                ImGui::RadioButton(samples == 1 ? "Off" : (std::to_string(samples) + "x").c_str(),
+                    &renderingSettings.msaaSamples, samples);
+            }
+            if (renderingSettings.msaaSamples > 1)
+            {
+                ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.6f);
+                ImGui::SliderFloat("Sample shading", &renderingSettings.minSampleShading, 0.f, 1.f);
+                ImGui::PopItemWidth();
+            }
+            ImGui::Checkbox("FXAA", &renderingSettings.fxaa);
+
             ImGui::Text("Clear Color");
             ImGui::ColorEdit3("##Clear Color", (float*)&clearColor);
         }
@@ -216,42 +341,91 @@ void SceneEditorGUI::enumerateObjectsInTheScene()
         }
 
         // Create "Inspect Object" window for chosed type of scene object
-        if (sceneObjects[pickedItemSceneObjectsList].pointLight != nullptr) {
-            inspectObject(sceneObjects[pickedItemSceneObjectsList], true);
-        }
-        else {
-            inspectObject(sceneObjects[pickedItemSceneObjectsList], false);
+        auto picked = sceneObjects.find(pickedItemSceneObjectsList);
+        if (picked != sceneObjects.end()) {
+            auto pointLight = sceneObjects.pointLights().find(picked->first);
+            inspectObject(picked->second,
+                pointLight != sceneObjects.pointLights().end() ? &pointLight->second : nullptr);
         }
     }
     ImGui::End();
 }
 
-void SceneEditorGUI::inspectObject(SceneObject& object, bool isPointLight)
+void SceneEditorGUI::inspectObject(SceneObject& object, PointLightComponent* pointLight)
 {
     ImGui::SetNextWindowPos(ImVec2{0, 510}, ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowSize(ImVec2{350, 290}, ImGuiCond_FirstUseEver);
 
     if (ImGui::Begin("Inspector")) {
         if (ImGui::CollapsingHeader("Transform Component", ImGuiTreeNodeFlags_DefaultOpen)) {
-            ImGui::DragFloat3("Position", glm::value_ptr(object.transform.translation), 0.02f);
-            ImGui::DragFloat3("Scale", glm::value_ptr(object.transform.scale), 0.02f);
-            ImGui::DragFloat3("Rotation", glm::value_ptr(object.transform.rotation), 0.02f);
+            // the cached world matrix is recomputed only for transforms marked dirty
+            bool transformChanged = ImGui::DragFloat3("Position", glm::value_ptr(object.transform.translation), 0.02f);
+            transformChanged |= ImGui::DragFloat3("Scale", glm::value_ptr(object.transform.scale), 0.02f);
+            transformChanged |= ImGui::DragFloat3("Rotation", glm::value_ptr(object.transform.rotation), 0.02f);
+            if (transformChanged)
+                object.transform.markDirty();
         }
 
-        renderTransformGizmo(object.transform); // render object's gizmo along with its inspector tool
+        if (ImGui::CollapsingHeader("Hierarchy", ImGuiTreeNodeFlags_DefaultOpen)) {
+            showParentSelector(object);
+        }
+
+        // render object's gizmo along with its inspector tool
+        renderTransformGizmo(object.transform, parentWorldMatrix(object));
 
-        if (isPointLight) {
+        if (pointLight != nullptr) {
             if (ImGui::CollapsingHeader("PointLight Component", ImGuiTreeNodeFlags_DefaultOpen)) {
-                ImGui::SliderFloat("Light intensity", &object.pointLight->lightIntensity, .0f, 100.0f);
-                ImGui::SliderFloat("Light radius", &object.transform.scale.x, 0.01f, 5.0f);
+                ImGui::SliderFloat("Light intensity", &pointLight->lightIntensity, .0f, 100.0f);
+                if (ImGui::SliderFloat("Light radius", &object.transform.scale.x, 0.01f, 5.0f))
+                    object.transform.markDirty();
                 ImGui::ColorEdit3("Light color", (float*)&object.color);
-                ImGui::Checkbox("Demo Carousel Enabled", &object.pointLight->carouselEnabled);
+                ImGui::Checkbox("Demo Carousel Enabled", &pointLight->carouselEnabled);
             }
         }
     }
     ImGui::End();
 }
 
+void SceneEditorGUI::showParentSelector(SceneObject& object)
+{
+    const SceneObject::id_t parentId = object.getParentId();
+    auto parentIt = sceneObjects.find(parentId);
+    const std::string preview = parentIt != sceneObjects.end() ? parentIt->second.getName() : "None";
+
+    // the transform is kept relative, so the object follows its new parent from its local position
+    if (ImGui::BeginCombo("Parent", preview.c_str())) {
+        if (ImGui::Selectable("None", parentId == SceneObject::NO_PARENT)) {
+            object.setParent(SceneObject::NO_PARENT);
+        }
+        for (auto& obj : sceneObjects) {
+            // objects of the own subtree are skipped, they would make a cycle
+            if (isInSubtree(obj.first, object.getId())) continue;
+            if (ImGui::Selectable(obj.second.getName().c_str(), obj.first == parentId)) {
+                object.setParent(obj.first);
+            }
+        }
+        ImGui::EndCombo();
+    }
+}
+
+glm::mat4 SceneEditorGUI::parentWorldMatrix(const SceneObject& object)
+{
+    glm::mat4 world{1.f};
+    for (auto it = sceneObjects.find(object.getParentId()); it != sceneObjects.end();
+        it = sceneObjects.find(it->second.getParentId())) {
+        world = it->second.transform.modelMatrix() * world;
+    }
+    return world;
+}
+
+bool SceneEditorGUI::isInSubtree(SceneObject::id_t object, SceneObject::id_t ancestor)
+{
+    for (auto it = sceneObjects.find(object); it != sceneObjects.end(); it = sceneObjects.find(it->second.getParentId())) {
+        if (it->first == ancestor) return true;
+    }
+    return false;
+}
+
 void SceneEditorGUI::setupObjectCreationPanel()
 {
     ImGui::SetNextWindowPos(ImVec2{395, 0}, ImGuiCond_FirstUseEver);
@@ -315,10 +489,7 @@ void SceneEditorGUI::showModelsFromDirectory()
 
     if (ImGui::Button("Add to the scene")) {
         std::shared_ptr<WrpModel> model = WrpModel::createModelFromObjMtl(wrpDevice, objectsPaths.at(pickedItemModelsList));
-        auto newObj = SceneObject::createSceneObject();
-        newObj.model = model;
-        sceneObjects.emplace(newObj.getId(), std::move(newObj));
-        pickedItemSceneObjectsList = newObj.getId();
+        pickedItemSceneObjectsList = sceneObjects.add(SceneObject::createSceneObject(), model);
     }
 }
 
@@ -337,15 +508,13 @@ void SceneEditorGUI::showPointLightCreator()
 
     if (ImGui::Button("Add Point Light"))
     {
-        SceneObject pointLight = SceneObject::makePointLight(pointLightIntensity, pointLightRadius, pointLightColor);
-        sceneObjects.emplace(pointLight.getId(), std::move(pointLight));
-        pickedItemSceneObjectsList = pointLight.getId();
+        pickedItemSceneObjectsList = sceneObjects.addPointLight(pointLightIntensity, pointLightRadius, pointLightColor);
     }
 
     ImGui::PopItemWidth();
 }
 
-void SceneEditorGUI::renderTransformGizmo(TransformComponent& transform)
+void SceneEditorGUI::renderTransformGizmo(TransformComponent& transform, const glm::mat4& parentWorld)
 {
     ImGuizmo::BeginFrame();
     static ImGuizmo::OPERATION currentGizmoOperation = ImGuizmo::TRANSLATE;
@@ -385,20 +554,18 @@ void SceneEditorGUI::renderTransformGizmo(TransformComponent& transform)
         currentGizmoMode = ImGuizmo::LOCAL;
     }
 
-    glm::mat4 modelMat = transform.modelMatrix();
+    // the gizmo works in world space, while the transform is relative to the parent
+    glm::mat4 modelMat = parentWorld * transform.modelMatrix();
     glm::mat4 deltaMat{};
     glm::mat4 guizmoProj(camera.getProjection());
     guizmoProj[1][1] *= -1;
 
     ImGuiIO& io = ImGui::GetIO();
     ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
-    ImGuizmo::Manipulate(glm::value_ptr(camera.getView()), glm::value_ptr(guizmoProj), currentGizmoOperation,
+    const bool manipulated = ImGuizmo::Manipulate(glm::value_ptr(camera.getView()), glm::value_ptr(guizmoProj), currentGizmoOperation,
         currentGizmoMode, glm::value_ptr(modelMat), glm::value_ptr(deltaMat), nullptr);
 
-    /*if (transform.parent != nullptr) {
-        modelMat = glm::inverse(transform.parent->GetMatrix()) * modelMat;
-    }
-    transform.transform = modelMat;*/
+    modelMat = glm::inverse(parentWorld) * modelMat;
 
     /*glm::vec3 deltaTranslation{};
     glm::vec3 deltaRotation{};
@@ -410,6 +577,8 @@ void SceneEditorGUI::renderTransformGizmo(TransformComponent& transform)
 
     ImGuizmo::DecomposeMatrixToComponents(glm::value_ptr(modelMat), glm::value_ptr(transform.translation),
         glm::value_ptr(empty), glm::value_ptr(transform.scale));
+    if (manipulated)
+        transform.markDirty();
 
     // Преобразование градусов в радианы.
     // todo: поворот дёргается. нужен фикс
@@ -2,10 +2,13 @@
 
 #include "../src/renderer/Device.hpp"
 #include "../src/renderer/Window.hpp"
-#include "../src/renderer/SceneObject.hpp"
+#include "../src/renderer/Scene.hpp"
 #include "../src/renderer/Camera.hpp"
 #include "./common/KeyboardMovementController.hpp"
 #include "../src/renderer/FrameInfo.hpp"
+#include "../src/renderer/TransformCache.hpp"
+#include "../src/renderer/ShaderWatcher.hpp"
+#include "../src/renderer/RenderGraph.hpp"
 
 // libs
 #include <imgui.h>
@@ -26,9 +29,11 @@ static void check_vk_result(VkResult err) {
 
 class SceneEditorGUI {
 public:
-    SceneEditorGUI(WrpWindow& window, WrpDevice& device, VkRenderPass renderPass,
+    // Without a window (headless rendering) no ImGui context is created: the GUI methods do nothing
+    // and the fields controlled by tools keep their defaults
+    SceneEditorGUI(WrpWindow* window, WrpDevice& device, VkRenderPass renderPass,
         uint32_t imageCount, WrpCamera& camera, KeyboardMovementController& kmc,
-        SceneObject::Map& sceneObjects, RenderingSettings& renderingSettings);
+        WrpScene& sceneObjects, WrpTransformCache& transformCache, RenderingSettings& renderingSettings);
     ~SceneEditorGUI();
 
     SceneEditorGUI() = default;
@@ -37,6 +42,14 @@ public:
     void newFrame();
     void setupGUI();
     void render(VkCommandBuffer commandBuffer);
+    // Must be called between frames after the swap chain render pass was recreated with another MSAA sample count
+    void setRenderPass(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
+
+    // Shader hot-reload compilation errors (the last good pipelines keep rendering)
+    std::vector<ShaderReloadError> shaderErrors;
+    RenderStats renderStats{};
+    WrpRenderGraph::Stats renderGraphStats{};
+    int maxRecordingThreads = 1; // upper bound of the "Recording threads" slider
 
     // Fields controlled by tools
     float directionalLightIntensity = 1.0f;
@@ -58,22 +71,34 @@ public:
     glm::vec3 pointLightColor{1, 1, 1};
 
 private:
+    void initVulkanBackend(VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
     void setupAllWindows();
     void setupMainSettingsPanel();    // presented as "Vulkan Renderer" window
     void setupObjectCreationPanel();
     void showPointLightCreator();
     void showModelsFromDirectory();
     void enumerateObjectsInTheScene();
-    void inspectObject(SceneObject& object, bool isPointLight);
-    void renderTransformGizmo(TransformComponent& transform);
+    // Left click on the scene selects the nearest object under the cursor (ray query against the spatial index)
+    void pickObjectUnderCursor();
+    void inspectObject(SceneObject& object, PointLightComponent* pointLight);
+    void showParentSelector(SceneObject& object);
+    void renderTransformGizmo(TransformComponent& transform, const glm::mat4& parentWorld);
+
+    // World matrix of the object's parent chain (identity for root objects)
+    glm::mat4 parentWorldMatrix(const SceneObject& object);
+    // true if `object` is `ancestor` itself or lies in its subtree
+    bool isInSubtree(SceneObject::id_t object, SceneObject::id_t ancestor);
 
     bool showImGuiDemoWindow = false; // controllable by UI checkbox
 
     WrpDevice& wrpDevice;
+    uint32_t imageCount;
     WrpCamera& camera;
     KeyboardMovementController& kmc;
-    SceneObject::Map& sceneObjects;
+    WrpScene& sceneObjects;
+    WrpTransformCache& transformCache;
     RenderingSettings& renderingSettings;
 
-    VkDescriptorPool descriptorPool; // ImGui's descriptor pool
+    bool enabled; // false without a window
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE; // ImGui's descriptor pool
 };
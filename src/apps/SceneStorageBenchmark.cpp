@@ -0,0 +1,128 @@
+#include "SceneStorageBenchmark.hpp"
+
+#include "../renderer/Scene.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // every N-th object is a point light, every M-th one has a model
+    constexpr uint32_t LIGHT_EVERY = 16;
+    constexpr uint32_t MODEL_EVERY = 2;
+    constexpr int ITERATIONS = 20;
+
+    // The storage layout the scene used before WrpScene: components hang off the object itself
+    struct LegacyObject
+    {
+        std::string name;
+        TransformComponent transform{};
+        glm::vec3 color{};
+        std::shared_ptr<WrpModel> model{};
+        std::unique_ptr<PointLightComponent> pointLight = nullptr;
+    };
+
+    using LegacyMap = std::unordered_map<SceneObject::id_t, LegacyObject>;
+
+    template <typename F>
+    double measureMicroseconds(F&& walk)
+    {
+        walk(); // warm-up
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) walk();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / ITERATIONS;
+    }
+
+    // models are never dereferenced, only the presence of the component matters
+    std::shared_ptr<WrpModel> fakeModel()
+    {
+        static int dummy = 0;
+        return std::shared_ptr<WrpModel>(std::shared_ptr<void>{}, reinterpret_cast<WrpModel*>(&dummy));
+    }
+}
+
+void SceneStorageBenchmark::run()
+{
+    const glm::mat4 rotateLight = glm::rotate(glm::mat4(1.f), 0.016f, {0.f, -1.f, 0.f});
+    const auto model = fakeModel();
+
+    std::printf("%10s | %-22s | %12s | %12s | %7s\n", "objects", "walk", "legacy, us", "pools, us", "speedup");
+    for (uint32_t objectCount : {10'000u, 100'000u, 1'000'000u})
+    {
+        LegacyMap legacy;
+        legacy.reserve(objectCount);
+        WrpScene scene;
+
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            const bool isLight = i % LIGHT_EVERY == 0;
+            const bool hasModel = !isLight && i % MODEL_EVERY == 0;
+
+            SceneObject::id_t id;
+            if (isLight)
+            {
+                id = scene.addPointLight();
+            }
+            else
+            {
+                SceneObject object = SceneObject::createSceneObject("Object");
+                id = scene.add(std::move(object), hasModel ? model : nullptr);
+            }
+            scene.at(id).transform.setTranslation({float(i % 100), 0.f, float(i / 100)});
+
+            LegacyObject& legacyObject = legacy[id];
+            legacyObject.name = scene.at(id).getName();
+            legacyObject.transform = scene.at(id).transform;
+            if (isLight) legacyObject.pointLight = std::make_unique<PointLightComponent>();
+            if (hasModel) legacyObject.model = model;
+        }
+
+        // point light update as in PointLightSystem::update
+        const double legacyLights = measureMicroseconds([&] {
+            for (auto& kv : legacy)
+            {
+                auto& obj = kv.second;
+                if (obj.pointLight == nullptr) continue;
+                obj.transform.setTranslation(glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f)));
+            }
+        });
+        const double poolLights = measureMicroseconds([&] {
+            for (auto& kv : scene.pointLights())
+            {
+                TransformComponent& transform = scene.at(kv.first).transform;
+                transform.setTranslation(glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f)));
+            }
+        });
+
+        // collection of objects to render as in SimpleRenderSystem
+        std::vector<WrpRenderObject> renderObjects;
+        renderObjects.reserve(objectCount);
+        const double legacyModels = measureMicroseconds([&] {
+            renderObjects.clear();
+            for (auto& kv : legacy)
+            {
+                if (kv.second.model == nullptr) continue;
+                renderObjects.push_back({kv.first, &kv.second.transform, kv.second.model.get()});
+            }
+        });
+        const double poolModels = measureMicroseconds([&] {
+            renderObjects.clear();
+            for (auto& kv : scene.models())
+                renderObjects.push_back({kv.first, &scene.at(kv.first).transform, kv.second.model.get()});
+        });
+
+        auto printRow = [objectCount](const char* walk, double legacyTime, double poolTime) {
+            std::printf("%10u | %-22s | %12.1f | %12.1f | %6.2fx\n", objectCount, walk, legacyTime, poolTime, legacyTime / poolTime);
+        };
+        printRow("point lights update", legacyLights, poolLights);
+        printRow("render list", legacyModels, poolModels);
+    }
+}
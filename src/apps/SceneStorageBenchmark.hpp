@@ -0,0 +1,13 @@
+#pragma once
+
+/*
+ * CPU benchmark of scene storage layouts, no window or Vulkan device is created.
+ * Compares the old layout (SceneObject with inline component pointers in an unordered_map, every system
+ * walks all objects and filters by component type) with WrpScene, where each system walks only its own
+ * dense component pool. Runs at 10k, 100k and 1M objects and prints per-walk timings to stdout.
+ */
+class SceneStorageBenchmark
+{
+public:
+    void run();
+};
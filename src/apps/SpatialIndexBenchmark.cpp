@@ -0,0 +1,209 @@
+#include "SpatialIndexBenchmark.hpp"
+
+#include "../renderer/Bvh.hpp"
+#include "../renderer/Culling.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr int QUERIES = 200;
+    constexpr int UPDATE_FRAMES = 100;
+    constexpr float MOVING_FRACTION = .05f;
+
+    using Clock = std::chrono::steady_clock;
+
+    double microsecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // the same tests the BVH applies to its leaves, so the results must match exactly
+    bool boxInFrustum(const WrpAabb& box, const std::array<glm::vec4, 6>& planes)
+    {
+        const glm::vec3 center = box.center();
+        const glm::vec3 extents = box.extents();
+        for (const auto& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -glm::dot(extents, glm::abs(glm::vec3(plane)))) return false;
+        }
+        return true;
+    }
+
+    bool boxOverlapsSphere(const WrpAabb& box, const WrpBoundingSphere& sphere)
+    {
+        const glm::vec3 offset = glm::clamp(sphere.center, box.min, box.max) - sphere.center;
+        return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+    }
+
+    bool boxesOverlap(const WrpAabb& a, const WrpAabb& b)
+    {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::greaterThanEqual(a.max, b.min));
+    }
+
+    float rayEnter(const WrpAabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+    {
+        const glm::vec3 t1 = (box.min - origin) * inverseDirection;
+        const glm::vec3 t2 = (box.max - origin) * inverseDirection;
+        const glm::vec3 tNear = glm::min(t1, t2);
+        const glm::vec3 tFar = glm::max(t1, t2);
+        const float enter = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+        const float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+        return enter <= exit ? enter : -1.f;
+    }
+
+    struct Query
+    {
+        std::array<glm::vec4, 6> planes;
+        WrpBoundingSphere sphere;
+        WrpAabb box;
+        glm::vec3 rayOrigin;
+        glm::vec3 rayDirection;
+    };
+
+    void printRow(uint32_t objectCount, const char* name, double linearTime, double bvhTime, bool mismatch)
+    {
+        std::printf("%10u | %-15s | %12.1f | %10.1f | %7.1fx%s\n", objectCount, name, linearTime, bvhTime,
+            linearTime / bvhTime, mismatch ? "  RESULTS DIFFER" : "");
+    }
+}
+
+void SpatialIndexBenchmark::run()
+{
+    std::mt19937 random{42};
+    std::printf("%10s | %-15s | %12s | %10s | %8s\n", "objects", "query", "linear, us", "bvh, us", "speedup");
+
+    for (uint32_t objectCount : {10'000u, 100'000u, 1'000'000u})
+    {
+        // constant density: roughly one object per 4x4x4 cell
+        const float side = std::cbrt(static_cast<float>(objectCount)) * 4.f;
+        std::uniform_real_distribution<float> position{0.f, side};
+        std::uniform_real_distribution<float> halfSize{.2f, 1.5f};
+        std::uniform_real_distribution<float> unit{-1.f, 1.f};
+
+        std::vector<WrpAabb> boxes(objectCount);
+        for (auto& box : boxes)
+        {
+            const glm::vec3 center{position(random), position(random), position(random)};
+            const glm::vec3 half{halfSize(random), halfSize(random), halfSize(random)};
+            box = {center - half, center + half};
+        }
+
+        WrpBvh bvh{};
+        std::vector<uint32_t> proxies(objectCount);
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < objectCount; i++)
+            proxies[i] = bvh.insert(boxes[i], i);
+        const double insertTime = microsecondsSince(start);
+        const float insertSah = bvh.getSahCost();
+        start = Clock::now();
+        bvh.rebuild();
+        const double rebuildTime = microsecondsSince(start);
+        std::printf("%10u | build: %.1f ms incremental (SAH cost %.1f), %.1f ms binned SAH (SAH cost %.1f, height %d)\n",
+            objectCount, insertTime / 1000., insertSah, rebuildTime / 1000., bvh.getSahCost(), bvh.getHeight());
+
+        std::vector<Query> queries(QUERIES);
+        for (auto& query : queries)
+        {
+            const glm::vec3 eye{position(random), position(random), position(random)};
+            const glm::vec3 forward = glm::normalize(glm::vec3{unit(random), unit(random), unit(random)});
+            const glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, .1f, side * .25f);
+            query.planes = WrpFrustumCuller{projection * glm::lookAt(eye, eye + forward, {0.f, 1.f, 0.f})}.getPlanes();
+            query.sphere = {eye, 8.f};
+            query.box = {eye - glm::vec3(8.f), eye + glm::vec3(8.f)};
+            query.rayOrigin = eye;
+            query.rayDirection = forward;
+        }
+
+        auto runQueries = [&](auto&& linear, auto&& indexed, size_t& linearHits, size_t& bvhHits) {
+            std::vector<uint32_t> result;
+            linearHits = bvhHits = 0;
+            auto begin = Clock::now();
+            for (const auto& query : queries)
+                linearHits += linear(query);
+            const double linearTime = microsecondsSince(begin) / QUERIES;
+            begin = Clock::now();
+            for (const auto& query : queries)
+            {
+                result.clear();
+                bvhHits += indexed(query, result);
+            }
+            return std::pair{linearTime, microsecondsSince(begin) / QUERIES};
+        };
+
+        auto benchmarkQueries = [&](const char* suffix) {
+            size_t linearHits, bvhHits;
+            auto [frustumLinear, frustumBvh] = runQueries(
+                [&](const Query& q) { return std::count_if(boxes.begin(), boxes.end(), [&](const WrpAabb& b) { return boxInFrustum(b, q.planes); }); },
+                [&](const Query& q, std::vector<uint32_t>& out) { bvh.queryFrustum(q.planes, out); return out.size(); },
+                linearHits, bvhHits);
+            printRow(objectCount, (std::string("frustum") + suffix).c_str(), frustumLinear, frustumBvh, linearHits != bvhHits);
+
+            auto [sphereLinear, sphereBvh] = runQueries(
+                [&](const Query& q) { return std::count_if(boxes.begin(), boxes.end(), [&](const WrpAabb& b) { return boxOverlapsSphere(b, q.sphere); }); },
+                [&](const Query& q, std::vector<uint32_t>& out) { bvh.querySphere(q.sphere, out); return out.size(); },
+                linearHits, bvhHits);
+            printRow(objectCount, (std::string("sphere") + suffix).c_str(), sphereLinear, sphereBvh, linearHits != bvhHits);
+
+            auto [boxLinear, boxBvh] = runQueries(
+                [&](const Query& q) { return std::count_if(boxes.begin(), boxes.end(), [&](const WrpAabb& b) { return boxesOverlap(b, q.box); }); },
+                [&](const Query& q, std::vector<uint32_t>& out) { bvh.queryAabb(q.box, out); return out.size(); },
+                linearHits, bvhHits);
+            printRow(objectCount, (std::string("aabb") + suffix).c_str(), boxLinear, boxBvh, linearHits != bvhHits);
+
+            // the nearest hit is compared by object index (0 = no hit)
+            auto [rayLinear, rayBvh] = runQueries(
+                [&](const Query& q) -> size_t {
+                    const glm::vec3 inverseDirection = 1.f / q.rayDirection;
+                    float closest = std::numeric_limits<float>::max();
+                    size_t hit = 0;
+                    for (uint32_t i = 0; i < objectCount; i++)
+                    {
+                        const float distance = rayEnter(boxes[i], q.rayOrigin, inverseDirection, closest);
+                        if (distance >= 0.f && distance < closest) { closest = distance; hit = i + 1; }
+                    }
+                    return hit;
+                },
+                [&](const Query& q, std::vector<uint32_t>&) -> size_t {
+                    uint32_t index;
+                    float distance;
+                    return bvh.raycast(q.rayOrigin, q.rayDirection, std::numeric_limits<float>::max(), index, distance) ? index + 1 : 0;
+                },
+                linearHits, bvhHits);
+            printRow(objectCount, (std::string("ray") + suffix).c_str(), rayLinear, rayBvh, linearHits != bvhHits);
+        };
+        benchmarkQueries("");
+
+        // moving objects: a random subset drifts each frame, the tree is maintained as in WrpTransformCache::update
+        const uint32_t movingCount = static_cast<uint32_t>(objectCount * MOVING_FRACTION);
+        std::vector<glm::vec3> velocities(movingCount);
+        for (auto& velocity : velocities)
+            velocity = glm::vec3{unit(random), unit(random), unit(random)} * 2.f;
+        size_t reinserted = 0;
+        start = Clock::now();
+        for (int frame = 0; frame < UPDATE_FRAMES; frame++)
+        {
+            for (uint32_t i = 0; i < movingCount; i++)
+            {
+                const glm::vec3 offset = velocities[i] * (1.f / 60.f);
+                boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+                reinserted += bvh.move(proxies[i], boxes[i]) ? 1 : 0;
+            }
+            bvh.maintain();
+        }
+        std::printf("%10u | update: %u moving objects, %.1f us/frame, %.1f reinsertions/frame, SAH cost %.1f\n",
+            objectCount, movingCount, microsecondsSince(start) / UPDATE_FRAMES, double(reinserted) / UPDATE_FRAMES, bvh.getSahCost());
+        benchmarkQueries(" (moved)");
+    }
+}
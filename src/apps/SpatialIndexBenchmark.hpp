@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ * CPU benchmark of the dynamic BVH (WrpBvh) against linear scans over the same array of world AABBs,
+ * no window or Vulkan device is created. Procedural scenes of 10k, 100k and 1M random boxes at constant density:
+ * frustum, sphere, AABB and ray queries, incremental insertion vs SAH build, and per-frame updates
+ * with a fraction of the objects moving (refits, reinsertions and background SAH rebuilds).
+ * Query results are compared with the linear scans, a mismatch is reported.
+ */
+class SpatialIndexBenchmark
+{
+public:
+    void run();
+};
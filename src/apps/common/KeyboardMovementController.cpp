@@ -34,6 +34,7 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Sce
         // Вектор поворота нормализуется, чтобы поворот по диагонали (зажаты две кнопки поворота)
         // не был быстрее поворота по одной из осей. Нормализация делает длину любого вектора равной единице.
         sceneObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+        sceneObject.transform.markDirty();
     }
 
     // Ограничение поворота тангажа в пределах примерно +/- 85 градусов
@@ -60,5 +61,6 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Sce
         // На игровой объект применяется сдвиг с учётом настройки скорости и временного шага кадра.
         // Нормализация вектора смещения для случая движения сразу по нескольким осям.
         sceneObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+        sceneObject.transform.markDirty();
     }
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <limits>
+
+struct WrpBoundingSphere
+{
+    glm::vec3 center{0.f};
+    float radius = 0.f;
+
+    // Сфера с отрицательным радиусом пустая (например, границы узла иерархии без моделей)
+    bool isEmpty() const { return radius < 0.f; }
+
+    // Расширение до наименьшей сферы, содержащей обе
+    void expand(const WrpBoundingSphere& other)
+    {
+        if (other.isEmpty()) return;
+        if (isEmpty()) { *this = other; return; }
+
+        const glm::vec3 offset = other.center - center;
+        const float distance = glm::length(offset);
+        if (distance + other.radius <= radius) return;
+        if (distance + radius <= other.radius) { *this = other; return; }
+
+        const float newRadius = (distance + radius + other.radius) * .5f;
+        center += offset * ((newRadius - radius) / distance);
+        radius = newRadius;
+    }
+};
+
+// Axis-aligned bounding box в пространстве модели
+struct WrpAabb
+{
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+    void expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const WrpAabb& other)
+    {
+        if (!other.isValid()) return;
+        expand(other.min);
+        expand(other.max);
+    }
+
+    glm::vec3 center() const { return (min + max) * .5f; }
+    glm::vec3 extents() const { return (max - min) * .5f; }
+
+    // Бокс, описанный вокруг преобразованного бокса (метод Арво: полуразмеры проецируются через модули элементов матрицы)
+    WrpAabb transformed(const glm::mat4& matrix) const
+    {
+        if (!isValid()) return {};
+        const glm::vec3 newCenter{matrix * glm::vec4(center(), 1.f)};
+        const glm::vec3 e = extents();
+        const glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * e.x
+            + glm::abs(glm::vec3(matrix[1])) * e.y
+            + glm::abs(glm::vec3(matrix[2])) * e.z;
+        return {newCenter - newExtents, newCenter + newExtents};
+    }
+
+    // Описанная вокруг бокса сфера (используется для быстрых тестов отсечения)
+    WrpBoundingSphere boundingSphere() const
+    {
+        if (!isValid()) return {};
+        return {center(), glm::length(extents())};
+    }
+};
@@ -0,0 +1,627 @@
+#include "Bvh.hpp"
+#include "JobSystem.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // минимальное число вставок и перестановок листьев, после которого запускается фоновое построение по SAH
+    constexpr size_t MIN_LEAF_UPDATES_FOR_REBUILD = 64;
+    constexpr uint32_t SAH_BINS = 16;
+
+    // половина площади поверхности (множитель 2 на сравнение не влияет)
+    float area(const WrpAabb& box)
+    {
+        const glm::vec3 d = box.max - box.min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    WrpAabb merged(const WrpAabb& a, const WrpAabb& b)
+    {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
+
+    bool contains(const WrpAabb& outer, const WrpAabb& inner)
+    {
+        return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::greaterThanEqual(outer.max, inner.max));
+    }
+
+    bool overlaps(const WrpAabb& a, const WrpAabb& b)
+    {
+        return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::greaterThanEqual(a.max, b.min));
+    }
+
+    bool overlaps(const WrpAabb& box, const WrpBoundingSphere& sphere)
+    {
+        const glm::vec3 offset = glm::clamp(sphere.center, box.min, box.max) - sphere.center;
+        return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+    }
+
+    // Пересечение луча с боксом методом пластин: расстояние входа (не меньше 0) или отрицательное число при промахе
+    float intersectRay(const WrpAabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+    {
+        const glm::vec3 t1 = (box.min - origin) * inverseDirection;
+        const glm::vec3 t2 = (box.max - origin) * inverseDirection;
+        const glm::vec3 tNear = glm::min(t1, t2);
+        const glm::vec3 tFar = glm::max(t1, t2);
+        const float enter = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+        const float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+        return enter <= exit ? enter : -1.f;
+    }
+}
+
+WrpBvh::~WrpBvh()
+{
+    // задача построения работает только со своими данными, но дожидаемся её, чтобы не оставлять работу после объекта
+    if (pendingBuild.valid())
+        pendingBuild.wait();
+}
+
+WrpAabb WrpBvh::fatten(const WrpAabb& bounds) const
+{
+    return {bounds.min - glm::vec3(fatMargin), bounds.max + glm::vec3(fatMargin)};
+}
+
+uint32_t WrpBvh::allocateNode()
+{
+    if (!freeNodes.empty())
+    {
+        const uint32_t node = freeNodes.back();
+        freeNodes.pop_back();
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void WrpBvh::freeNode(uint32_t node)
+{
+    nodes[node] = Node{};
+    freeNodes.push_back(node);
+}
+
+void WrpBvh::markChanged(uint32_t proxy)
+{
+    // изменения нужно запоминать только пока строится новое дерево
+    if (!pendingBuild.valid() || proxies[proxy].changed) return;
+    proxies[proxy].changed = true;
+    changedProxies.push_back(proxy);
+}
+
+uint32_t WrpBvh::insert(const WrpAabb& bounds, uint32_t userData)
+{
+    uint32_t proxy;
+    if (!freeProxies.empty())
+    {
+        proxy = freeProxies.back();
+        freeProxies.pop_back();
+    }
+    else
+    {
+        proxy = static_cast<uint32_t>(proxies.size());
+        proxies.emplace_back();
+    }
+    proxyCount++;
+
+    const uint32_t leaf = allocateNode();
+    nodes[leaf].bounds = fatten(bounds);
+    nodes[leaf].proxy = proxy;
+
+    Proxy& p = proxies[proxy];
+    p.bounds = bounds;
+    p.userData = userData;
+    p.node = leaf;
+    p.alive = true;
+
+    insertLeaf(leaf);
+    leafUpdates++;
+    markChanged(proxy);
+    return proxy;
+}
+
+void WrpBvh::remove(uint32_t proxy)
+{
+    Proxy& p = proxies[proxy];
+    removeLeaf(p.node);
+    freeNode(p.node);
+    p.node = NO_NODE;
+    p.alive = false;
+    markChanged(proxy);
+    freeProxies.push_back(proxy);
+    proxyCount--;
+}
+
+bool WrpBvh::move(uint32_t proxy, const WrpAabb& bounds)
+{
+    Proxy& p = proxies[proxy];
+    p.bounds = bounds;
+
+    // Лист остаётся на месте, пока объект внутри толстого бокса и бокс не стал сильно больше объекта
+    // (например, после уменьшения масштаба)
+    const uint32_t leaf = p.node;
+    const WrpAabb fat = fatten(bounds);
+    if (contains(nodes[leaf].bounds, bounds) && area(nodes[leaf].bounds) <= 4.f * area(fat))
+        return false;
+
+    removeLeaf(leaf);
+    nodes[leaf].bounds = fat;
+    insertLeaf(leaf);
+    leafUpdates++;
+    markChanged(proxy);
+    return true;
+}
+
+void WrpBvh::insertLeaf(uint32_t leaf)
+{
+    if (root == NO_NODE)
+    {
+        root = leaf;
+        nodes[leaf].parent = NO_NODE;
+        return;
+    }
+
+    // Спуск к соседу: на каждом узле сравнивается стоимость нового родителя здесь с нижней оценкой
+    // стоимости спуска в каждого из детей (прирост площади всех пройденных предков наследуется)
+    const WrpAabb leafBounds = nodes[leaf].bounds;
+    uint32_t index = root;
+    while (!nodes[index].isLeaf())
+    {
+        const Node& node = nodes[index];
+        const float combinedArea = area(merged(node.bounds, leafBounds));
+        const float cost = 2.f * combinedArea;
+        const float inheritanceCost = 2.f * (combinedArea - area(node.bounds));
+
+        auto descendCost = [&](uint32_t child) {
+            const float newArea = area(merged(leafBounds, nodes[child].bounds));
+            return (nodes[child].isLeaf() ? newArea : newArea - area(nodes[child].bounds)) + inheritanceCost;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    const uint32_t sibling = index;
+    const uint32_t oldParent = nodes[sibling].parent;
+    const uint32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == NO_NODE)
+        root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+        nodes[oldParent].child1 = newParent;
+    else
+        nodes[oldParent].child2 = newParent;
+
+    refitUpwards(newParent);
+}
+
+void WrpBvh::removeLeaf(uint32_t leaf)
+{
+    if (leaf == root)
+    {
+        root = NO_NODE;
+        return;
+    }
+
+    const uint32_t parent = nodes[leaf].parent;
+    const uint32_t grandParent = nodes[parent].parent;
+    const uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    nodes[leaf].parent = NO_NODE;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    if (grandParent == NO_NODE)
+    {
+        root = sibling;
+        return;
+    }
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    refitUpwards(grandParent);
+}
+
+void WrpBvh::refitUpwards(uint32_t index)
+{
+    while (index != NO_NODE)
+    {
+        rotate(index);
+        Node& node = nodes[index];
+        node.bounds = merged(nodes[node.child1].bounds, nodes[node.child2].bounds);
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        index = node.parent;
+    }
+}
+
+void WrpBvh::rotate(uint32_t a)
+{
+    // Поворот: ребёнок узла меняется местами с внуком из другой ветки, если это уменьшает площадь
+    // промежуточного узла. Набор листьев под a не меняется, поэтому его границы остаются прежними.
+    const uint32_t b = nodes[a].child1;
+    const uint32_t c = nodes[a].child2;
+
+    enum class Rotation { None, CwithD, CwithE, BwithF, BwithG };
+    Rotation best = Rotation::None;
+    float bestGain = 0.f;
+
+    if (!nodes[b].isLeaf())
+    {
+        const float areaB = area(nodes[b].bounds);
+        const float gainD = areaB - area(merged(nodes[c].bounds, nodes[nodes[b].child2].bounds)); // b = (c, e)
+        const float gainE = areaB - area(merged(nodes[nodes[b].child1].bounds, nodes[c].bounds)); // b = (d, c)
+        if (gainD > bestGain) { bestGain = gainD; best = Rotation::CwithD; }
+        if (gainE > bestGain) { bestGain = gainE; best = Rotation::CwithE; }
+    }
+    if (!nodes[c].isLeaf())
+    {
+        const float areaC = area(nodes[c].bounds);
+        const float gainF = areaC - area(merged(nodes[b].bounds, nodes[nodes[c].child2].bounds)); // c = (b, g)
+        const float gainG = areaC - area(merged(nodes[nodes[c].child1].bounds, nodes[b].bounds)); // c = (f, b)
+        if (gainF > bestGain) { bestGain = gainF; best = Rotation::BwithF; }
+        if (gainG > bestGain) { bestGain = gainG; best = Rotation::BwithG; }
+    }
+
+    // ребёнок a lowered опускается в node на место внука raised, а тот поднимается в a
+    auto swapNodes = [this, a](uint32_t lowered, uint32_t node, uint32_t raised) {
+        if (nodes[a].child1 == lowered) nodes[a].child1 = raised; else nodes[a].child2 = raised;
+        if (nodes[node].child1 == raised) nodes[node].child1 = lowered; else nodes[node].child2 = lowered;
+        nodes[raised].parent = a;
+        nodes[lowered].parent = node;
+        Node& n = nodes[node];
+        n.bounds = merged(nodes[n.child1].bounds, nodes[n.child2].bounds);
+        n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+    };
+    switch (best)
+    {
+    case Rotation::CwithD: swapNodes(c, b, nodes[b].child1); break;
+    case Rotation::CwithE: swapNodes(c, b, nodes[b].child2); break;
+    case Rotation::BwithF: swapNodes(b, c, nodes[c].child1); break;
+    case Rotation::BwithG: swapNodes(b, c, nodes[c].child2); break;
+    case Rotation::None: break;
+    }
+}
+
+void WrpBvh::maintain()
+{
+    if (pendingBuild.valid() && pendingBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        applyBuild(pendingBuild.get());
+
+    if (!pendingBuild.valid() && leafUpdates >= std::max(MIN_LEAF_UPDATES_FOR_REBUILD, proxyCount / 4))
+    {
+        leafUpdates = 0;
+        pendingBuild = WrpJobSystem::instance().submit([items = snapshotLeaves()]() mutable {
+            return build(std::move(items));
+        });
+    }
+}
+
+void WrpBvh::rebuild()
+{
+    if (pendingBuild.valid())
+        applyBuild(pendingBuild.get());
+    leafUpdates = 0;
+    applyBuild(build(snapshotLeaves()));
+}
+
+std::vector<WrpBvh::BuildItem> WrpBvh::snapshotLeaves() const
+{
+    std::vector<BuildItem> items;
+    items.reserve(proxyCount);
+    for (uint32_t proxy = 0; proxy < proxies.size(); proxy++)
+    {
+        if (!proxies[proxy].alive) continue;
+        const WrpAabb& bounds = nodes[proxies[proxy].node].bounds;
+        items.push_back({bounds, bounds.center(), proxy});
+    }
+    return items;
+}
+
+void WrpBvh::applyBuild(BuildResult&& result)
+{
+    for (uint32_t proxy : changedProxies)
+        proxies[proxy].node = NO_NODE;
+
+    nodes = std::move(result.nodes);
+    root = result.root;
+    freeNodes.clear();
+    for (uint32_t node = 0; node < nodes.size(); node++)
+    {
+        if (nodes[node].isLeaf())
+            proxies[nodes[node].proxy].node = node;
+    }
+
+    // Изменения, сделанные во время построения: удалённые прокси убираются из нового дерева,
+    // добавленные вставляются, а переставленные вставляются заново с текущими границами
+    for (uint32_t proxy : changedProxies)
+    {
+        Proxy& p = proxies[proxy];
+        p.changed = false;
+        const uint32_t leaf = p.node;
+        if (!p.alive)
+        {
+            if (leaf == NO_NODE) continue;
+            removeLeaf(leaf);
+            freeNode(leaf);
+            p.node = NO_NODE;
+        }
+        else if (leaf == NO_NODE)
+        {
+            const uint32_t newLeaf = allocateNode();
+            nodes[newLeaf].bounds = fatten(p.bounds);
+            nodes[newLeaf].proxy = proxy;
+            proxies[proxy].node = newLeaf;
+            insertLeaf(newLeaf);
+        }
+        else
+        {
+            removeLeaf(leaf);
+            nodes[leaf].bounds = fatten(p.bounds);
+            insertLeaf(leaf);
+        }
+    }
+    changedProxies.clear();
+}
+
+WrpBvh::BuildResult WrpBvh::build(std::vector<BuildItem> items)
+{
+    BuildResult result;
+    if (items.empty()) return result;
+    result.nodes.reserve(items.size() * 2 - 1);
+    result.root = buildRange(result, items, 0, static_cast<uint32_t>(items.size()));
+    return result;
+}
+
+uint32_t WrpBvh::buildRange(BuildResult& result, std::vector<BuildItem>& items, uint32_t first, uint32_t end)
+{
+    const uint32_t index = static_cast<uint32_t>(result.nodes.size());
+    result.nodes.emplace_back();
+    if (end - first == 1)
+    {
+        result.nodes[index].bounds = items[first].bounds;
+        result.nodes[index].proxy = items[first].proxy;
+        return index;
+    }
+
+    WrpAabb centroidBounds{};
+    for (uint32_t i = first; i < end; i++)
+        centroidBounds.expand(items[i].centroid);
+    const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    uint32_t middle = first;
+    if (extent[axis] > 0.f)
+    {
+        // Разбиение по SAH: центры раскладываются по корзинам вдоль самой длинной оси,
+        // и выбирается граница между корзинами с наименьшей суммой count * area слева и справа
+        struct Bin { WrpAabb bounds{}; uint32_t count = 0; };
+        std::array<Bin, SAH_BINS> bins{};
+        const float binScale = SAH_BINS / extent[axis] * .9999f;
+        auto binIndex = [&](const BuildItem& item) {
+            return std::min(SAH_BINS - 1, static_cast<uint32_t>((item.centroid[axis] - centroidBounds.min[axis]) * binScale));
+        };
+        for (uint32_t i = first; i < end; i++)
+        {
+            Bin& bin = bins[binIndex(items[i])];
+            bin.bounds.expand(items[i].bounds);
+            bin.count++;
+        }
+
+        std::array<float, SAH_BINS - 1> leftCosts{};
+        WrpAabb leftBounds{};
+        uint32_t leftCount = 0;
+        for (uint32_t split = 0; split < SAH_BINS - 1; split++)
+        {
+            leftBounds.expand(bins[split].bounds);
+            leftCount += bins[split].count;
+            leftCosts[split] = leftCount > 0 ? leftCount * area(leftBounds) : 0.f;
+        }
+        float bestCost = std::numeric_limits<float>::max();
+        uint32_t bestSplit = 0;
+        WrpAabb rightBounds{};
+        uint32_t rightCount = 0;
+        for (uint32_t split = SAH_BINS - 1; split > 0; split--)
+        {
+            rightBounds.expand(bins[split].bounds);
+            rightCount += bins[split].count;
+            const float cost = leftCosts[split - 1] + (rightCount > 0 ? rightCount * area(rightBounds) : 0.f);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = split;
+            }
+        }
+
+        middle = static_cast<uint32_t>(std::partition(items.begin() + first, items.begin() + end,
+            [&](const BuildItem& item) { return binIndex(item) < bestSplit; }) - items.begin());
+    }
+    if (middle == first || middle == end)
+    {
+        // все центры совпадают или попали в одну корзину - делим пополам
+        middle = first + (end - first) / 2;
+        std::nth_element(items.begin() + first, items.begin() + middle, items.begin() + end,
+            [axis](const BuildItem& a, const BuildItem& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    const uint32_t child1 = buildRange(result, items, first, middle);
+    const uint32_t child2 = buildRange(result, items, middle, end);
+    Node& node = result.nodes[index];
+    node.child1 = child1;
+    node.child2 = child2;
+    node.bounds = merged(result.nodes[child1].bounds, result.nodes[child2].bounds);
+    node.height = 1 + std::max(result.nodes[child1].height, result.nodes[child2].height);
+    result.nodes[child1].parent = index;
+    result.nodes[child2].parent = index;
+    return index;
+}
+
+void WrpBvh::queryFrustum(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& out) const
+{
+    if (root == NO_NODE) return;
+
+    // Вместе с узлом в стеке лежит маска плоскостей, относительно которых ещё неизвестно положение:
+    // если бокс целиком по внутреннюю сторону плоскости, его потомков с ней можно не проверять
+    constexpr uint32_t ALL_PLANES = (1u << 6) - 1;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, ALL_PLANES);
+    while (!stack.empty())
+    {
+        auto [index, mask] = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[index];
+
+        if (mask != 0)
+        {
+            const WrpAabb& bounds = node.isLeaf() ? proxies[node.proxy].bounds : node.bounds;
+            const glm::vec3 center = bounds.center();
+            const glm::vec3 extents = bounds.extents();
+            bool outside = false;
+            for (uint32_t p = 0; p < planes.size(); p++)
+            {
+                if (!(mask & (1u << p))) continue;
+                const glm::vec3 normal{planes[p]};
+                const float distance = glm::dot(normal, center) + planes[p].w;
+                const float radius = glm::dot(extents, glm::abs(normal));
+                if (distance < -radius) { outside = true; break; }
+                if (distance >= radius) mask &= ~(1u << p);
+            }
+            if (outside) continue;
+        }
+
+        if (node.isLeaf())
+        {
+            out.push_back(proxies[node.proxy].userData);
+            continue;
+        }
+        stack.emplace_back(node.child1, mask);
+        stack.emplace_back(node.child2, mask);
+    }
+}
+
+void WrpBvh::querySphere(const WrpBoundingSphere& sphere, std::vector<uint32_t>& out) const
+{
+    if (root == NO_NODE) return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.isLeaf() ? proxies[node.proxy].bounds : node.bounds, sphere)) continue;
+
+        if (node.isLeaf())
+        {
+            out.push_back(proxies[node.proxy].userData);
+            continue;
+        }
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+    }
+}
+
+void WrpBvh::queryAabb(const WrpAabb& box, std::vector<uint32_t>& out) const
+{
+    if (root == NO_NODE) return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.isLeaf() ? proxies[node.proxy].bounds : node.bounds, box)) continue;
+
+        if (node.isLeaf())
+        {
+            out.push_back(proxies[node.proxy].userData);
+            continue;
+        }
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+    }
+}
+
+bool WrpBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+    uint32_t& outUserData, float& outDistance,
+    const std::function<float(uint32_t userData, float maxDistance)>& hitTest) const
+{
+    if (root == NO_NODE) return false;
+
+    const glm::vec3 inverseDirection = 1.f / direction;
+    float closest = maxDistance;
+    bool found = false;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.isLeaf())
+        {
+            const Proxy& proxy = proxies[node.proxy];
+            float distance = intersectRay(proxy.bounds, origin, inverseDirection, closest);
+            if (distance >= 0.f && hitTest)
+                distance = hitTest(proxy.userData, closest);
+            if (distance >= 0.f && distance <= closest)
+            {
+                closest = distance;
+                outUserData = proxy.userData;
+                found = true;
+            }
+            continue;
+        }
+
+        // ближний ребёнок кладётся в стек последним, чтобы найденное в нём попадание сократило обход дальнего
+        const float distance1 = intersectRay(nodes[node.child1].bounds, origin, inverseDirection, closest);
+        const float distance2 = intersectRay(nodes[node.child2].bounds, origin, inverseDirection, closest);
+        if (distance1 >= 0.f && distance2 >= 0.f)
+        {
+            const bool firstIsNear = distance1 <= distance2;
+            stack.push_back(firstIsNear ? node.child2 : node.child1);
+            stack.push_back(firstIsNear ? node.child1 : node.child2);
+        }
+        else if (distance1 >= 0.f)
+        {
+            stack.push_back(node.child1);
+        }
+        else if (distance2 >= 0.f)
+        {
+            stack.push_back(node.child2);
+        }
+    }
+
+    if (found) outDistance = closest;
+    return found;
+}
+
+float WrpBvh::getSahCost() const
+{
+    if (root == NO_NODE || nodes[root].isLeaf()) return 0.f;
+
+    float internalArea = 0.f;
+    std::vector<uint32_t> stack{root};
+    while (!stack.empty())
+    {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.isLeaf()) continue;
+        internalArea += area(node.bounds);
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+    }
+    return internalArea / area(nodes[root].bounds);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Bounds.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <limits>
+#include <vector>
+
+/*
+ * Динамическая иерархия ограничивающих объёмов (BVH) по мировым AABB объектов.
+ * Каждый объект - прокси с пользовательскими данными (номер слота, id и т.п.) и листом дерева.
+ * Лист хранит "толстый" бокс (границы объекта, расширенные на запас), поэтому небольшие перемещения
+ * не меняют дерево. Вышедший за запас объект переставляется: лист удаляется и вставляется к соседу с наименьшим
+ * приростом площади поверхности, а на пути к корню узлы перестраиваются поворотами (перестановкой внука
+ * и дяди), если это уменьшает площадь. Качество такого дерева постепенно падает, поэтому после заметного
+ * числа вставок и перестановок в WrpJobSystem строится новое дерево по SAH (binned), которое подменяет текущее на
+ * следующем maintain; изменения, сделанные во время построения, применяются к новому дереву повторно.
+ * Запросы проверяют листья по точным границам прокси.
+ */
+class WrpBvh
+{
+public:
+    static constexpr uint32_t NO_PROXY = std::numeric_limits<uint32_t>::max();
+
+    explicit WrpBvh(float fatMargin = .1f) : fatMargin{fatMargin} {}
+    ~WrpBvh();
+
+    WrpBvh(const WrpBvh&) = delete;
+    WrpBvh& operator=(const WrpBvh&) = delete;
+
+    uint32_t insert(const WrpAabb& bounds, uint32_t userData);
+    void remove(uint32_t proxy);
+    // Новые границы объекта. Возвращает true, если лист пришлось переставить.
+    bool move(uint32_t proxy, const WrpAabb& bounds);
+
+    uint32_t getUserData(uint32_t proxy) const { return proxies[proxy].userData; }
+    const WrpAabb& getBounds(uint32_t proxy) const { return proxies[proxy].bounds; }
+    size_t size() const { return proxyCount; }
+
+    // Раз в кадр: подмена деревом из фонового SAH построения, если оно готово, и запуск нового при деградации
+    void maintain();
+    // Синхронное построение по SAH (после загрузки сцены и т.п.)
+    void rebuild();
+
+    // Запросы дописывают в out пользовательские данные пересекающихся прокси
+    void queryFrustum(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& out) const;
+    void querySphere(const WrpBoundingSphere& sphere, std::vector<uint32_t>& out) const;
+    void queryAabb(const WrpAabb& box, std::vector<uint32_t>& out) const;
+    // Ближайшее пересечение луча (direction не обязан быть нормирован, расстояние - в его длинах).
+    // hitTest уточняет попадание в прокси: возвращает расстояние или отрицательное число при промахе,
+    // без hitTest попаданием считается вход луча в границы прокси.
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+        uint32_t& outUserData, float& outDistance,
+        const std::function<float(uint32_t userData, float maxDistance)>& hitTest = nullptr) const;
+
+    // высота дерева и стоимость по SAH (сумма площадей внутренних узлов к площади корня) для статистики
+    int getHeight() const { return root == NO_NODE ? 0 : nodes[root].height; }
+    float getSahCost() const;
+    bool isRebuilding() const { return pendingBuild.valid(); }
+
+private:
+    static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+    struct Node
+    {
+        WrpAabb bounds{};
+        uint32_t parent = NO_NODE;
+        uint32_t child1 = NO_NODE; // NO_NODE у листа
+        uint32_t child2 = NO_NODE;
+        uint32_t proxy = NO_PROXY;
+        int32_t height = 0;        // 0 у листа
+
+        bool isLeaf() const { return child1 == NO_NODE; }
+    };
+
+    struct Proxy
+    {
+        WrpAabb bounds{};          // точные границы объекта
+        uint32_t userData = 0;
+        uint32_t node = NO_NODE;
+        bool alive = false;
+        bool changed = false;      // прокси менялся после снимка для фонового построения
+    };
+
+    struct BuildItem
+    {
+        WrpAabb bounds;
+        glm::vec3 centroid;
+        uint32_t proxy;
+    };
+
+    struct BuildResult
+    {
+        std::vector<Node> nodes;
+        uint32_t root = NO_NODE;
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t node);
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    void refitUpwards(uint32_t node);
+    void rotate(uint32_t node);
+    void markChanged(uint32_t proxy);
+    WrpAabb fatten(const WrpAabb& bounds) const;
+
+    std::vector<BuildItem> snapshotLeaves() const;
+    void applyBuild(BuildResult&& result);
+    static BuildResult build(std::vector<BuildItem> items);
+    static uint32_t buildRange(BuildResult& result, std::vector<BuildItem>& items, uint32_t first, uint32_t end);
+
+    float fatMargin;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = NO_NODE;
+
+    std::vector<Proxy> proxies;
+    std::vector<uint32_t> freeProxies;
+    size_t proxyCount = 0;
+
+    // вставки и перестановки листьев после последнего построения по SAH
+    size_t leafUpdates = 0;
+    std::future<BuildResult> pendingBuild;
+    std::vector<uint32_t> changedProxies; // прокси, добавленные, удалённые или переставленные после снимка
+};
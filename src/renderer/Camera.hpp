@@ -30,9 +30,13 @@ public:
     const glm::mat4& getView() const {return viewMatrix;}
     const glm::mat4& getInverseView() const {return inverseViewMatrix;}
     const glm::vec3 getPosition() const {return glm::vec3(inverseViewMatrix[3]);}
+    float getNear() const {return nearPlane;}
+    float getFar() const {return farPlane;}
 
 private:
     glm::mat4 projectionMatrix{1.f}; // матрица проекции перспективы
     glm::mat4 viewMatrix{1.f}; // матрица просмотра (камеры)
     glm::mat4 inverseViewMatrix{1.f}; // матрица для обратного преобразования позиций из camera space в world space
+    float nearPlane = .1f; // расстояния до ближней и дальней плоскостей отсечения последней заданной проекции
+    float farPlane = 100.f;
 };
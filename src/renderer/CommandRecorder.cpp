@@ -0,0 +1,101 @@
+#include "CommandRecorder.hpp"
+
+// std
+#include <stdexcept>
+
+WrpCommandRecorder::WrpCommandRecorder(WrpDevice& device, WrpRenderer& renderer, uint32_t framesCount)
+    : wrpDevice{device}, wrpRenderer{renderer}, threadSlots{WrpJobSystem::instance().getWorkerCount() + 1}
+{
+    framePools.resize(framesCount * (threadSlots + 1));
+    for (auto& slot : framePools)
+    {
+        // буферы не сбрасываются по одному, весь пул сбрасывается в начале кадра
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = wrpDevice.getGraphicsQueueFamily();
+        if (vkCreateCommandPool(wrpDevice.device(), &poolInfo, nullptr, &slot.pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create secondary command pool!");
+        }
+    }
+}
+
+WrpCommandRecorder::~WrpCommandRecorder()
+{
+    // буферы команд освобождаются вместе с пулом
+    for (auto& slot : framePools)
+    {
+        vkDestroyCommandPool(wrpDevice.device(), slot.pool, nullptr);
+    }
+}
+
+void WrpCommandRecorder::beginFrame(int frameIndex)
+{
+    currentFrame = frameIndex;
+    setRenderPass(VK_NULL_HANDLE, VK_NULL_HANDLE, {});
+    for (uint32_t slot = 0; slot <= threadSlots; slot++)
+    {
+        SlotPool& pool = slotPool(slot);
+        if (pool.used == 0)
+            continue;
+        vkResetCommandPool(wrpDevice.device(), pool.pool, 0);
+        pool.used = 0;
+    }
+}
+
+void WrpCommandRecorder::setRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D renderExtent)
+{
+    inheritedRenderPass = renderPass;
+    inheritedFramebuffer = framebuffer;
+    inheritedExtent = renderExtent;
+}
+
+VkCommandBuffer WrpCommandRecorder::beginSecondary(uint32_t slot)
+{
+    SlotPool& pool = slotPool(slot);
+    if (pool.used == pool.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(wrpDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate secondary command buffer!");
+        }
+        pool.commandBuffers.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    const bool swapChainPass = inheritedRenderPass == VK_NULL_HANDLE;
+    inheritanceInfo.renderPass = swapChainPass ? wrpRenderer.getSwapChainRenderPass() : inheritedRenderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = swapChainPass ? wrpRenderer.getCurrentFramebuffer() : inheritedFramebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to begin recording secondary command buffer!");
+    }
+    if (swapChainPass)
+        wrpRenderer.setSwapChainViewport(commandBuffer);
+    else
+        WrpRenderer::setViewport(commandBuffer, inheritedExtent);
+    return commandBuffer;
+}
+
+void WrpCommandRecorder::endSecondary(VkCommandBuffer commandBuffer)
+{
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record secondary command buffer!");
+    }
+}
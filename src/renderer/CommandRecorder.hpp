@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Renderer.hpp"
+#include "FrameInfo.hpp"
+#include "JobSystem.hpp"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <vector>
+
+/*
+ * Параллельная запись команд прохода рендера во вторичные буферы команд.
+ * Пул команд нельзя использовать из нескольких потоков одновременно, поэтому у каждого слота записи
+ * (задача WrpJobSystem или главный поток) свой пул на каждый кадр в полёте. Пулы кадра сбрасываются целиком
+ * в beginFrame, когда его fence уже пройден, а выделенные буферы переиспользуются.
+ * Вторичные буферы наследуют проход рендера swapchain'а (или заданный setRenderPass, например G-buffer)
+ * и выполняются первичным в порядке их записи.
+ */
+class WrpCommandRecorder
+{
+public:
+    WrpCommandRecorder(WrpDevice& device, WrpRenderer& renderer, uint32_t framesCount);
+    ~WrpCommandRecorder();
+
+    WrpCommandRecorder(const WrpCommandRecorder&) = delete;
+    WrpCommandRecorder& operator=(const WrpCommandRecorder&) = delete;
+
+    // максимальное число потоков записи: рабочие потоки WrpJobSystem + главный
+    uint32_t getMaxThreads() const { return threadSlots; }
+
+    void beginFrame(int frameIndex);
+    // Проход рендера, который наследуют следующие вторичные буферы кадра, и область кадра для их viewport и scissor.
+    // VK_NULL_HANDLE - проход swapchain'а (на весь swapchain, renderExtent не используется),
+    // к нему же наследование возвращается в beginFrame.
+    void setRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D renderExtent);
+
+    // Начинает вторичный буфер в текущем наследуемом проходе рендера (с viewport и scissor) из пула слота.
+    // Слот threadSlots зарезервирован за главным потоком для записи вне recordParallel.
+    VkCommandBuffer beginSecondary(uint32_t slot);
+    VkCommandBuffer beginSecondary() { return beginSecondary(threadSlots); }
+
+    // Делит itemCount элементов на непрерывные диапазоны по числу потоков и записывает каждый во вторичный буфер:
+    // record(commandBuffer, first, count, stats). Первый диапазон записывает сам вызывающий поток.
+    // Возвращает буферы в порядке диапазонов, счётчики потоков добавляются в stats.
+    template <typename F>
+    std::vector<VkCommandBuffer> recordParallel(uint32_t itemCount, uint32_t threads, RenderStats& stats, F record)
+    {
+        const uint32_t chunks = std::min({itemCount, std::max(threads, 1u), threadSlots});
+        std::vector<VkCommandBuffer> commandBuffers(chunks);
+        std::vector<RenderStats> chunkStats(chunks);
+        auto recordChunk = [&](uint32_t chunk) {
+            const uint32_t first = static_cast<uint32_t>(uint64_t{itemCount} * chunk / chunks);
+            const uint32_t last = static_cast<uint32_t>(uint64_t{itemCount} * (chunk + 1) / chunks);
+            commandBuffers[chunk] = beginSecondary(chunk);
+            record(commandBuffers[chunk], first, last - first, chunkStats[chunk]);
+            endSecondary(commandBuffers[chunk]);
+        };
+
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(chunks);
+        for (uint32_t chunk = 1; chunk < chunks; chunk++)
+        {
+            jobs.push_back(WrpJobSystem::instance().submit([&recordChunk, chunk]() { recordChunk(chunk); }));
+        }
+        // задачи ссылаются на локальные переменные, поэтому даже при ошибке дожидаемся их все
+        std::exception_ptr error;
+        try
+        {
+            if (chunks != 0)
+                recordChunk(0);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        for (auto& job : jobs)
+        {
+            try
+            {
+                job.get(); // пробрасывает исключения из потоков записи
+            }
+            catch (...)
+            {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+
+        for (const auto& chunk : chunkStats)
+        {
+            stats += chunk;
+        }
+        return commandBuffers;
+    }
+
+    void endSecondary(VkCommandBuffer commandBuffer);
+
+private:
+    struct SlotPool
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t used = 0;
+    };
+
+    SlotPool& slotPool(uint32_t slot) { return framePools[currentFrame * (threadSlots + 1) + slot]; }
+
+    WrpDevice& wrpDevice;
+    WrpRenderer& wrpRenderer;
+    uint32_t threadSlots;
+    std::vector<SlotPool> framePools; // [кадр][слот], слот threadSlots - главный поток
+    int currentFrame = 0;
+    VkRenderPass inheritedRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer inheritedFramebuffer = VK_NULL_HANDLE;
+    VkExtent2D inheritedExtent{};
+};
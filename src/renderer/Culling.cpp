@@ -0,0 +1,156 @@
+#include "Culling.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WRP_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cmath>
+
+WrpFrustumCuller::WrpFrustumCuller(const WrpCamera& camera)
+    : WrpFrustumCuller(camera.getProjection() * camera.getView())
+{
+}
+
+WrpFrustumCuller::WrpFrustumCuller(const glm::mat4& viewProjection)
+{
+    // GLM хранит матрицы по столбцам, поэтому строка i = (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&viewProjection](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+    const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    planes[0] = r3 + r0; // left
+    planes[1] = r3 - r0; // right
+    planes[2] = r3 + r1; // bottom
+    planes[3] = r3 - r1; // top
+    planes[4] = r2;      // near (глубина в интервале [0, 1], GLM_FORCE_DEPTH_ZERO_TO_ONE)
+    planes[5] = r3 - r2; // far
+
+    for (auto& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+WrpBoundingSphere WrpFrustumCuller::transformSphere(const glm::mat4& modelMatrix, const WrpBoundingSphere& sphere)
+{
+    const float maxScale = std::sqrt(std::max({
+        glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0])),
+        glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1])),
+        glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2]))
+    }));
+    return {glm::vec3(modelMatrix * glm::vec4(sphere.center, 1.f)), sphere.radius * maxScale};
+}
+
+bool WrpFrustumCuller::testSphere(const WrpBoundingSphere& sphere) const
+{
+    for (const auto& plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+void WrpFrustumCuller::testSpheres(const WrpBoundingSphere* spheres, size_t count, uint8_t* visible) const
+{
+    size_t i = 0;
+#ifdef WRP_CULLING_SSE
+    // Четыре сферы за итерацию: координаты раскладываются в SoA-регистры,
+    // а каждая плоскость проверяется сразу для всех четырёх сфер.
+    for (; i + 4 <= count; i += 4)
+    {
+        const WrpBoundingSphere* s = spheres + i;
+        const __m128 x = _mm_setr_ps(s[0].center.x, s[1].center.x, s[2].center.x, s[3].center.x);
+        const __m128 y = _mm_setr_ps(s[0].center.y, s[1].center.y, s[2].center.y, s[3].center.y);
+        const __m128 z = _mm_setr_ps(s[0].center.z, s[1].center.z, s[2].center.z, s[3].center.z);
+        const __m128 negRadius = _mm_setr_ps(-s[0].radius, -s[1].radius, -s[2].radius, -s[3].radius);
+
+        auto insidePlane = [&](const glm::vec4& plane) {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            return _mm_cmpge_ps(distance, negRadius);
+        };
+        __m128 inside = insidePlane(planes[0]);
+        for (size_t p = 1; p < planes.size(); p++)
+        {
+            inside = _mm_and_ps(inside, insidePlane(planes[p]));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = (mask >> 0) & 1;
+        visible[i + 1] = (mask >> 1) & 1;
+        visible[i + 2] = (mask >> 2) & 1;
+        visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+    // хвост пачки (или весь массив без SSE)
+    for (; i < count; i++)
+    {
+        visible[i] = testSphere(spheres[i]) ? 1 : 0;
+    }
+}
+
+std::vector<uint8_t> WrpFrustumCuller::cullObjects(const std::vector<WrpRenderObject>& objects, const WrpTransformCache& transforms,
+    RenderStats& stats) const
+{
+    // Видимые слоты собираются обходом BVH: узлы вне пирамиды отбрасываются вместе со всеми объектами под ними,
+    // а узлы целиком внутри принимаются без проверки листьев
+    candidateScratch.clear();
+    transforms.spatialIndex().queryFrustum(planes, candidateScratch);
+    slotScratch.assign(transforms.getSlotCount(), 0);
+    for (uint32_t slot : candidateScratch)
+        slotScratch[slot] = 1;
+
+    std::vector<uint8_t> visible(objects.size(), 0);
+    for (size_t i = 0; i < objects.size(); i++)
+        visible[i] = slotScratch[transforms.slotIndex(*objects[i].transform)];
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (visible[i])
+        {
+            stats.objectsVisible++;
+        }
+        else
+        {
+            stats.objectsCulled++;
+            stats.trianglesCulled += objects[i].model->getTriangleCount();
+        }
+    }
+    return visible;
+}
+
+void WrpFrustumCuller::cullSubMeshes(const glm::mat4& modelMatrix, const WrpModel& model,
+    std::vector<uint8_t>& visible, RenderStats& stats) const
+{
+    const auto& subMeshes = model.getSubMeshesInfos();
+    visible.assign(subMeshes.size(), 1);
+    if (subMeshes.size() > 1)
+    {
+        sphereScratch.resize(subMeshes.size());
+        for (size_t i = 0; i < subMeshes.size(); i++)
+        {
+            sphereScratch[i] = transformSphere(modelMatrix, subMeshes[i].boundingSphere);
+        }
+        testSpheres(sphereScratch.data(), sphereScratch.size(), visible.data());
+    }
+
+    for (size_t i = 0; i < subMeshes.size(); i++)
+    {
+        const uint32_t triangles = subMeshes[i].indexCount / 3;
+        if (visible[i])
+        {
+            stats.trianglesVisible += triangles;
+        }
+        else
+        {
+            stats.subMeshesCulled++;
+            stats.trianglesCulled += triangles;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Camera.hpp"
+#include "FrameInfo.hpp"
+#include "Model.hpp"
+#include "TransformCache.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Отсечение по пирамиде видимости камеры.
+ * Плоскости извлекаются из произведения projection * view (метод Gribb/Hartmann),
+ * а ограничивающие сферы объектов проверяются пачками по 4 штуки SIMD-инструкциями (SSE),
+ * на платформах без SSE используется скалярная проверка.
+ */
+class WrpFrustumCuller
+{
+public:
+    explicit WrpFrustumCuller(const WrpCamera& camera);
+    explicit WrpFrustumCuller(const glm::mat4& viewProjection);
+
+    // Проверка сфер в мировом пространстве: visible[i] = 1, если сфера пересекает пирамиду видимости
+    void testSpheres(const WrpBoundingSphere* spheres, size_t count, uint8_t* visible) const;
+    bool testSphere(const WrpBoundingSphere& sphere) const;
+
+    // Видимость объектов целиком: результат выровнен с массивом objects, мировые сферы берутся из кэша преобразований.
+    // Проверяются мировые AABB из пространственного индекса кэша (WrpBvh).
+    std::vector<uint8_t> cullObjects(const std::vector<WrpRenderObject>& objects, const WrpTransformCache& transforms,
+        RenderStats& stats) const;
+    // Видимость подобъектов уже прошедшей проверку модели (для моделей из одного подобъекта проверка не повторяется)
+    void cullSubMeshes(const glm::mat4& modelMatrix, const WrpModel& model,
+        std::vector<uint8_t>& visible, RenderStats& stats) const;
+
+    // Перевод сферы из пространства модели в мировое. Радиус масштабируется по наибольшей оси,
+    // поэтому при неравномерном масштабе сфера остаётся консервативной.
+    static WrpBoundingSphere transformSphere(const glm::mat4& modelMatrix, const WrpBoundingSphere& sphere);
+
+    // те же плоскости передаются в compute шейдер GPU отсечения
+    const std::array<glm::vec4, 6>& getPlanes() const { return planes; }
+
+private:
+    // плоскости (nx, ny, nz, d) с нормалями внутрь пирамиды: left, right, bottom, top, near, far
+    std::array<glm::vec4, 6> planes;
+
+    // буферы текущей пачки, чтобы не выделять память каждый кадр
+    mutable std::vector<WrpBoundingSphere> sphereScratch;
+    mutable std::vector<uint8_t> slotScratch;
+    mutable std::vector<uint32_t> candidateScratch;
+};
@@ -11,7 +11,8 @@ WrpDescriptorSetLayout::Builder& WrpDescriptorSetLayout::Builder::addBinding(
 	uint32_t binding,
 	VkDescriptorType descriptorType,
 	VkShaderStageFlags stageFlags,
-	uint32_t count)
+	uint32_t count,
+	VkDescriptorBindingFlags flags)
 {
 	assert(bindings.count(binding) == 0 && "Binding already in use.");
 	VkDescriptorSetLayoutBinding layoutBinding{};
@@ -21,30 +22,57 @@ WrpDescriptorSetLayout::Builder& WrpDescriptorSetLayout::Builder::addBinding(
 	layoutBinding.stageFlags = stageFlags;
 	layoutBinding.pImmutableSamplers = nullptr; // Optional
 	bindings[binding] = layoutBinding;
+	if (flags != 0)
+	{
+		bindingFlags[binding] = flags;
+	}
 	return *this;
 }
 
 std::unique_ptr<WrpDescriptorSetLayout> WrpDescriptorSetLayout::Builder::build() const
 {
-	return std::make_unique<WrpDescriptorSetLayout>(wrpDevice, bindings);
+	return std::make_unique<WrpDescriptorSetLayout>(wrpDevice, bindings, bindingFlags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 WrpDescriptorSetLayout::WrpDescriptorSetLayout(
-	WrpDevice& wrpDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-	: wrpDevice{wrpDevice}, bindings{bindings}
+	WrpDevice& wrpDevice,
+	std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+	const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags)
+	: wrpDevice{wrpDevice}, bindings{bindings}, bindingFlags{bindingFlags}
 {
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+	std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{}; // в том же порядке, что и setLayoutBindings
+	bool updateAfterBind = false;
 	for (auto& kv : bindings)
 	{
 		setLayoutBindings.push_back(kv.second);
+
+		auto flagsIt = bindingFlags.find(kv.first);
+		VkDescriptorBindingFlags flags = flagsIt != bindingFlags.end() ? flagsIt->second : 0;
+		setLayoutBindingFlags.push_back(flags);
+		updateAfterBind |= (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
 	}
 
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 	descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+	if (!bindingFlags.empty())
+	{
+		descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+	}
+	if (updateAfterBind)
+	{
+		// наборы с таким лэйаутом можно выделять только из пула с VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT
+		descriptorSetLayoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
 
 	if (vkCreateDescriptorSetLayout(wrpDevice.device(), &descriptorSetLayoutInfo,
 		nullptr, &descriptorSetLayout) != VK_SUCCESS)
@@ -114,7 +142,9 @@ WrpDescriptorPool::~WrpDescriptorPool()
 }
 
 bool WrpDescriptorPool::allocateDescriptorSet(
-	const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptorSet) const
+	const VkDescriptorSetLayout descriptorSetLayout,
+	VkDescriptorSet& descriptorSet,
+	uint32_t variableDescriptorCount) const
 {
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -122,6 +152,15 @@ bool WrpDescriptorPool::allocateDescriptorSet(
 	allocInfo.pSetLayouts = &descriptorSetLayout; // в лэйауте обозначен тип и кол-во дескрипторов в наборе
 	allocInfo.descriptorSetCount = 1;
 
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+	variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	variableCountInfo.descriptorSetCount = 1;
+	variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+	if (variableDescriptorCount > 0)
+	{
+		allocInfo.pNext = &variableCountInfo;
+	}
+
 	// todo: Might want to create a "DescriptorPoolManager" class that handles this case, and builds
 	// a new pool whenever an old pool fills up. But this is beyond our current scope
 	if (vkAllocateDescriptorSets(wrpDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS)
@@ -181,15 +220,21 @@ WrpDescriptorWriter& WrpDescriptorWriter::writeBuffer(
 
 // Подготовка записи в дескриптор информации о его ресурсе-изображении 
 WrpDescriptorWriter& WrpDescriptorWriter::writeImage(
-	uint32_t binding, VkDescriptorImageInfo* imageInfo, uint32_t count)
+	uint32_t binding, VkDescriptorImageInfo* imageInfo, uint32_t count, uint32_t dstArrayElement)
 {
 	assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding.");
 
 	auto& bindingDescription = setLayout.bindings[binding];
 
-	assert(bindingDescription.descriptorCount == count &&
+	// массив целиком обязателен только для привязок без VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT,
+	// частично связанные (bindless) массивы обновляются поэлементно начиная с dstArrayElement
+	auto flagsIt = setLayout.bindingFlags.find(binding);
+	bool partiallyBound = flagsIt != setLayout.bindingFlags.end()
+		&& (flagsIt->second & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT) != 0;
+	assert((partiallyBound ? dstArrayElement + count <= bindingDescription.descriptorCount
+		: dstArrayElement == 0 && bindingDescription.descriptorCount == count) &&
 		"DescriptorCount in VkWriteDescriptorSet for image resource "
-		"is not equal to DSLayout binding's descriptor count.");
+		"does not match DSLayout binding's descriptor count.");
 
 	VkWriteDescriptorSet write{};
 	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -197,7 +242,7 @@ WrpDescriptorWriter& WrpDescriptorWriter::writeImage(
 	write.dstBinding = binding;
 	write.pImageInfo = imageInfo; // Единственное отличие от writeBuffer()
 	write.descriptorCount = count;
-	write.dstArrayElement = 0;
+	write.dstArrayElement = dstArrayElement;
 
 	writes.push_back(write);
 	return *this;
@@ -22,7 +22,8 @@ public:
             uint32_t binding,
             VkDescriptorType descriptorType,
             VkShaderStageFlags stageFlags,
-            uint32_t count = 1);
+            uint32_t count = 1,
+            VkDescriptorBindingFlags bindingFlags = 0); // флаги descriptor indexing (partially bound, update after bind, ...)
         // Создание экземпляра WrpDescriptorSetLayout на основе текущей мапы привязок
         std::unique_ptr<WrpDescriptorSetLayout> build() const;
 
@@ -30,9 +31,13 @@ public:
         WrpDevice& wrpDevice;
         // Мапа с информацией по каждой привязке. На основе этой мапы строится WrpDescriptorSetLayout
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+        std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
     };
 
-    WrpDescriptorSetLayout(WrpDevice& wrpDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+    WrpDescriptorSetLayout(
+        WrpDevice& wrpDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
     ~WrpDescriptorSetLayout();
     WrpDescriptorSetLayout(const WrpDescriptorSetLayout&) = delete;
     WrpDescriptorSetLayout& operator=(const WrpDescriptorSetLayout&) = delete;
@@ -43,6 +48,7 @@ private:
     WrpDevice& wrpDevice;
     VkDescriptorSetLayout descriptorSetLayout;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+    std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags;
 
     friend class WrpDescriptorWriter;
 };
@@ -79,8 +85,12 @@ public:
     WrpDescriptorPool(const WrpDescriptorPool&) = delete;
     WrpDescriptorPool& operator=(const WrpDescriptorPool&) = delete;
 
-    // Выделение набора дескрипторов из пула
-    bool allocateDescriptorSet(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+    // Выделение набора дескрипторов из пула. variableDescriptorCount > 0 задаёт реальный размер
+    // последней привязки набора, если она объявлена с VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+    bool allocateDescriptorSet(
+        const VkDescriptorSetLayout descriptorSetLayout,
+        VkDescriptorSet& descriptor,
+        uint32_t variableDescriptorCount = 0) const;
 
     // Освобождение дескрипторов из пула
     void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
@@ -105,7 +115,12 @@ public:
     // Готовит запись для информации о буфере дескриптора
     WrpDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
     // Готовт запись для информации о ресурсе-изображении дескрипторов
-    WrpDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo, uint32_t count = 1);
+    // dstArrayElement позволяет обновить отдельные элементы массива дескрипторов (например, ячейки bindless массива)
+    WrpDescriptorWriter& writeImage(
+        uint32_t binding,
+        VkDescriptorImageInfo* imageInfo,
+        uint32_t count = 1,
+        uint32_t dstArrayElement = 0);
 
     // Выделяет набор из пула в переданный VkDescriptorSet
     // и конфигурирует его VkWriteDescriptorSet записями
@@ -1,6 +1,9 @@
 #include "Device.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -79,21 +82,26 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugReportCallbackFUNC(
 
 // --- CLASS MEMBER FUNCTIONS ---
 
-WrpDevice::WrpDevice(WrpWindow& window) : window{window}
+WrpDevice::WrpDevice(WrpWindow* window) : window{window}
 {
     createInstance();      // Vulkan API initialization
     setupDebugMessenger(); // to control output messages from validation layer during debug
-    createSurface();       // surface to present output images to (window <-> frame image)
+    createSurface();       // surface to present output images to (window <-> frame image), none without a window
     pickPhysicalDevice();
+    queryOptionalFeatures();
     createLogicalDevice();
     createCommandPool();
+    createPipelineCache();
 }
 
 WrpDevice::~WrpDevice()
 {
+    savePipelineCache();
+    vkDestroyPipelineCache(device_, pipelineCache, nullptr);
     vkDestroyCommandPool(device_, commandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
-    vkDestroySurfaceKHR(instance, surface_, nullptr);
+    if (surface_ != VK_NULL_HANDLE) // без окна расширение поверхности не включено
+        vkDestroySurfaceKHR(instance, surface_, nullptr);
 
     if (enableValidationLayers)
     {
@@ -186,12 +194,16 @@ void WrpDevice::checkRequiredInstanceExtensionsAvailability()
 
 std::vector<const char*> WrpDevice::getRequiredInstanceExtensions()
 {
-    // GLFW required extensions
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // GLFW required extensions (surface and its platform extension), not needed without a window
+    if (window != nullptr)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     // Add extensions for debug messanger (handling validation layers output)
     if (enableValidationLayers) {
@@ -286,6 +298,53 @@ void WrpDevice::pickPhysicalDevice()
     std::cout << "Picked physical device: " << properties.deviceName << std::endl;
 }
 
+// Опциональный функционал: движок работает и без него, но использует более быстрые пути, если он поддерживается.
+void WrpDevice::queryOptionalFeatures()
+{
+    // структуры VkPhysicalDeviceVulkan12* можно запрашивать только у устройств с поддержкой Vulkan 1.2
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+        return;
+
+    VkPhysicalDeviceVulkan11Features features11{};
+    features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features11;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(physicalDevice_, &features2);
+
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physicalDevice_, &properties2);
+
+    // Bindless textures: один большой массив сэмплеров, в свободные ячейки которого можно писать, пока кадры в полёте
+    bindlessTexturesSupported = features12.descriptorIndexing
+        && features12.runtimeDescriptorArray
+        && features12.descriptorBindingPartiallyBound
+        && features12.descriptorBindingVariableDescriptorCount
+        && features12.descriptorBindingSampledImageUpdateAfterBind
+        && features12.descriptorBindingUpdateUnusedWhilePending;
+    maxBindlessTextures = std::min(properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        properties12.maxDescriptorSetUpdateAfterBindSampledImages);
+
+    // Multi-draw indirect: шейдер различает отрисовки внутри одного вызова по gl_DrawID
+    multiDrawIndirectSupported = features2.features.multiDrawIndirect && features11.shaderDrawParameters;
+    // Число indirect-отрисовок берётся из буфера: GPU отсечение упаковывает видимые команды без чтения на CPU
+    drawIndirectCountSupported = features12.drawIndirectCount;
+    // Ненулевой firstInstance в indirect-команде; без него начало экземпляров отрисовки передаётся через DrawData
+    drawIndirectFirstInstanceSupported = features2.features.drawIndirectFirstInstance;
+
+    std::cout << "Bindless textures (descriptor indexing): " << (bindlessTexturesSupported ? "supported" : "not supported") << std::endl;
+    std::cout << "Multi-draw indirect: " << (multiDrawIndirectSupported ? "supported" : "not supported") << std::endl;
+    std::cout << "Draw indirect count: " << (drawIndirectCountSupported ? "supported" : "not supported") << std::endl;
+    std::cout << "Draw indirect first instance: " << (drawIndirectFirstInstanceSupported ? "supported" : "not supported") << std::endl;
+}
+
 // Проверка пригодности переданного физического ус-ва для исп. движком.
 bool WrpDevice::isDeviceSuitable(VkPhysicalDevice physicalDevice)
 {
@@ -293,8 +352,9 @@ bool WrpDevice::isDeviceSuitable(VkPhysicalDevice physicalDevice)
 
     bool extensionsSupported = checkDeviceExtensionsSupport(physicalDevice);
 
-    bool isSwapChainAdequate = false;
-    if (extensionsSupported)
+    // без окна цепь обмена не создаётся, кадры рисуются во внеэкранные изображения
+    bool isSwapChainAdequate = window == nullptr;
+    if (extensionsSupported && window != nullptr)
     {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupportDetails(physicalDevice);
         isSwapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
@@ -331,7 +391,10 @@ QueueFamilyIndices WrpDevice::findQueueFamilies(VkPhysicalDevice physicalDevice)
 
         // Добавление индекса семейства очередей, которое поддерживает команды отображения
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface_, &presentSupport);
+        if (window != nullptr)
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface_, &presentSupport);
+        else // без окна кадры не показываются, семейством "показа" считается графическое
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
         if (queueFamily.queueCount > 0 && presentSupport)
         {
             indices.presentFamily = i;
@@ -370,14 +433,36 @@ void WrpDevice::createLogicalDevice()
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.sampleRateShading = VK_TRUE;   // sample shading feature
     deviceFeatures.fillModeNonSolid = VK_TRUE;    // support point and wireframe fill modes
+    deviceFeatures.multiDrawIndirect = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+    deviceFeatures.drawIndirectFirstInstance = drawIndirectFirstInstanceSupported ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceVulkan11Features features11 = {};
+    features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    features11.shaderDrawParameters = multiDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.pNext = &features11;
+    features12.drawIndirectCount = drawIndirectCountSupported ? VK_TRUE : VK_FALSE;
+    if (bindlessTexturesSupported)
+    {
+        features12.descriptorIndexing = VK_TRUE;
+        features12.runtimeDescriptorArray = VK_TRUE;
+        features12.descriptorBindingPartiallyBound = VK_TRUE;
+        features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = properties.apiVersion >= VK_API_VERSION_1_2 ? &features12 : nullptr;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    const std::vector<const char*> extensions = getRequiredDeviceExtensions();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // Device validation layers is deprecated, but they are passed to the info struct to keep consistancy with older Vulkan implementations.
     if (enableValidationLayers)
@@ -417,7 +502,105 @@ void WrpDevice::createCommandPool()
     }
 }
 
-void WrpDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+// Создание кэша пайплайнов. Если на диске есть данные от предыдущего запуска и они были получены
+// на этом же GPU/драйвере, то кэш инициализируется ими и пайплайны создаются без повторной компиляции.
+void WrpDevice::createPipelineCache()
+{
+    std::vector<char> cacheData;
+    std::ifstream file(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::ate);
+    if (file.is_open())
+    {
+        cacheData.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(cacheData.data(), cacheData.size());
+        if (!file || !isPipelineCacheDataCompatible(cacheData))
+        {
+            std::cout << "Pipeline cache file \"" << PIPELINE_CACHE_PATH << "\" is invalid or was created by another device/driver, ignoring it." << std::endl;
+            cacheData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+    if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        // драйвер может отклонить данные, тогда пробуем создать пустой кэш
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        cacheData.clear();
+        if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+    }
+
+    pipelineCacheStats.warmStart = !cacheData.empty();
+    pipelineCacheStats.loadedSizeInBytes = cacheData.size();
+    std::cout << "Pipeline cache: " << (pipelineCacheStats.warmStart ? "warm start, loaded " : "cold start")
+        << (pipelineCacheStats.warmStart ? std::to_string(cacheData.size()) + " bytes" : "") << std::endl;
+}
+
+// Проверка заголовка данных кэша (VkPipelineCacheHeaderVersionOne) на совпадение с текущим физическим устройством
+bool WrpDevice::isPipelineCacheDataCompatible(const std::vector<char>& cacheData)
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (cacheData.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, cacheData.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header)
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Сохранение кэша пайплайнов на диск. Данные пишутся во временный файл, который затем переименовывается,
+// поэтому прерванное сохранение не оставит на диске повреждённый кэш.
+void WrpDevice::savePipelineCache()
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device_, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        return;
+
+    std::vector<char> cacheData(dataSize);
+    if (vkGetPipelineCacheData(device_, pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+        return;
+
+    const std::filesystem::path cachePath{PIPELINE_CACHE_PATH};
+    std::filesystem::path tmpPath = cachePath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(cacheData.data(), dataSize))
+        {
+            std::cerr << "Failed to write pipeline cache to " << tmpPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        std::cerr << "Failed to save pipeline cache: " << ec.message() << std::endl;
+        std::filesystem::remove(tmpPath, ec);
+        return;
+    }
+
+    std::cout << "Pipeline cache saved (" << dataSize << " bytes). Pipelines created this run: "
+        << pipelineCacheStats.pipelinesCreated << " in " << pipelineCacheStats.totalCreationTimeMs() << " ms ("
+        << (pipelineCacheStats.warmStart ? "warm" : "cold") << " cache)" << std::endl;
+}
+
+void WrpDevice::createSurface()
+{
+    if (window != nullptr)
+        window->createWindowSurface(instance, &surface_);
+}
 
 // Проверка есть ли требуемые слои проверки в списке доступных слоёв экземпляра.
 bool WrpDevice::checkValidationLayerSupport()
@@ -458,7 +641,8 @@ bool WrpDevice::checkDeviceExtensionsSupport(VkPhysicalDevice physicalDevice)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    const std::vector<const char*> extensions = getRequiredDeviceExtensions();
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto &extension : availableExtensions)
     {
@@ -468,6 +652,14 @@ bool WrpDevice::checkDeviceExtensionsSupport(VkPhysicalDevice physicalDevice)
     return requiredExtensions.empty();
 }
 
+// Без окна не нужна и цепь обмена (VK_KHR_swapchain)
+std::vector<const char*> WrpDevice::getRequiredDeviceExtensions() const
+{
+    if (window == nullptr)
+        return {};
+    return deviceExtensions;
+}
+
 SwapChainSupportDetails WrpDevice::querySwapChainSupportDetails(VkPhysicalDevice physicalDevice)
 {
     SwapChainSupportDetails details;
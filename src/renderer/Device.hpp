@@ -3,6 +3,7 @@
 #include "HeaderCore.hpp"
 #include "Window.hpp"
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <optional>
@@ -22,6 +23,17 @@ struct QueueFamilyIndices
     bool isComplete() { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
 
+// Статистика создания графических пайплайнов (холодный/тёплый старт кэша пайплайнов)
+struct PipelineCacheStats
+{
+    bool warmStart = false;                    // кэш был успешно загружен с диска
+    size_t loadedSizeInBytes = 0;
+    std::atomic<uint32_t> pipelinesCreated = 0;
+    std::atomic<uint64_t> creationTimeMicroseconds = 0;
+
+    double totalCreationTimeMs() const { return creationTimeMicroseconds.load() / 1000.0; }
+};
+
 class WrpDevice
 {
 public:
@@ -31,7 +43,10 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-    WrpDevice(WrpWindow& window);
+    WrpDevice(WrpWindow& window) : WrpDevice(&window) {}
+    // window == nullptr - устройство без окна (headless): поверхность и цепь обмена не создаются, расширения
+    // поверхности не требуются, поэтому подходит и программный Vulkan (lavapipe) на машине без дисплея
+    explicit WrpDevice(WrpWindow* window);
     ~WrpDevice();
 
     // Not copyable or movable
@@ -43,11 +58,23 @@ const bool enableValidationLayers = true;
     VkCommandPool getCommandPool() { return commandPool; }
     VkDevice device() { return device_; }
     VkSurfaceKHR surface() { return surface_; }
+    bool isHeadless() const { return window == nullptr; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
     VkInstance getInstance() { return instance; }
     VkPhysicalDevice getPhysicalDevice() { return physicalDevice_; }
     uint32_t getGraphicsQueueFamily() { return getQueueFamilies().graphicsFamily.value(); }
+    VkPipelineCache getPipelineCache() { return pipelineCache; }
+    // descriptor indexing (Vulkan 1.2 core): update-after-bind, partially bound, variable count sampler arrays
+    bool supportsBindlessTextures() const { return bindlessTexturesSupported; }
+    uint32_t getMaxBindlessTextures() const { return maxBindlessTextures; }
+    // multiDrawIndirect + shaderDrawParameters (gl_DrawID): несколько отрисовок за один вызов vkCmdDrawIndexedIndirect
+    bool supportsMultiDrawIndirect() const { return multiDrawIndirectSupported; }
+    // vkCmdDrawIndexedIndirectCount (Vulkan 1.2 core)
+    bool supportsDrawIndirectCount() const { return drawIndirectCountSupported; }
+    // drawIndirectFirstInstance: ненулевой firstInstance в VkDrawIndexedIndirectCommand
+    bool supportsDrawIndirectFirstInstance() const { return drawIndirectFirstInstanceSupported; }
+    PipelineCacheStats& getPipelineCacheStats() { return pipelineCacheStats; }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupportDetails(physicalDevice_); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -82,8 +109,12 @@ private:
     void setupDebugMessenger();
     void createSurface();
     void pickPhysicalDevice();
+    void queryOptionalFeatures();
     void createLogicalDevice();
     void createCommandPool();
+    void createPipelineCache();
+    void savePipelineCache();
+    bool isPipelineCacheDataCompatible(const std::vector<char>& cacheData);
 
     bool isDeviceSuitable(VkPhysicalDevice device);
     std::vector<const char*> getRequiredInstanceExtensions();
@@ -93,17 +124,26 @@ private:
     void populateDebugReportCallbackInfo(VkDebugReportCallbackCreateInfoEXT& createInfo);
     void checkRequiredInstanceExtensionsAvailability();
     bool checkDeviceExtensionsSupport(VkPhysicalDevice device);
+    std::vector<const char*> getRequiredDeviceExtensions() const;
     SwapChainSupportDetails querySwapChainSupportDetails(VkPhysicalDevice device);
 
-    WrpWindow& window;
+    WrpWindow* window; // nullptr без окна
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkDebugReportCallbackEXT debugReportCallback;
     VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
     VkCommandPool commandPool;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    PipelineCacheStats pipelineCacheStats;
+
+    bool bindlessTexturesSupported = false;
+    uint32_t maxBindlessTextures = 0;
+    bool multiDrawIndirectSupported = false;
+    bool drawIndirectCountSupported = false;
+    bool drawIndirectFirstInstanceSupported = false;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
 
@@ -0,0 +1,178 @@
+#include "DrawList.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr uint32_t PIPELINE_BITS = 8;
+    constexpr uint32_t MATERIAL_BITS = 16;
+    constexpr uint32_t MESH_BITS = 16;
+    constexpr uint32_t DEPTH_BITS = 24;
+    static_assert(PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+    constexpr uint64_t mask(uint32_t bits) { return (uint64_t{1} << bits) - 1; }
+}
+
+void WrpDrawList::clear()
+{
+    commands.clear();
+    meshIds.clear();
+}
+
+uint32_t WrpDrawList::meshId(WrpModel* model)
+{
+    auto [it, inserted] = meshIds.try_emplace(model, static_cast<uint32_t>(meshIds.size()));
+    return it->second;
+}
+
+void WrpDrawList::add(WrpModel* model, uint32_t objectIndex, uint32_t subMeshIndex,
+    uint32_t firstInstance, uint32_t instanceCount, uint32_t instanceGroup,
+    uint32_t pipelineId, uint32_t materialId, float viewDepth)
+{
+    commands.push_back({makeSortKey(pipelineId, materialId, meshId(model), viewDepth),
+        model, objectIndex, subMeshIndex, firstInstance, instanceCount, instanceGroup});
+}
+
+uint64_t WrpDrawList::makeSortKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth)
+{
+    // Для неотрицательных float битовое представление монотонно, поэтому старшие 24 бита
+    // (без знакового) можно сравнивать как целые без знания дальней плоскости отсечения.
+    uint32_t depthBits;
+    viewDepth = std::max(viewDepth, 0.f);
+    std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+    depthBits >>= 32 - DEPTH_BITS - 1;
+
+    return ((pipelineId & mask(PIPELINE_BITS)) << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS))
+        | ((materialId & mask(MATERIAL_BITS)) << (MESH_BITS + DEPTH_BITS))
+        | ((meshId & mask(MESH_BITS)) << DEPTH_BITS)
+        | (depthBits & mask(DEPTH_BITS));
+}
+
+void WrpDrawList::addInstanced(const std::vector<WrpRenderObject>& objects, const std::vector<uint8_t>& visibleObjects,
+    const WrpFrustumCuller* culler, const WrpOcclusionCuller* occlusionCuller,
+    const glm::mat4& view, const WrpTransformCache& transforms,
+    WrpInstanceBuffer& instanceBuffer, RenderStats& stats, bool instancing, uint32_t groupParts,
+    uint32_t pipelineId, uint32_t materialId)
+{
+    groupIndices.clear();
+    size_t groupCount = 0;
+    for (uint32_t i = 0; i < objects.size(); i++)
+    {
+        if (culler && !visibleObjects[i]) continue;
+        auto [it, inserted] = groupIndices.try_emplace(objects[i].model, static_cast<uint32_t>(groupCount));
+        if (inserted)
+        {
+            if (instanceGroups.size() <= groupCount) instanceGroups.emplace_back();
+            instanceGroups[groupCount++].clear();
+        }
+        instanceGroups[it->second].push_back(i);
+    }
+
+    for (size_t g = 0; g < groupCount; g++)
+    {
+        const auto& group = instanceGroups[g];
+        const uint32_t groupSize = static_cast<uint32_t>(group.size());
+        const uint32_t parts = instancing ? std::min(std::max(groupParts, 1u), groupSize) : groupSize;
+        for (uint32_t part = 0; part < parts; part++)
+        {
+            const uint32_t first = static_cast<uint32_t>(uint64_t{groupSize} * part / parts);
+            const uint32_t last = static_cast<uint32_t>(uint64_t{groupSize} * (part + 1) / parts);
+            addGroup(objects, group.data() + first, last - first, culler, occlusionCuller, view, transforms,
+                instanceBuffer, stats, pipelineId, materialId);
+        }
+    }
+}
+
+void WrpDrawList::addGroup(const std::vector<WrpRenderObject>& objects, const uint32_t* objectIndices, uint32_t instanceCount,
+    const WrpFrustumCuller* culler, const WrpOcclusionCuller* occlusionCuller,
+    const glm::mat4& view, const WrpTransformCache& transforms,
+    WrpInstanceBuffer& instanceBuffer, RenderStats& stats, uint32_t pipelineId, uint32_t materialId)
+{
+    WrpModel* model = objects[objectIndices[0]].model;
+    const WrpInstanceRange range = instanceBuffer.allocate(instanceCount);
+    const uint32_t firstInstance = range.first;
+    const WrpBoundingSphere& sphere = model->getBoundingSphere();
+
+    // глубина группы - глубина ближайшего экземпляра, чтобы сортировка спереди назад оставалась консервативной
+    float nearestDepth = std::numeric_limits<float>::max();
+    for (uint32_t k = 0; k < instanceCount; k++)
+    {
+        const auto& transform = *objects[objectIndices[k]].transform;
+        InstanceData& instance = instanceBuffer.at(firstInstance + k);
+        instance.modelMatrix = transforms.modelMatrix(transform);
+        instance.normalMatrix = transforms.normalMatrix(transform);
+        instance.boundingSphere = glm::vec4(sphere.center, sphere.radius);
+        instance.group = range.group;
+        instance.groupFirst = firstInstance;
+        nearestDepth = std::min(nearestDepth,
+            viewDepth(view, glm::vec3(instance.modelMatrix * glm::vec4(sphere.center, 1.f))));
+    }
+    stats.instances += instanceCount;
+
+    const auto& subMeshes = model->getSubMeshesInfos();
+    if (instanceCount == 1 && culler)
+    {
+        const glm::mat4& modelMatrix = instanceBuffer.at(firstInstance).modelMatrix;
+        culler->cullSubMeshes(modelMatrix, *model, visibleSubMeshes, stats);
+        if (occlusionCuller)
+            occlusionCuller->cullSubMeshes(modelMatrix, *model, visibleSubMeshes, stats);
+        for (uint32_t j = 0; j < subMeshes.size(); j++)
+        {
+            if (!visibleSubMeshes[j]) continue;
+            const glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(subMeshes[j].boundingSphere.center, 1.f));
+            add(model, objectIndices[0], j, firstInstance, 1, range.group, pipelineId, materialId, viewDepth(view, center));
+        }
+    }
+    else
+    {
+        // при GPU отсечении статистику видимости заполняет WrpGpuCulling
+        if (culler)
+            stats.trianglesVisible += static_cast<uint64_t>(model->getTriangleCount()) * instanceCount;
+        for (uint32_t j = 0; j < subMeshes.size(); j++)
+        {
+            add(model, objectIndices[0], j, firstInstance, instanceCount, range.group, pipelineId, materialId, nearestDepth);
+        }
+    }
+}
+
+float WrpDrawList::viewDepth(const glm::mat4& view, const glm::vec3& worldPosition)
+{
+    return (view * glm::vec4(worldPosition, 1.f)).z;
+}
+
+void WrpDrawList::sort()
+{
+    // LSD radix sort по байтам ключа: 8 проходов, устойчивый, O(n).
+    // Проходы, в которых у всех ключей одинаковый байт (обычно старшие - пайплайн и материал), пропускаются.
+    const size_t count = commands.size();
+    if (count < 2) return;
+    sortScratch.resize(count);
+
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> histogram{};
+        for (const auto& command : commands)
+        {
+            histogram[(command.sortKey >> shift) & 0xFF]++;
+        }
+        if (histogram[(commands[0].sortKey >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (auto& bucket : histogram)
+        {
+            size_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+        for (const auto& command : commands)
+        {
+            sortScratch[histogram[(command.sortKey >> shift) & 0xFF]++] = command;
+        }
+        commands.swap(sortScratch);
+    }
+}
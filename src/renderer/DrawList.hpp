@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Model.hpp"
+#include "Culling.hpp"
+#include "OcclusionCulling.hpp"
+#include "InstanceBuffer.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Одна (instanced) команда отрисовки подобъекта модели. Данные группы объектов (отступы текстур и т.п.)
+// хранит сама система рендера в своём массиве, команда ссылается на них по objectIndex.
+// Матрицы экземпляров лежат в WrpInstanceBuffer в диапазоне [firstInstance, firstInstance + instanceCount).
+struct WrpDrawCommand
+{
+    uint64_t sortKey;
+    WrpModel* model;
+    uint32_t objectIndex;
+    uint32_t subMeshIndex;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t instanceGroup; // группа экземпляров в WrpInstanceBuffer (для GPU отсечения)
+};
+
+/*
+ * Список отрисовки с 64-битными ключами сортировки.
+ * Системы рендера сначала собирают в него видимые подобъекты, затем список сортируется поразрядно (LSD radix sort),
+ * и при записи команд соседние отрисовки с одинаковым состоянием не перепривязывают его.
+ *
+ * Раскладка ключа (от старших битов к младшим):
+ *   [63..56] пайплайн | [55..40] материал/набор дескрипторов | [39..24] меш | [23..0] глубина
+ * Глубина идёт последней, поэтому внутри одинакового состояния непрозрачная геометрия рисуется спереди назад (early-Z).
+ */
+class WrpDrawList
+{
+public:
+    void clear();
+    void add(WrpModel* model, uint32_t objectIndex, uint32_t subMeshIndex,
+        uint32_t firstInstance, uint32_t instanceCount, uint32_t instanceGroup,
+        uint32_t pipelineId, uint32_t materialId, float viewDepth);
+    void sort();
+
+    // Группирует видимые объекты по модели, записывает их матрицы в instanceBuffer и добавляет
+    // по одной instanced-команде на каждый подобъект модели. objectIndex команды - индекс первого объекта
+    // группы в objects. Подобъекты одиночных объектов дополнительно отсекаются по отдельности,
+    // у групп из нескольких экземпляров рисуются все подобъекты (общий вызов нельзя сократить для части экземпляров).
+    // Без culler (GPU отсечение) в группы попадают все объекты, а видимость экземпляров решает compute шейдер.
+    // С occlusionCuller подобъекты одиночных объектов, прошедшие пирамиду видимости, проверяются и на перекрытие.
+    // Группа модели делится на groupParts групп с непрерывными диапазонами экземпляров (по одной на поток записи,
+    // чтобы потокам было что делить и в сцене из одной модели), без instancing каждый объект - отдельная группа.
+    void addInstanced(const std::vector<WrpRenderObject>& objects, const std::vector<uint8_t>& visibleObjects,
+        const WrpFrustumCuller* culler, const WrpOcclusionCuller* occlusionCuller,
+        const glm::mat4& view, const WrpTransformCache& transforms,
+        WrpInstanceBuffer& instanceBuffer, RenderStats& stats, bool instancing = true, uint32_t groupParts = 1,
+        uint32_t pipelineId = 0, uint32_t materialId = 0);
+
+    const std::vector<WrpDrawCommand>& getCommands() const { return commands; }
+    size_t size() const { return commands.size(); }
+
+    static uint64_t makeSortKey(uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDepth);
+    // Глубина центра сферы в пространстве камеры (камера смотрит вдоль +z)
+    static float viewDepth(const glm::mat4& view, const glm::vec3& worldPosition);
+
+private:
+    // Порядковый номер модели в текущем кадре: меньше бит в ключе, чем указатель
+    uint32_t meshId(WrpModel* model);
+    // группа экземпляров из objects[objectIndices[0..instanceCount)] одной модели
+    void addGroup(const std::vector<WrpRenderObject>& objects, const uint32_t* objectIndices, uint32_t instanceCount,
+        const WrpFrustumCuller* culler, const WrpOcclusionCuller* occlusionCuller,
+        const glm::mat4& view, const WrpTransformCache& transforms,
+        WrpInstanceBuffer& instanceBuffer, RenderStats& stats, uint32_t pipelineId, uint32_t materialId);
+
+    std::vector<WrpDrawCommand> commands;
+    std::vector<WrpDrawCommand> sortScratch;
+    std::unordered_map<WrpModel*, uint32_t> meshIds;
+
+    // группы объектов по модели текущего кадра (индексы в массиве objects), переиспользуются между кадрами
+    std::unordered_map<WrpModel*, uint32_t> groupIndices;
+    std::vector<std::vector<uint32_t>> instanceGroups;
+    std::vector<uint8_t> visibleSubMeshes;
+};
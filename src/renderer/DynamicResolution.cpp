@@ -0,0 +1,288 @@
+#include "DynamicResolution.hpp"
+
+#include "SwapChain.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    constexpr float MIN_SCALE = .25f;
+    // доля нового измерения в сглаженном времени кадра: отдельные медленные кадры не дёргают разрешение
+    constexpr float FRAME_TIME_SMOOTHING = .1f;
+    // в пределах этого отклонения от целевого времени масштаб не меняется, иначе он колеблется около цели
+    constexpr float TOLERANCE = .05f;
+    // Измерение отстаёт от масштаба на число кадров в полёте и на сглаживание, поэтому за кадр масштаб проходит
+    // только часть пути к нужному значению: с полным шагом он колеблется вокруг цели
+    constexpr float SCALE_GAIN = .1f;
+    constexpr float MAX_SCALE_STEP = .02f;
+}
+
+WrpDynamicResolution::WrpDynamicResolution(WrpDevice& device, VkFormat colorFormat, VkFormat depthFormat,
+    VkSampleCountFlagBits msaaSampleCount)
+    : wrpDevice{device}, colorFormat{colorFormat}, depthFormat{depthFormat}, msaaSampleCount{msaaSampleCount}
+{
+    createRenderPass();
+    createSampler();
+
+    descriptorSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .build();
+    descriptorPool = WrpDescriptorPool::Builder(wrpDevice)
+        .setMaxSets(1)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+        .build();
+}
+
+WrpDynamicResolution::~WrpDynamicResolution()
+{
+    vkDestroyFramebuffer(wrpDevice.device(), framebuffer, nullptr);
+    vkDestroySampler(wrpDevice.device(), sampler, nullptr);
+    vkDestroyRenderPass(wrpDevice.device(), renderPass, nullptr);
+}
+
+void WrpDynamicResolution::declareAttachments(WrpRenderGraph& graph, VkExtent2D newExtent)
+{
+    renderGraph = &graph;
+    extent = newExtent;
+    colorAttachment = graph.createImage("Scene color", {colorFormat, extent, msaaSampleCount});
+    depthAttachment = graph.createImage("Scene depth", {depthFormat, extent, msaaSampleCount});
+    if (multisampled())
+        resolveAttachment = graph.createImage("Scene resolved color", {colorFormat, extent});
+}
+
+void WrpDynamicResolution::writeAttachments(WrpRenderGraph::PassBuilder& pass) const
+{
+    pass.write(colorAttachment, WrpRenderGraph::Usage::ColorAttachment);
+    pass.write(depthAttachment, WrpRenderGraph::Usage::DepthAttachment);
+    if (multisampled())
+        pass.write(resolveAttachment, WrpRenderGraph::Usage::ColorAttachment);
+}
+
+void WrpDynamicResolution::readSceneColor(WrpRenderGraph::PassBuilder& pass) const
+{
+    pass.read(sceneColor(), WrpRenderGraph::Usage::SampledFragment);
+}
+
+void WrpDynamicResolution::setSampleCount(VkSampleCountFlagBits sampleCount)
+{
+    if (sampleCount == msaaSampleCount)
+        return;
+
+    vkDeviceWaitIdle(wrpDevice.device());
+    vkDestroyFramebuffer(wrpDevice.device(), framebuffer, nullptr);
+    framebuffer = VK_NULL_HANDLE;
+    vkDestroyRenderPass(wrpDevice.device(), renderPass, nullptr);
+    msaaSampleCount = sampleCount;
+    createRenderPass();
+    attachmentsGeneration = 0; // framebuffer создаётся заново при следующем beginRenderPass
+}
+
+void WrpDynamicResolution::update(float gpuFrameMs, const RenderingSettings& renderingSettings)
+{
+    if (!renderingSettings.dynamicResolution)
+    {
+        scale = 1.f;
+        smoothedFrameMs = -1.f;
+        return;
+    }
+
+    const float minScale = std::clamp(renderingSettings.minResolutionScale, MIN_SCALE, 1.f);
+    const float maxScale = std::clamp(renderingSettings.maxResolutionScale, minScale, 1.f);
+    if (gpuFrameMs > 0.f && renderingSettings.targetFrameMs > 0.f)
+    {
+        smoothedFrameMs = smoothedFrameMs < 0.f
+            ? gpuFrameMs : smoothedFrameMs + (gpuFrameMs - smoothedFrameMs) * FRAME_TIME_SMOOTHING;
+        const float ratio = renderingSettings.targetFrameMs / smoothedFrameMs;
+        if (ratio < 1.f - TOLERANCE || ratio > 1.f + TOLERANCE)
+        {
+            // время кадра ~ числу пикселей ~ scale^2
+            const float desiredScale = scale * std::sqrt(ratio);
+            scale += std::clamp((desiredScale - scale) * SCALE_GAIN, -MAX_SCALE_STEP, MAX_SCALE_STEP);
+        }
+    }
+    scale = std::clamp(scale, minScale, maxScale);
+}
+
+VkExtent2D WrpDynamicResolution::getRenderExtent() const
+{
+    auto scaled = [this](uint32_t size) {
+        return std::clamp(static_cast<uint32_t>(std::lround(size * scale)), 1u, size);
+    };
+    return {scaled(extent.width), scaled(extent.height)};
+}
+
+void WrpDynamicResolution::createRenderPass()
+{
+    // Вложения и зависимости те же, что у прохода swapchain'а (WrpSwapChain::createRenderPass), отличаются только
+    // операции загрузки/сохранения и схемы, которые не влияют на совместимость проходов. Схемы вложений
+    // не меняются проходом: переходы делает граф кадра
+    VkAttachmentDescription colorDescription{};
+    colorDescription.format = colorFormat;
+    colorDescription.samples = msaaSampleCount;
+    colorDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // с MSAA нужен только разрешённый цвет
+    colorDescription.storeOp = multisampled() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    colorDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription depthDescription{};
+    depthDescription.format = depthFormat;
+    depthDescription.samples = msaaSampleCount;
+    depthDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthDescription.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthDescription.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthDescription.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentDescription resolveDescription{};
+    resolveDescription.format = colorFormat;
+    resolveDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+    resolveDescription.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolveDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    resolveDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    resolveDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    resolveDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    resolveDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depthRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference resolveRef{2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+    subpass.pDepthStencilAttachment = &depthRef;
+    subpass.pResolveAttachments = multisampled() ? &resolveRef : nullptr;
+
+    const std::array<VkSubpassDependency, 2> dependencies = WrpSwapChain::renderPassDependencies();
+    const std::array<VkAttachmentDescription, 3> descriptions{colorDescription, depthDescription, resolveDescription};
+    const uint32_t attachmentCount = multisampled() ? 3 : 2;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = attachmentCount;
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(wrpDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create dynamic resolution render pass!");
+    }
+}
+
+void WrpDynamicResolution::createFramebuffer()
+{
+    const uint32_t attachmentCount = multisampled() ? 3 : 2;
+    std::array<VkImageView, 3> views{renderGraph->getImageView(colorAttachment), renderGraph->getImageView(depthAttachment)};
+    if (multisampled())
+        views[2] = renderGraph->getImageView(resolveAttachment);
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = attachmentCount;
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(wrpDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create dynamic resolution framebuffer!");
+    }
+}
+
+void WrpDynamicResolution::createSampler()
+{
+    // билинейная выборка при масштабировании, за край кадра сцены шейдер не выходит
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+    if (vkCreateSampler(wrpDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create dynamic resolution sampler!");
+    }
+}
+
+void WrpDynamicResolution::writeDescriptorSet()
+{
+    VkDescriptorImageInfo imageInfo{sampler, renderGraph->getImageView(sceneColor()), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    WrpDescriptorWriter writer{*descriptorSetLayout, *descriptorPool};
+    writer.writeImage(0, &imageInfo);
+
+    // при пересоздании изображений набор уже выделен и не используется (граф дожидается устройства)
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        if (!writer.build(descriptorSet))
+            throw std::runtime_error("Failed to allocate dynamic resolution descriptor set!");
+    }
+    else
+    {
+        writer.overwrite(descriptorSet);
+    }
+}
+
+void WrpDynamicResolution::beginRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColor, VkSubpassContents contents)
+{
+    if (attachmentsGeneration != renderGraph->getGeneration())
+    {
+        vkDestroyFramebuffer(wrpDevice.device(), framebuffer, nullptr);
+        createFramebuffer();
+        writeDescriptorSet();
+        attachmentsGeneration = renderGraph->getGeneration();
+    }
+
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {clearColor.x, clearColor.y, clearColor.z, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    const VkExtent2D renderExtent = getRenderExtent();
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = renderExtent;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+    {
+        VkViewport viewport{0.f, 0.f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.f, 1.f};
+        VkRect2D scissor{{0, 0}, renderExtent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+}
+
+void WrpDynamicResolution::endRenderPass(VkCommandBuffer commandBuffer)
+{
+    // переход цвета в схему для чтения и его видимость шейдеру масштабирования обеспечивает барьер графа кадра
+    // перед проходом, объявившим readSceneColor
+    vkCmdEndRenderPass(commandBuffer);
+}
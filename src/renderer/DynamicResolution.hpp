@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Descriptors.hpp"
+#include "FrameInfo.hpp"
+#include "RenderGraph.hpp"
+
+// libs
+#include <imgui.h>
+
+// std
+#include <memory>
+
+/*
+ * Внеэкранная цель сцены с динамическим разрешением. Проход рендера повторяет проход swapchain'а
+ * (те же форматы, число выборок MSAA и зависимости), поэтому он совместим с ним, и системы рисуют в цель
+ * своими пайплайнами без пересборки. Разрешённый цвет (без MSAA - сам цвет) после прохода читается
+ * проходом масштабирования и постобработки (UpscaleSystem) через getDescriptorSet. С FXAA без динамического
+ * разрешения цель используется в масштабе 1.
+ *
+ * Вложения - временные изображения графа кадра (WrpRenderGraph), как у WrpGBuffer: проход сцены их пишет
+ * (writeAttachments), проход масштабирования читает цвет (readSceneColor). Они размером со swapchain, а кадр
+ * рисуется в их левый верхний угол размером getRenderExtent: смена масштаба не пересоздаёт ресурсы и не ждёт
+ * устройство. Масштаб подбирается по измеренному времени кадра на GPU (WrpGpuTimer): время растеризации
+ * и освещения примерно пропорционально числу пикселей, т.е. квадрату масштаба.
+ */
+class WrpDynamicResolution
+{
+public:
+    WrpDynamicResolution(WrpDevice& device, VkFormat colorFormat, VkFormat depthFormat,
+        VkSampleCountFlagBits msaaSampleCount);
+    ~WrpDynamicResolution();
+
+    WrpDynamicResolution(const WrpDynamicResolution&) = delete;
+    WrpDynamicResolution& operator=(const WrpDynamicResolution&) = delete;
+
+    // Вложения размером со swapchain (newExtent) в графе текущего кадра
+    void declareAttachments(WrpRenderGraph& graph, VkExtent2D newExtent);
+    void writeAttachments(WrpRenderGraph::PassBuilder& pass) const;
+    void readSceneColor(WrpRenderGraph::PassBuilder& pass) const;
+    // Пересоздание прохода под новое число выборок swapchain'а (ждёт завершения работы устройства),
+    // вложения с ним пересоздаст граф
+    void setSampleCount(VkSampleCountFlagBits sampleCount);
+    // Новый масштаб по времени кадра на GPU (gpuFrameMs < 0 - измерения нет, масштаб не меняется).
+    // Без динамического разрешения в настройках масштаб возвращается к 1.
+    void update(float gpuFrameMs, const RenderingSettings& renderingSettings);
+
+    // Вызывается в проходе графа, который пишет вложения; после пересоздания изображений графом заново создаёт
+    // framebuffer и набор дескрипторов.
+    // С VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS viewport и scissor задают вторичные буферы
+    void beginRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColor, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+    void endRenderPass(VkCommandBuffer commandBuffer);
+
+    float getScale() const { return scale; }
+    // размер области кадра сцены в пикселях вложений
+    VkExtent2D getRenderExtent() const;
+    VkExtent2D getExtent() const { return extent; }
+    VkRenderPass getRenderPass() const { return renderPass; }
+    VkFramebuffer getFramebuffer() const { return framebuffer; }
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout->getDescriptorSetLayout(); }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+private:
+    void createRenderPass();
+    void createFramebuffer();
+    void createSampler();
+    void writeDescriptorSet();
+
+    WrpDevice& wrpDevice;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    VkSampleCountFlagBits msaaSampleCount;
+    VkExtent2D extent{};
+
+    float scale = 1.f;
+    float smoothedFrameMs = -1.f; // сглаженное время кадра на GPU
+
+    bool multisampled() const { return msaaSampleCount != VK_SAMPLE_COUNT_1_BIT; }
+    // цвет, который читается после прохода
+    WrpRenderGraph::ResourceId sceneColor() const { return multisampled() ? resolveAttachment : colorAttachment; }
+
+    WrpRenderGraph* renderGraph = nullptr;       // граф, в котором объявлены вложения
+    WrpRenderGraph::ResourceId colorAttachment{}; // цвет (MSAA или итоговый)
+    WrpRenderGraph::ResourceId depthAttachment{};
+    WrpRenderGraph::ResourceId resolveAttachment{}; // разрешённый цвет, только с MSAA
+    uint64_t attachmentsGeneration = 0; // поколение изображений графа, под которое созданы framebuffer и набор
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    std::unique_ptr<WrpDescriptorPool> descriptorPool;
+    std::unique_ptr<WrpDescriptorSetLayout> descriptorSetLayout;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
@@ -1,16 +1,21 @@
 #pragma once
 
 #include "Camera.hpp"
-#include "SceneObject.hpp"
+#include "Scene.hpp"
+#include "ShaderPermutations.hpp" // REFLECTION_MODELS_COUNT
 
 // lib
 #include <vulkan/vulkan.h>
 
-#define MAX_LIGHTS 10
+class WrpInstanceBuffer;
+class WrpIndirectDrawBuffer;
+class WrpTransformCache;
+class WrpLightClusters;
+class WrpOcclusionCuller;
 
 struct PointLight
 {
-	glm::vec4 position{}; // w - игнорируется
+	glm::vec4 position{}; // w - радиус влияния (за ним вклад источника обнуляется, см. WrpLightClusters)
 	glm::vec4 color{};	  // w - интенсивность цвета
 };
 
@@ -18,6 +23,66 @@ struct RenderingSettings
 {
     int reflectionModel;
     int polygonFillMode;
+    bool gpuCulling = false;       // отсечение объектов compute шейдером вместо CPU
+    bool verifyGpuCulling = false; // сверка результатов GPU отсечения с CPU (для отладки, в т.ч. на программном Vulkan)
+    int recordingThreads = 1;      // > 1 - отрисовки систем записываются во вторичные буферы параллельно (WrpCommandRecorder)
+    bool instancing = true;        // объекты одной модели рисуются одной instanced-командой на подобъект (WrpDrawList)
+    bool deferredShading = false;  // сцена рисуется в G-buffer, освещение считается отдельным полноэкранным проходом
+    bool occlusionCulling = false; // отсечение перекрытых объектов по программному буферу глубины (только с CPU отсечением)
+    // Динамическое разрешение: сцена рисуется во внеэкранную цель (WrpDynamicResolution), масштаб стороны кадра
+    // подбирается под целевое время кадра на GPU в пределах [minResolutionScale; maxResolutionScale]
+    bool dynamicResolution = false;
+    float targetFrameMs = 16.7f;
+    float minResolutionScale = .5f;
+    float maxResolutionScale = 1.f;
+    float sharpness = .5f; // повышение резкости при масштабировании в кадр swapchain'а, [0; 1]
+    // Сглаживание: число выборок MSAA прохода swapchain'а и цели сцены (WrpRenderer::setMultisampling),
+    // доля выборок с отдельным вызовом фрагментного шейдера (sample shading, 0 - выключен)
+    // и FXAA при переносе кадра сцены в swapchain вместо повышения резкости
+    int msaaSamples = 1;
+    float minSampleShading = .2f;
+    bool fxaa = false;
+};
+
+// Счётчики отсечения за кадр, заполняются системами рендера и выводятся в GUI
+struct RenderStats
+{
+    uint32_t objectsVisible = 0;
+    uint32_t objectsCulled = 0;
+    uint32_t subMeshesCulled = 0;
+    uint64_t trianglesVisible = 0;
+    uint64_t trianglesCulled = 0;
+    uint32_t drawCalls = 0;
+    uint32_t instances = 0;
+    uint32_t transformsUpdated = 0; // матрицы, пересчитанные WrpTransformCache в этом кадре
+    float recordTimeMs = 0.f; // время записи команд систем рендера на CPU
+    uint32_t pointLights = 0;
+    uint32_t lightAssignments = 0; // суммарная длина списков источников по кластерам
+    float lightBinningMs = 0.f; // время распределения источников по кластерам на CPU
+    uint32_t occludersRasterized = 0; // объекты, растеризованные в программный буфер глубины (WrpOcclusionCuller)
+    uint32_t occluderTriangles = 0;
+    uint32_t objectsOccluded = 0;     // входят в objectsCulled
+    uint32_t subMeshesOccluded = 0;   // входят в subMeshesCulled
+    float occlusionMs = 0.f; // время выбора и растеризации окклюдеров на CPU
+    float gpuFrameMs = 0.f;       // время кадра на GPU (WrpGpuTimer), измеренное кадрами в полёте раньше
+    float gpuSceneMs = 0.f;       // его части: проход сцены,
+    float gpuPostProcessMs = 0.f; // масштабирование/FXAA
+    float resolutionScale = 1.f;  // масштаб кадра сцены относительно swapchain'а
+
+    // сложение счётчиков, собранных разными потоками записи
+    RenderStats& operator+=(const RenderStats& other)
+    {
+        objectsVisible += other.objectsVisible;
+        objectsCulled += other.objectsCulled;
+        subMeshesCulled += other.subMeshesCulled;
+        objectsOccluded += other.objectsOccluded;
+        subMeshesOccluded += other.subMeshesOccluded;
+        trianglesVisible += other.trianglesVisible;
+        trianglesCulled += other.trianglesCulled;
+        drawCalls += other.drawCalls;
+        instances += other.instances;
+        return *this;
+    }
 };
 
 // Структура, хранящая нужную для отрисовки кадра информацию.
@@ -29,8 +94,15 @@ struct FrameInfo
 	VkCommandBuffer commandBuffer;
 	WrpCamera& camera;
 	VkDescriptorSet globalDescriptorSet;
-	SceneObject::Map& sceneObjects;
+	WrpScene& sceneObjects;
     RenderingSettings& renderingSettings;
+    RenderStats& renderStats;
+    WrpInstanceBuffer& instanceBuffer;
+    WrpIndirectDrawBuffer& indirectDrawBuffer;
+    WrpTransformCache& transformCache;
+    WrpLightClusters& lightClusters;
+    WrpOcclusionCuller& occlusionCuller;
+    VkExtent2D renderExtent{}; // размер кадра сцены: swapchain или уменьшенная область внеэкранной цели
 };
 
 struct GlobalUbo // global uniform buffer object
@@ -43,26 +115,41 @@ struct GlobalUbo // global uniform buffer object
 	glm::vec4 ambientLightColor{ 1.f, 1.f, 1.f, .02f }; // [r, g, b, w]
 	float directionalLightIntensity;
 	alignas(16) glm::vec4 directionalLightPosition;
-	PointLight pointLights[MAX_LIGHTS];
-	int numLights; // кол-во активных точечных источников света
     float diffuseProportion;
     float roughness;
     float indexOfRefraction;
+    // Параметры кластерного освещения (точечные источники лежат в storage buffer'ах WrpLightClusters)
+    alignas(16) glm::uvec4 clusterGrid{}; // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    glm::vec4 clusterParams{};            // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
 };
 
-struct SimplePushConstantData
+// Данные экземпляра в storage buffer (set 0, binding 1). Вершинный шейдер находит их через список
+// видимых экземпляров (binding 3) по gl_InstanceIndex, compute отсечение - по индексу потока.
+struct InstanceData
 {
     glm::mat4 modelMatrix{ 1.f }; // такой конструктор создаёт единичную матрицу
-    glm::mat4 normalMatrix{ 1.f };
-    alignas(16) glm::vec3 diffuseColor{};
+    glm::mat3x4 normalMatrix{ 1.f }; // mat3 в std430: три столбца с шагом 16 байт
+    glm::vec4 boundingSphere{};   // ограничивающая сфера модели в её пространстве: xyz - центр, w - радиус
+    uint32_t group = 0;           // индекс instanced-группы (счётчик её видимых экземпляров)
+    uint32_t groupFirst = 0;      // начало диапазона группы в буфере экземпляров
+    uint32_t padding[2]{};        // выравнивание структуры до 16 байт (std430)
+};
+
+// Данные одной отрисовки подобъекта в storage buffer (set 0, binding 2). Матрицы экземпляров берутся из InstanceData
+// по gl_InstanceIndex (firstInstance задаётся в indirect-команде), а эти данные - по drawOffset + gl_DrawID.
+struct DrawData
+{
+    glm::vec4 diffuseColor{};
+    int diffTexIndex = -1;
+    int specTexIndex = -1;
+    // Начало экземпляров отрисовки, если устройство не поддерживает ненулевой firstInstance в indirect-команде
+    // (WrpIndirectDrawBuffer::addDraw), иначе 0 - начало уже входит в gl_InstanceIndex
+    uint32_t firstInstance = 0;
+    int padding = 0; // выравнивание структуры до 16 байт (std430)
 };
 
-struct TextureSystemPushConstantData
+// Начало текущей пачки indirect-отрисовок в массиве DrawData
+struct IndirectDrawPushConstants
 {
-    glm::mat4 modelMatrix{ 1.f };
-    glm::mat4 normalMatrix{1.f};
-    // 128 byte min limit is reached. next fields will be limited by maxPushConstantSize
-    int diffTexIndex;
-    int specTexIndex;
-    alignas(16) glm::vec3 diffuseColor{};
+    uint32_t drawOffset = 0;
 };
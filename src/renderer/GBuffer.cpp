@@ -0,0 +1,223 @@
+#include "GBuffer.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t DEPTH_ATTACHMENT = WrpGBuffer::COLOR_ATTACHMENTS_COUNT;
+}
+
+WrpGBuffer::WrpGBuffer(WrpDevice& device) : wrpDevice{device}
+{
+    formats[0] = VK_FORMAT_R8G8B8A8_UNORM;
+    formats[1] = VK_FORMAT_R8G8B8A8_UNORM;
+    formats[2] = VK_FORMAT_R16G16B16A16_SFLOAT;
+    // только форматы без stencil: вложение глубины и его представление для чтения в шейдере используют одну view
+    formats[DEPTH_ATTACHMENT] = wrpDevice.findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+    createRenderPass();
+    createSampler();
+
+    descriptorSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .build();
+    descriptorPool = WrpDescriptorPool::Builder(wrpDevice)
+        .setMaxSets(1)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(attachments.size()))
+        .build();
+}
+
+WrpGBuffer::~WrpGBuffer()
+{
+    vkDestroyFramebuffer(wrpDevice.device(), framebuffer, nullptr);
+    vkDestroySampler(wrpDevice.device(), sampler, nullptr);
+    vkDestroyRenderPass(wrpDevice.device(), renderPass, nullptr);
+}
+
+void WrpGBuffer::declareAttachments(WrpRenderGraph& graph, VkExtent2D newExtent)
+{
+    static constexpr std::array<const char*, COLOR_ATTACHMENTS_COUNT + 1> NAMES{
+        "G-buffer albedo", "G-buffer specular", "G-buffer normal", "G-buffer depth"};
+    renderGraph = &graph;
+    extent = newExtent;
+    for (uint32_t i = 0; i < attachments.size(); i++)
+        attachments[i] = graph.createImage(NAMES[i], {formats[i], extent});
+}
+
+void WrpGBuffer::writeAttachments(WrpRenderGraph::PassBuilder& pass) const
+{
+    for (uint32_t i = 0; i < attachments.size(); i++)
+    {
+        pass.write(attachments[i], i == DEPTH_ATTACHMENT
+            ? WrpRenderGraph::Usage::DepthAttachment : WrpRenderGraph::Usage::ColorAttachment);
+    }
+}
+
+void WrpGBuffer::readAttachments(WrpRenderGraph::PassBuilder& pass) const
+{
+    for (uint32_t i = 0; i < attachments.size(); i++)
+    {
+        pass.read(attachments[i], i == DEPTH_ATTACHMENT
+            ? WrpRenderGraph::Usage::DepthSampledFragment : WrpRenderGraph::Usage::SampledFragment);
+    }
+}
+
+void WrpGBuffer::createRenderPass()
+{
+    std::array<VkAttachmentDescription, COLOR_ATTACHMENTS_COUNT + 1> descriptions{};
+    std::array<VkAttachmentReference, COLOR_ATTACHMENTS_COUNT> colorRefs{};
+    for (uint32_t i = 0; i < descriptions.size(); i++)
+    {
+        const bool depth = i == DEPTH_ATTACHMENT;
+        VkAttachmentDescription& description = descriptions[i];
+        description.format = formats[i];
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        description.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // содержимое читает проход освещения
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // в схему вложения и из неё в схему для чтения вложения переводит граф кадра (барьеры вместо зависимостей прохода)
+        description.initialLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        description.finalLayout = description.initialLayout;
+        if (!depth)
+            colorRefs[i] = {i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}; // layout(location = i) out во фрагментном шейдере
+    }
+    VkAttachmentReference depthRef{DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(wrpDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create G-buffer render pass!");
+    }
+}
+
+void WrpGBuffer::createFramebuffer()
+{
+    std::array<VkImageView, COLOR_ATTACHMENTS_COUNT + 1> views{};
+    for (uint32_t i = 0; i < attachments.size(); i++)
+        views[i] = renderGraph->getImageView(attachments[i]);
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(wrpDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create G-buffer framebuffer!");
+    }
+}
+
+void WrpGBuffer::createSampler()
+{
+    // проход освещения читает вложения попиксельно (texelFetch), фильтрация не нужна
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+    if (vkCreateSampler(wrpDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create G-buffer sampler!");
+    }
+}
+
+void WrpGBuffer::writeDescriptorSet()
+{
+    std::array<VkDescriptorImageInfo, COLOR_ATTACHMENTS_COUNT + 1> imageInfos{};
+    WrpDescriptorWriter writer{*descriptorSetLayout, *descriptorPool};
+    for (uint32_t i = 0; i < attachments.size(); i++)
+    {
+        imageInfos[i].sampler = sampler;
+        imageInfos[i].imageView = renderGraph->getImageView(attachments[i]);
+        imageInfos[i].imageLayout = i == DEPTH_ATTACHMENT
+            ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        writer.writeImage(i, &imageInfos[i]);
+    }
+
+    // при пересоздании изображений набор уже выделен и не используется (граф дожидается устройства)
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        if (!writer.build(descriptorSet))
+            throw std::runtime_error("Failed to allocate G-buffer descriptor set!");
+    }
+    else
+    {
+        writer.overwrite(descriptorSet);
+    }
+}
+
+void WrpGBuffer::beginRenderPass(VkCommandBuffer commandBuffer, VkExtent2D renderExtent, VkSubpassContents contents)
+{
+    if (attachmentsGeneration != renderGraph->getGeneration())
+    {
+        vkDestroyFramebuffer(wrpDevice.device(), framebuffer, nullptr);
+        createFramebuffer();
+        writeDescriptorSet();
+        attachmentsGeneration = renderGraph->getGeneration();
+    }
+
+    renderExtent = {std::min(renderExtent.width, extent.width), std::min(renderExtent.height, extent.height)};
+
+    // очистка нормали нулём и глубины единицей: пиксели без геометрии проход освещения отбрасывает
+    std::array<VkClearValue, COLOR_ATTACHMENTS_COUNT + 1> clearValues{};
+    clearValues[DEPTH_ATTACHMENT].depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = renderExtent;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+    {
+        VkViewport viewport{0.f, 0.f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.f, 1.f};
+        VkRect2D scissor{{0, 0}, renderExtent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+}
+
+void WrpGBuffer::endRenderPass(VkCommandBuffer commandBuffer)
+{
+    vkCmdEndRenderPass(commandBuffer);
+}
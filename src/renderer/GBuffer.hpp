@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Descriptors.hpp"
+#include "RenderGraph.hpp"
+
+// std
+#include <array>
+#include <memory>
+
+/*
+ * G-buffer отложенного освещения: проход рендера с тремя вложениями цвета и вложением глубины без MSAA.
+ *  0 - albedo (RGBA8): цвет рассеянного отражения;
+ *  1 - specular (RGBA8): цвет зеркального отражения, a - шероховатость;
+ *  2 - normal (RGBA16F): нормаль в мировом пространстве;
+ *  3 - depth: по ней проход освещения восстанавливает позицию пикселя.
+ * Вложения - временные изображения графа кадра (WrpRenderGraph): они объявляются каждый кадр (declareAttachments),
+ * проход G-buffer'а их пишет (writeAttachments), проход освещения читает (readAttachments) через набор
+ * дескрипторов getDescriptorSet (combined image sampler'ы в тех же привязках 0-3). Переходы схем и порядок
+ * с кадрами в полёте выводит граф, проход рендера их не делает.
+ */
+class WrpGBuffer
+{
+public:
+    static constexpr uint32_t COLOR_ATTACHMENTS_COUNT = 3;
+
+    WrpGBuffer(WrpDevice& device);
+    ~WrpGBuffer();
+
+    WrpGBuffer(const WrpGBuffer&) = delete;
+    WrpGBuffer& operator=(const WrpGBuffer&) = delete;
+
+    // Вложения размером newExtent в графе текущего кадра
+    void declareAttachments(WrpRenderGraph& graph, VkExtent2D newExtent);
+    void writeAttachments(WrpRenderGraph::PassBuilder& pass) const;
+    void readAttachments(WrpRenderGraph::PassBuilder& pass) const;
+
+    // Вызывается в проходе графа, который пишет вложения; после пересоздания изображений графом заново создаёт
+    // framebuffer и набор дескрипторов. Кадр рисуется в область renderExtent от левого верхнего угла вложений
+    // (меньше их при динамическом разрешении).
+    // С VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS viewport и scissor задают вторичные буферы
+    void beginRenderPass(VkCommandBuffer commandBuffer, VkExtent2D renderExtent,
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+    void endRenderPass(VkCommandBuffer commandBuffer);
+
+    VkRenderPass getRenderPass() const { return renderPass; }
+    VkFramebuffer getFramebuffer() const { return framebuffer; }
+    VkExtent2D getExtent() const { return extent; }
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout->getDescriptorSetLayout(); }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+private:
+    void createRenderPass();
+    void createFramebuffer();
+    void createSampler();
+    void writeDescriptorSet();
+
+    WrpDevice& wrpDevice;
+    VkExtent2D extent{};
+
+    std::array<VkFormat, COLOR_ATTACHMENTS_COUNT + 1> formats{}; // последнее - глубина
+    WrpRenderGraph* renderGraph = nullptr;                     // граф, в котором объявлены вложения
+    std::array<WrpRenderGraph::ResourceId, COLOR_ATTACHMENTS_COUNT + 1> attachments{};
+    uint64_t attachmentsGeneration = 0; // поколение изображений графа, под которое созданы framebuffer и набор
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    std::unique_ptr<WrpDescriptorPool> descriptorPool;
+    std::unique_ptr<WrpDescriptorSetLayout> descriptorSetLayout;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
@@ -0,0 +1,245 @@
+#include "GpuCulling.hpp"
+#include "Culling.hpp"
+#include "ShaderModule.hpp"
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x в CullInstances.comp и CompactDraws.comp
+
+    // общий блок пуш-констант обоих compute шейдеров
+    struct GpuCullingPushConstants
+    {
+        glm::vec4 planes[6];
+        uint32_t instanceCount;
+        uint32_t drawCount;
+        uint32_t compactDraws;
+    };
+
+    uint32_t groupsCount(uint32_t count)
+    {
+        return (count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+    }
+
+    void bufferBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+    {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+WrpGpuCulling::WrpGpuCulling(WrpDevice& device, uint32_t framesCount,
+    WrpInstanceBuffer& instanceBuffer, WrpIndirectDrawBuffer& indirectDrawBuffer)
+    : wrpDevice{device}, instanceBuffer{instanceBuffer}, indirectDrawBuffer{indirectDrawBuffer}
+{
+    frameResults.resize(framesCount);
+    createDescriptorSets(framesCount);
+    createPipelineLayout();
+    cullInstancesPipeline = createPipeline("CullInstances.comp");
+    compactDrawsPipeline = createPipeline("CompactDraws.comp");
+}
+
+WrpGpuCulling::~WrpGpuCulling()
+{
+    vkDestroyPipeline(wrpDevice.device(), cullInstancesPipeline, nullptr);
+    vkDestroyPipeline(wrpDevice.device(), compactDrawsPipeline, nullptr);
+    vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
+}
+
+void WrpGpuCulling::createDescriptorSets(uint32_t framesCount)
+{
+    constexpr uint32_t BINDINGS_COUNT = 8;
+
+    descriptorPool = WrpDescriptorPool::Builder(wrpDevice)
+        .setMaxSets(framesCount)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, BINDINGS_COUNT * framesCount)
+        .build();
+
+    WrpDescriptorSetLayout::Builder layoutBuilder{wrpDevice};
+    for (uint32_t binding = 0; binding < BINDINGS_COUNT; binding++)
+    {
+        layoutBuilder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+    descriptorSetLayout = layoutBuilder.build();
+
+    descriptorSets.resize(framesCount);
+    for (uint32_t i = 0; i < framesCount; i++)
+    {
+        VkDescriptorBufferInfo infos[BINDINGS_COUNT] = {
+            instanceBuffer.descriptorInfo(i),
+            instanceBuffer.visibleInstancesDescriptorInfo(i),
+            instanceBuffer.groupCountsDescriptorInfo(i),
+            indirectDrawBuffer.commandsDescriptorInfo(i),
+            indirectDrawBuffer.drawInfosDescriptorInfo(i),
+            indirectDrawBuffer.culledCommandsDescriptorInfo(i),
+            indirectDrawBuffer.drawRemapDescriptorInfo(i),
+            indirectDrawBuffer.batchCountsDescriptorInfo(i),
+        };
+        WrpDescriptorWriter writer{*descriptorSetLayout, *descriptorPool};
+        for (uint32_t binding = 0; binding < BINDINGS_COUNT; binding++)
+        {
+            writer.writeBuffer(binding, &infos[binding]);
+        }
+        if (!writer.build(descriptorSets[i]))
+        {
+            throw std::runtime_error("Failed to allocate GPU culling descriptor set!");
+        }
+    }
+}
+
+void WrpGpuCulling::createPipelineLayout()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(GpuCullingPushConstants);
+
+    VkDescriptorSetLayout setLayout = descriptorSetLayout->getDescriptorSetLayout();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(wrpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create GPU culling pipeline layout!");
+    }
+}
+
+VkPipeline WrpGpuCulling::createPipeline(const char* shaderName)
+{
+    ShaderModule shaderModule{wrpDevice, shaderName};
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule.shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(wrpDevice.device(), wrpDevice.getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error(std::string("Failed to create compute pipeline for ") + shaderName + "!");
+    }
+    return pipeline;
+}
+
+void WrpGpuCulling::dispatch(VkCommandBuffer commandBuffer, int frameIndex, const WrpCamera& camera, bool verify)
+{
+    FrameResults& results = frameResults[frameIndex];
+    results.instanceCount = instanceBuffer.getInstanceCount();
+    results.groupCount = instanceBuffer.getGroupCount();
+    results.pending = results.instanceCount != 0;
+    if (!results.pending)
+        return;
+
+    WrpFrustumCuller culler{camera};
+    // ожидаемые счётчики считаются сейчас: к моменту сравнения буфер экземпляров этого слота уже перезаписан
+    results.expectedGroupCounts.clear();
+    if (verify)
+        results.expectedGroupCounts = cpuGroupCounts(frameIndex, camera);
+
+    GpuCullingPushConstants push{};
+    std::copy(culler.getPlanes().begin(), culler.getPlanes().end(), push.planes);
+    push.instanceCount = results.instanceCount;
+    push.drawCount = indirectDrawBuffer.getDrawCount();
+    push.compactDraws = indirectDrawBuffer.compactsDraws() ? 1 : 0;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+        0, 1, &descriptorSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullInstancesPipeline);
+    vkCmdDispatch(commandBuffer, groupsCount(push.instanceCount), 1, 1);
+
+    // счётчики групп должны быть досчитаны до того, как их прочитает упаковка команд
+    bufferBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    if (push.drawCount != 0)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compactDrawsPipeline);
+        vkCmdDispatch(commandBuffer, groupsCount(push.drawCount), 1, 1);
+    }
+
+    // команды и их число читаются на этапе indirect-отрисовки, видимые экземпляры и drawRemap - вершинным шейдером
+    bufferBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+    // Счётчики групп читает CPU в collectResults после ожидания забора: одного забора мало,
+    // запись шейдера нужно сделать видимой для хоста (память HOST_COHERENT, поэтому invalidate не нужен)
+    const VkDescriptorBufferInfo countsInfo = instanceBuffer.groupCountsDescriptorInfo(frameIndex);
+    VkBufferMemoryBarrier countsBarrier{};
+    countsBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    countsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    countsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    countsBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countsBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countsBarrier.buffer = countsInfo.buffer;
+    countsBarrier.offset = countsInfo.offset;
+    countsBarrier.size = countsInfo.range;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &countsBarrier, 0, nullptr);
+}
+
+std::vector<uint32_t> WrpGpuCulling::cpuGroupCounts(int frameIndex, const WrpCamera& camera) const
+{
+    const uint32_t count = instanceBuffer.getInstanceCount();
+    const InstanceData* instances = instanceBuffer.instances(frameIndex);
+
+    std::vector<WrpBoundingSphere> spheres(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const WrpBoundingSphere sphere{glm::vec3(instances[i].boundingSphere), instances[i].boundingSphere.w};
+        spheres[i] = WrpFrustumCuller::transformSphere(instances[i].modelMatrix, sphere);
+    }
+    std::vector<uint8_t> visible(count);
+    WrpFrustumCuller{camera}.testSpheres(spheres.data(), count, visible.data());
+
+    std::vector<uint32_t> counts(instanceBuffer.getGroupCount(), 0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        counts[instances[i].group] += visible[i];
+    }
+    return counts;
+}
+
+void WrpGpuCulling::collectResults(int frameIndex, RenderStats& stats)
+{
+    FrameResults& results = frameResults[frameIndex];
+    if (!results.pending)
+        return;
+    results.pending = false;
+
+    const uint32_t* counts = instanceBuffer.groupCounts(frameIndex);
+    uint32_t visible = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t group = 0; group < results.groupCount; group++)
+    {
+        visible += counts[group];
+        if (!results.expectedGroupCounts.empty() && counts[group] != results.expectedGroupCounts[group])
+            mismatches++;
+    }
+    stats.objectsVisible += visible;
+    stats.objectsCulled += results.instanceCount - visible;
+
+    if (mismatches != 0)
+    {
+        mismatchCount += mismatches;
+        std::cerr << "[GpuCulling] " << mismatches << " of " << results.groupCount
+            << " instance groups differ from CPU culling" << std::endl;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Descriptors.hpp"
+#include "Camera.hpp"
+#include "FrameInfo.hpp"
+#include "InstanceBuffer.hpp"
+#include "IndirectDrawBuffer.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+/*
+ * GPU отсечение по пирамиде видимости (RenderingSettings::gpuCulling).
+ * Системы рендера записывают в WrpInstanceBuffer все объекты, а в WrpIndirectDrawBuffer - команды для всех групп.
+ * Перед проходом рендера два compute шейдера:
+ *   CullInstances.comp - проверяет сферу каждого экземпляра и собирает видимые экземпляры групп и их счётчики;
+ *   CompactDraws.comp  - подставляет счётчики в indirect-команды и упаковывает непустые команды пачек
+ *                        (число команд пачки для vkCmdDrawIndexedIndirectCount тоже считается на GPU).
+ * CPU результаты не ждёт: в статистику попадают счётчики групп уже завершённого кадра из того же слота.
+ * В режиме проверки (verifyGpuCulling) счётчики сравниваются с CPU отсечением тех же экземпляров.
+ */
+class WrpGpuCulling
+{
+public:
+    WrpGpuCulling(WrpDevice& device, uint32_t framesCount,
+        WrpInstanceBuffer& instanceBuffer, WrpIndirectDrawBuffer& indirectDrawBuffer);
+    ~WrpGpuCulling();
+
+    WrpGpuCulling(const WrpGpuCulling&) = delete;
+    WrpGpuCulling& operator=(const WrpGpuCulling&) = delete;
+
+    // Записывает отсечение в буфер команд кадра, вызывается после подготовки систем рендера и до начала прохода рендера
+    void dispatch(VkCommandBuffer commandBuffer, int frameIndex, const WrpCamera& camera, bool verify);
+    // Результаты прошлого использования слота кадра (после ожидания его fence в WrpRenderer::beginFrame,
+    // до перезаписи буферов экземпляров). Заполняет статистику видимости и при проверке сообщает о расхождениях.
+    void collectResults(int frameIndex, RenderStats& stats);
+
+    // количество расхождений с CPU отсечением за всё время проверки
+    uint64_t getMismatchCount() const { return mismatchCount; }
+
+private:
+    struct FrameResults
+    {
+        bool pending = false;
+        uint32_t instanceCount = 0;
+        uint32_t groupCount = 0;
+        std::vector<uint32_t> expectedGroupCounts; // только в режиме проверки
+    };
+
+    void createDescriptorSets(uint32_t framesCount);
+    void createPipelineLayout();
+    VkPipeline createPipeline(const char* shaderName);
+    std::vector<uint32_t> cpuGroupCounts(int frameIndex, const WrpCamera& camera) const;
+
+    WrpDevice& wrpDevice;
+    WrpInstanceBuffer& instanceBuffer;
+    WrpIndirectDrawBuffer& indirectDrawBuffer;
+
+    std::unique_ptr<WrpDescriptorPool> descriptorPool;
+    std::unique_ptr<WrpDescriptorSetLayout> descriptorSetLayout;
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline cullInstancesPipeline = VK_NULL_HANDLE;
+    VkPipeline compactDrawsPipeline = VK_NULL_HANDLE;
+
+    std::vector<FrameResults> frameResults;
+    uint64_t mismatchCount = 0;
+};
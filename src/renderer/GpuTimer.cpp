@@ -0,0 +1,77 @@
+#include "GpuTimer.hpp"
+
+// std
+#include <array>
+#include <stdexcept>
+
+WrpGpuTimer::WrpGpuTimer(WrpDevice& device, uint32_t framesCount) : wrpDevice{device}, pending(framesCount, false),
+    timestampsWritten(framesCount, 0)
+{
+    if (!wrpDevice.properties.limits.timestampComputeAndGraphics)
+        return;
+    timestampPeriodNs = wrpDevice.properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = MAX_TIMESTAMPS * framesCount;
+    if (vkCreateQueryPool(wrpDevice.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create timestamp query pool!");
+    }
+}
+
+WrpGpuTimer::~WrpGpuTimer()
+{
+    vkDestroyQueryPool(wrpDevice.device(), queryPool, nullptr);
+}
+
+float WrpGpuTimer::collectResults(int frameIndex)
+{
+    intervalsMs.clear();
+    if (!isSupported() || !pending[frameIndex])
+        return -1.f;
+    pending[frameIndex] = false;
+
+    const uint32_t count = timestampsWritten[frameIndex];
+    std::array<uint64_t, MAX_TIMESTAMPS> timestamps{};
+    // fence кадра пройден, поэтому ожидание (VK_QUERY_RESULT_WAIT_BIT) не нужно
+    if (vkGetQueryPoolResults(wrpDevice.device(), queryPool, MAX_TIMESTAMPS * frameIndex, count,
+        count * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+        return -1.f;
+    }
+    auto toMs = [&](uint64_t ticks) { return static_cast<float>(static_cast<double>(ticks) * timestampPeriodNs * 1e-6); };
+    for (uint32_t i = 1; i < count; i++)
+        intervalsMs.push_back(toMs(timestamps[i] - timestamps[i - 1]));
+    return toMs(timestamps[count - 1] - timestamps[0]);
+}
+
+void WrpGpuTimer::begin(VkCommandBuffer commandBuffer, int frameIndex)
+{
+    if (!isSupported())
+        return;
+    vkCmdResetQueryPool(commandBuffer, queryPool, MAX_TIMESTAMPS * frameIndex, MAX_TIMESTAMPS);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, MAX_TIMESTAMPS * frameIndex);
+    timestampsWritten[frameIndex] = 1;
+}
+
+void WrpGpuTimer::mark(VkCommandBuffer commandBuffer, int frameIndex)
+{
+    if (!isSupported())
+        return;
+    if (timestampsWritten[frameIndex] >= MAX_TIMESTAMPS)
+    {
+        throw std::runtime_error("Too many GPU timer marks in one frame!");
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+        MAX_TIMESTAMPS * frameIndex + timestampsWritten[frameIndex]++);
+}
+
+void WrpGpuTimer::end(VkCommandBuffer commandBuffer, int frameIndex)
+{
+    if (!isSupported())
+        return;
+    mark(commandBuffer, frameIndex);
+    pending[frameIndex] = true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Device.hpp"
+
+// std
+#include <vector>
+
+/*
+ * Время выполнения кадра на GPU по меткам времени (timestamp query): до MAX_TIMESTAMPS запросов на каждый кадр
+ * в полёте. begin записывается в начале первичного буфера кадра, end - в конце, а mark между ними делит кадр на
+ * интервалы (например, сцена и постобработка). Результат читается при следующем использовании того же слота
+ * кадра, когда его fence уже пройден, поэтому чтение не ждёт GPU.
+ * Без поддержки меток времени в очереди графики (timestampComputeAndGraphics) таймер ничего не измеряет.
+ */
+class WrpGpuTimer
+{
+public:
+    static constexpr uint32_t MAX_TIMESTAMPS = 8;
+
+    WrpGpuTimer(WrpDevice& device, uint32_t framesCount);
+    ~WrpGpuTimer();
+
+    WrpGpuTimer(const WrpGpuTimer&) = delete;
+    WrpGpuTimer& operator=(const WrpGpuTimer&) = delete;
+
+    bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+    // Время прошлого использования слота кадра от begin до end в миллисекундах, < 0 - если измерения ещё нет.
+    // Интервалы между соседними метками этого измерения возвращает getIntervalsMs
+    float collectResults(int frameIndex);
+    const std::vector<float>& getIntervalsMs() const { return intervalsMs; }
+
+    // begin записывается вне прохода рендера (сброс запросов внутри прохода запрещён)
+    void begin(VkCommandBuffer commandBuffer, int frameIndex);
+    // Промежуточная метка: можно и внутри прохода, в том числе во вторичном буфере, который выполнится
+    // в первичном буфере кадра после уже записанных меток
+    void mark(VkCommandBuffer commandBuffer, int frameIndex);
+    void end(VkCommandBuffer commandBuffer, int frameIndex);
+
+private:
+    WrpDevice& wrpDevice;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    float timestampPeriodNs = 1.f;
+    std::vector<bool> pending;                 // по кадрам: метки записаны и ещё не прочитаны
+    std::vector<uint32_t> timestampsWritten;   // по кадрам
+    std::vector<float> intervalsMs;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Инкрементальный 64-bit FNV-1a для ключей кэшей (SPIR-V модули, варианты пайплайнов и т.п.)
+class WrpHasher
+{
+public:
+    WrpHasher& addBytes(const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    WrpHasher& add(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be hashed byte-wise");
+        return addBytes(&value, sizeof(value));
+    }
+
+    // строки хэшируются вместе с длиной, чтобы "ab"+"c" и "a"+"bc" давали разные ключи
+    WrpHasher& add(const std::string& str)
+    {
+        add(static_cast<uint64_t>(str.size()));
+        return addBytes(str.data(), str.size());
+    }
+
+    uint64_t value() const { return hash; }
+
+private:
+    static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    static constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+};
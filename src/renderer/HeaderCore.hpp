@@ -20,3 +20,13 @@
 #ifndef SHADERS_DIR
 #define SHADERS_DIR "../../../src/shaders/"
 #endif
+
+// Файл с данными VkPipelineCache (кладётся рядом с исполняемым файлом, т.к. зависит от драйвера и GPU)
+#ifndef PIPELINE_CACHE_PATH
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+#endif
+
+// Директория дискового кэша скомпилированных SPIR-V модулей
+#ifndef SPIRV_CACHE_DIR
+#define SPIRV_CACHE_DIR "spirv_cache/"
+#endif
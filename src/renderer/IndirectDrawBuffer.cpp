@@ -0,0 +1,210 @@
+#include "IndirectDrawBuffer.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    std::unique_ptr<WrpBuffer> createMappedBuffer(WrpDevice& device, VkDeviceSize elementSize, uint32_t count,
+        VkBufferUsageFlags usage)
+    {
+        // HOST_COHERENT: команды пишутся прямо в отображённую память во время записи буфера команд, без явного flush
+        auto buffer = std::make_unique<WrpBuffer>(
+            device,
+            elementSize,
+            count,
+            usage,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->map();
+        return buffer;
+    }
+}
+
+WrpIndirectDrawBuffer::WrpIndirectDrawBuffer(WrpDevice& device, uint32_t framesCount, uint32_t maxDraws)
+    : wrpDevice{device}, maxDraws{maxDraws}
+{
+    constexpr VkBufferUsageFlags indirectStorage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    frames.resize(framesCount);
+    for (auto& frame : frames)
+    {
+        frame.commands = createMappedBuffer(device, sizeof(VkDrawIndexedIndirectCommand), maxDraws, indirectStorage);
+        frame.drawData = createMappedBuffer(device, sizeof(DrawData), maxDraws, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        frame.drawRemap = createMappedBuffer(device, sizeof(uint32_t), maxDraws, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        frame.drawInfos = createMappedBuffer(device, sizeof(glm::uvec4), maxDraws, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        frame.culledCommands = createMappedBuffer(device, sizeof(VkDrawIndexedIndirectCommand), maxDraws, indirectStorage);
+        // пачек не больше, чем отрисовок
+        frame.batchCounts = createMappedBuffer(device, sizeof(uint32_t), maxDraws, indirectStorage);
+    }
+}
+
+void WrpIndirectDrawBuffer::beginFrame(int frameIndex, bool gpuCulling)
+{
+    currentFrame = frameIndex;
+    this->gpuCulling = gpuCulling;
+    drawCount = 0;
+    batches.clear();
+}
+
+bool WrpIndirectDrawBuffer::compactsDraws() const
+{
+    // vkCmdDrawIndexedIndirectCount с maxDrawCount > 1 требует ещё и multiDrawIndirect
+    return gpuCulling && wrpDevice.supportsDrawIndirectCount() && wrpDevice.supportsMultiDrawIndirect();
+}
+
+void WrpIndirectDrawBuffer::beginBatch(WrpModel* model)
+{
+    batches.push_back({model, drawCount, 0});
+}
+
+void WrpIndirectDrawBuffer::addDraw(VkDrawIndexedIndirectCommand command, DrawData drawData, uint32_t instanceGroup)
+{
+    if (drawCount == maxDraws)
+    {
+        throw std::runtime_error("Indirect draw buffer overflow: capacity is " + std::to_string(maxDraws) + " draws!");
+    }
+    // Команды служат и шаблонами GPU отсечения (CompactDraws.comp копирует их), поэтому нулевой firstInstance
+    // достаточно записать здесь. Вершинный шейдер прибавляет DrawData::firstInstance к gl_InstanceIndex
+    if (!wrpDevice.supportsDrawIndirectFirstInstance())
+    {
+        drawData.firstInstance = command.firstInstance;
+        command.firstInstance = 0;
+    }
+    else
+    {
+        drawData.firstInstance = 0;
+    }
+    auto& frame = frames[currentFrame];
+    static_cast<VkDrawIndexedIndirectCommand*>(frame.commands->getMappedMemory())[drawCount] = command;
+    static_cast<DrawData*>(frame.drawData->getMappedMemory())[drawCount] = drawData;
+    if (gpuCulling)
+    {
+        const uint32_t batchIndex = static_cast<uint32_t>(batches.size() - 1);
+        static_cast<glm::uvec4*>(frame.drawInfos->getMappedMemory())[drawCount] =
+            glm::uvec4(instanceGroup, batchIndex, batches.back().first, 0);
+    }
+    else
+    {
+        static_cast<uint32_t*>(frame.drawRemap->getMappedMemory())[drawCount] = drawCount;
+    }
+    drawCount++;
+    batches.back().count++;
+}
+
+uint32_t WrpIndirectDrawBuffer::endBatch()
+{
+    const uint32_t batchIndex = static_cast<uint32_t>(batches.size() - 1);
+    // счётчик пачки накапливает compute шейдер, поэтому перед кадром он обнуляется
+    static_cast<uint32_t*>(frames[currentFrame].batchCounts->getMappedMemory())[batchIndex] = 0;
+    return batchIndex;
+}
+
+void WrpIndirectDrawBuffer::drawBatch(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+    uint32_t batchIndex, RenderStats& stats)
+{
+    const Batch& batch = batches[batchIndex];
+    drawCommands(commandBuffer, pipelineLayout, batchIndex, batch.first, batch.count, stats);
+}
+
+void WrpIndirectDrawBuffer::drawRange(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+    uint32_t firstDraw, uint32_t drawCount, RenderStats& stats)
+{
+    const uint32_t endDraw = firstDraw + drawCount;
+    // пачки идут подряд по возрастанию first, первая задетая - последняя, начавшаяся не позже firstDraw
+    auto it = std::upper_bound(batches.begin(), batches.end(), firstDraw,
+        [](uint32_t draw, const Batch& batch) { return draw < batch.first; });
+    if (it != batches.begin())
+        --it;
+    for (; it != batches.end() && it->first < endDraw; ++it)
+    {
+        const uint32_t first = std::max(firstDraw, it->first);
+        const uint32_t end = std::min(endDraw, it->first + it->count);
+        if (first >= end)
+            continue;
+        const uint32_t batchIndex = static_cast<uint32_t>(it - batches.begin());
+        if (compactsDraws())
+        {
+            if (first == it->first)
+                drawCommands(commandBuffer, pipelineLayout, batchIndex, it->first, it->count, stats);
+            continue;
+        }
+        drawCommands(commandBuffer, pipelineLayout, batchIndex, first, end - first, stats);
+    }
+}
+
+void WrpIndirectDrawBuffer::drawCommands(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+    uint32_t batchIndex, uint32_t firstCommand, uint32_t commandCount, RenderStats& stats)
+{
+    const Batch& batch = batches[batchIndex];
+    if (commandCount == 0)
+        return;
+
+    // прикрепление буфера вершин (модели) и буфера индексов к буферу команд, один раз на записываемую часть пачки
+    batch.model->bind(commandBuffer);
+
+    const auto& frame = frames[currentFrame];
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    if (compactsDraws())
+    {
+        // число команд пачки известно только GPU, CPU передаёт лишь верхнюю границу
+        IndirectDrawPushConstants push{batch.first};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+            0, sizeof(IndirectDrawPushConstants), &push);
+        vkCmdDrawIndexedIndirectCount(commandBuffer, frame.culledCommands->getBuffer(), batch.first * stride,
+            frame.batchCounts->getBuffer(), batchIndex * sizeof(uint32_t), batch.count, stride);
+        stats.drawCalls++;
+        return;
+    }
+
+    // без упаковки GPU отсечение оставляет команды на своих местах (отсечённые - с нулём экземпляров)
+    const VkBuffer buffer = gpuCulling ? frame.culledCommands->getBuffer() : frame.commands->getBuffer();
+    const uint32_t maxDrawsPerCall = wrpDevice.supportsMultiDrawIndirect()
+        ? std::max(1u, wrpDevice.properties.limits.maxDrawIndirectCount)
+        : 1u;
+    const uint32_t end = firstCommand + commandCount;
+    for (uint32_t first = firstCommand; first < end; first += maxDrawsPerCall)
+    {
+        const uint32_t count = std::min(maxDrawsPerCall, end - first);
+        IndirectDrawPushConstants push{first};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+            0, sizeof(IndirectDrawPushConstants), &push);
+        vkCmdDrawIndexedIndirect(commandBuffer, buffer, first * stride, count, stride);
+        stats.drawCalls++;
+    }
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::drawDataDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].drawData->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::drawRemapDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].drawRemap->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::commandsDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].commands->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::drawInfosDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].drawInfos->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::culledCommandsDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].culledCommands->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpIndirectDrawBuffer::batchCountsDescriptorInfo(int frameIndex)
+{
+    return frames[frameIndex].batchCounts->descriptorInfo();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "FrameInfo.hpp"
+#include "Model.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+/*
+ * Покадровые буферы для multi-draw indirect: массив VkDrawIndexedIndirectCommand и параллельный ему
+ * массив DrawData (storage buffer, шейдер читает его по drawRemap[drawOffset + gl_DrawID]).
+ * Системы рендера накапливают отрисовки подобъектов одной модели в пачку (до начала прохода рендера)
+ * и затем отправляют пачку одним вызовом vkCmdDrawIndexedIndirect, так что число вызовов зависит
+ * от количества разных моделей, а не объектов.
+ * Без multiDrawIndirect/shaderDrawParameters те же команды отправляются по одной, со своим drawOffset.
+ *
+ * При GPU отсечении записанные команды служат шаблонами: compute шейдер (WrpGpuCulling) подставляет в них
+ * число видимых экземпляров группы, упаковывает непустые команды пачки в culledCommands и считает их
+ * в batchCounts, а отрисовка идёт через vkCmdDrawIndexedIndirectCount без чтения результатов на CPU.
+ */
+class WrpIndirectDrawBuffer
+{
+public:
+    static constexpr uint32_t MAX_DRAWS = 16384;
+
+    WrpIndirectDrawBuffer(WrpDevice& device, uint32_t framesCount, uint32_t maxDraws = MAX_DRAWS);
+
+    WrpIndirectDrawBuffer(const WrpIndirectDrawBuffer&) = delete;
+    WrpIndirectDrawBuffer& operator=(const WrpIndirectDrawBuffer&) = delete;
+
+    // сброс записанных отрисовок в начале кадра
+    void beginFrame(int frameIndex, bool gpuCulling);
+
+    // Пачка отрисовок одной модели: всё, что добавлено между beginBatch и endBatch, уйдёт одним вызовом
+    void beginBatch(WrpModel* model);
+    // instanceGroup - группа экземпляров команды (нужна GPU отсечению для подстановки числа видимых экземпляров).
+    // Без drawIndirectFirstInstance command.firstInstance переносится в drawData, а в команду пишется 0
+    void addDraw(VkDrawIndexedIndirectCommand command, DrawData drawData, uint32_t instanceGroup);
+    // возвращает индекс пачки для drawBatch
+    uint32_t endBatch();
+
+    // Записывает пачку в буфер команд (привязка буферов модели + indirect-вызов), вызывается внутри прохода рендера
+    void drawBatch(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t batchIndex, RenderStats& stats);
+    // Записывает отрисовки [firstDraw, firstDraw + drawCount) кадра. Диапазон может резать пачки, так потоки записи
+    // делят между собой и пачки одной модели. При упаковке GPU отсечением (compactsDraws) число команд пачки знает
+    // только GPU, поэтому пачка записывается целиком тем диапазоном, в который попало её начало
+    void drawRange(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t firstDraw, uint32_t drawCount,
+        RenderStats& stats);
+    // Диапазон отрисовок пачки [getBatchFirstDraw, getBatchEndDraw)
+    uint32_t getBatchFirstDraw(uint32_t batchIndex) const { return batches[batchIndex].first; }
+    uint32_t getBatchEndDraw(uint32_t batchIndex) const { return batches[batchIndex].first + batches[batchIndex].count; }
+
+    VkDescriptorBufferInfo drawDataDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo drawRemapDescriptorInfo(int frameIndex);
+    // буферы, которые читает и заполняет compute отсечение
+    VkDescriptorBufferInfo commandsDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo drawInfosDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo culledCommandsDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo batchCountsDescriptorInfo(int frameIndex);
+
+    uint32_t getDrawCount() const { return drawCount; }
+    // упаковка непустых команд GPU отсечением и отрисовка через vkCmdDrawIndexedIndirectCount
+    bool compactsDraws() const;
+
+private:
+    struct FrameBuffers
+    {
+        std::unique_ptr<WrpBuffer> commands;       // команды, записанные на CPU (шаблоны при GPU отсечении)
+        std::unique_ptr<WrpBuffer> drawData;
+        std::unique_ptr<WrpBuffer> drawRemap;      // индекс отрисовки -> индекс DrawData
+        std::unique_ptr<WrpBuffer> drawInfos;      // uvec4 (группа экземпляров, пачка, начало пачки, -)
+        std::unique_ptr<WrpBuffer> culledCommands; // команды после GPU отсечения
+        std::unique_ptr<WrpBuffer> batchCounts;    // число команд пачки после GPU отсечения
+    };
+
+    struct Batch
+    {
+        WrpModel* model;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // команды [firstCommand, firstCommand + commandCount) пачки batchIndex (при упаковке - вся пачка)
+    void drawCommands(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t batchIndex,
+        uint32_t firstCommand, uint32_t commandCount, RenderStats& stats);
+
+    WrpDevice& wrpDevice;
+    uint32_t maxDraws;
+    std::vector<FrameBuffers> frames;
+
+    int currentFrame = 0;
+    bool gpuCulling = false;
+    uint32_t drawCount = 0;
+    std::vector<Batch> batches;
+};
@@ -0,0 +1,98 @@
+#include "InstanceBuffer.hpp"
+
+// std
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    std::unique_ptr<WrpBuffer> createMappedStorageBuffer(WrpDevice& device, VkDeviceSize elementSize, uint32_t count)
+    {
+        // HOST_COHERENT: данные пишутся прямо в отображённую память во время записи команд, без явного flush
+        auto buffer = std::make_unique<WrpBuffer>(
+            device,
+            elementSize,
+            count,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->map();
+        return buffer;
+    }
+}
+
+WrpInstanceBuffer::WrpInstanceBuffer(WrpDevice& device, uint32_t framesCount, uint32_t maxInstances)
+    : maxInstances{maxInstances}
+{
+    for (uint32_t i = 0; i < framesCount; i++)
+    {
+        instanceBuffers.push_back(createMappedStorageBuffer(device, sizeof(InstanceData), maxInstances));
+        visibleInstanceBuffers.push_back(createMappedStorageBuffer(device, sizeof(uint32_t), maxInstances));
+        // групп не больше, чем экземпляров
+        groupCountBuffers.push_back(createMappedStorageBuffer(device, sizeof(uint32_t), maxInstances));
+    }
+}
+
+void WrpInstanceBuffer::beginFrame(int frameIndex, bool gpuCulling)
+{
+    currentFrame = frameIndex;
+    this->gpuCulling = gpuCulling;
+    instanceCount = 0;
+    groupCount = 0;
+}
+
+WrpInstanceRange WrpInstanceBuffer::allocate(uint32_t count)
+{
+    if (instanceCount + count > maxInstances)
+    {
+        throw std::runtime_error("Instance buffer overflow: " + std::to_string(instanceCount + count)
+            + " instances requested, capacity is " + std::to_string(maxInstances) + "!");
+    }
+    WrpInstanceRange range{instanceCount, count, groupCount};
+    instanceCount += count;
+    groupCount++;
+
+    // При CPU отсечении все экземпляры группы видимы, и список видимых совпадает с самим диапазоном.
+    // При GPU отсечении счётчик обнуляется, а compute шейдер увеличивает его для каждого прошедшего проверку экземпляра.
+    auto* counts = static_cast<uint32_t*>(groupCountBuffers[currentFrame]->getMappedMemory());
+    counts[range.group] = gpuCulling ? 0 : count;
+    if (!gpuCulling)
+    {
+        auto* visible = static_cast<uint32_t*>(visibleInstanceBuffers[currentFrame]->getMappedMemory());
+        for (uint32_t i = range.first; i < range.first + count; i++)
+        {
+            visible[i] = i;
+        }
+    }
+    return range;
+}
+
+InstanceData& WrpInstanceBuffer::at(uint32_t index)
+{
+    return static_cast<InstanceData*>(instanceBuffers[currentFrame]->getMappedMemory())[index];
+}
+
+const uint32_t* WrpInstanceBuffer::groupCounts(int frameIndex) const
+{
+    return static_cast<const uint32_t*>(groupCountBuffers[frameIndex]->getMappedMemory());
+}
+
+const InstanceData* WrpInstanceBuffer::instances(int frameIndex) const
+{
+    return static_cast<const InstanceData*>(instanceBuffers[frameIndex]->getMappedMemory());
+}
+
+VkDescriptorBufferInfo WrpInstanceBuffer::descriptorInfo(int frameIndex)
+{
+    return instanceBuffers[frameIndex]->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpInstanceBuffer::visibleInstancesDescriptorInfo(int frameIndex)
+{
+    return visibleInstanceBuffers[frameIndex]->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpInstanceBuffer::groupCountsDescriptorInfo(int frameIndex)
+{
+    return groupCountBuffers[frameIndex]->descriptorInfo();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "FrameInfo.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+// Непрерывный диапазон экземпляров одной instanced-группы
+struct WrpInstanceRange
+{
+    uint32_t first;
+    uint32_t count;
+    uint32_t group;
+};
+
+/*
+ * Покадровые storage buffer'ы с данными экземпляров (матрицы модели и нормали, ограничивающая сфера).
+ * Системы рендера резервируют в них непрерывные диапазоны под группы объектов с одной моделью
+ * и рисуют группу одним вызовом с firstInstance = началу диапазона.
+ *
+ * Рядом хранятся список видимых экземпляров (индексы в массиве экземпляров, упакованные в начало диапазона группы)
+ * и счётчики видимых экземпляров групп. При CPU отсечении в группы попадают только видимые объекты, и оба массива
+ * заполняются сразу; при GPU отсечении их заполняет compute шейдер (WrpGpuCulling).
+ * Буферы на каждый кадр в полёте свои, поэтому запись не пересекается с чтением предыдущих кадров.
+ */
+class WrpInstanceBuffer
+{
+public:
+    static constexpr uint32_t MAX_INSTANCES = 16384;
+
+    WrpInstanceBuffer(WrpDevice& device, uint32_t framesCount, uint32_t maxInstances = MAX_INSTANCES);
+
+    WrpInstanceBuffer(const WrpInstanceBuffer&) = delete;
+    WrpInstanceBuffer& operator=(const WrpInstanceBuffer&) = delete;
+
+    // сброс диапазонов в начале кадра
+    void beginFrame(int frameIndex, bool gpuCulling);
+    // Резервирует группу из count подряд идущих экземпляров (first - firstInstance для отрисовки)
+    WrpInstanceRange allocate(uint32_t count);
+    InstanceData& at(uint32_t index);
+
+    // счётчики видимых экземпляров групп кадра frameIndex (результат GPU отсечения, когда кадр завершён)
+    const uint32_t* groupCounts(int frameIndex) const;
+    const InstanceData* instances(int frameIndex) const;
+
+    VkDescriptorBufferInfo descriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo visibleInstancesDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo groupCountsDescriptorInfo(int frameIndex);
+
+    uint32_t getInstanceCount() const { return instanceCount; }
+    uint32_t getGroupCount() const { return groupCount; }
+
+private:
+    uint32_t maxInstances;
+    std::vector<std::unique_ptr<WrpBuffer>> instanceBuffers;
+    std::vector<std::unique_ptr<WrpBuffer>> visibleInstanceBuffers;
+    std::vector<std::unique_ptr<WrpBuffer>> groupCountBuffers;
+
+    int currentFrame = 0;
+    bool gpuCulling = false;
+    uint32_t instanceCount = 0;
+    uint32_t groupCount = 0;
+};
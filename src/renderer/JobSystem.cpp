@@ -0,0 +1,62 @@
+#include "JobSystem.hpp"
+
+// std
+#include <algorithm>
+
+WrpJobSystem& WrpJobSystem::instance()
+{
+    static WrpJobSystem jobSystem;
+    return jobSystem;
+}
+
+WrpJobSystem::WrpJobSystem()
+{
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    uint32_t workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&WrpJobSystem::workerLoop, this);
+    }
+}
+
+WrpJobSystem::~WrpJobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void WrpJobSystem::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        jobs.push_back(std::move(job));
+    }
+    condition.notify_one();
+}
+
+void WrpJobSystem::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            // оставшиеся в очереди задачи выполняются до конца, чтобы их future не остались без результата
+            if (stopping && jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
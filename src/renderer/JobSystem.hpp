@@ -0,0 +1,53 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Простой пул рабочих потоков для независимых задач движка (компиляция шейдеров, создание пайплайнов и т.п.).
+ * Один общий экземпляр на процесс, количество потоков = число ядер - 1 (главный поток продолжает свою работу).
+ */
+class WrpJobSystem
+{
+public:
+    static WrpJobSystem& instance();
+
+    ~WrpJobSystem();
+
+    WrpJobSystem(const WrpJobSystem&) = delete;
+    WrpJobSystem& operator=(const WrpJobSystem&) = delete;
+
+    // Ставит задачу в очередь и возвращает future с её результатом (исключения тоже пробрасываются через future)
+    template <typename F>
+    auto submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    WrpJobSystem();
+
+    void enqueue(std::function<void()> job);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
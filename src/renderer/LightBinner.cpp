@@ -0,0 +1,228 @@
+#include "LightBinner.hpp"
+#include "JobSystem.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WRP_BINNING_SSE
+#include <xmmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+namespace
+{
+    // при меньшем числе пар (источник, срез) распределение по потокам не окупается
+    constexpr size_t PARALLEL_CANDIDATES_THRESHOLD = 512;
+    // номер плитки заглушки, дополняющей строку кандидатов до кратного 4 размера (не попадает ни в одну плитку)
+    constexpr float NO_TILE = 1e9f;
+}
+
+void WrpLightBinner::RowCandidates::clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    tileMin.clear();
+    tileMax.clear();
+    lights.clear();
+}
+
+void WrpLightBinner::RowCandidates::push(const glm::vec4& sphere, float minTile, float maxTile, uint32_t light)
+{
+    x.push_back(sphere.x);
+    y.push_back(sphere.y);
+    z.push_back(sphere.z);
+    radius.push_back(sphere.w);
+    tileMin.push_back(minTile);
+    tileMax.push_back(maxTile);
+    lights.push_back(light);
+}
+
+void WrpLightBinner::setProjection(const glm::mat4& newProjection, float near, float far)
+{
+    if (!clusterMin.empty() && newProjection == projection && near == nearPlane && far == farPlane)
+        return;
+
+    projection = newProjection;
+    nearPlane = near;
+    farPlane = far;
+    const float logDepthRatio = std::log(far / near);
+    sliceScale = CLUSTERS_Z / logDepthRatio;
+    sliceBias = -static_cast<float>(CLUSTERS_Z) * std::log(near) / logDepthRatio;
+
+    // Координата в пространстве камеры на глубине d: ndc * d / P[i][i] (P[2][3] = 1, т.е. w = z).
+    // Для диапазона ndc и диапазона глубин экстремумы достигаются в углах.
+    auto viewRange = [](float ndc0, float ndc1, float scale, float z0, float z1) {
+        return glm::vec2{std::min(ndc0 * z0, ndc0 * z1) / scale, std::max(ndc1 * z0, ndc1 * z1) / scale};
+    };
+
+    clusterMin.resize(CLUSTER_COUNT);
+    clusterMax.resize(CLUSTER_COUNT);
+    clusters.resize(CLUSTER_COUNT);
+    for (uint32_t z = 0; z < CLUSTERS_Z; z++)
+    {
+        const float z0 = near * std::pow(far / near, static_cast<float>(z) / CLUSTERS_Z);
+        const float z1 = near * std::pow(far / near, static_cast<float>(z + 1) / CLUSTERS_Z);
+        for (uint32_t y = 0; y < CLUSTERS_Y; y++)
+        {
+            const glm::vec2 yRange = viewRange(-1.f + 2.f * y / CLUSTERS_Y, -1.f + 2.f * (y + 1) / CLUSTERS_Y,
+                projection[1][1], z0, z1);
+            for (uint32_t x = 0; x < CLUSTERS_X; x++)
+            {
+                const glm::vec2 xRange = viewRange(-1.f + 2.f * x / CLUSTERS_X, -1.f + 2.f * (x + 1) / CLUSTERS_X,
+                    projection[0][0], z0, z1);
+                const uint32_t cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+                clusterMin[cluster] = {xRange.x, yRange.x, z0};
+                clusterMax[cluster] = {xRange.y, yRange.y, z1};
+            }
+        }
+    }
+}
+
+uint32_t WrpLightBinner::sliceOf(float depth) const
+{
+    const float slice = std::log(depth) * sliceScale + sliceBias;
+    return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(CLUSTERS_Z - 1)));
+}
+
+void WrpLightBinner::assign(const glm::mat4& view, const std::vector<glm::vec4>& lightSpheres)
+{
+    viewSpheres.resize(lightSpheres.size());
+    tileRanges.resize(lightSpheres.size());
+    size_t candidatesCount = 0;
+    for (auto& slice : slices)
+        slice.candidates.clear();
+
+    // Диапазон плиток - по проекции AABB сферы в пространстве камеры, часть за ближней плоскостью отбрасывается.
+    // Для x/z при x в [a, b] и z в [zMin, zMax] экстремумы тоже лежат в углах.
+    auto tileRange = [](float a, float b, float zMin, float zMax, float scale, uint32_t tiles, uint8_t& outMin, uint8_t& outMax) {
+        const float ndcMin = std::min(a / zMin, a / zMax) * scale;
+        const float ndcMax = std::max(b / zMin, b / zMax) * scale;
+        if (ndcMax < -1.f || ndcMin > 1.f) return false;
+        const float last = static_cast<float>(tiles - 1);
+        outMin = static_cast<uint8_t>(std::clamp(std::floor((ndcMin + 1.f) * .5f * tiles), 0.f, last));
+        outMax = static_cast<uint8_t>(std::clamp(std::floor((ndcMax + 1.f) * .5f * tiles), 0.f, last));
+        return true;
+    };
+
+    for (uint32_t i = 0; i < lightSpheres.size(); i++)
+    {
+        const glm::vec3 center{view * glm::vec4(glm::vec3(lightSpheres[i]), 1.f)};
+        const float radius = lightSpheres[i].w;
+        viewSpheres[i] = glm::vec4(center, radius);
+
+        const float zMin = std::max(center.z - radius, nearPlane);
+        const float zMax = std::min(center.z + radius, farPlane);
+        if (zMin > zMax) continue;
+
+        auto& range = tileRanges[i];
+        if (!tileRange(center.x - radius, center.x + radius, zMin, zMax, projection[0][0], CLUSTERS_X, range[0], range[1])
+            || !tileRange(center.y - radius, center.y + radius, zMin, zMax, projection[1][1], CLUSTERS_Y, range[2], range[3]))
+        {
+            continue;
+        }
+
+        const uint32_t lastSlice = sliceOf(zMax);
+        for (uint32_t z = sliceOf(zMin); z <= lastSlice; z++)
+            slices[z].candidates.push_back(i);
+        candidatesCount += lastSlice - sliceOf(zMin) + 1;
+    }
+
+    // срезы независимы: каждый пишет только свои кластеры и свой список индексов
+    if (candidatesCount < PARALLEL_CANDIDATES_THRESHOLD)
+    {
+        for (uint32_t z = 0; z < CLUSTERS_Z; z++)
+            binSlice(z);
+    }
+    else
+    {
+        std::array<std::future<void>, CLUSTERS_Z> jobs;
+        for (uint32_t z = 0; z < CLUSTERS_Z; z++)
+            jobs[z] = WrpJobSystem::instance().submit([this, z]() { binSlice(z); });
+        for (auto& job : jobs)
+            job.get();
+    }
+
+    // склейка списков срезов, смещения кластеров переводятся из локальных в общие
+    lightIndices.clear();
+    for (uint32_t z = 0; z < CLUSTERS_Z; z++)
+    {
+        const uint32_t base = static_cast<uint32_t>(lightIndices.size());
+        const uint32_t firstCluster = z * CLUSTERS_X * CLUSTERS_Y;
+        for (uint32_t cluster = firstCluster; cluster < firstCluster + CLUSTERS_X * CLUSTERS_Y; cluster++)
+            clusters[cluster].x += base;
+        lightIndices.insert(lightIndices.end(), slices[z].indices.begin(), slices[z].indices.end());
+    }
+}
+
+void WrpLightBinner::binSlice(uint32_t z)
+{
+    Slice& slice = slices[z];
+    slice.indices.clear();
+    RowCandidates& row = slice.row;
+
+    for (uint32_t y = 0; y < CLUSTERS_Y; y++)
+    {
+        row.clear();
+        for (uint32_t light : slice.candidates)
+        {
+            const auto& range = tileRanges[light];
+            if (y >= range[2] && y <= range[3])
+                row.push(viewSpheres[light], range[0], range[1], light);
+        }
+        while (row.lights.size() % 4 != 0)
+            row.push(glm::vec4{0.f}, NO_TILE, NO_TILE, 0);
+
+        for (uint32_t x = 0; x < CLUSTERS_X; x++)
+        {
+            const uint32_t cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+            const uint32_t offset = static_cast<uint32_t>(slice.indices.size());
+            const glm::vec3& boxMin = clusterMin[cluster];
+            const glm::vec3& boxMax = clusterMax[cluster];
+            const float tile = static_cast<float>(x);
+
+            for (size_t i = 0; i < row.lights.size(); i += 4)
+            {
+#ifdef WRP_BINNING_SSE
+                // квадрат расстояния от центров четырёх сфер до AABB кластера
+                const __m128 zero = _mm_setzero_ps();
+                auto axisDistance = [&zero](const float* centers, float min, float max) {
+                    const __m128 center = _mm_loadu_ps(centers);
+                    const __m128 distance = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(min), center), zero),
+                        _mm_max_ps(_mm_sub_ps(center, _mm_set1_ps(max)), zero));
+                    return _mm_mul_ps(distance, distance);
+                };
+                const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(
+                    axisDistance(&row.x[i], boxMin.x, boxMax.x),
+                    axisDistance(&row.y[i], boxMin.y, boxMax.y)),
+                    axisDistance(&row.z[i], boxMin.z, boxMax.z));
+                const __m128 radius = _mm_loadu_ps(&row.radius[i]);
+                const __m128 tileX = _mm_set1_ps(tile);
+                const __m128 hit = _mm_and_ps(
+                    _mm_cmple_ps(distanceSquared, _mm_mul_ps(radius, radius)),
+                    _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&row.tileMin[i]), tileX), _mm_cmpge_ps(_mm_loadu_ps(&row.tileMax[i]), tileX)));
+
+                const int mask = _mm_movemask_ps(hit);
+                for (int lane = 0; mask >> lane != 0; lane++)
+                {
+                    if (mask & (1 << lane))
+                        slice.indices.push_back(row.lights[i + lane]);
+                }
+#else
+                for (size_t k = i; k < i + 4; k++)
+                {
+                    if (row.tileMin[k] > tile || row.tileMax[k] < tile) continue;
+                    const glm::vec3 center{row.x[k], row.y[k], row.z[k]};
+                    const glm::vec3 offset = glm::max(boxMin - center, 0.f) + glm::max(center - boxMax, 0.f);
+                    if (glm::dot(offset, offset) <= row.radius[k] * row.radius[k])
+                        slice.indices.push_back(row.lights[k]);
+                }
+#endif
+            }
+            clusters[cluster] = {offset, static_cast<uint32_t>(slice.indices.size()) - offset};
+        }
+    }
+}
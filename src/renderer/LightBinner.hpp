@@ -0,0 +1,85 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Распределение точечных источников света по кластерам пирамиды видимости (froxel'ам) на CPU.
+ * Экран делится на CLUSTERS_X * CLUSTERS_Y плиток, а глубина между ближней и дальней плоскостями -
+ * на CLUSTERS_Z срезов с экспоненциальным шагом (номер среза = log(z) * scale + bias), поэтому кластеры
+ * вблизи камеры мельче. Для каждого кластера строится список источников, сфера влияния которых пересекает
+ * его AABB в пространстве камеры.
+ *
+ * Сначала для каждого источника вычисляются диапазоны срезов и плиток, которые покрывает проекция его сферы,
+ * затем срезы обрабатываются независимо в WrpJobSystem: кандидаты среза отбираются по строкам плиток,
+ * и каждая плитка строки проверяется против 4 источников за раз SIMD-инструкциями (SSE).
+ * Результат - смещение и длина списка для каждого кластера и общий массив индексов источников.
+ * Кластеры рассчитаны на перспективную проекцию WrpCamera (+z вперёд, глубина в [0, 1]).
+ */
+class WrpLightBinner
+{
+public:
+    static constexpr uint32_t CLUSTERS_X = 16;
+    static constexpr uint32_t CLUSTERS_Y = 9;
+    static constexpr uint32_t CLUSTERS_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+    // Пересчёт границ кластеров, если проекция изменилась
+    void setProjection(const glm::mat4& projection, float near, float far);
+    // Распределение источников: xyz - позиция в мировом пространстве, w - радиус влияния
+    void assign(const glm::mat4& view, const std::vector<glm::vec4>& lightSpheres);
+
+    // для каждого кластера (x - начало списка в getLightIndices, y - количество источников),
+    // индекс кластера = (z * CLUSTERS_Y + y) * CLUSTERS_X + x
+    const std::vector<glm::uvec2>& getClusters() const { return clusters; }
+    const std::vector<uint32_t>& getLightIndices() const { return lightIndices; }
+
+    // параметры номера среза по глубине в пространстве камеры: slice = log(z) * scale + bias
+    float getSliceScale() const { return sliceScale; }
+    float getSliceBias() const { return sliceBias; }
+
+private:
+    // кандидаты одной строки плиток в SoA-раскладке для SIMD проверки
+    struct RowCandidates
+    {
+        std::vector<float> x, y, z, radius, tileMin, tileMax;
+        std::vector<uint32_t> lights;
+        void clear();
+        void push(const glm::vec4& sphere, float tileMin, float tileMax, uint32_t light);
+    };
+
+    // данные среза: кандидаты и результат его обработки
+    struct Slice
+    {
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> indices;
+        RowCandidates row;
+    };
+
+    void binSlice(uint32_t z);
+    uint32_t sliceOf(float depth) const;
+
+    glm::mat4 projection{0.f};
+    float nearPlane = 0.f;
+    float farPlane = 0.f;
+    float sliceScale = 0.f;
+    float sliceBias = 0.f;
+    // границы кластеров в пространстве камеры
+    std::vector<glm::vec3> clusterMin;
+    std::vector<glm::vec3> clusterMax;
+
+    // источники текущего кадра в пространстве камеры и покрываемые ими диапазоны плиток и срезов
+    std::vector<glm::vec4> viewSpheres;
+    std::vector<std::array<uint8_t, 4>> tileRanges; // minX, maxX, minY, maxY
+
+    std::array<Slice, CLUSTERS_Z> slices;
+    std::vector<glm::uvec2> clusters;
+    std::vector<uint32_t> lightIndices;
+};
@@ -0,0 +1,139 @@
+#include "LightClusters.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+    std::unique_ptr<WrpBuffer> createMappedStorageBuffer(WrpDevice& device, VkDeviceSize elementSize, uint32_t count)
+    {
+        // HOST_COHERENT: источники и списки пишутся прямо в отображённую память перед записью команд кадра
+        auto buffer = std::make_unique<WrpBuffer>(
+            device,
+            elementSize,
+            count,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->map();
+        return buffer;
+    }
+}
+
+WrpLightClusters::WrpLightClusters(WrpDevice& device, uint32_t framesCount) : wrpDevice{device}
+{
+    for (uint32_t i = 0; i < framesCount; i++)
+    {
+        lightBuffers.push_back(createMappedStorageBuffer(device, sizeof(PointLight), INITIAL_LIGHTS));
+        clusterBuffers.push_back(createMappedStorageBuffer(device, sizeof(glm::uvec2), WrpLightBinner::CLUSTER_COUNT));
+        lightIndexBuffers.push_back(createMappedStorageBuffer(device, sizeof(uint32_t), INITIAL_LIGHT_INDICES));
+    }
+    bufferGenerations.assign(framesCount, 0);
+    lightSpheres.reserve(INITIAL_LIGHTS);
+}
+
+bool WrpLightClusters::reserve(std::unique_ptr<WrpBuffer>& buffer, VkDeviceSize elementSize, size_t required, uint32_t keepCount)
+{
+    const uint64_t capacity = buffer->getInstanceCount();
+    if (required <= capacity)
+        return true;
+
+    const uint64_t limit = std::min<uint64_t>(wrpDevice.properties.limits.maxStorageBufferRange / elementSize,
+        std::numeric_limits<uint32_t>::max());
+    if (capacity >= limit)
+        return false;
+    uint64_t newCapacity = capacity;
+    while (newCapacity < required && newCapacity < limit)
+        newCapacity = std::min(newCapacity * 2, limit);
+
+    // буфер этого кадра GPU уже не читает (забор кадра дождались), поэтому его можно сразу освободить
+    auto grown = createMappedStorageBuffer(wrpDevice, elementSize, static_cast<uint32_t>(newCapacity));
+    std::memcpy(grown->getMappedMemory(), buffer->getMappedMemory(), keepCount * elementSize);
+    buffer = std::move(grown);
+    bufferGenerations[currentFrame]++;
+    return newCapacity >= required;
+}
+
+void WrpLightClusters::beginFrame(int frameIndex)
+{
+    currentFrame = frameIndex;
+    lightCount = 0;
+    droppedLights = 0;
+    lightSpheres.clear();
+}
+
+void WrpLightClusters::addLight(const glm::vec3& position, const glm::vec3& color, float intensity)
+{
+    if (!reserve(lightBuffers[currentFrame], sizeof(PointLight), lightCount + 1, lightCount))
+    {
+        droppedLights++;
+        return;
+    }
+
+    // intensity * max(color) / d^2 = LIGHT_CUTOFF
+    const float radius = std::sqrt(std::max(intensity * std::max({color.r, color.g, color.b}), 0.f) / LIGHT_CUTOFF);
+    auto* lights = static_cast<PointLight*>(lightBuffers[currentFrame]->getMappedMemory());
+    lights[lightCount].position = glm::vec4(position, radius);
+    lights[lightCount].color = glm::vec4(color, intensity);
+    lightSpheres.push_back(glm::vec4(position, radius));
+    lightCount++;
+}
+
+void WrpLightClusters::assignLights(const WrpCamera& camera, VkExtent2D extent, GlobalUbo& ubo, RenderStats& stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    binner.setProjection(camera.getProjection(), camera.getNear(), camera.getFar());
+    binner.assign(camera.getView(), lightSpheres);
+
+    // Массив индексов растёт под списки кадра. Усекаются они только за пределом устройства: тогда часть
+    // источников в дальних кластерах пропадёт, но кадр останется корректным.
+    const auto& indices = binner.getLightIndices();
+    reserve(lightIndexBuffers[currentFrame], sizeof(uint32_t), indices.size(), 0);
+    const uint32_t indexCount = static_cast<uint32_t>(
+        std::min<size_t>(indices.size(), lightIndexBuffers[currentFrame]->getInstanceCount()));
+
+    const bool overflow = droppedLights != 0 || indexCount < indices.size();
+    if (overflow && !overflowReported)
+    {
+        std::cerr << "[LightClusters] storage buffer limit reached: " << droppedLights << " point lights and "
+            << indices.size() - indexCount << " cluster light indices are dropped" << std::endl;
+    }
+    overflowReported = overflow;
+
+    auto* clusters = static_cast<glm::uvec2*>(clusterBuffers[currentFrame]->getMappedMemory());
+    for (uint32_t i = 0; i < WrpLightBinner::CLUSTER_COUNT; i++)
+    {
+        const glm::uvec2 cluster = binner.getClusters()[i];
+        const uint32_t offset = std::min(cluster.x, indexCount);
+        clusters[i] = {offset, std::min(cluster.y, indexCount - offset)};
+    }
+    std::memcpy(lightIndexBuffers[currentFrame]->getMappedMemory(), indices.data(), indexCount * sizeof(uint32_t));
+
+    ubo.clusterGrid = {WrpLightBinner::CLUSTERS_X, WrpLightBinner::CLUSTERS_Y, WrpLightBinner::CLUSTERS_Z, lightCount};
+    ubo.clusterParams = {static_cast<float>(extent.width), static_cast<float>(extent.height),
+        binner.getSliceScale(), binner.getSliceBias()};
+
+    stats.pointLights = lightCount;
+    stats.lightAssignments = indexCount;
+    stats.lightBinningMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+VkDescriptorBufferInfo WrpLightClusters::lightsDescriptorInfo(int frameIndex)
+{
+    return lightBuffers[frameIndex]->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpLightClusters::clustersDescriptorInfo(int frameIndex)
+{
+    return clusterBuffers[frameIndex]->descriptorInfo();
+}
+
+VkDescriptorBufferInfo WrpLightClusters::lightIndicesDescriptorInfo(int frameIndex)
+{
+    return lightIndexBuffers[frameIndex]->descriptorInfo();
+}
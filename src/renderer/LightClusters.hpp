@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "FrameInfo.hpp"
+#include "LightBinner.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+/*
+ * Кластерное прямое освещение: покадровые storage buffer'ы с точечными источниками (set 0, binding 5),
+ * списками источников по кластерам пирамиды видимости (binding 6: начало и длина списка) и общим массивом
+ * индексов (binding 7). Источники добавляются за кадр через addLight, затем assignLights распределяет их
+ * по кластерам (WrpLightBinner), и фрагментный шейдер обходит только список своего кластера.
+ *
+ * Буферы источников и индексов растут по требованию: при нехватке буфер кадра пересоздаётся вдвое большим
+ * (в пределах maxStorageBufferRange), и его номер версии (getBufferGeneration) меняется - привязки 5 и 7
+ * набора дескрипторов этого кадра нужно переписать до его привязки. Источники и индексы сверх предела
+ * устройства отбрасываются с сообщением в лог.
+ *
+ * Радиус влияния источника - расстояние, на котором интенсивность по обратному квадрату падает до LIGHT_CUTOFF;
+ * шейдер сводит вклад к нулю на этом радиусе (ClusteredLights.glsl), поэтому отбрасывание источника
+ * за его пределами не даёт видимых швов между кластерами.
+ */
+class WrpLightClusters
+{
+public:
+    // начальная ёмкость покадровых буферов
+    static constexpr uint32_t INITIAL_LIGHTS = 8192;
+    static constexpr uint32_t INITIAL_LIGHT_INDICES = 1 << 19;
+    static constexpr float LIGHT_CUTOFF = .05f;
+
+    WrpLightClusters(WrpDevice& device, uint32_t framesCount);
+
+    WrpLightClusters(const WrpLightClusters&) = delete;
+    WrpLightClusters& operator=(const WrpLightClusters&) = delete;
+
+    // сброс источников в начале кадра
+    void beginFrame(int frameIndex);
+    void addLight(const glm::vec3& position, const glm::vec3& color, float intensity);
+    // Распределение источников кадра по кластерам камеры и заполнение параметров кластеров в ubo
+    void assignLights(const WrpCamera& camera, VkExtent2D extent, GlobalUbo& ubo, RenderStats& stats);
+
+    VkDescriptorBufferInfo lightsDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo clustersDescriptorInfo(int frameIndex);
+    VkDescriptorBufferInfo lightIndicesDescriptorInfo(int frameIndex);
+
+    uint32_t getLightCount() const { return lightCount; }
+    // меняется при пересоздании буферов источников или индексов кадра
+    uint32_t getBufferGeneration(int frameIndex) const { return bufferGenerations[frameIndex]; }
+
+private:
+    // Пересоздание буфера текущего кадра с ёмкостью не меньше required, первые keepCount элементов копируются.
+    // false, если столько элементов не помещается в maxStorageBufferRange (буфер всё равно растёт до предела)
+    bool reserve(std::unique_ptr<WrpBuffer>& buffer, VkDeviceSize elementSize, size_t required, uint32_t keepCount);
+
+    WrpDevice& wrpDevice;
+    std::vector<std::unique_ptr<WrpBuffer>> lightBuffers;
+    std::vector<std::unique_ptr<WrpBuffer>> clusterBuffers;
+    std::vector<std::unique_ptr<WrpBuffer>> lightIndexBuffers;
+    std::vector<uint32_t> bufferGenerations;
+
+    WrpLightBinner binner{};
+    std::vector<glm::vec4> lightSpheres; // xyz - позиция, w - радиус влияния
+    int currentFrame = 0;
+    uint32_t lightCount = 0;
+    uint32_t droppedLights = 0;   // источники кадра, не поместившиеся в буфер
+    bool overflowReported = false; // о потерях сообщается один раз, пока они не прекратятся
+};
@@ -8,9 +8,11 @@
 #include <tiny_obj_loader.h>
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <numeric>
 #include <unordered_map>
 
 namespace std
@@ -28,11 +30,18 @@ namespace std
 }
 
 WrpModel::WrpModel(WrpDevice& device, const WrpModel::Builder& builder)
-    : wrpDevice{device}, subMeshesInfos{builder.subMeshesInfos}
+    : wrpDevice{device}, subMeshesInfos{builder.subMeshesInfos}, bounds{builder.bounds}
 {
+    boundingSphere = bounds.boundingSphere();
+    for (const auto& subMesh : subMeshesInfos)
+    {
+        triangleCount += subMesh.indexCount / 3;
+    }
+
     createVertexBuffers(builder.vertices);
     createIndexBuffers(builder.indices);
     createTextures(builder.texturePaths);
+    createOccluderMesh(builder);
 }
 
 WrpModel::~WrpModel(){}
@@ -188,6 +197,24 @@ void WrpModel::Builder::loadModel(const std::string& filepath)
             shape.mesh.material_ids.at(shape.mesh.material_ids.size()-1), difTexPathsMap, specTexPathsMap, materials);
         subMeshesInfos.push_back(subMesh);
     }
+
+    computeBounds();
+}
+
+// Границы всей модели и каждого подобъекта считаются один раз при импорте, по вершинам из их диапазонов индексов
+void WrpModel::Builder::computeBounds()
+{
+    bounds = WrpAabb{};
+    for (auto& subMesh : subMeshesInfos)
+    {
+        subMesh.bounds = WrpAabb{};
+        for (uint32_t i = subMesh.indexStart; i < subMesh.indexStart + subMesh.indexCount; i++)
+        {
+            subMesh.bounds.expand(vertices[indices[i]].position);
+        }
+        subMesh.boundingSphere = subMesh.bounds.boundingSphere();
+        bounds.expand(subMesh.bounds);
+    }
 }
 
 WrpModel::Builder::SubMesh WrpModel::Builder::createSubMesh(
@@ -303,6 +330,39 @@ void WrpModel::createIndexBuffers(const std::vector<uint32_t>& indices)
     wrpDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
 }
 
+void WrpModel::createOccluderMesh(const Builder& builder)
+{
+    // Окклюдер - подмножество подобъектов самой модели, поэтому он никогда не закрывает больше, чем настоящая геометрия.
+    // Первыми берутся подобъекты с наибольшей площадью границ на треугольник (стены, пол, крупные простые детали),
+    // пока не исчерпан бюджет треугольников.
+    auto surfaceArea = [](const WrpAabb& box) {
+        const glm::vec3 size = box.max - box.min;
+        return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    };
+    std::vector<uint32_t> order(subMeshesInfos.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto score = [&](uint32_t i) {
+        const auto& subMesh = subMeshesInfos[i];
+        return subMesh.bounds.isValid() ? surfaceArea(subMesh.bounds) / std::max(subMesh.indexCount / 3, 1u) : 0.f;
+    };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return score(a) > score(b); });
+
+    uint32_t occluderTriangleCount = 0;
+    for (uint32_t i : order)
+    {
+        const auto& subMesh = subMeshesInfos[i];
+        const uint32_t triangles = subMesh.indexCount / 3;
+        if (triangles == 0 || score(i) <= 0.f || occluderTriangleCount + triangles > MAX_OCCLUDER_TRIANGLES) continue;
+
+        for (uint32_t k = subMesh.indexStart; k < subMesh.indexStart + triangles * 3; k++)
+        {
+            const uint32_t vertex = builder.indices.empty() ? k : builder.indices[k];
+            occluderTriangles.push_back(builder.vertices[vertex].position);
+        }
+        occluderTriangleCount += triangles;
+    }
+}
+
 void WrpModel::createTextures(const std::vector<std::string>& texturePaths)
 {
     if (!texturePaths.empty()) hasTextures = true;
@@ -326,9 +386,10 @@ void WrpModel::draw(VkCommandBuffer commandBuffer)
     }
 }
 
-void WrpModel::drawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t indexStart)
+void WrpModel::drawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t indexStart,
+    uint32_t instanceCount, uint32_t firstInstance)
 {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexStart, 0, 0);
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, indexStart, 0, firstInstance);
 }
 
 // Binding vertexBuffers and indexBuffer to graphics pipeline
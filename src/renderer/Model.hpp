@@ -3,6 +3,7 @@
 #include "Device.hpp"
 #include "Buffer.hpp"
 #include "Texture.hpp"
+#include "Bounds.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS			  // Функции GLM будут работать с радианами, а не градусами
@@ -46,19 +47,26 @@ public:
             int diffuseTextureIndex;
             glm::vec3 diffuseColor;
             int specularTextureIndex;
+            WrpAabb bounds{};                    // границы подобъекта в пространстве модели
+            WrpBoundingSphere boundingSphere{};  // описанная сфера для отсечения по фрустуму
         };
 
         std::vector<Vertex> vertices{};
         std::vector<uint32_t> indices{};
         std::vector<std::string> texturePaths{};
         std::vector<SubMesh> subMeshesInfos{};
+        WrpAabb bounds{};
 
         void loadModel(const std::string& filepath);
+        void computeBounds();
         SubMesh createSubMesh(uint32_t indexStart, uint32_t indexCount, int materialId,
             std::unordered_map<std::string, int>& difTexPathsMap, std::unordered_map<std::string, int>& specTexPathsMap,
             std::vector<tinyobj::material_t>& materials);
     };
 
+    // бюджет треугольников упрощённого окклюдера модели для программного отсечения перекрытых объектов
+    static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 4096;
+
     WrpModel(WrpDevice& device, const WrpModel::Builder& builder);
     ~WrpModel();
 
@@ -73,10 +81,17 @@ public:
 
     void bind(VkCommandBuffer commandBuffer);
     void draw(VkCommandBuffer commandBuffer);
-    void drawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t indexStart = 0);
+    void drawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t indexStart = 0,
+        uint32_t instanceCount = 1, uint32_t firstInstance = 0);
 
     std::vector<Builder::SubMesh>& getSubMeshesInfos() {return subMeshesInfos;}
+    const std::vector<Builder::SubMesh>& getSubMeshesInfos() const {return subMeshesInfos;}
     std::vector<std::unique_ptr<WrpTexture>>& getTextures() {return textures;}
+    const WrpAabb& getBounds() const {return bounds;}
+    const WrpBoundingSphere& getBoundingSphere() const {return boundingSphere;}
+    uint32_t getTriangleCount() const {return triangleCount;}
+    // вершины треугольников окклюдера подряд по 3 в пространстве модели (см. WrpOcclusionBuffer)
+    const std::vector<glm::vec3>& getOccluderTriangles() const {return occluderTriangles;}
 
     bool hasTextures = false;
 
@@ -84,6 +99,7 @@ private:
     void createVertexBuffers(const std::vector<Vertex>& vertices);
     void createIndexBuffers(const std::vector<uint32_t>& indices);
     void createTextures(const std::vector<std::string>& texturePaths);
+    void createOccluderMesh(const Builder& builder);
 
     WrpDevice& wrpDevice;
 
@@ -96,4 +112,9 @@ private:
 
     std::vector<Builder::SubMesh> subMeshesInfos;
     std::vector<std::unique_ptr<WrpTexture>> textures;
+
+    WrpAabb bounds{};
+    WrpBoundingSphere boundingSphere{};
+    uint32_t triangleCount = 0;
+    std::vector<glm::vec3> occluderTriangles;
 };
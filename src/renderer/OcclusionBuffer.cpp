@@ -0,0 +1,254 @@
+#include "OcclusionBuffer.hpp"
+#include "JobSystem.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WRP_OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+
+namespace
+{
+    // при меньшем числе треугольников распределение полос по потокам не окупается
+    constexpr size_t PARALLEL_TRIANGLES_THRESHOLD = 256;
+    // допуск сравнения обратной глубины: поверхность, совпадающая с гранью своего же бокса, не закрывает его
+    constexpr float DEPTH_EPSILON = 1e-5f;
+
+    // точка на отрезке между вершинами по разные стороны ближней плоскости (z = 0 в пространстве отсечения)
+    glm::vec4 nearIntersection(const glm::vec4& inside, const glm::vec4& outside)
+    {
+        const float t = inside.z / (inside.z - outside.z);
+        return inside + (outside - inside) * t;
+    }
+}
+
+void WrpOcclusionBuffer::begin(const glm::mat4& newViewProjection)
+{
+    viewProjection = newViewProjection;
+    std::fill(inverseDepth.begin(), inverseDepth.end(), 0.f);
+    triangles.clear();
+    for (auto& band : bands)
+        band.clear();
+}
+
+void WrpOcclusionBuffer::addOccluder(const glm::mat4& modelMatrix, const std::vector<glm::vec3>& positions)
+{
+    const glm::mat4 transform = viewProjection * modelMatrix;
+    for (size_t i = 0; i + 2 < positions.size(); i += 3)
+    {
+        const std::array<glm::vec4, 3> v{
+            transform * glm::vec4(positions[i], 1.f),
+            transform * glm::vec4(positions[i + 1], 1.f),
+            transform * glm::vec4(positions[i + 2], 1.f)
+        };
+
+        // целиком за одной из боковых плоскостей пирамиды видимости
+        if ((v[0].x > v[0].w && v[1].x > v[1].w && v[2].x > v[2].w)
+            || (v[0].x < -v[0].w && v[1].x < -v[1].w && v[2].x < -v[2].w)
+            || (v[0].y > v[0].w && v[1].y > v[1].w && v[2].y > v[2].w)
+            || (v[0].y < -v[0].w && v[1].y < -v[1].w && v[2].y < -v[2].w))
+        {
+            continue;
+        }
+
+        // Обрезка ближней плоскостью (Сазерленд-Ходжман по одной плоскости): остаётся треугольник или четырёхугольник
+        std::array<glm::vec4, 4> polygon;
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            const glm::vec4& current = v[j];
+            const glm::vec4& next = v[(j + 1) % 3];
+            if (current.z >= 0.f)
+                polygon[count++] = current;
+            if ((current.z >= 0.f) != (next.z >= 0.f))
+                polygon[count++] = current.z >= 0.f ? nearIntersection(current, next) : nearIntersection(next, current);
+        }
+        for (uint32_t j = 2; j < count; j++)
+            addClippedTriangle(polygon[0], polygon[j - 1], polygon[j]);
+    }
+}
+
+void WrpOcclusionBuffer::addClippedTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+    // экранные координаты в пикселях и обратная глубина
+    auto toScreen = [](const glm::vec4& clip) {
+        const float inverseW = 1.f / clip.w;
+        return glm::vec3{(clip.x * inverseW * .5f + .5f) * WIDTH, (clip.y * inverseW * .5f + .5f) * HEIGHT, inverseW};
+    };
+    const glm::vec3 s0 = toScreen(v0);
+    const glm::vec3 s1 = toScreen(v1);
+    const glm::vec3 s2 = toScreen(v2);
+
+    const float area = (s1.x - s0.x) * (s2.y - s0.y) - (s1.y - s0.y) * (s2.x - s0.x);
+    if (std::abs(area) < 1e-6f) return;
+
+    ScreenTriangle triangle;
+    triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({s0.x, s1.x, s2.x}))));
+    triangle.maxX = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(std::max({s0.x, s1.x, s2.x}))));
+    triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({s0.y, s1.y, s2.y}))));
+    triangle.maxY = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(std::max({s0.y, s1.y, s2.y}))));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+
+    // Функции рёбер ориентируются так, чтобы внутри треугольника они были положительны при любом обходе вершин.
+    // Покрытие проверяется в центре пикселя: соседние треугольники меша закрывают общее ребро без щелей.
+    const float orientation = area > 0.f ? 1.f : -1.f;
+    const std::array<const glm::vec3*, 3> vertices{&s0, &s1, &s2};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const glm::vec3& a = *vertices[i];
+        const glm::vec3& b = *vertices[(i + 1) % 3];
+        const float edgeA = (a.y - b.y) * orientation;
+        const float edgeB = (b.x - a.x) * orientation;
+        triangle.edgeA[i] = edgeA;
+        triangle.edgeB[i] = edgeB;
+        triangle.edgeC[i] = -(edgeA * a.x + edgeB * a.y);
+    }
+
+    // Плоскость обратной глубины q = depthA * x + depthB * y + depthC, сдвинутая к самой дальней точке пикселя
+    const float depthA = ((s1.z - s0.z) * (s2.y - s0.y) - (s2.z - s0.z) * (s1.y - s0.y)) / area;
+    const float depthB = ((s2.z - s0.z) * (s1.x - s0.x) - (s1.z - s0.z) * (s2.x - s0.x)) / area;
+    triangle.depthA = depthA;
+    triangle.depthB = depthB;
+    triangle.depthC = s0.z - depthA * s0.x - depthB * s0.y - .5f * (std::abs(depthA) + std::abs(depthB));
+
+    const uint32_t index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+    for (int band = triangle.minY / static_cast<int>(BAND_HEIGHT); band <= triangle.maxY / static_cast<int>(BAND_HEIGHT); band++)
+        bands[band].push_back(index);
+}
+
+void WrpOcclusionBuffer::rasterize()
+{
+    // полосы независимы: каждая пишет только свои строки буфера
+    if (triangles.size() < PARALLEL_TRIANGLES_THRESHOLD)
+    {
+        for (uint32_t band = 0; band < BAND_COUNT; band++)
+            rasterizeBand(band);
+    }
+    else
+    {
+        std::array<std::future<void>, BAND_COUNT> jobs;
+        for (uint32_t band = 0; band < BAND_COUNT; band++)
+            jobs[band] = WrpJobSystem::instance().submit([this, band]() { rasterizeBand(band); });
+        for (auto& job : jobs)
+            job.get();
+    }
+}
+
+void WrpOcclusionBuffer::rasterizeBand(uint32_t band)
+{
+    const int bandBegin = static_cast<int>(band * BAND_HEIGHT);
+    const int bandEnd = bandBegin + static_cast<int>(BAND_HEIGHT);
+    for (uint32_t index : bands[band])
+    {
+        const ScreenTriangle& t = triangles[index];
+        const int firstRow = std::max(t.minY, bandBegin);
+        const int lastRow = std::min(t.maxY, bandEnd - 1);
+        // начало выравнивается на 4 пикселя: лишние пиксели слева отсекают функции рёбер
+        const int firstColumn = t.minX & ~3;
+
+        for (int y = firstRow; y <= lastRow; y++)
+        {
+            const float py = static_cast<float>(y) + .5f;
+            float* row = inverseDepth.data() + static_cast<size_t>(y) * WIDTH;
+            int x = firstColumn;
+#ifdef WRP_OCCLUSION_SSE
+            // четыре пикселя за итерацию, WIDTH кратно 4, поэтому последняя четвёрка не выходит за строку
+            const __m128 offsets = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 rowEdge0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+            const __m128 rowEdge1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+            const __m128 rowEdge2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+            const __m128 rowDepth = _mm_set1_ps(t.depthB * py + t.depthC);
+            for (; x <= t.maxX; x += 4)
+            {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+                const __m128 inside = _mm_and_ps(
+                    _mm_and_ps(
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(t.edgeA[0])), rowEdge0), zero),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(t.edgeA[1])), rowEdge1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(t.edgeA[2])), rowEdge2), zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                const __m128 depth = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(t.depthA)), rowDepth);
+                const __m128 current = _mm_loadu_ps(row + x);
+                const __m128 nearest = _mm_max_ps(current, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+#endif
+            // без SSE - попиксельно
+            for (; x <= t.maxX; x++)
+            {
+                const float px = static_cast<float>(x) + .5f;
+                if (t.edgeA[0] * px + t.edgeB[0] * py + t.edgeC[0] < 0.f
+                    || t.edgeA[1] * px + t.edgeB[1] * py + t.edgeC[1] < 0.f
+                    || t.edgeA[2] * px + t.edgeB[2] * py + t.edgeC[2] < 0.f)
+                {
+                    continue;
+                }
+                row[x] = std::max(row[x], t.depthA * px + t.depthB * py + t.depthC);
+            }
+        }
+    }
+}
+
+bool WrpOcclusionBuffer::isOccluded(const WrpAabb& worldBox) const
+{
+    if (!worldBox.isValid()) return false;
+
+    // экранный прямоугольник бокса и обратная глубина его ближайшей точки (по 8 углам)
+    glm::vec2 minScreen{std::numeric_limits<float>::max()};
+    glm::vec2 maxScreen{std::numeric_limits<float>::lowest()};
+    float nearestDepth = 0.f;
+    for (uint32_t corner = 0; corner < 8; corner++)
+    {
+        const glm::vec3 position{
+            corner & 1 ? worldBox.max.x : worldBox.min.x,
+            corner & 2 ? worldBox.max.y : worldBox.min.y,
+            corner & 4 ? worldBox.max.z : worldBox.min.z
+        };
+        const glm::vec4 clip = viewProjection * glm::vec4(position, 1.f);
+        if (clip.z < 0.f || clip.w <= 0.f) return false; // перед ближней плоскостью
+
+        const float inverseW = 1.f / clip.w;
+        const glm::vec2 screen{(clip.x * inverseW * .5f + .5f) * WIDTH, (clip.y * inverseW * .5f + .5f) * HEIGHT};
+        minScreen = glm::min(minScreen, screen);
+        maxScreen = glm::max(maxScreen, screen);
+        nearestDepth = std::max(nearestDepth, inverseW);
+    }
+
+    // Проверяются все пиксели, которых касается прямоугольник; часть бокса за краями экрана не видна в любом случае
+    const int minX = std::max(0, static_cast<int>(std::floor(minScreen.x)));
+    const int maxX = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(maxScreen.x)));
+    const int minY = std::max(0, static_cast<int>(std::floor(minScreen.y)));
+    const int maxY = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(maxScreen.y)));
+    if (minX > maxX || minY > maxY) return false; // вне экрана: это решает отсечение по пирамиде видимости
+
+    // объект виден, если хотя бы в одном пикселе окклюдеры не ближе его ближайшей точки
+    const float threshold = nearestDepth * (1.f + DEPTH_EPSILON);
+    for (int y = minY; y <= maxY; y++)
+    {
+        const float* row = inverseDepth.data() + static_cast<size_t>(y) * WIDTH;
+        int x = minX;
+#ifdef WRP_OCCLUSION_SSE
+        // выравнивание вниз на 4 пикселя добавляет к проверке соседние пиксели, что только консервативнее
+        x &= ~3;
+        const __m128 limit = _mm_set1_ps(threshold);
+        for (; x <= maxX; x += 4)
+        {
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), limit)) != 0)
+                return false;
+        }
+#endif
+        for (; x <= maxX; x++)
+        {
+            if (row[x] <= threshold) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Bounds.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Программный буфер глубины низкого разрешения для отсечения перекрытых объектов на CPU.
+ * Треугольники окклюдеров переводятся в пространство отсечения, обрезаются ближней плоскостью и раскладываются
+ * по горизонтальным полосам буфера; полосы растеризуются независимо в WrpJobSystem, по 4 пикселя строки
+ * за раз SIMD-инструкциями (SSE), на платформах без SSE - скалярно.
+ *
+ * Покрытие пикселя проверяется в его центре, а глубина пишется консервативно - самая дальняя точка плоскости
+ * треугольника в пределах пикселя, поэтому окклюдер никогда не оказывается ближе, чем он есть. Погрешность
+ * остаётся только на силуэтах окклюдеров (до половины пикселя буфера): объект, видимый в более узкую щель,
+ * может быть отсечён. Окклюдеры - подмножество настоящей геометрии (см. WrpModel::getOccluderTriangles).
+ * В буфере хранится обратная глубина 1/w: она линейна в экранном пространстве, как и функции рёбер, и сохраняет
+ * относительную точность вдали от камеры (в отличие от глубины NDC). Больше значение - ближе, 0 - пусто.
+ */
+class WrpOcclusionBuffer
+{
+public:
+    static constexpr uint32_t WIDTH = 256; // кратно 4 (строка обрабатывается по 4 пикселя)
+    static constexpr uint32_t HEIGHT = 144;
+    static constexpr uint32_t BAND_HEIGHT = 16;
+    static constexpr uint32_t BAND_COUNT = HEIGHT / BAND_HEIGHT;
+
+    // Очистка буфера и треугольников прошлого кадра
+    void begin(const glm::mat4& viewProjection);
+    // Треугольники окклюдера: вершины подряд по 3 в пространстве модели
+    void addOccluder(const glm::mat4& modelMatrix, const std::vector<glm::vec3>& triangles);
+    // Растеризация добавленных треугольников, после неё буфер готов к проверкам
+    void rasterize();
+
+    // true, если бокс в мировом пространстве целиком закрыт уже растеризованными окклюдерами.
+    // Боксы, пересекающие ближнюю плоскость или целиком вне экрана, перекрытыми не считаются.
+    bool isOccluded(const WrpAabb& worldBox) const;
+
+    // треугольники, попавшие в буфер после обрезки (ближней плоскостью и краями экрана)
+    uint32_t getTriangleCount() const { return static_cast<uint32_t>(triangles.size()); }
+    // обратная глубина по строкам, WIDTH * HEIGHT значений
+    const std::vector<float>& getInverseDepth() const { return inverseDepth; }
+
+private:
+    // Треугольник в пикселях: функции рёбер a * x + b * y + c (внутри >= 0),
+    // плоскость обратной глубины (уже уменьшена до минимума в пределах пикселя) и ограничивающий
+    // прямоугольник, обрезанный экраном. Всё вычисляется в центрах пикселей.
+    struct ScreenTriangle
+    {
+        std::array<float, 3> edgeA, edgeB, edgeC;
+        float depthA, depthB, depthC;
+        int minX, maxX, minY, maxY;
+    };
+
+    void addClippedTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+    void rasterizeBand(uint32_t band);
+
+    glm::mat4 viewProjection{1.f};
+    std::vector<float> inverseDepth = std::vector<float>(WIDTH * HEIGHT, 0.f);
+    std::vector<ScreenTriangle> triangles;
+    std::array<std::vector<uint32_t>, BAND_COUNT> bands; // индексы треугольников, задевающих полосу
+};
@@ -0,0 +1,92 @@
+#include "OcclusionCulling.hpp"
+#include "Culling.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+
+void WrpOcclusionCuller::rasterizeOccluders(const WrpCamera& camera, WrpScene& sceneObjects,
+    const WrpTransformCache& transforms, RenderStats& stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const WrpFrustumCuller frustum{camera};
+    const glm::vec3 cameraPosition = camera.getPosition();
+
+    // кандидаты - видимые модели с окклюдером, крупные на экране (камера внутри сферы - самые крупные)
+    occluders.clear();
+    for (auto& [id, component] : sceneObjects.models())
+    {
+        const WrpModel* model = component.model.get();
+        if (model->getOccluderTriangles().empty()) continue;
+
+        const TransformComponent& transform = sceneObjects.at(id).transform;
+        const WrpBoundingSphere& sphere = transforms.worldSphere(transform);
+        if (sphere.isEmpty() || !frustum.testSphere(sphere)) continue;
+
+        const float distance = std::max(glm::length(sphere.center - cameraPosition), camera.getNear());
+        const float size = sphere.radius / distance;
+        if (size < MIN_OCCLUDER_SIZE) continue;
+        occluders.push_back({size, &transforms.modelMatrix(transform), model});
+    }
+    std::sort(occluders.begin(), occluders.end(),
+        [](const Occluder& a, const Occluder& b) { return a.size > b.size; });
+
+    buffer.begin(camera.getProjection() * camera.getView());
+    uint32_t triangleBudget = MAX_FRAME_OCCLUDER_TRIANGLES;
+    uint32_t rasterized = 0;
+    for (const auto& occluder : occluders)
+    {
+        if (rasterized >= MAX_OCCLUDERS) break;
+        const uint32_t triangles = static_cast<uint32_t>(occluder.model->getOccluderTriangles().size() / 3);
+        if (triangles > triangleBudget) continue; // меньшие окклюдеры ещё могут поместиться в бюджет
+        buffer.addOccluder(*occluder.modelMatrix, occluder.model->getOccluderTriangles());
+        triangleBudget -= triangles;
+        rasterized++;
+    }
+    buffer.rasterize();
+    active = true;
+
+    stats.occludersRasterized = rasterized;
+    stats.occluderTriangles = buffer.getTriangleCount();
+    stats.occlusionMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void WrpOcclusionCuller::cullObjects(const std::vector<WrpRenderObject>& objects, const WrpTransformCache& transforms,
+    std::vector<uint8_t>& visible, RenderStats& stats) const
+{
+    if (!active) return;
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (!visible[i]) continue;
+        const WrpModel& model = *objects[i].model;
+        if (!buffer.isOccluded(model.getBounds().transformed(transforms.modelMatrix(*objects[i].transform)))) continue;
+
+        // объект уже посчитан видимым отсечением по пирамиде видимости
+        visible[i] = 0;
+        stats.objectsVisible--;
+        stats.objectsCulled++;
+        stats.objectsOccluded++;
+        stats.trianglesCulled += model.getTriangleCount();
+    }
+}
+
+void WrpOcclusionCuller::cullSubMeshes(const glm::mat4& modelMatrix, const WrpModel& model,
+    std::vector<uint8_t>& visible, RenderStats& stats) const
+{
+    const auto& subMeshes = model.getSubMeshesInfos();
+    if (!active || subMeshes.size() < 2) return;
+
+    for (size_t i = 0; i < subMeshes.size(); i++)
+    {
+        if (!visible[i] || !buffer.isOccluded(subMeshes[i].bounds.transformed(modelMatrix))) continue;
+
+        // подобъект уже посчитан видимым WrpFrustumCuller::cullSubMeshes
+        const uint32_t triangles = subMeshes[i].indexCount / 3;
+        visible[i] = 0;
+        stats.trianglesVisible -= triangles;
+        stats.trianglesCulled += triangles;
+        stats.subMeshesCulled++;
+        stats.subMeshesOccluded++;
+    }
+}
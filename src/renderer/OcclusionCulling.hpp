@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "FrameInfo.hpp"
+#include "Model.hpp"
+#include "OcclusionBuffer.hpp"
+#include "TransformCache.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+/*
+ * Отсечение перекрытых объектов на CPU по программному буферу глубины (WrpOcclusionBuffer).
+ * Раз в кадр из видимых объектов выбираются окклюдеры - модели с упрощённым окклюдером, наибольшие на экране
+ * (отношение радиуса к расстоянию), в пределах бюджета треугольников, и растеризуются в буфер. Затем системы
+ * рендера после отсечения по пирамиде видимости проверяют мировые AABB объектов и подобъектов по этому буферу
+ * до сборки списка отрисовки. Работает только вместе с CPU отсечением: при GPU отсечении буфер выключен.
+ */
+class WrpOcclusionCuller
+{
+public:
+    static constexpr uint32_t MAX_OCCLUDERS = 64;
+    static constexpr uint32_t MAX_FRAME_OCCLUDER_TRIANGLES = 32768;
+    static constexpr float MIN_OCCLUDER_SIZE = .1f; // радиус / расстояние до камеры
+
+    // Выбор окклюдеров и растеризация, вызывается после обновления кэша преобразований до prepareSceneObjects
+    void rasterizeOccluders(const WrpCamera& camera, WrpScene& sceneObjects, const WrpTransformCache& transforms,
+        RenderStats& stats);
+    // до следующего rasterizeOccluders ничего не отсекается
+    void disable() { active = false; }
+    bool isActive() const { return active; }
+
+    // Снимает видимость с перекрытых объектов (visible выровнен с objects, как результат WrpFrustumCuller::cullObjects)
+    void cullObjects(const std::vector<WrpRenderObject>& objects, const WrpTransformCache& transforms,
+        std::vector<uint8_t>& visible, RenderStats& stats) const;
+    // То же для подобъектов уже прошедшего проверки объекта (у моделей из одного подобъекта проверка не повторяется)
+    void cullSubMeshes(const glm::mat4& modelMatrix, const WrpModel& model,
+        std::vector<uint8_t>& visible, RenderStats& stats) const;
+
+    const WrpOcclusionBuffer& getBuffer() const { return buffer; }
+
+private:
+    struct Occluder
+    {
+        float size;
+        const glm::mat4* modelMatrix;
+        const WrpModel* model;
+    };
+
+    WrpOcclusionBuffer buffer{};
+    bool active = false;
+    std::vector<Occluder> occluders; // кандидаты текущего кадра, переиспользуются между кадрами
+};
@@ -3,6 +3,7 @@
 #include "Model.hpp"
 
 // std
+#include <chrono>
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
@@ -77,10 +78,6 @@ void WrpPipeline::createGraphicsPipeline(
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
-    // Информация для мультисэмплинга
-    // todo: не логично, конечно, изменять здесь конфиг, который назван дефолтным. можно обдумать этот момент - как вносить правки в параметры пайплайна
-    configInfo.multisampleInfo.rasterizationSamples = wrpDevice.getMaxUsableMSAASampleCount();
-
     // Информация для самого Графического Пайплайна
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -109,14 +106,24 @@ void WrpPipeline::createGraphicsPipeline(
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.flags = 0; // два поля выше исп., если задать флаг VK_PIPELINE_CREATE_DERIVATIVE_BIT
 
+    // Кэш пайплайнов общий для всех систем рендера, принадлежит устройству и сохраняется на диск между запусками
+    auto creationStart = std::chrono::high_resolution_clock::now();
     if (vkCreateGraphicsPipelines(wrpDevice.device(),
-        VK_NULL_HANDLE,
+        wrpDevice.getPipelineCache(),
         1, &pipelineInfo,
         nullptr,
         &graphicsPipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
+    auto creationTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - creationStart).count();
+
+    PipelineCacheStats& cacheStats = wrpDevice.getPipelineCacheStats();
+    cacheStats.pipelinesCreated++;
+    cacheStats.creationTimeMicroseconds += creationTime;
+    std::cout << "Graphics Pipeline created in " << creationTime / 1000.0 << " ms ("
+        << (cacheStats.warmStart ? "warm" : "cold") << " pipeline cache)" << std::endl;
 
     // Шейдерные модули можно освободить сразу после создания пайплайна, т.к. шейдеры уже скомпилированы
     delete vertShaderModule;
@@ -167,9 +174,10 @@ void WrpPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 
     // Информация для этапа мультисемплирования (множественная выборка цвета для фрагментов, чтобы устранить зубчатость краёв)
     configInfo.multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    configInfo.multisampleInfo.sampleShadingEnable = VK_TRUE;
-    //configInfo.multisampleInfo.rasterizationSamples; этот параметр дописывается при создании пайплайна (из статик контекста не могу достать девайс)
-    configInfo.multisampleInfo.minSampleShading = .2f;            // min fraction for sample shading; closer to one is smoother
+    // число выборок и sample shading задаёт вариант пайплайна (PipelineVariantDesc) под MSAA своего прохода рендера
+    configInfo.multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    configInfo.multisampleInfo.sampleShadingEnable = VK_FALSE;
+    configInfo.multisampleInfo.minSampleShading = 0.f;            // min fraction for sample shading; closer to one is smoother
     configInfo.multisampleInfo.pSampleMask = nullptr;             // Optional
     configInfo.multisampleInfo.alphaToCoverageEnable = VK_FALSE;  // Optional
     configInfo.multisampleInfo.alphaToOneEnable = VK_FALSE;       // Optional
@@ -4,6 +4,9 @@
 #include "ShaderModule.hpp"
 
 // std
+#include <chrono>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -25,6 +28,8 @@ struct PipelineConfigInfo
     VkPipelineRasterizationStateCreateInfo rasterizationInfo;  // информация об этапе растеризации
     VkPipelineMultisampleStateCreateInfo multisampleInfo;	   // информация о этапе мультисемплирования
     VkPipelineColorBlendAttachmentState colorBlendAttachment;
+    // состояния смешивания для подпрохода с несколькими вложениями цвета (G-buffer), иначе используется colorBlendAttachment
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments{};
     VkPipelineColorBlendStateCreateInfo colorBlendInfo;
     VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
     std::vector<VkDynamicState> dynamicStateEnables;
@@ -68,3 +73,72 @@ private:
     WrpDevice& wrpDevice;				// девайс
     VkPipeline graphicsPipeline;		// Vulkan Graphics Pipeline (это указатель, сам тип определён через typedef)
 };
+
+// Пайплайн, который собирается задачей в WrpJobSystem. Обращение к get() блокирует поток
+// только если сборка ещё не завершилась, поэтому ожидаются лишь реально используемые пайплайны.
+class AsyncPipeline
+{
+public:
+    AsyncPipeline() = default;
+    explicit AsyncPipeline(std::future<std::unique_ptr<WrpPipeline>>&& future) : future{std::move(future)} {}
+    ~AsyncPipeline() { wait(); }
+
+    AsyncPipeline(AsyncPipeline&&) = default;
+    AsyncPipeline& operator=(AsyncPipeline&& other)
+    {
+        wait(); // текущая задача может ещё использовать ресурсы, которые освободит владелец
+        future = std::move(other.future);
+        rebuiltFuture = std::move(other.rebuiltFuture);
+        pipeline = std::move(other.pipeline);
+        return *this;
+    }
+
+    WrpPipeline* get()
+    {
+        if (future.valid())
+            pipeline = future.get(); // исключение из рабочего потока пробрасывается сюда
+        return pipeline.get();
+    }
+
+    bool isReady() const
+    {
+        return !future.valid() || future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void wait()
+    {
+        if (future.valid())
+            future.wait();
+        if (rebuiltFuture.valid())
+            rebuiltFuture.wait();
+    }
+
+    // Фоновая пересборка (hot-reload). Текущий пайплайн продолжает использоваться, пока новый не будет готов.
+    void rebuild(std::future<std::unique_ptr<WrpPipeline>>&& newFuture)
+    {
+        if (rebuiltFuture.valid())
+            rebuiltFuture.wait();
+        rebuiltFuture = std::move(newFuture);
+    }
+
+    // Подменяет пайплайн пересобранным, если тот готов. Возвращает старый пайплайн, который нужно удалить
+    // только после завершения кадров в полёте. Если пересборка не удалась (nullptr), остаётся прежний пайплайн.
+    std::unique_ptr<WrpPipeline> swapIfRebuilt()
+    {
+        if (!rebuiltFuture.valid() || rebuiltFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return nullptr;
+
+        std::unique_ptr<WrpPipeline> rebuilt = rebuiltFuture.get();
+        if (!rebuilt)
+            return nullptr;
+
+        get();
+        std::swap(pipeline, rebuilt);
+        return rebuilt;
+    }
+
+private:
+    std::future<std::unique_ptr<WrpPipeline>> future;
+    std::future<std::unique_ptr<WrpPipeline>> rebuiltFuture;
+    std::unique_ptr<WrpPipeline> pipeline;
+};
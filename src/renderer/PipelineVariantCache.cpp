@@ -0,0 +1,178 @@
+#include "PipelineVariantCache.hpp"
+#include "Hash.hpp"
+#include "JobSystem.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+uint64_t PipelineVariantDesc::hash() const
+{
+    WrpHasher hasher;
+    hasher.add(vertShader).add(fragShader);
+    for (const auto& [name, value] : vertDefines) hasher.add(name).add(value);
+    hasher.add(static_cast<uint64_t>(vertDefines.size()));
+    for (const auto& [name, value] : fragDefines) hasher.add(name).add(value);
+    hasher.add(static_cast<uint64_t>(fragDefines.size()));
+
+    hasher.add(polygonMode).add(cullMode).add(alphaBlending).add(depthTestEnable).add(depthWriteEnable).add(vertexInput);
+    hasher.add(samples).add(minSampleShading).add(colorAttachmentCount);
+    hasher.add(renderPass).add(pipelineLayout).add(subpass);
+    return hasher.value();
+}
+
+void PipelineVariantDesc::fillConfigInfo(PipelineConfigInfo& configInfo) const
+{
+    WrpPipeline::defaultPipelineConfigInfo(configInfo);
+    if (alphaBlending)
+    {
+        WrpPipeline::enableAlphaBlending(configInfo);
+    }
+    if (!vertexInput)
+    {
+        configInfo.bindingDescriptions.clear();
+        configInfo.attributeDescriptions.clear();
+    }
+    if (colorAttachmentCount > 1)
+    {
+        VkPipelineColorBlendAttachmentState attachment = configInfo.colorBlendAttachment;
+        attachment.blendEnable = VK_FALSE;
+        configInfo.colorBlendAttachments.assign(colorAttachmentCount, attachment);
+        configInfo.colorBlendInfo.attachmentCount = colorAttachmentCount;
+        configInfo.colorBlendInfo.pAttachments = configInfo.colorBlendAttachments.data();
+    }
+    configInfo.multisampleInfo.rasterizationSamples = samples;
+    // sample shading имеет смысл только при нескольких выборках
+    if (samples != VK_SAMPLE_COUNT_1_BIT && minSampleShading > 0.f)
+    {
+        configInfo.multisampleInfo.sampleShadingEnable = VK_TRUE;
+        configInfo.multisampleInfo.minSampleShading = minSampleShading;
+    }
+    configInfo.rasterizationInfo.polygonMode = polygonMode;
+    configInfo.rasterizationInfo.cullMode = cullMode;
+    configInfo.depthStencilInfo.depthTestEnable = depthTestEnable ? VK_TRUE : VK_FALSE;
+    configInfo.depthStencilInfo.depthWriteEnable = depthWriteEnable ? VK_TRUE : VK_FALSE;
+    configInfo.renderPass = renderPass;
+    configInfo.pipelineLayout = pipelineLayout;
+    configInfo.subpass = subpass;
+}
+
+WrpPipelineVariantCache::WrpPipelineVariantCache(WrpDevice& device, WrpRenderer& renderer, std::string name)
+    : wrpDevice{device}, wrpRenderer{renderer}, name{std::move(name)},
+    swapChainGeneration{renderer.getSwapChainGeneration()}
+{
+}
+
+WrpPipelineVariantCache::~WrpPipelineVariantCache()
+{
+    wait();
+}
+
+std::unique_ptr<WrpPipeline> WrpPipelineVariantCache::createPipeline(const PipelineVariantDesc& desc) const
+{
+    assert(desc.pipelineLayout != VK_NULL_HANDLE && "Cannot create pipeline variant without pipeline layout");
+
+    PipelineConfigInfo pipelineConfig{};
+    desc.fillConfigInfo(pipelineConfig);
+
+    ShaderModule* vertShaderModule = new ShaderModule(wrpDevice, desc.vertShader, desc.vertDefines);
+    ShaderModule* fragShaderModule = new ShaderModule(wrpDevice, desc.fragShader, desc.fragDefines);
+    return std::make_unique<WrpPipeline>(
+        wrpDevice, desc.vertShader, desc.fragShader, pipelineConfig, vertShaderModule, fragShaderModule);
+}
+
+void WrpPipelineVariantCache::evictSwapChainVariants()
+{
+    if (swapChainGeneration == wrpRenderer.getSwapChainGeneration())
+        return;
+    swapChainGeneration = wrpRenderer.getSwapChainGeneration();
+
+    for (auto it = variants.begin(); it != variants.end();)
+    {
+        if (it->second.swapChainPass)
+        {
+            wrpRenderer.retireResource(std::make_shared<AsyncPipeline>(std::move(it->second.pipeline)));
+            it = variants.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+WrpPipelineVariantCache::Variant& WrpPipelineVariantCache::findOrCreate(const PipelineVariantDesc& desc)
+{
+    evictSwapChainVariants();
+
+    const uint64_t key = desc.hash();
+    auto it = variants.find(key);
+    if (it != variants.end())
+    {
+        // другой вариант с тем же хэшем отрисовал бы не тем пайплайном, поэтому проверка есть и в release сборке
+        if (!(it->second.desc == desc))
+        {
+            throw std::runtime_error("Pipeline variant hash collision in " + name + ": " + desc.fragShader);
+        }
+        return it->second;
+    }
+
+    Variant& variant = variants[key];
+    variant.desc = desc;
+    variant.swapChainPass = desc.renderPass == wrpRenderer.getSwapChainRenderPass();
+    variant.pipeline = AsyncPipeline{WrpJobSystem::instance().submit(
+        [this, desc]() { return createPipeline(desc); })};
+    return variant;
+}
+
+WrpPipeline* WrpPipelineVariantCache::get(const PipelineVariantDesc& desc)
+{
+    return findOrCreate(desc).pipeline.get();
+}
+
+void WrpPipelineVariantCache::prefetch(const PipelineVariantDesc& desc)
+{
+    findOrCreate(desc);
+}
+
+void WrpPipelineVariantCache::reloadShaders(
+    WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    for (auto& [key, variant] : variants)
+    {
+        const PipelineVariantDesc& desc = variant.desc;
+        if (changedShaders.count(desc.vertShader) == 0 && changedShaders.count(desc.fragShader) == 0)
+            continue;
+
+        variant.pipeline.rebuild(shaderWatcher.rebuildPipelineAsync(name + ": " + desc.fragShader,
+            [this, desc]() { return createPipeline(desc); }));
+    }
+}
+
+// Старые пайплайны могут использоваться кадрами в полёте, поэтому удаляются отложенно
+void WrpPipelineVariantCache::swapReloadedPipelines()
+{
+    evictSwapChainVariants();
+    for (auto& [key, variant] : variants)
+    {
+        if (std::unique_ptr<WrpPipeline> oldPipeline = variant.pipeline.swapIfRebuilt())
+            wrpRenderer.retireResource(std::move(oldPipeline));
+    }
+}
+
+void WrpPipelineVariantCache::clear()
+{
+    for (auto& [key, variant] : variants)
+    {
+        wrpRenderer.retireResource(std::make_shared<AsyncPipeline>(std::move(variant.pipeline)));
+    }
+    variants.clear();
+}
+
+void WrpPipelineVariantCache::wait()
+{
+    for (auto& [key, variant] : variants)
+    {
+        variant.pipeline.wait();
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Pipeline.hpp"
+#include "Renderer.hpp"
+#include "ShaderWatcher.hpp"
+#include "SpirvCache.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Состояние пайплайна, от которого зависит его вариант. Всё остальное берётся из WrpPipeline::defaultPipelineConfigInfo.
+struct PipelineVariantDesc
+{
+    std::string vertShader;
+    std::string fragShader;
+    ShaderDefines vertDefines{};
+    ShaderDefines fragDefines{};
+
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    bool alphaBlending = false;
+    bool depthTestEnable = true;
+    bool depthWriteEnable = true;
+    bool vertexInput = true; // false - вершины генерируются в шейдере (например, билборды PointLightSystem)
+    // MSAA подпрохода (должно совпадать с его вложениями) и доля выборок с отдельным вызовом фрагментного шейдера,
+    // 0 - sample shading выключен. Для прохода swapchain'а берутся из WrpRenderer.
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    float minSampleShading = 0.f;
+    uint32_t colorAttachmentCount = 1; // вложения цвета подпрохода, смешивание у нескольких вложений выключено
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    uint64_t hash() const;
+    void fillConfigInfo(PipelineConfigInfo& configInfo) const;
+
+    bool operator==(const PipelineVariantDesc&) const = default;
+};
+
+/*
+ * Кэш вариантов пайплайнов одной системы рендера, ключ - хэш PipelineVariantDesc.
+ * Вариант собирается в WrpJobSystem при первом обращении и дальше хранится до конца работы системы,
+ * поэтому переключение режима полигонов или модели отражения после первого использования ничего не стоит.
+ * Здесь же обрабатывается hot-reload: варианты с изменёнными шейдерами пересобираются в фоне и подменяются на границе кадра.
+ * Варианты для прохода swapchain'а удаляются после пересоздания цепи обмена (смена размера окна, MSAA): их проход
+ * рендера уничтожен, а его дескриптор может достаться новому проходу.
+ */
+class WrpPipelineVariantCache
+{
+public:
+    WrpPipelineVariantCache(WrpDevice& device, WrpRenderer& renderer, std::string name);
+    ~WrpPipelineVariantCache();
+
+    WrpPipelineVariantCache(const WrpPipelineVariantCache&) = delete;
+    WrpPipelineVariantCache& operator=(const WrpPipelineVariantCache&) = delete;
+
+    // Вариант для отрисовки; при первом обращении поток ждёт только его сборки
+    WrpPipeline* get(const PipelineVariantDesc& desc);
+    // Ставит сборку варианта в очередь заранее, не дожидаясь её
+    void prefetch(const PipelineVariantDesc& desc);
+
+    // Фоновая пересборка вариантов, использующих изменённые шейдеры
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
+    // Подмена пересобранных вариантов, вызывается на границе кадра
+    void swapReloadedPipelines();
+
+    // Все варианты удаляются отложенно (например, перед пересозданием pipeline layout, на который они ссылаются)
+    void clear();
+    // Ожидание всех фоновых сборок, т.к. они используют pipeline layout владельца кэша
+    void wait();
+
+    size_t size() const { return variants.size(); }
+
+private:
+    struct Variant
+    {
+        PipelineVariantDesc desc;
+        AsyncPipeline pipeline;
+        bool swapChainPass = false; // собран для прохода swapchain'а поколения swapChainGeneration
+    };
+
+    Variant& findOrCreate(const PipelineVariantDesc& desc);
+    // Отложенное удаление вариантов прохода swapchain'а, если цепь обмена пересоздана
+    void evictSwapChainVariants();
+    std::unique_ptr<WrpPipeline> createPipeline(const PipelineVariantDesc& desc) const;
+
+    WrpDevice& wrpDevice;
+    WrpRenderer& wrpRenderer;
+    std::string name; // имя владельца для сообщений об ошибках hot-reload
+
+    std::unordered_map<uint64_t, Variant> variants;
+    uint64_t swapChainGeneration;
+};
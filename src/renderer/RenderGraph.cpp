@@ -0,0 +1,477 @@
+#include "RenderGraph.hpp"
+
+// std
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    VkImageUsageFlags imageUsageFlags(WrpRenderGraph::Usage usage)
+    {
+        switch (usage)
+        {
+        case WrpRenderGraph::Usage::ColorAttachment: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        case WrpRenderGraph::Usage::DepthAttachment: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        case WrpRenderGraph::Usage::SampledFragment:
+        case WrpRenderGraph::Usage::DepthSampledFragment:
+        case WrpRenderGraph::Usage::SampledCompute: return VK_IMAGE_USAGE_SAMPLED_BIT;
+        case WrpRenderGraph::Usage::StorageCompute: return VK_IMAGE_USAGE_STORAGE_BIT;
+        }
+        return 0;
+    }
+
+    bool isDepthUsage(WrpRenderGraph::Usage usage)
+    {
+        return usage == WrpRenderGraph::Usage::DepthAttachment || usage == WrpRenderGraph::Usage::DepthSampledFragment;
+    }
+}
+
+WrpRenderGraph::PassBuilder& WrpRenderGraph::PassBuilder::read(ResourceId image, Usage usage)
+{
+    graph.passes[pass].uses.push_back({image, usage, false});
+    return *this;
+}
+
+WrpRenderGraph::PassBuilder& WrpRenderGraph::PassBuilder::write(ResourceId image, Usage usage)
+{
+    graph.passes[pass].uses.push_back({image, usage, true});
+    return *this;
+}
+
+WrpRenderGraph::PassBuilder& WrpRenderGraph::PassBuilder::setSideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+    return *this;
+}
+
+WrpRenderGraph::WrpRenderGraph(WrpDevice& device, uint32_t framesCount)
+    : wrpDevice{device}, gpuTimer{device, framesCount}, timedPasses(framesCount)
+{
+}
+
+WrpRenderGraph::~WrpRenderGraph()
+{
+    destroyImages(); // приложение дожидается vkDeviceWaitIdle перед уничтожением графа
+}
+
+void WrpRenderGraph::beginFrame(int frameIndex)
+{
+    this->frameIndex = frameIndex;
+    passes.clear();
+    images.clear();
+
+    stats.passTimings.clear();
+    if (gpuTimer.collectResults(frameIndex) >= 0.f)
+    {
+        const std::vector<float>& intervalsMs = gpuTimer.getIntervalsMs();
+        const std::vector<std::string>& names = timedPasses[frameIndex];
+        for (size_t i = 0; i < intervalsMs.size() && i < names.size(); i++)
+            stats.passTimings.push_back({names[i], intervalsMs[i]});
+    }
+}
+
+WrpRenderGraph::ResourceId WrpRenderGraph::createImage(const std::string& name, const ImageDesc& desc)
+{
+    images.push_back({name, desc});
+    return static_cast<ResourceId>(images.size() - 1);
+}
+
+WrpRenderGraph::PassBuilder WrpRenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer)> execute)
+{
+    passes.push_back({name, std::move(execute)});
+    return PassBuilder{*this, static_cast<uint32_t>(passes.size() - 1)};
+}
+
+void WrpRenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    cullPasses();
+    allocateImages(collectImages());
+    planBarriers();
+
+    std::vector<std::string>& names = timedPasses[frameIndex];
+    names.clear();
+    std::vector<Pass*> alivePasses;
+    for (auto& pass : passes)
+    {
+        if (pass.alive)
+            alivePasses.push_back(&pass);
+    }
+    if (!alivePasses.empty())
+        gpuTimer.begin(commandBuffer, frameIndex);
+
+    for (size_t i = 0; i < alivePasses.size(); i++)
+    {
+        Pass& pass = *alivePasses[i];
+        if (!pass.barriers.empty())
+        {
+            vkCmdPipelineBarrier(commandBuffer,
+                pass.srcStages != 0 ? pass.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pass.dstStages,
+                0,
+                0, nullptr,
+                0, nullptr,
+                static_cast<uint32_t>(pass.barriers.size()), pass.barriers.data());
+        }
+        pass.execute(commandBuffer);
+
+        names.push_back(pass.name);
+        if (i + 1 < alivePasses.size())
+            gpuTimer.mark(commandBuffer, frameIndex);
+        else
+            gpuTimer.end(commandBuffer, frameIndex);
+    }
+}
+
+VkImage WrpRenderGraph::getImage(ResourceId image) const
+{
+    if (images[image].physical == NONE)
+    {
+        throw std::runtime_error("Render graph image '" + images[image].name + "' is not used by any live pass!");
+    }
+    return physicalImages[images[image].physical].image;
+}
+
+VkImageView WrpRenderGraph::getImageView(ResourceId image) const
+{
+    if (images[image].physical == NONE)
+    {
+        throw std::runtime_error("Render graph image '" + images[image].name + "' is not used by any live pass!");
+    }
+    return physicalImages[images[image].physical].view;
+}
+
+WrpRenderGraph::ImageAccess WrpRenderGraph::usageAccess(Usage usage)
+{
+    switch (usage)
+    {
+    case Usage::ColorAttachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+    case Usage::DepthAttachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case Usage::SampledFragment:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+    case Usage::DepthSampledFragment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+    case Usage::SampledCompute:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+    case Usage::StorageCompute:
+        return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    }
+    throw std::invalid_argument("Unknown render graph image usage!");
+}
+
+WrpRenderGraph::ImageAccess WrpRenderGraph::layoutAccess(VkImageLayout layout)
+{
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+    case VK_IMAGE_LAYOUT_PREINITIALIZED:
+        return {layout, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0};
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        return {layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        return {layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        return {layout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT};
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        return usageAccess(Usage::ColorAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        return usageAccess(Usage::DepthAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+        return {layout, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT};
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        return {layout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+    default:
+        // GENERAL и схемы расширений: самая широкая синхронизация
+        return {layout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT};
+    }
+}
+
+void WrpRenderGraph::cullPasses()
+{
+    // от последнего прохода к первому: проход жив, если его результат внешний или его читает живой проход после него
+    std::vector<bool> read(images.size(), false);
+    for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass)
+    {
+        pass->alive = pass->sideEffect || std::any_of(pass->uses.begin(), pass->uses.end(),
+            [&](const ImageUse& use) { return use.write && read[use.image]; });
+        if (!pass->alive)
+            continue;
+        for (const auto& use : pass->uses)
+        {
+            if (!use.write)
+                read[use.image] = true;
+        }
+    }
+
+    stats.passes = static_cast<uint32_t>(passes.size());
+    stats.passesCulled = static_cast<uint32_t>(
+        std::count_if(passes.begin(), passes.end(), [](const Pass& pass) { return !pass.alive; }));
+}
+
+std::vector<WrpRenderGraph::PhysicalImage> WrpRenderGraph::collectImages()
+{
+    std::vector<PhysicalImage> frameImages(images.size());
+    for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+    {
+        if (!passes[passIndex].alive)
+            continue;
+        for (const auto& use : passes[passIndex].uses)
+        {
+            Image& image = images[use.image];
+            PhysicalImage& frameImage = frameImages[use.image];
+            if (image.firstPass == NONE)
+            {
+                // содержимое не переживает кадр, поэтому первым изображение должно писаться
+                if (!use.write)
+                {
+                    throw std::runtime_error("Render graph image '" + image.name + "' is read by pass '" +
+                        passes[passIndex].name + "' before it is written!");
+                }
+                image.firstPass = passIndex;
+            }
+            image.lastPass = passIndex;
+
+            frameImage.usage |= imageUsageFlags(use.usage);
+            if (isDepthUsage(use.usage))
+                frameImage.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+    }
+
+    std::vector<PhysicalImage> liveImages;
+    for (uint32_t i = 0; i < images.size(); i++)
+    {
+        if (images[i].firstPass == NONE)
+            continue; // не нужно ни одному живому проходу
+        PhysicalImage& frameImage = frameImages[i];
+        frameImage.name = images[i].name;
+        frameImage.desc = images[i].desc;
+        frameImage.firstPass = images[i].firstPass;
+        frameImage.lastPass = images[i].lastPass;
+        if (frameImage.aspect == 0)
+            frameImage.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        // вложения, которые не читаются после своего прохода, могут не получать памяти вне прохода
+        if ((frameImage.usage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) == 0)
+            frameImage.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        images[i].physical = static_cast<uint32_t>(liveImages.size());
+        liveImages.push_back(std::move(frameImage));
+    }
+    return liveImages;
+}
+
+void WrpRenderGraph::allocateImages(std::vector<PhysicalImage>&& frameImages)
+{
+    const bool sameImages = frameImages.size() == physicalImages.size() &&
+        std::equal(frameImages.begin(), frameImages.end(), physicalImages.begin(),
+            [](const PhysicalImage& a, const PhysicalImage& b) { return a.sameKey(b); });
+    if (sameImages)
+        return;
+
+    // изображения и память могут использоваться кадрами в полёте
+    vkDeviceWaitIdle(wrpDevice.device());
+    destroyImages();
+    physicalImages = std::move(frameImages);
+
+    for (auto& image : physicalImages)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = image.desc.extent.width;
+        imageInfo.extent.height = image.desc.extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = image.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = image.usage;
+        imageInfo.samples = image.desc.samples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateImage(wrpDevice.device(), &imageInfo, nullptr, &image.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create render graph image '" + image.name + "'!");
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(wrpDevice.device(), image.image, &memoryRequirements);
+        image.size = memoryRequirements.size;
+        image.memoryTypeIndex = wrpDevice.findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    // Наложение: от больших изображений к меньшим, каждое - в первый блок того же типа памяти, ни одно изображение
+    // которого не живёт одновременно с ним. Все изображения блока привязаны к его началу, размер блока - наибольший
+    std::vector<uint32_t> order(physicalImages.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+        [this](uint32_t a, uint32_t b) { return physicalImages[a].size > physicalImages[b].size; });
+    auto overlaps = [](const PhysicalImage& a, const PhysicalImage& b) {
+        return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+    };
+    for (uint32_t index : order)
+    {
+        PhysicalImage& image = physicalImages[index];
+        for (uint32_t block = 0; block < memoryBlocks.size() && image.block == NONE; block++)
+        {
+            if (memoryBlocks[block].memoryTypeIndex != image.memoryTypeIndex)
+                continue;
+            const bool free = std::none_of(physicalImages.begin(), physicalImages.end(), [&](const PhysicalImage& other) {
+                return other.block == block && overlaps(image, other);
+            });
+            if (free)
+                image.block = block;
+        }
+        if (image.block == NONE)
+        {
+            image.block = static_cast<uint32_t>(memoryBlocks.size());
+            memoryBlocks.push_back({});
+            memoryBlocks.back().memoryTypeIndex = image.memoryTypeIndex;
+        }
+        memoryBlocks[image.block].size = std::max(memoryBlocks[image.block].size, image.size);
+    }
+
+    stats.images = static_cast<uint32_t>(physicalImages.size());
+    stats.imageBytes = 0;
+    stats.allocatedBytes = 0;
+    for (auto& block : memoryBlocks)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = block.memoryTypeIndex;
+        if (vkAllocateMemory(wrpDevice.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate render graph memory!");
+        }
+        stats.allocatedBytes += block.size;
+    }
+
+    for (auto& image : physicalImages)
+    {
+        if (vkBindImageMemory(wrpDevice.device(), image.image, memoryBlocks[image.block].memory, 0) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to bind render graph image memory!");
+        }
+        stats.imageBytes += image.size;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = image.desc.format;
+        viewInfo.subresourceRange.aspectMask = image.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(wrpDevice.device(), &viewInfo, nullptr, &image.view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create render graph image view '" + image.name + "'!");
+        }
+    }
+    generation++;
+}
+
+void WrpRenderGraph::destroyImages()
+{
+    for (auto& image : physicalImages)
+    {
+        vkDestroyImageView(wrpDevice.device(), image.view, nullptr);
+        vkDestroyImage(wrpDevice.device(), image.image, nullptr);
+    }
+    for (auto& block : memoryBlocks)
+        vkFreeMemory(wrpDevice.device(), block.memory, nullptr);
+    physicalImages.clear();
+    memoryBlocks.clear();
+}
+
+void WrpRenderGraph::planBarriers()
+{
+    // содержимое прошлого кадра не нужно, но порядок с его обращениями к памяти хранится в блоках
+    for (auto& image : physicalImages)
+        image.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    stats.barriers = 0;
+    for (auto& pass : passes)
+    {
+        pass.barriers.clear();
+        pass.srcStages = 0;
+        pass.dstStages = 0;
+        if (!pass.alive)
+            continue;
+
+        for (const auto& use : pass.uses)
+        {
+            PhysicalImage& image = physicalImages[images[use.image].physical];
+            MemoryBlock& block = memoryBlocks[image.block];
+            ImageAccess access = usageAccess(use.usage);
+            if (!use.write)
+                access.access &= ~WRITE_ACCESS;
+
+            // Запись и смена схемы ждут всех прошлых обращений к памяти (в том числе другого изображения,
+            // наложенного на неё), чтение в той же схеме - только записи, ещё не видимой его стадиям
+            const bool layoutChange = image.layout != access.layout;
+            VkPipelineStageFlags waitStages = 0;
+            VkAccessFlags waitAccess = 0;
+            bool barrier = false;
+            if (use.write || layoutChange)
+            {
+                waitStages = block.writeStages | block.readStages;
+                waitAccess = block.writeAccess;
+                barrier = layoutChange || waitStages != 0;
+            }
+            else if (block.writeStages != 0 && (access.stages & ~block.visibleStages) != 0)
+            {
+                waitStages = block.writeStages;
+                waitAccess = block.writeAccess;
+                barrier = true;
+            }
+
+            if (barrier)
+            {
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = waitAccess;
+                imageBarrier.dstAccessMask = access.access;
+                imageBarrier.oldLayout = image.layout;
+                imageBarrier.newLayout = access.layout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = image.image;
+                imageBarrier.subresourceRange = {image.aspect, 0, 1, 0, 1};
+                pass.barriers.push_back(imageBarrier);
+                pass.srcStages |= waitStages;
+                pass.dstStages |= access.stages;
+                stats.barriers++;
+            }
+
+            image.layout = access.layout;
+            if (use.write)
+            {
+                block.writeStages = access.stages;
+                block.writeAccess = access.access & WRITE_ACCESS;
+                block.readStages = 0;
+                block.visibleStages = 0;
+            }
+            else
+            {
+                // следующие чтения других стадий должны ждать и сам переход схемы
+                if (layoutChange)
+                {
+                    block.writeStages |= access.stages;
+                    block.visibleStages = 0;
+                }
+                block.readStages |= access.stages;
+                block.visibleStages |= access.stages;
+            }
+        }
+    }
+}
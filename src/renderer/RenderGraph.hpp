@@ -0,0 +1,217 @@
+#pragma once
+
+#include "Device.hpp"
+#include "GpuTimer.hpp"
+
+// std
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+/*
+ * Граф кадра: проходы объявляют, какие изображения и как они читают и пишут, а граф по этим объявлениям
+ *  - отсекает проходы, результаты которых никто не читает (кроме проходов с внешним результатом, setSideEffect);
+ *  - ставит перед проходами барьеры: переход схемы и ожидание только там, где есть зависимость (чтение после
+ *    записи, запись после чтения или записи, смена схемы), повторное чтение в той же схеме барьера не требует;
+ *  - создаёт временные изображения кадра и накладывает в памяти те, времена жизни которых (от первого
+ *    до последнего использующего прохода) не пересекаются.
+ * Граф описывается заново каждый кадр (beginFrame, createImage, addPass, execute), а изображения и память
+ * пересоздаются только при изменении набора изображений или их времён жизни (с ожиданием устройства), поэтому
+ * обычный кадр ничего не выделяет. Содержимое временных изображений не переживает кадр. Изображения одни на все
+ * кадры в полёте: первое использование памяти в кадре ждёт её последнего использования в прошлом кадре.
+ *
+ * Проходы рендера, вложения которых выдаёт граф, создаются с исходной и итоговой схемами вложений, равными схемам
+ * их использования (ColorAttachment, DepthAttachment): переходы делает граф, а не проход.
+ * Буферы граф не отслеживает, их барьеры (например, у GPU отсечения) остаются у владельцев.
+ */
+class WrpRenderGraph
+{
+public:
+    using ResourceId = uint32_t;
+
+    // Использование изображения проходом, по нему выводятся схема, стадии и доступ барьера.
+    // Запись считается полной перезаписью: проход, дописывающий изображение (VK_ATTACHMENT_LOAD_OP_LOAD),
+    // объявляет и его чтение
+    enum class Usage
+    {
+        ColorAttachment,
+        DepthAttachment,
+        SampledFragment,      // выборка во фрагментном шейдере
+        DepthSampledFragment, // выборка глубины во фрагментном шейдере
+        SampledCompute,
+        StorageCompute,
+    };
+
+    struct ImageDesc
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        bool operator==(const ImageDesc& other) const
+        {
+            return format == other.format && extent.width == other.extent.width &&
+                extent.height == other.extent.height && samples == other.samples;
+        }
+    };
+
+    // Схема изображения и стадии/доступ, которыми оно в ней используется
+    struct ImageAccess
+    {
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+    };
+
+    struct PassTiming
+    {
+        std::string name;
+        float gpuMs;
+    };
+
+    struct Stats
+    {
+        uint32_t passes = 0;             // объявлены в кадре
+        uint32_t passesCulled = 0;
+        uint32_t barriers = 0;           // барьеры изображений за кадр
+        uint32_t images = 0;             // временные изображения живых проходов
+        VkDeviceSize imageBytes = 0;     // их память без наложения
+        VkDeviceSize allocatedBytes = 0; // выделенная память с наложением
+        std::vector<PassTiming> passTimings; // время проходов на GPU, измеренное кадрами в полёте раньше
+    };
+
+    class PassBuilder
+    {
+    public:
+        PassBuilder& read(ResourceId image, Usage usage);
+        PassBuilder& write(ResourceId image, Usage usage);
+        // результат прохода виден вне графа (кадр swapchain'а), такой проход не отсекается
+        PassBuilder& setSideEffect();
+
+    private:
+        friend class WrpRenderGraph;
+        PassBuilder(WrpRenderGraph& graph, uint32_t pass) : graph{graph}, pass{pass} {}
+
+        WrpRenderGraph& graph;
+        uint32_t pass;
+    };
+
+    WrpRenderGraph(WrpDevice& device, uint32_t framesCount);
+    ~WrpRenderGraph();
+
+    WrpRenderGraph(const WrpRenderGraph&) = delete;
+    WrpRenderGraph& operator=(const WrpRenderGraph&) = delete;
+
+    // Начало описания кадра. Fence слота кадра уже пройден: читаются времена проходов его прошлого использования
+    void beginFrame(int frameIndex);
+    ResourceId createImage(const std::string& name, const ImageDesc& desc);
+    // execute записывает проход в первичный буфер кадра; вызывается из WrpRenderGraph::execute вне прохода рендера.
+    // Проходы выполняются в порядке добавления
+    PassBuilder addPass(const std::string& name, std::function<void(VkCommandBuffer)> execute);
+    // Отсечение проходов, выделение изображений и барьеры, затем запись живых проходов
+    void execute(VkCommandBuffer commandBuffer);
+
+    // Изображения живых проходов, доступны в их execute
+    VkImage getImage(ResourceId image) const;
+    VkImageView getImageView(ResourceId image) const;
+    // Растёт при каждом пересоздании изображений (устройство к этому моменту простаивает): по нему владельцы
+    // framebuffer'ов и наборов дескрипторов понимают, что их пора пересоздать
+    uint64_t getGeneration() const { return generation; }
+    const Stats& getStats() const { return stats; }
+
+    static ImageAccess usageAccess(Usage usage);
+    // Стадии и доступ, обычные для схемы изображения, - для переходов вне графа (WrpTexture::transitionImageLayout)
+    static ImageAccess layoutAccess(VkImageLayout layout);
+
+private:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct ImageUse
+    {
+        ResourceId image;
+        Usage usage;
+        bool write;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::function<void(VkCommandBuffer)> execute;
+        std::vector<ImageUse> uses;
+        bool sideEffect = false;
+        bool alive = false;
+
+        std::vector<VkImageMemoryBarrier> barriers;
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+    };
+
+    // Изображение, объявленное в кадре
+    struct Image
+    {
+        std::string name;
+        ImageDesc desc;
+        uint32_t firstPass = NONE; // живые проходы, использующие изображение
+        uint32_t lastPass = NONE;
+        uint32_t physical = NONE;  // индекс в physicalImages
+    };
+
+    // Созданное изображение, по ключу сопоставляется изображениям следующих кадров
+    struct PhysicalImage
+    {
+        std::string name;
+        ImageDesc desc;
+        VkImageUsageFlags usage = 0;
+        uint32_t firstPass = NONE;
+        uint32_t lastPass = NONE;
+
+        VkImageAspectFlags aspect = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        uint32_t block = NONE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED; // по ходу планирования кадра
+
+        bool sameKey(const PhysicalImage& other) const
+        {
+            return name == other.name && desc == other.desc && usage == other.usage &&
+                firstPass == other.firstPass && lastPass == other.lastPass;
+        }
+    };
+
+    // Память, общая для изображений с непересекающимися временами жизни, и последние обращения к ней
+    struct MemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+
+        VkPipelineStageFlags writeStages = 0;   // последняя запись (в том числе переход схемы)
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;    // чтения после неё
+        VkPipelineStageFlags visibleStages = 0; // стадии, которым запись уже видна
+    };
+
+    void cullPasses();
+    // Времена жизни и флаги использования изображений живых проходов
+    std::vector<PhysicalImage> collectImages();
+    void allocateImages(std::vector<PhysicalImage>&& frameImages);
+    void destroyImages();
+    void planBarriers();
+
+    WrpDevice& wrpDevice;
+    WrpGpuTimer gpuTimer;
+    int frameIndex = 0;
+
+    std::vector<Pass> passes;
+    std::vector<Image> images;
+
+    std::vector<PhysicalImage> physicalImages;
+    std::vector<MemoryBlock> memoryBlocks;
+    uint64_t generation = 0;
+
+    std::vector<std::vector<std::string>> timedPasses; // по кадрам: имена проходов в порядке меток таймера
+    Stats stats{};
+};
@@ -2,12 +2,20 @@
 #include "Utils.hpp"
 
 // std
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
 #include <array>
 #include <iostream>
 
-WrpRenderer::WrpRenderer(WrpWindow& window, WrpDevice& device) : wrpWindow{ window }, wrpDevice{ device }
+WrpRenderer::WrpRenderer(WrpWindow& window, WrpDevice& device)
+    : WrpRenderer(&window, device, {})
+{
+}
+
+WrpRenderer::WrpRenderer(WrpWindow* window, WrpDevice& device, VkExtent2D headlessExtent)
+    : wrpWindow{ window }, wrpDevice{ device }, headlessExtent{ headlessExtent },
+    msaaSampleCount{ device.getMaxUsableMSAASampleCount() }
 {
     recreateSwapChain();
     createCommandBuffers();
@@ -15,24 +23,41 @@ WrpRenderer::WrpRenderer(WrpWindow& window, WrpDevice& device) : wrpWindow{ wind
 
 WrpRenderer::~WrpRenderer()
 {
+    retiredResources.clear(); // приложение дожидается vkDeviceWaitIdle перед уничтожением рендерера
     freeCommandBuffers();
 }
 
 void WrpRenderer::recreateSwapChain()
 {
+    hasSubmittedImage = false;
+    swapChainGeneration++;
+
+    // Внеэкранная цепь не зависит от поверхности и пересоздаётся только при смене MSAA: старые изображения
+    // освобождаются сразу, поэтому сначала дожидаемся кадров в полёте
+    if (wrpWindow == nullptr)
+    {
+        if (wrpSwapChain != nullptr)
+        {
+            vkDeviceWaitIdle(wrpDevice.device());
+            wrpSwapChain.reset();
+        }
+        wrpSwapChain = std::make_unique<WrpSwapChain>(wrpDevice, headlessExtent, msaaSampleCount);
+        return;
+    }
+
     // glfwWaitEvents() waits for the event which cause resize of window when it has no size.
     // It can be helpful for the window minimizing case.
-    auto extent = wrpWindow.getExtent();
+    auto extent = wrpWindow->getExtent();
     while (extent.width == 0 || extent.height == 0)
     {
-        extent = wrpWindow.getExtent();
+        extent = wrpWindow->getExtent();
         glfwWaitEvents();
     }
 
     if (wrpSwapChain == nullptr) // first time SwapChain creation
     {
         std::cout << "Creating SwapChain for the first time." << std::endl;
-        wrpSwapChain = std::make_unique<WrpSwapChain>(wrpDevice, wrpWindow);
+        wrpSwapChain = std::make_unique<WrpSwapChain>(wrpDevice, *wrpWindow, msaaSampleCount);
     }
     else // SwapCahin recreation
     {
@@ -40,7 +65,7 @@ void WrpRenderer::recreateSwapChain()
         
         // oldSwapChain as shared_ptr used to initialize new wrpSwapCahin
         std::shared_ptr<WrpSwapChain> oldSwapChain = std::move(wrpSwapChain);
-        wrpSwapChain = std::make_unique<WrpSwapChain>(wrpDevice, wrpWindow, oldSwapChain);
+        wrpSwapChain = std::make_unique<WrpSwapChain>(wrpDevice, *wrpWindow, msaaSampleCount, oldSwapChain);
 
         if (!oldSwapChain->compareSwapChainFormats(*wrpSwapChain.get()))
         {
@@ -49,6 +74,20 @@ void WrpRenderer::recreateSwapChain()
     }
 }
 
+bool WrpRenderer::setMultisampling(VkSampleCountFlagBits sampleCount, float newMinSampleShading)
+{
+    assert(!isFrameStarted && "Can't change multisampling while frame is in progress");
+
+    minSampleShading = std::clamp(newMinSampleShading, 0.f, 1.f);
+    sampleCount = std::clamp(sampleCount, VK_SAMPLE_COUNT_1_BIT, wrpDevice.getMaxUsableMSAASampleCount());
+    if (sampleCount == msaaSampleCount)
+        return false;
+
+    msaaSampleCount = sampleCount;
+    recreateSwapChain(); // новая цепь обмена дожидается устройства перед удалением старой
+    return true;
+}
+
 void WrpRenderer::createCommandBuffers()
 {
     // CommandBuffers count are equal to FrameBuffers count
@@ -98,6 +137,9 @@ VkCommandBuffer WrpRenderer::beginFrame()
         throw std::runtime_error("Failed to acquire swap chain image!");
     }
 
+    // acquireNextImage() дождался fence'а кадра, который использовал этот же слот, поэтому можно освобождать ресурсы старых кадров
+    releaseRetiredResources();
+
     // Start frame creating in current command buffer
     isFrameStarted = true;
 
@@ -129,13 +171,15 @@ void WrpRenderer::endFrame()
     // Отправка буфера команд для соответствующего кадра в очередь на выполнение девайсом (с учётом синхронизации работы CPU и GPU).
     // Команды выполняются и SwapChain предоставляет полученное из Color attachment'а изображение дисплею в нужное время (в зависимости от выбранного PRESENT MODE).
     auto result = wrpSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+    hasSubmittedImage = true;
 
     /* Проверка изменения размеров окна, сброс флага, пересоздание цепи обмена.
        Результат SUBOPTIMAL_KHR указывает на случай, когда свойства поверхности изменились, но SwapChain
        по прежнему может продолжать вывод изображения. Здесь мы избавляемся от таких ситуаций тоже. */
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || wrpWindow.wasWindowResized())
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+        (wrpWindow != nullptr && wrpWindow->wasWindowResized()))
     {
-        wrpWindow.resetWindowsResizedFlag();
+        wrpWindow->resetWindowsResizedFlag();
         recreateSwapChain();
     }
     else if (result != VK_SUCCESS)
@@ -144,10 +188,38 @@ void WrpRenderer::endFrame()
     }
 
     isFrameStarted = false;
+    frameCounter++;
     currentFrameIndex = (currentFrameIndex + 1) % wrpSwapChain->getImageCount(); // выбираем следующий кадр
 }
 
-void WrpRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColors)
+void WrpRenderer::retireResource(std::shared_ptr<void> resource)
+{
+    retiredResources.emplace_back(frameCounter, std::move(resource));
+}
+
+void WrpRenderer::readLastFrame(std::vector<uint8_t>& rgba)
+{
+    assert(!isFrameStarted && "Can't read the last frame while frame is in progress");
+    if (!hasSubmittedImage)
+    {
+        throw std::runtime_error("No frame has been rendered to read back!");
+    }
+
+    wrpSwapChain->readImage(currentImageIndex, rgba);
+}
+
+void WrpRenderer::releaseRetiredResources()
+{
+    // Ресурс, убранный во время записи кадра N, мог использоваться кадрами до N включительно.
+    // Кадр N точно завершён, когда начинается кадр N + imageCount (его fence уже дождались в acquireNextImage).
+    const uint64_t framesInFlight = wrpSwapChain->getImageCount();
+    while (!retiredResources.empty() && retiredResources.front().first + framesInFlight <= frameCounter)
+    {
+        retiredResources.pop_front();
+    }
+}
+
+void WrpRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColors, VkSubpassContents contents)
 {
     assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
     assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
@@ -171,23 +243,34 @@ void WrpRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, ImVec4
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // начинаем проход рендера
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents); // начинаем проход рендера
+
+    // в проходе со вторичными буферами первичный может только выполнять их, динамическое состояние задают они сами
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+        setSwapChainViewport(commandBuffer);
+}
 
+void WrpRenderer::setSwapChainViewport(VkCommandBuffer commandBuffer)
+{
     /* Ширина и высота изображения берутся из SwapChain, т.к. они могут отличаться от ширины и высоты из окна WrpWindow.
        Например, такой эффект есть при использовании Retina дисплеев (Apple), у которых высокая плотность пикселей.
        Перезаписываясь каждый кадр, динамические Viewport и Scissor всегда получают корректное значение ширины и высоты окна.*/
+    setViewport(commandBuffer, wrpSwapChain->getSwapChainExtent());
+}
 
+void WrpRenderer::setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
     // Заполняем конфигурацию для наших динамических объектов пайплайна.
     // Viewport (Область просмотра) - определяет свойства перехода от выходных данных пайплайна к итоговому изображению (Frame Buffer)
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(wrpSwapChain->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(wrpSwapChain->getSwapChainExtent().height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     // Scissor (ножницы) - обрезка выводимых пикселей вне заданного Scissor Rectangle
-    VkRect2D scissor{ {0, 0}, wrpSwapChain->getSwapChainExtent() };
+    VkRect2D scissor{ {0, 0}, extent };
 
     // Запись команд
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);  // установка viewport объекта
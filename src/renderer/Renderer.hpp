@@ -9,6 +9,7 @@
 
 // std
 #include <cassert>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -16,15 +17,32 @@ class WrpRenderer
 {
 public:
     WrpRenderer(WrpWindow& window, WrpDevice& device);
+    // window == nullptr - рендер без окна (устройство создано без поверхности) во внеэкранную цепь размером
+    // headlessExtent, кадры которой читаются через readLastFrame
+    WrpRenderer(WrpWindow* window, WrpDevice& device, VkExtent2D headlessExtent);
     ~WrpRenderer();
 
     WrpRenderer(const WrpRenderer&) = delete;
     WrpRenderer& operator=(const WrpRenderer&) = delete;
 
     VkRenderPass getSwapChainRenderPass() const { return wrpSwapChain->getRenderPass(); }
+    // Растёт при каждом пересоздании цепи обмена: проход рендера старой цепи к этому моменту уничтожен
+    uint64_t getSwapChainGeneration() const { return swapChainGeneration; }
     uint32_t getSwapChainImageCount() const { return wrpSwapChain->getImageCount(); }
     float getAspectRatio() const {return wrpSwapChain->extentAspectRatio();}
+    VkExtent2D getSwapChainExtent() const { return wrpSwapChain->getSwapChainExtent(); }
+    VkFormat getSwapChainImageFormat() const { return wrpSwapChain->getSwapChainImageFormat(); }
+    VkFormat getSwapChainDepthFormat() const { return wrpSwapChain->findDepthFormat(); }
     bool isFrameInProgress() const { return isFrameStarted; }
+    bool isHeadless() const { return wrpWindow == nullptr; }
+
+    // MSAA прохода swapchain'а. Смена числа выборок пересоздаёт цепь обмена (ждёт завершения работы устройства):
+    // проход рендера меняется, поэтому системы собирают под него новые варианты пайплайнов, а GUI - свой пайплайн.
+    // Возвращает true, если проход пересоздан. Вызывается вне кадра.
+    bool setMultisampling(VkSampleCountFlagBits sampleCount, float minSampleShading);
+    VkSampleCountFlagBits getMsaaSampleCount() const { return msaaSampleCount; }
+    // доля выборок, для которых фрагментный шейдер вызывается отдельно (0 - sample shading выключен)
+    float getMinSampleShading() const { return minSampleShading; }
 
     VkCommandBuffer getCurrentCommandBuffer() const
     {
@@ -40,20 +58,52 @@ public:
 
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColors);
+    // С VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS все команды прохода записываются во вторичные буферы
+    // (WrpCommandRecorder), а первичный буфер только выполняет их через vkCmdExecuteCommands
+    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, ImVec4 clearColors,
+        VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // Динамические viewport и scissor на весь swapchain. Вторичные буферы не наследуют их от первичного,
+    // поэтому каждый вторичный буфер прохода задаёт их сам.
+    void setSwapChainViewport(VkCommandBuffer commandBuffer);
+    // Динамические viewport и scissor на область extent от левого верхнего угла (кадр сцены во внеэкранной цели)
+    static void setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+    VkFramebuffer getCurrentFramebuffer() const
+    {
+        assert(isFrameStarted && "Cannot get framebuffer when frame not in progress");
+        return wrpSwapChain->getFrameBuffer(currentImageIndex);
+    }
+
+    // Отложенное удаление ресурса (пайплайна и т.п.), который ещё может использоваться кадрами в полёте.
+    // Ресурс освобождается, когда все кадры, записанные до этого момента, гарантированно выполнились.
+    void retireResource(std::shared_ptr<void> resource);
+
+    // Только без окна: дожидается последнего отправленного кадра и копирует его пиксели
+    // (getSwapChainExtent, RGBA8 sRGB, строки сверху вниз). Вызывается вне кадра
+    void readLastFrame(std::vector<uint8_t>& rgba);
 
 private:
     void createCommandBuffers();
+    void releaseRetiredResources();
     void freeCommandBuffers();
     void recreateSwapChain();
 
-    WrpWindow& wrpWindow;
+    WrpWindow* wrpWindow; // nullptr - рендер без окна
     WrpDevice& wrpDevice;
+    VkExtent2D headlessExtent{};
     std::unique_ptr<WrpSwapChain> wrpSwapChain;
     std::vector<VkCommandBuffer> commandBuffers;
 
-    uint32_t currentImageIndex;
+    VkSampleCountFlagBits msaaSampleCount;
+    float minSampleShading = .2f;
+
+    uint32_t currentImageIndex{ 0 };
+    bool hasSubmittedImage{ false };      // в текущей цепи обмена есть отправленный кадр currentImageIndex
     int currentFrameIndex{ 0 };           // [0, Max_Frames_In_Flight]
     bool isFrameStarted{ false };
+
+    uint64_t swapChainGeneration{ 0 };
+    uint64_t frameCounter{ 0 };           // кол-во отправленных на выполнение кадров
+    std::deque<std::pair<uint64_t, std::shared_ptr<void>>> retiredResources; // (номер кадра удаления, ресурс)
 };
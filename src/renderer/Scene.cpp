@@ -0,0 +1,45 @@
+#include "Scene.hpp"
+
+WrpScene::id_t WrpScene::add(SceneObject&& object, std::shared_ptr<WrpModel> model)
+{
+    const id_t id = object.getId();
+    TransformComponent& transform = objects.emplace(id, std::move(object)).first->second.transform;
+    transform.dirtyList = &dirtyObjects;
+    transform.ownerId = id;
+    transform.dirty = true;
+    dirtyObjects.push_back(id);
+    if (model != nullptr)
+        modelComponents.emplace(id, ModelComponent{std::move(model)});
+    return id;
+}
+
+WrpScene::id_t WrpScene::addPointLight(float intensity, float radius, glm::vec3 color)
+{
+    SceneObject object = SceneObject::createSceneObject("PointLight");
+    object.color = color;
+    object.transform.scale.x = radius;
+    const id_t id = add(std::move(object));
+    pointLightComponents.emplace(id, PointLightComponent{intensity});
+    return id;
+}
+
+void WrpScene::erase(id_t id)
+{
+    // слот кэша преобразований освобождается при следующем WrpTransformCache::update
+    auto it = objects.find(id);
+    if (it != objects.end() && it->second.transform.cacheSlot != TransformComponent::NO_CACHE_SLOT)
+        releasedSlots.push_back(it->second.transform.cacheSlot);
+    objects.erase(id);
+    modelComponents.erase(id);
+    pointLightComponents.erase(id);
+}
+
+void WrpScene::setModel(id_t id, std::shared_ptr<WrpModel> model)
+{
+    TransformComponent& transform = objects.at(id).transform;
+    if (model != nullptr)
+        modelComponents[id].model = std::move(model);
+    else
+        modelComponents.erase(id);
+    transform.markDirty();
+}
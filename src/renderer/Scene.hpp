@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SceneObject.hpp"
+#include "SparseSet.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+// Объект с моделью, отобранный системой рендера из пула моделей.
+// Указатели действительны до изменения состава сцены (вставка или удаление объектов и компонентов).
+struct WrpRenderObject
+{
+    SceneObject::id_t id;
+    TransformComponent* transform;
+    WrpModel* model;
+};
+
+/*
+ * Хранилище сцены: общие данные объектов (имя, преобразование, цвет, родитель) и каждый вид компонентов лежат
+ * в отдельных разреженных множествах (WrpSparseSet) с плотными массивами по id объекта.
+ * Системы обходят только нужные им компоненты, а данные объекта находят по id за O(1).
+ * id объектов стабильны, а ссылки на элементы действительны только до изменения состава соответствующего множества.
+ */
+class WrpScene
+{
+public:
+    using id_t = SceneObject::id_t;
+    using iterator = WrpSparseSet<SceneObject>::iterator;
+    using const_iterator = WrpSparseSet<SceneObject>::const_iterator;
+
+    WrpScene() = default;
+    WrpScene(const WrpScene&) = delete;
+    WrpScene& operator=(const WrpScene&) = delete;
+
+    // Объекты: обход пар (id, SceneObject) и поиск по id как у std::unordered_map
+    iterator begin() { return objects.begin(); }
+    iterator end() { return objects.end(); }
+    const_iterator begin() const { return objects.begin(); }
+    const_iterator end() const { return objects.end(); }
+    size_t size() const { return objects.size(); }
+    bool contains(id_t id) const { return objects.contains(id); }
+    iterator find(id_t id) { return objects.find(id); }
+    const_iterator find(id_t id) const { return objects.find(id); }
+    SceneObject& at(id_t id) { return objects.at(id); }
+    const SceneObject& at(id_t id) const { return objects.at(id); }
+
+    // Добавление объекта (с моделью, если она задана), возвращает его id
+    id_t add(SceneObject&& object, std::shared_ptr<WrpModel> model = nullptr);
+    // Точечный источник света: радиус видимого билборда сохраняется в X-компоненту scale'а
+    id_t addPointLight(float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
+    // Удаление объекта вместе со всеми его компонентами
+    void erase(id_t id);
+    // Замена модели объекта (nullptr удаляет компонент), WrpTransformCache пересчитает его границы
+    void setModel(id_t id, std::shared_ptr<WrpModel> model);
+
+    // Пулы компонентов (модели меняются только через add и setModel)
+    const WrpSparseSet<ModelComponent>& models() const { return modelComponents; }
+    WrpSparseSet<PointLightComponent>& pointLights() { return pointLightComponents; }
+    const WrpSparseSet<PointLightComponent>& pointLights() const { return pointLightComponents; }
+
+    // модель объекта или nullptr, если компонента нет
+    WrpModel* findModel(id_t id) const
+    {
+        auto it = modelComponents.find(id);
+        return it != modelComponents.end() ? it->second.model.get() : nullptr;
+    }
+
+private:
+    WrpSparseSet<SceneObject> objects;
+    WrpSparseSet<ModelComponent> modelComponents;
+    WrpSparseSet<PointLightComponent> pointLightComponents;
+
+    // Изменения для WrpTransformCache::update, список очищает сам кэш:
+    // объекты с изменёнными преобразованием, родителем или моделью (каждый не больше одного раза до пересчёта)
+    // и слоты кэша удалённых объектов. Указатель на dirtyObjects хранят преобразования объектов,
+    // поэтому сцена не копируется и не перемещается.
+    std::vector<id_t> dirtyObjects;
+    std::vector<uint32_t> releasedSlots;
+
+    friend class WrpTransformCache;
+};
@@ -67,13 +67,3 @@ glm::mat3 TransformComponent::normalMatrix()
         }
     };
 }
-
-SceneObject SceneObject::makePointLight(float intensity, float radius, glm::vec3 color)
-{
-    SceneObject sceneObj = SceneObject::createSceneObject("PointLight");
-    sceneObj.color = color;
-    sceneObj.transform.scale.x = radius;  // радиус видимого билборда сохраняется в X-компоненту scale'а
-    sceneObj.pointLight = std::make_unique<PointLightComponent>();
-    sceneObj.pointLight->lightIntensity = intensity;
-    return sceneObj;
-}
@@ -6,9 +6,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <unordered_map>
 #include <string>
+#include <vector>
 
 struct TransformComponent
 {
@@ -25,6 +27,37 @@ struct TransformComponent
     // Построение матрицы нормали для приведения позиции нормалей вершин к мировому пространству (world space).
     // Эта матрица очень похожа на матрицу преобразования для самих вершин, за исключением некоторых моментов.
     glm::mat3 normalMatrix();
+
+    // Матрицы мирового пространства хранятся в WrpTransformCache и пересчитываются только для изменённых
+    // преобразований. После прямой записи в translation/rotation/scale (например, из GUI) нужно вызвать markDirty.
+    // Первое изменение после пересчёта ставит объект в список изменённых объектов WrpScene, который обходит кэш.
+    void setTranslation(const glm::vec3& value) { translation = value; markDirty(); }
+    void setRotation(const glm::vec3& value) { rotation = value; markDirty(); }
+    void setScale(const glm::vec3& value) { scale = value; markDirty(); }
+    void markDirty()
+    {
+        if (!dirty && dirtyList != nullptr)
+            dirtyList->push_back(ownerId);
+        dirty = true;
+    }
+    bool isDirty() const { return dirty; }
+
+private:
+    static constexpr uint32_t NO_CACHE_SLOT = std::numeric_limits<uint32_t>::max();
+
+    bool dirty = true;                    // новое преобразование ещё не посчитано
+    uint32_t cacheSlot = NO_CACHE_SLOT;   // индекс матриц в массивах WrpTransformCache
+    std::vector<uint32_t>* dirtyList = nullptr; // список изменённых объектов сцены (nullptr, пока объект не в сцене)
+    uint32_t ownerId = 0;                 // id объекта для списка изменённых
+
+    friend class WrpTransformCache;
+    friend class WrpScene;
+};
+
+// Компоненты хранятся не в объекте, а в плотных массивах WrpScene по id объекта
+struct ModelComponent
+{
+    std::shared_ptr<WrpModel> model; // модель общая для всех объектов, которые её используют
 };
 
 struct PointLightComponent
@@ -36,8 +69,7 @@ struct PointLightComponent
 class SceneObject
 {
 public:
-    using id_t = unsigned int; // псевдоним для типа
-    using Map = std::unordered_map<id_t, SceneObject>;
+    using id_t = uint32_t; // псевдоним для типа
 
     SceneObject() = default; // Просит компилятор, хотя такой конструктор не используется
 
@@ -48,9 +80,6 @@ public:
         return SceneObject{ currentId++, name };
     }
 
-    // Метод для создания PointLight объекта
-    static SceneObject makePointLight(float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
-
     // RAII
     SceneObject(const SceneObject&) = delete;
     SceneObject& operator=(const SceneObject&) = delete;
@@ -63,17 +92,20 @@ public:
     const id_t getId() { return id; }
     const std::string getName() { return name; }
 
+    // Иерархия сцены: преобразование объекта задаётся относительно родителя, мировые матрицы считает
+    // WrpTransformCache. Иерархия на отсечение не влияет: оно идёт по BVH из мировых AABB отдельных объектов.
+    // Циклы в иерархии недопустимы.
+    static constexpr id_t NO_PARENT = std::numeric_limits<id_t>::max();
+    id_t getParentId() const { return parentId; }
+    void setParent(id_t newParentId) { parentId = newParentId; transform.markDirty(); }
+
     glm::vec3 color{}; // being used for point light color
     TransformComponent transform{};
 
-    // Опциональные компоненты объекта в виде указателей.
-    // Эти компоненты сигнализируют то, может ли данный объект исп. в конкретной системе рендерера.
-    std::shared_ptr<WrpModel> model{};
-    std::unique_ptr<PointLightComponent> pointLight = nullptr;
-
 private:
     SceneObject(id_t objId, std::string name) : id{objId}, name{name} { this->name.append(std::to_string(this->id)); }
 
     id_t id;
     std::string name;
+    id_t parentId = NO_PARENT;
 };
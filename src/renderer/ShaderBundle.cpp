@@ -0,0 +1,145 @@
+#include "ShaderBundle.hpp"
+#include "Hash.hpp"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr uint32_t SHADER_BUNDLE_MAGIC = 0x4e425357; // "WSBN"
+    constexpr uint32_t SHADER_BUNDLE_VERSION = 1;
+
+    struct ShaderBundleHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t entryCount;
+    };
+
+    struct ShaderBundleIndexEntry
+    {
+        uint64_t key;
+        uint64_t offset;
+        uint64_t wordCount;
+    };
+}
+
+ShaderBundle& ShaderBundle::instance()
+{
+    static ShaderBundle bundle = []() {
+        ShaderBundle loaded;
+        if (loaded.load(SHADER_BUNDLE_PATH))
+            std::cout << "[ShaderBundle] Loaded " << loaded.size() << " SPIR-V permutations from " << SHADER_BUNDLE_PATH << std::endl;
+        return loaded;
+    }();
+    return bundle;
+}
+
+uint64_t ShaderBundle::permutationKey(const std::string& shaderName, const ShaderDefines& defines)
+{
+    WrpHasher hasher;
+    hasher.add(SHADER_BUNDLE_VERSION).add(shaderName).add(static_cast<uint64_t>(defines.size()));
+    for (const auto& [name, value] : defines)
+    {
+        hasher.add(name).add(value);
+    }
+    return hasher.value();
+}
+
+bool ShaderBundle::write(const std::filesystem::path& path, std::vector<Entry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+
+    std::vector<ShaderBundleIndexEntry> indexEntries;
+    indexEntries.reserve(entries.size());
+    uint64_t offset = 0;
+    for (const auto& entry : entries)
+    {
+        indexEntries.push_back({entry.key, offset, entry.spirv.size()});
+        offset += entry.spirv.size();
+    }
+
+    // запись через временный файл, чтобы запущенный рендер не прочитал недописанный бандл
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        const ShaderBundleHeader header{SHADER_BUNDLE_MAGIC, SHADER_BUNDLE_VERSION, entries.size()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(indexEntries.data()), indexEntries.size() * sizeof(ShaderBundleIndexEntry));
+        for (const auto& entry : entries)
+        {
+            file.write(reinterpret_cast<const char*>(entry.spirv.data()), entry.spirv.size() * sizeof(uint32_t));
+        }
+        if (!file)
+        {
+            std::cerr << "[ShaderBundle] Failed to write " << tmpPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::cerr << "[ShaderBundle] Failed to replace " << path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ShaderBundle::load(const std::filesystem::path& path)
+{
+    index.clear();
+    words.clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    ShaderBundleHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != SHADER_BUNDLE_MAGIC
+        || header.version != SHADER_BUNDLE_VERSION)
+    {
+        std::cerr << "[ShaderBundle] " << path << " is not a compatible shader bundle, ignoring it." << std::endl;
+        return false;
+    }
+
+    std::vector<ShaderBundleIndexEntry> indexEntries(header.entryCount);
+    if (!file.read(reinterpret_cast<char*>(indexEntries.data()), indexEntries.size() * sizeof(ShaderBundleIndexEntry)))
+        return false;
+
+    uint64_t totalWords = 0;
+    for (const auto& entry : indexEntries)
+    {
+        totalWords = std::max(totalWords, entry.offset + entry.wordCount);
+    }
+    words.resize(totalWords);
+    if (!file.read(reinterpret_cast<char*>(words.data()), totalWords * sizeof(uint32_t)))
+    {
+        std::cerr << "[ShaderBundle] " << path << " is truncated, ignoring it." << std::endl;
+        words.clear();
+        return false;
+    }
+
+    for (const auto& entry : indexEntries)
+    {
+        index[entry.key] = {entry.offset, entry.wordCount};
+    }
+    return true;
+}
+
+bool ShaderBundle::find(const std::string& shaderName, const ShaderDefines& defines, std::vector<uint32_t>& outSpirv) const
+{
+    auto it = index.find(permutationKey(shaderName, defines));
+    if (it == index.end())
+        return false;
+
+    const auto begin = words.begin() + it->second.offset;
+    outSpirv.assign(begin, begin + it->second.wordCount);
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "SpirvCache.hpp" // ShaderDefines
+
+// std
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Бандл SPIR-V, собранный офлайн инструментом ShaderBundler (ищется в рабочей директории, как и кэш пайплайнов)
+#ifndef SHADER_BUNDLE_PATH
+#define SHADER_BUNDLE_PATH "shaders.bundle"
+#endif
+
+/*
+ * Indexed binary bundle of precompiled SPIR-V permutations.
+ * Layout: header {magic, version, entryCount}, index of {key, offset, wordCount} sorted by key, then SPIR-V words.
+ * The key is a hash of the shader file name and its defines, so modules can be looked up without GLSL sources.
+ * Code here does not depend on Vulkan or shaderc: it is shared by the runtime and the offline ShaderBundler tool.
+ */
+class ShaderBundle
+{
+public:
+    struct Entry
+    {
+        uint64_t key;
+        std::vector<uint32_t> spirv;
+    };
+
+    // Бандл из SHADER_BUNDLE_PATH, загружается при первом обращении. Отсутствующий файл - это пустой бандл.
+    static ShaderBundle& instance();
+
+    static uint64_t permutationKey(const std::string& shaderName, const ShaderDefines& defines);
+    static bool write(const std::filesystem::path& path, std::vector<Entry> entries);
+
+    bool load(const std::filesystem::path& path);
+    // После загрузки бандл только читается, поэтому поиск потокобезопасен
+    bool find(const std::string& shaderName, const ShaderDefines& defines, std::vector<uint32_t>& outSpirv) const;
+
+    size_t size() const { return index.size(); }
+
+private:
+    struct Location
+    {
+        uint64_t offset; // в словах от начала блока данных
+        uint64_t wordCount;
+    };
+
+    std::unordered_map<uint64_t, Location> index;
+    std::vector<uint32_t> words;
+};
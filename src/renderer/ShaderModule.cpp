@@ -1,23 +1,29 @@
 #include "ShaderModule.hpp"
 #include "HeaderCore.hpp"
+#include "ShaderBundle.hpp"
 
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <filesystem>
 #include <string>
 #include <fstream>
 #include <iostream>
 
-ShaderModule::ShaderModule(WrpDevice& device, std::string shaderFilename) : wrpDevice(device)
+ShaderModule::ShaderModule(WrpDevice& device, std::string shaderFilename, const ShaderDefines& defines) : wrpDevice(device)
 {
+#ifdef WRP_RUNTIME_SHADER_COMPILATION
+    // В сборках для разработки исходники GLSL первичны (в том числе для hot-reload),
+    // бандл используется, только если исходника рядом нет
     std::string path = SHADERS_DIR + shaderFilename;
-    std::string shaderSource = readShaderFile(path);
-    if (shaderSource.empty()) {
-        throw std::runtime_error("[ShaderModule] Shader source string is empty.");
-    }
-
-    if (compileShaderIntoSPIRV(glslangShaderStageFromFileName(path.c_str()), shaderSource, path) < 1) {
-        throw std::runtime_error("[ShaderModule] SPIR-V source has 0 size.");
+    if (std::filesystem::exists(path))
+    {
+        loadFromSource(path, defines);
+        createShaderModule();
+        return;
     }
+#endif
+    loadFromBundle(shaderFilename, defines);
     createShaderModule();
 }
 
@@ -26,6 +32,43 @@ ShaderModule::~ShaderModule()
     vkDestroyShaderModule(wrpDevice.device(), shaderModule, nullptr);
 }
 
+// Готовый оптимизированный SPIR-V из бандла, собранного ShaderBundler'ом
+void ShaderModule::loadFromBundle(const std::string& shaderFilename, const ShaderDefines& defines)
+{
+    if (!ShaderBundle::instance().find(shaderFilename, defines, spirv))
+    {
+        std::string permutation = shaderFilename;
+        for (const auto& [name, value] : defines) permutation += " " + name + "=" + value;
+        throw std::runtime_error("[ShaderModule] Shader permutation \"" + permutation + "\" is missing in " SHADER_BUNDLE_PATH
+            ". Rebuild the shader_bundle target.");
+    }
+    sourceSizeInBytes = spirv.size() * sizeof(uint32_t);
+}
+
+#ifdef WRP_RUNTIME_SHADER_COMPILATION
+void ShaderModule::loadFromSource(std::string& path, const ShaderDefines& defines)
+{
+    std::string shaderSource = readShaderFile(path);
+    if (shaderSource.empty()) {
+        throw std::runtime_error("[ShaderModule] Shader source string is empty.");
+    }
+
+    // Скомпилированный модуль ищется в кэше по хэшу исходника (с раскрытыми #include), стадии, макросам и опциям компилятора
+    shaderc_shader_kind shaderKind = glslangShaderStageFromFileName(path.c_str());
+    SpirvCache& spirvCache = SpirvCache::instance();
+    uint64_t cacheKey = SpirvCache::computeKey(shaderSource, shaderKind, defines, compilerOptionsSignature());
+    if (!spirvCache.find(cacheKey, spirv))
+    {
+        auto compileStart = std::chrono::high_resolution_clock::now();
+        if (compileShaderIntoSPIRV(shaderKind, shaderSource, path, defines) < 1) {
+            throw std::runtime_error("[ShaderModule] SPIR-V source has 0 size.");
+        }
+        auto compileTime = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - compileStart).count();
+        spirvCache.store(cacheKey, spirv, compileTime);
+    }
+}
+
 std::string ShaderModule::readShaderFile(std::string& shaderPath)
 {
     // ate is setting pointer to the end of file to read file size right from to-go
@@ -65,7 +108,7 @@ std::string ShaderModule::readShaderFile(std::string& shaderPath)
         {
             throw std::runtime_error("Failed to handle #include directive in " + shaderPath);
         }
-        std::string name = code.substr(p1 + 1, p2 - p1 - 1);
+        std::string name = SHADERS_DIR + code.substr(p1 + 1, p2 - p1 - 1); // include-файлы ищутся в директории шейдеров
         std::string include = readShaderFile(name);
         code.replace(pos, p2 - pos + 1, include.c_str());
     }
@@ -106,16 +149,52 @@ bool ShaderModule::endsWith(const char* s, const char* part)
     return strcmp(s + sLength - partLength, part) == 0;
 }
 
-size_t ShaderModule::compileShaderIntoSPIRV(shaderc_shader_kind shaderKind, std::string& shaderSource, std::string& shaderPath)
+// Всё, что влияет на результат компиляции помимо исходника и макросов, должно попадать в эту строку,
+// иначе кэш SPIR-V вернёт модуль, собранный с другими настройками.
+std::string ShaderModule::compilerOptionsSignature()
+{
+    unsigned int spvVersion = 0, spvRevision = 0;
+    shaderc_get_spv_version(&spvVersion, &spvRevision);
+    return "shaderc;spv=" + std::to_string(spvVersion) + "." + std::to_string(spvRevision) + ";entry=main;opt=none";
+}
+
+// Компилятор shaderc создаётся один раз на поток: модули могут собираться параллельно из задач WrpJobSystem
+namespace
+{
+    struct ThreadLocalShaderCompiler
+    {
+        shaderc_compiler_t compiler = shaderc_compiler_initialize();
+        ~ThreadLocalShaderCompiler() { shaderc_compiler_release(compiler); }
+    };
+}
+
+size_t ShaderModule::compileShaderIntoSPIRV(shaderc_shader_kind shaderKind, std::string& shaderSource, std::string& shaderPath, const ShaderDefines& defines)
 {
-    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    static thread_local ThreadLocalShaderCompiler threadCompiler;
+    shaderc_compiler_t compiler = threadCompiler.compiler;
+    shaderc_compile_options_t options = nullptr;
+    if (!defines.empty())
+    {
+        options = shaderc_compile_options_initialize();
+        for (const auto& [name, value] : defines)
+        {
+            shaderc_compile_options_add_macro_definition(options, name.c_str(), name.size(), value.c_str(), value.size());
+        }
+    }
+
     shaderc_compilation_result_t result = shaderc_compile_into_spv(compiler, shaderSource.data(), shaderSource.size(),
-        shaderKind, shaderPath.c_str(), "main", nullptr);
+        shaderKind, shaderPath.c_str(), "main", options);
 
-    const char* compiler_error_msgs = shaderc_result_get_error_message(result);
-    if (compiler_error_msgs)
+    // Ошибки компиляции пробрасываются исключением, чтобы их текст можно было показать (например, при hot-reload в GUI)
+    if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
     {
-        std::cerr << compiler_error_msgs << std::endl;
+        std::string errorMessage = shaderc_result_get_error_message(result);
+        std::cerr << errorMessage << std::endl;
+        shaderc_result_release(result);
+        if (options) {
+            shaderc_compile_options_release(options);
+        }
+        throw std::runtime_error("[ShaderModule] Failed to compile " + shaderPath + ":\n" + errorMessage);
     }
 
     size_t sizeInBytes = shaderc_result_get_length(result);
@@ -127,9 +206,12 @@ size_t ShaderModule::compileShaderIntoSPIRV(shaderc_shader_kind shaderKind, std:
     if (result) {
         shaderc_result_release(result);
     }
-    shaderc_compiler_release(compiler);
+    if (options) {
+        shaderc_compile_options_release(options);
+    }
     return sizeInBytes;
 }
+#endif // WRP_RUNTIME_SHADER_COMPILATION
 
 VkResult ShaderModule::createShaderModule()
 {
@@ -141,4 +223,5 @@ VkResult ShaderModule::createShaderModule()
     {
         throw std::runtime_error("Failed to create shader module.");
     }
+    return VK_SUCCESS;
 }
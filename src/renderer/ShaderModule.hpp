@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Device.hpp"
+#include "SpirvCache.hpp"
 
+// Без WRP_RUNTIME_SHADER_COMPILATION (CMake опция) shaderc не линкуется, и модули берутся только из ShaderBundle
+#ifdef WRP_RUNTIME_SHADER_COMPILATION
 #include "shaderc/shaderc.h"
+#endif
 
 #include <vector>
 #include <string>
@@ -10,7 +14,7 @@
 class ShaderModule
 {
 public:
-    ShaderModule(WrpDevice& device, std::string shaderFilename);
+    ShaderModule(WrpDevice& device, std::string shaderFilename, const ShaderDefines& defines = {});
     ~ShaderModule();
 
     size_t getSourceSizeInBytes() { return sourceSizeInBytes; };
@@ -18,10 +22,15 @@ public:
     VkShaderModule shaderModule = nullptr;
 
 private:
+    void loadFromBundle(const std::string& shaderFilename, const ShaderDefines& defines);
+#ifdef WRP_RUNTIME_SHADER_COMPILATION
+    void loadFromSource(std::string& shaderPath, const ShaderDefines& defines);
     std::string readShaderFile(std::string& shaderPath);
     shaderc_shader_kind glslangShaderStageFromFileName(const char* fileName);
     bool endsWith(const char* s, const char* part);
-    size_t compileShaderIntoSPIRV(shaderc_shader_kind shaderKind, std::string& shaderSource, std::string& shaderPath);
+    size_t compileShaderIntoSPIRV(shaderc_shader_kind shaderKind, std::string& shaderSource, std::string& shaderPath, const ShaderDefines& defines);
+    static std::string compilerOptionsSignature();
+#endif
     VkResult createShaderModule();
 
     WrpDevice& wrpDevice;
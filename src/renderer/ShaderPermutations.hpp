@@ -0,0 +1,115 @@
+#pragma once
+
+#include "SpirvCache.hpp" // ShaderDefines
+
+// std
+#include <string>
+#include <vector>
+
+#define REFLECTION_MODELS_COUNT 3 // Lambertian, Blinn-Phong, Cook-Torrance
+
+// Максимальный размер массива текстур, для которого офлайн собираются варианты без descriptor indexing.
+// Без компиляции шейдеров во время работы TextureRenderSystem ограничивает массив этим размером,
+// текстуры сверх него заменяются цветом материала
+#define LEGACY_TEXTURES_COUNT_MAX 32
+
+struct ShaderPermutation
+{
+    std::string shaderName;
+    ShaderDefines defines;
+};
+
+/*
+ * Имена шейдеров и наборы макросов, которые используют системы рендера.
+ * По этому же списку офлайн компилятор (tools/ShaderBundler) собирает бандл SPIR-V,
+ * поэтому системы должны брать имена и макросы отсюда, иначе их вариантов не окажется в бандле.
+ * Заголовок не зависит от Vulkan, чтобы его можно было подключать в инструментах сборки.
+ */
+class ShaderPermutations
+{
+public:
+    static std::string noTextureFragShader(int reflectionModel)
+    {
+        if (reflectionModel == 0) return "NoTextureLambertian.frag";
+        else if (reflectionModel == 1) return "NoTextureBlinnPhong.frag";
+        else return "NoTextureTorranceSparrow.frag";
+    }
+
+    static std::string textureFragShader(int reflectionModel)
+    {
+        if (reflectionModel == 0) return "TextureLambertian.frag";
+        else if (reflectionModel == 1) return "TextureBlinnPhong.frag";
+        else return "TextureTorranceSparrow.frag";
+    }
+
+    // Заполнение G-buffer'а отложенного освещения: модель отражения применяется уже в проходе освещения
+    static std::string gBufferFragShader(bool textured)
+    {
+        return textured ? "GBufferTexture.frag" : "GBufferNoTexture.frag";
+    }
+
+    // Проход освещения отложенного пути (DeferredLighting.frag) выбирает модель отражения макросом
+    static ShaderDefines deferredLightingDefines(int reflectionModel)
+    {
+        return {{"REFLECTION_MODEL", std::to_string(reflectionModel)}};
+    }
+
+    // Размер массива текстур передаётся в шейдер макросом, в bindless варианте массив безразмерный
+    static ShaderDefines textureFragDefines(bool bindless, int texturesCount)
+    {
+        if (bindless)
+            return {{"BINDLESS", "1"}};
+        return {{"TEXTURES_COUNT", std::to_string(texturesCount)}};
+    }
+
+    // Перенос кадра сцены в swapchain (Upscale.frag): FXAA вместо повышения резкости
+    static ShaderDefines upscaleFragDefines(bool fxaa)
+    {
+        if (fxaa)
+            return {{"FXAA", "1"}};
+        return {};
+    }
+
+    // Вершинные шейдеры мешей: с multi-draw indirect данные отрисовки индексируются по gl_DrawID
+    static ShaderDefines meshVertDefines(bool multiDrawIndirect)
+    {
+        if (multiDrawIndirect)
+            return {{"MULTI_DRAW_INDIRECT", "1"}};
+        return {};
+    }
+
+    // Все перестановки: модель отражения x с текстурами/без x макросы функционала, плюс шейдеры отложенного освещения
+    static std::vector<ShaderPermutation> all()
+    {
+        std::vector<ShaderPermutation> permutations{
+            {"NoTexture.vert", meshVertDefines(false)},
+            {"NoTexture.vert", meshVertDefines(true)},
+            {"Texture.vert", meshVertDefines(false)},
+            {"Texture.vert", meshVertDefines(true)},
+            {"PointLight.vert", {}},
+            {"PointLight.frag", {}},
+            {"CullInstances.comp", {}},
+            {"CompactDraws.comp", {}},
+            {"Fullscreen.vert", {}},
+            {"Upscale.frag", upscaleFragDefines(false)},
+            {"Upscale.frag", upscaleFragDefines(true)},
+            {gBufferFragShader(false), {}},
+            {gBufferFragShader(true), textureFragDefines(true, 0)},
+        };
+        for (int texturesCount = 0; texturesCount <= LEGACY_TEXTURES_COUNT_MAX; texturesCount++)
+        {
+            permutations.push_back({gBufferFragShader(true), textureFragDefines(false, texturesCount)});
+        }
+        for (int reflectionModel = 0; reflectionModel < REFLECTION_MODELS_COUNT; reflectionModel++)
+        {
+            permutations.push_back({noTextureFragShader(reflectionModel), {}});
+            permutations.push_back({"DeferredLighting.frag", deferredLightingDefines(reflectionModel)});
+            permutations.push_back({textureFragShader(reflectionModel), textureFragDefines(true, 0)});
+            for (int texturesCount = 0; texturesCount <= LEGACY_TEXTURES_COUNT_MAX; texturesCount++)
+            {
+                permutations.push_back({textureFragShader(reflectionModel), textureFragDefines(false, texturesCount)});
+            }
+        }
+        return permutations;
+    }
+};
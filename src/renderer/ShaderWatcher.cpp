@@ -0,0 +1,198 @@
+#include "ShaderWatcher.hpp"
+#include "JobSystem.hpp"
+
+// std
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+WrpShaderWatcher::WrpShaderWatcher(std::string shadersDir) : shadersDir{std::move(shadersDir)}
+{
+    watchThread = std::thread(&WrpShaderWatcher::watchLoop, this);
+}
+
+WrpShaderWatcher::~WrpShaderWatcher()
+{
+    stopping = true;
+    if (watchThread.joinable())
+        watchThread.join();
+}
+
+bool WrpShaderWatcher::isShaderFile(const std::string& fileName)
+{
+    static const std::unordered_set<std::string> extensions{".vert", ".frag", ".geom", ".comp", ".tesc", ".tese", ".glsl"};
+    return extensions.count(std::filesystem::path(fileName).extension().string()) != 0;
+}
+
+void WrpShaderWatcher::addChangedFile(const std::string& fileName)
+{
+    if (!isShaderFile(fileName))
+        return; // временные файлы редакторов и т.п.
+    std::lock_guard<std::mutex> lock{changesMutex};
+    changedFiles.insert(fileName);
+}
+
+#ifdef __linux__
+void WrpShaderWatcher::watchLoop()
+{
+    int fd = inotify_init1(IN_NONBLOCK);
+    if (fd < 0 || inotify_add_watch(fd, shadersDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        std::cerr << "[ShaderWatcher] inotify is unavailable for " << shadersDir << ", falling back to polling." << std::endl;
+        if (fd >= 0) close(fd);
+        pollingWatchLoop();
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (!stopping)
+    {
+        // таймаут нужен, чтобы периодически проверять флаг остановки
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0)
+            continue;
+
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0)
+                addChangedFile(event->name);
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    close(fd);
+}
+#else
+void WrpShaderWatcher::watchLoop()
+{
+    pollingWatchLoop();
+}
+#endif
+
+void WrpShaderWatcher::pollingWatchLoop()
+{
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+    bool firstScan = true;
+    while (!stopping)
+    {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(shadersDir, ec))
+        {
+            std::string fileName = entry.path().filename().string();
+            auto writeTime = entry.last_write_time(ec);
+            if (ec) continue;
+
+            auto it = writeTimes.find(fileName);
+            if (it == writeTimes.end() || it->second != writeTime)
+            {
+                if (!firstScan)
+                    addChangedFile(fileName);
+                writeTimes[fileName] = writeTime;
+            }
+        }
+        firstScan = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+
+// Обратный граф включений: include-файл -> шейдеры, которые его непосредственно включают
+std::unordered_map<std::string, std::vector<std::string>> WrpShaderWatcher::collectIncludeDependents()
+{
+    std::unordered_map<std::string, std::vector<std::string>> dependents;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(shadersDir, ec))
+    {
+        std::string fileName = entry.path().filename().string();
+        if (!isShaderFile(fileName))
+            continue;
+
+        std::ifstream file(entry.path());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const auto pos = line.find("#include ");
+            if (pos == line.npos)
+                continue;
+            const auto p1 = line.find('<', pos);
+            const auto p2 = line.find('>', pos);
+            if (p1 != line.npos && p2 != line.npos && p2 > p1)
+                dependents[line.substr(p1 + 1, p2 - p1 - 1)].push_back(fileName);
+        }
+    }
+    return dependents;
+}
+
+std::unordered_set<std::string> WrpShaderWatcher::pollChangedShaders()
+{
+    std::unordered_set<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock{changesMutex};
+        changed.swap(changedFiles);
+    }
+    if (changed.empty())
+        return changed;
+
+    // транзитивно добавляем шейдеры, зависящие от изменённых include-файлов
+    auto dependents = collectIncludeDependents();
+    std::vector<std::string> queue(changed.begin(), changed.end());
+    while (!queue.empty())
+    {
+        std::string fileName = std::move(queue.back());
+        queue.pop_back();
+        auto it = dependents.find(fileName);
+        if (it == dependents.end())
+            continue;
+        for (const auto& dependent : it->second)
+        {
+            if (changed.insert(dependent).second)
+                queue.push_back(dependent);
+        }
+    }
+
+    std::cout << "[ShaderWatcher] Changed shaders:";
+    for (const auto& name : changed) std::cout << " " << name;
+    std::cout << std::endl;
+    return changed;
+}
+
+std::future<std::unique_ptr<WrpPipeline>> WrpShaderWatcher::rebuildPipelineAsync(
+    const std::string& pipelineName, std::function<std::unique_ptr<WrpPipeline>()> buildPipeline)
+{
+    return WrpJobSystem::instance().submit([this, pipelineName, buildPipeline = std::move(buildPipeline)]() {
+        std::unique_ptr<WrpPipeline> pipeline;
+        try
+        {
+            pipeline = buildPipeline();
+        }
+        catch (const std::exception& ex)
+        {
+            std::lock_guard<std::mutex> lock{errorsMutex};
+            errors[pipelineName] = ex.what();
+            return pipeline;
+        }
+
+        std::lock_guard<std::mutex> lock{errorsMutex};
+        errors.erase(pipelineName);
+        return pipeline;
+    });
+}
+
+std::vector<ShaderReloadError> WrpShaderWatcher::getErrors()
+{
+    std::lock_guard<std::mutex> lock{errorsMutex};
+    std::vector<ShaderReloadError> result;
+    result.reserve(errors.size());
+    for (const auto& [pipelineName, message] : errors)
+    {
+        result.push_back({pipelineName, message});
+    }
+    return result;
+}
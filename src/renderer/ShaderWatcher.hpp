@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Pipeline.hpp"
+
+// std
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct ShaderReloadError
+{
+    std::string pipelineName;
+    std::string message;
+};
+
+/*
+ * Наблюдатель за директорией шейдеров для hot-reload.
+ * На Linux изменения приходят через inotify, на остальных платформах директория опрашивается по времени изменения файлов.
+ * Сами пайплайны пересобираются системами рендера в WrpJobSystem и подменяются на границе кадра,
+ * а ошибки компиляции собираются здесь для вывода в GUI.
+ */
+class WrpShaderWatcher
+{
+public:
+    explicit WrpShaderWatcher(std::string shadersDir = SHADERS_DIR);
+    ~WrpShaderWatcher();
+
+    WrpShaderWatcher(const WrpShaderWatcher&) = delete;
+    WrpShaderWatcher& operator=(const WrpShaderWatcher&) = delete;
+
+    // Имена шейдеров, которые нужно перекомпилировать с прошлого вызова:
+    // изменённые файлы и все шейдеры, которые включают их через #include (в том числе транзитивно).
+    std::unordered_set<std::string> pollChangedShaders();
+
+    // Ставит пересборку пайплайна в очередь WrpJobSystem. Ошибка сборки не пробрасывается,
+    // а записывается в список ошибок под именем pipelineName, при этом результатом будет nullptr.
+    std::future<std::unique_ptr<WrpPipeline>> rebuildPipelineAsync(
+        const std::string& pipelineName, std::function<std::unique_ptr<WrpPipeline>()> buildPipeline);
+
+    std::vector<ShaderReloadError> getErrors();
+
+private:
+    void watchLoop();
+    void pollingWatchLoop();
+    void addChangedFile(const std::string& fileName);
+    std::unordered_map<std::string, std::vector<std::string>> collectIncludeDependents();
+
+    static bool isShaderFile(const std::string& fileName);
+
+    std::string shadersDir;
+    std::thread watchThread;
+    std::atomic<bool> stopping = false;
+
+    std::mutex changesMutex;
+    std::unordered_set<std::string> changedFiles;
+
+    std::mutex errorsMutex;
+    std::unordered_map<std::string, std::string> errors; // pipelineName -> текст ошибки
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/*
+ * Разреженное множество: значения лежат плотным массивом пар (id, значение), а разреженный индекс id -> позиция
+ * хранится страницами, которые выделяются только под встречающиеся диапазоны id.
+ * Поиск, вставка и удаление за O(1), обход идёт по непрерывной памяти без пропусков.
+ * Удаление переносит последний элемент на место удалённого, поэтому порядок обхода не сохраняется,
+ * а ссылки и итераторы на элементы действительны только до следующей вставки или удаления (id при этом стабильны).
+ * Интерфейс повторяет используемую часть std::unordered_map: элементы обхода - пары с полями first и second.
+ */
+template <typename T>
+class WrpSparseSet
+{
+public:
+    using id_t = uint32_t;
+    using value_type = std::pair<id_t, T>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() { return dense.begin(); }
+    iterator end() { return dense.end(); }
+    const_iterator begin() const { return dense.begin(); }
+    const_iterator end() const { return dense.end(); }
+
+    size_t size() const { return dense.size(); }
+    bool empty() const { return dense.empty(); }
+    void reserve(size_t count) { dense.reserve(count); }
+
+    bool contains(id_t id) const { return indexOf(id) != NO_INDEX; }
+
+    iterator find(id_t id)
+    {
+        const uint32_t index = indexOf(id);
+        return index == NO_INDEX ? dense.end() : dense.begin() + index;
+    }
+
+    const_iterator find(id_t id) const
+    {
+        const uint32_t index = indexOf(id);
+        return index == NO_INDEX ? dense.end() : dense.begin() + index;
+    }
+
+    T& at(id_t id)
+    {
+        const uint32_t index = indexOf(id);
+        if (index == NO_INDEX)
+            throw std::out_of_range("sparse set has no element with id " + std::to_string(id));
+        return dense[index].second;
+    }
+
+    const T& at(id_t id) const { return const_cast<WrpSparseSet*>(this)->at(id); }
+
+    // Как у std::unordered_map: если элемента нет, вставляется значение по умолчанию
+    T& operator[](id_t id)
+    {
+        const uint32_t index = indexOf(id);
+        if (index != NO_INDEX) return dense[index].second;
+        return emplace(id, T{}).first->second;
+    }
+
+    // Вставка без замены существующего значения (как std::unordered_map::emplace)
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(id_t id, Args&&... args)
+    {
+        const uint32_t index = indexOf(id);
+        if (index != NO_INDEX) return {dense.begin() + index, false};
+
+        slot(id) = static_cast<uint32_t>(dense.size());
+        dense.emplace_back(std::piecewise_construct, std::forward_as_tuple(id), std::forward_as_tuple(std::forward<Args>(args)...));
+        return {dense.end() - 1, true};
+    }
+
+    size_t erase(id_t id)
+    {
+        const uint32_t index = indexOf(id);
+        if (index == NO_INDEX) return 0;
+
+        // последний элемент переносится на место удалённого
+        const uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+        if (index != last)
+        {
+            dense[index] = std::move(dense[last]);
+            slot(dense[index].first) = index;
+        }
+        dense.pop_back();
+        slot(id) = NO_INDEX;
+        return 1;
+    }
+
+    void clear()
+    {
+        dense.clear();
+        pages.clear();
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+
+    uint32_t indexOf(id_t id) const
+    {
+        const size_t page = id >> PAGE_BITS;
+        if (page >= pages.size() || !pages[page]) return NO_INDEX;
+        return pages[page][id & (PAGE_SIZE - 1)];
+    }
+
+    // ячейка разреженного индекса, страница выделяется при первом обращении
+    uint32_t& slot(id_t id)
+    {
+        const size_t page = id >> PAGE_BITS;
+        if (page >= pages.size()) pages.resize(page + 1);
+        if (!pages[page])
+        {
+            pages[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+            std::fill_n(pages[page].get(), PAGE_SIZE, NO_INDEX);
+        }
+        return pages[page][id & (PAGE_SIZE - 1)];
+    }
+
+    std::vector<std::unique_ptr<uint32_t[]>> pages;
+    std::vector<value_type> dense;
+};
@@ -0,0 +1,157 @@
+#include "SpirvCache.hpp"
+#include "HeaderCore.hpp"
+#include "Hash.hpp"
+
+// std
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr uint32_t SPIRV_CACHE_MAGIC = 0x56505357; // "WSPV"
+    constexpr uint32_t SPIRV_CACHE_VERSION = 1;
+
+    struct SpirvCacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t compileTimeMicroseconds;
+        uint64_t wordCount;
+    };
+}
+
+SpirvCache& SpirvCache::instance()
+{
+    static SpirvCache cache;
+    return cache;
+}
+
+SpirvCache::SpirvCache() : cacheDir{SPIRV_CACHE_DIR}
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    if (ec)
+    {
+        std::cerr << "[SpirvCache] Failed to create cache directory " << cacheDir << ": " << ec.message()
+            << ". Only in-memory caching will be used." << std::endl;
+        cacheDir.clear();
+    }
+}
+
+uint64_t SpirvCache::computeKey(
+    const std::string& expandedSource,
+    int shaderStage,
+    const ShaderDefines& defines,
+    const std::string& compilerOptions)
+{
+    WrpHasher hasher;
+    hasher.add(SPIRV_CACHE_VERSION).add(shaderStage).add(compilerOptions);
+    for (const auto& [name, value] : defines)
+    {
+        hasher.add(name).add(value);
+    }
+    hasher.add(expandedSource);
+    return hasher.value();
+}
+
+bool SpirvCache::find(uint64_t key, std::vector<uint32_t>& outSpirv)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        Entry entry;
+        if (!readEntryFromDisk(key, entry))
+        {
+            stats.misses++;
+            return false;
+        }
+        it = entries.emplace(key, std::move(entry)).first;
+    }
+
+    outSpirv = it->second.spirv;
+    stats.hits++;
+    stats.compileTimeSavedMicroseconds += it->second.compileTimeMicroseconds;
+    return true;
+}
+
+void SpirvCache::store(uint64_t key, const std::vector<uint32_t>& spirv, uint64_t compileTimeMicroseconds)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    stats.compileTimeSpentMicroseconds += compileTimeMicroseconds;
+    Entry& entry = entries[key];
+    entry.spirv = spirv;
+    entry.compileTimeMicroseconds = compileTimeMicroseconds;
+    writeEntryToDisk(key, entry);
+}
+
+std::filesystem::path SpirvCache::entryPath(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(key));
+    return cacheDir / name;
+}
+
+bool SpirvCache::readEntryFromDisk(uint64_t key, Entry& outEntry) const
+{
+    if (cacheDir.empty())
+        return false;
+
+    std::ifstream file(entryPath(key), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    SpirvCacheFileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != SPIRV_CACHE_MAGIC
+        || header.version != SPIRV_CACHE_VERSION
+        || header.key != key
+        || header.wordCount == 0)
+    {
+        return false;
+    }
+
+    outEntry.spirv.resize(header.wordCount);
+    if (!file.read(reinterpret_cast<char*>(outEntry.spirv.data()), header.wordCount * sizeof(uint32_t)))
+        return false;
+    outEntry.compileTimeMicroseconds = header.compileTimeMicroseconds;
+    return true;
+}
+
+void SpirvCache::writeEntryToDisk(uint64_t key, const Entry& entry) const
+{
+    if (cacheDir.empty())
+        return;
+
+    const SpirvCacheFileHeader header{
+        SPIRV_CACHE_MAGIC,
+        SPIRV_CACHE_VERSION,
+        key,
+        entry.compileTimeMicroseconds,
+        entry.spirv.size()
+    };
+
+    // запись через временный файл, чтобы параллельно запущенный процесс не прочитал недописанный модуль
+    const std::filesystem::path path = entryPath(key);
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entry.spirv.data()), entry.spirv.size() * sizeof(uint32_t));
+        if (!file)
+        {
+            std::cerr << "[SpirvCache] Failed to write " << tmpPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+        std::filesystem::remove(tmpPath, ec);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Набор макроопределений (имя, значение), передаваемых компилятору шейдеров
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+struct SpirvCacheStats
+{
+    std::atomic<uint32_t> hits = 0;
+    std::atomic<uint32_t> misses = 0;
+    std::atomic<uint64_t> compileTimeSavedMicroseconds = 0; // суммарное время компиляции, которое не пришлось тратить
+    std::atomic<uint64_t> compileTimeSpentMicroseconds = 0;
+
+    double compileTimeSavedMs() const { return compileTimeSavedMicroseconds.load() / 1000.0; }
+    double compileTimeSpentMs() const { return compileTimeSpentMicroseconds.load() / 1000.0; }
+};
+
+/*
+ * Content-addressed cache of compiled SPIR-V modules.
+ * The key is a hash of the fully include-expanded GLSL source, shader stage, defines and compiler options,
+ * so any change of the input produces a new entry and stale binaries are never picked up.
+ * Entries live in memory for the whole run and are mirrored to SPIRV_CACHE_DIR for warm starts.
+ * All methods are thread-safe.
+ */
+class SpirvCache
+{
+public:
+    static SpirvCache& instance();
+
+    static uint64_t computeKey(
+        const std::string& expandedSource,
+        int shaderStage,
+        const ShaderDefines& defines,
+        const std::string& compilerOptions);
+
+    // Ищет модуль в памяти, затем на диске. Учитывает попадание/промах в статистике.
+    bool find(uint64_t key, std::vector<uint32_t>& outSpirv);
+    // Сохраняет свежескомпилированный модуль в память и на диск.
+    void store(uint64_t key, const std::vector<uint32_t>& spirv, uint64_t compileTimeMicroseconds);
+
+    SpirvCacheStats& getStats() { return stats; }
+
+    SpirvCache(const SpirvCache&) = delete;
+    SpirvCache& operator=(const SpirvCache&) = delete;
+
+private:
+    struct Entry
+    {
+        std::vector<uint32_t> spirv;
+        uint64_t compileTimeMicroseconds = 0;
+    };
+
+    SpirvCache();
+
+    std::filesystem::path entryPath(uint64_t key) const;
+    bool readEntryFromDisk(uint64_t key, Entry& outEntry) const;
+    void writeEntryToDisk(uint64_t key, const Entry& entry) const;
+
+    std::filesystem::path cacheDir;
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    SpirvCacheStats stats;
+};
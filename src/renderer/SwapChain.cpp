@@ -10,14 +10,21 @@
 #include <set>
 #include <stdexcept>
 
-WrpSwapChain::WrpSwapChain(WrpDevice& device, WrpWindow& window)
-    : wrpDevice{device}, wrpWindow{window}
+namespace
+{
+    // изображений внеэкранной цепи столько же, сколько кадров в полёте
+    constexpr uint32_t OFFSCREEN_IMAGE_COUNT = 2;
+}
+
+WrpSwapChain::WrpSwapChain(WrpDevice& device, WrpWindow& window, VkSampleCountFlagBits msaaSampleCount)
+    : msaaSampleCount{msaaSampleCount}, wrpDevice{device}, wrpWindow{&window}
 {
     init();
 }
 
-WrpSwapChain::WrpSwapChain(WrpDevice& device, WrpWindow& window, std::shared_ptr<WrpSwapChain> previous)
-    : wrpDevice{device}, wrpWindow{window}, oldSwapChain{previous}
+WrpSwapChain::WrpSwapChain(WrpDevice& device, WrpWindow& window, VkSampleCountFlagBits msaaSampleCount,
+    std::shared_ptr<WrpSwapChain> previous)
+    : msaaSampleCount{msaaSampleCount}, wrpDevice{device}, wrpWindow{&window}, oldSwapChain{previous}
 {
     init();
 
@@ -25,6 +32,12 @@ WrpSwapChain::WrpSwapChain(WrpDevice& device, WrpWindow& window, std::shared_ptr
     oldSwapChain = nullptr; // get rid of oldSwapChain pointer after SwapChain creation
 }
 
+WrpSwapChain::WrpSwapChain(WrpDevice& device, VkExtent2D extent, VkSampleCountFlagBits msaaSampleCount)
+    : swapChainExtent{extent}, msaaSampleCount{msaaSampleCount}, wrpDevice{device}, wrpWindow{nullptr}
+{
+    init();
+}
+
 WrpSwapChain::~WrpSwapChain()
 {
     for (auto imageView : swapChainImageViews) {
@@ -37,6 +50,16 @@ WrpSwapChain::~WrpSwapChain()
         swapChain = nullptr;
     }
 
+    // изображения внеэкранной цепи принадлежат ей самой
+    for (size_t i = 0; i < offscreenImageMemories.size(); i++) {
+        vkDestroyImage(wrpDevice.device(), swapChainImages[i], nullptr);
+        vkFreeMemory(wrpDevice.device(), offscreenImageMemories[i], nullptr);
+    }
+    if (!readbackCommandBuffers.empty()) {
+        vkFreeCommandBuffers(wrpDevice.device(), wrpDevice.getCommandPool(),
+            static_cast<uint32_t>(readbackCommandBuffers.size()), readbackCommandBuffers.data());
+    }
+
     vkDestroyImageView(wrpDevice.device(), colorImageView, nullptr);
     vkDestroyImage(wrpDevice.device(), colorImage, nullptr);
     vkFreeMemory(wrpDevice.device(), colorImageMemory, nullptr);
@@ -63,14 +86,18 @@ WrpSwapChain::~WrpSwapChain()
 
 void WrpSwapChain::init()
 {
-    msaaSampleCount = wrpDevice.getMaxUsableMSAASampleCount(); // used in multiple structs
-    createSwapChain();
+    if (wrpWindow != nullptr)
+        createSwapChain();
+    else
+        createOffscreenImages();
     createImageViews();      // creating VkImageView representations for SwapChain images
     createColorResources();  // создание изображений цвета для реализации мультисэмплинга
     createDepthResources();  // создание изображений для Depth Buffer вложения
     createRenderPass();      // subpass с его привязками и дальнейшее создание RenderPassa'а
     createFramebuffers();
     createSyncObjects();
+    if (wrpWindow == nullptr)
+        createReadbackResources();
 }
 
 void WrpSwapChain::createSwapChain()
@@ -138,6 +165,146 @@ void WrpSwapChain::createSwapChain()
     swapChainExtent = extent;
 }
 
+// Изображения кадров внеэкранной цепи: sRGB формат, как у поверхности, и копирование в буфер вместо показа
+void WrpSwapChain::createOffscreenImages()
+{
+    imageCount = OFFSCREEN_IMAGE_COUNT;
+    swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    std::cout << "Number of offscreen frame images: " << imageCount << " (" << swapChainExtent.width << "x"
+        << swapChainExtent.height << ", no window)" << std::endl;
+
+    swapChainImages.resize(imageCount);
+    offscreenImageMemories.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        wrpDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i],
+            offscreenImageMemories[i]);
+    }
+}
+
+// Буфер для чтения на CPU и копирование в него для каждого изображения внеэкранной цепи. Копирование записано
+// один раз и отправляется вместе с буфером команд кадра, после fence'а кадра пиксели лежат в буфере
+void WrpSwapChain::createReadbackResources()
+{
+    const VkDeviceSize imageSize = VkDeviceSize{swapChainExtent.width} * swapChainExtent.height * 4;
+
+    readbackCommandBuffers.resize(imageCount);
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = wrpDevice.getCommandPool();
+    allocInfo.commandBufferCount = imageCount;
+    if (vkAllocateCommandBuffers(wrpDevice.device(), &allocInfo, readbackCommandBuffers.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate readback command buffers!");
+    }
+
+    readbackBuffers.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        readbackBuffers[i] = std::make_unique<WrpBuffer>(
+            wrpDevice,
+            imageSize,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        readbackBuffers[i]->map();
+
+        VkCommandBuffer commandBuffer = readbackCommandBuffers[i];
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to begin recording readback command buffer!");
+        }
+
+        // Проход swapchain'а оставляет изображение в схеме для копирования, осталось дождаться записи в него.
+        // Переход в конечную схему упорядочен внешней зависимостью прохода (dependencies[1]) со второй областью
+        // FRAGMENT_SHADER, поэтому этот этап входит в первую область барьера: так копирование попадает
+        // в одну цепочку зависимостей с переходом
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = swapChainImages[i];
+        imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &imageBarrier);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;   // строки плотно упакованы
+        region.bufferImageHeight = 0;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            readbackBuffers[i]->getBuffer(), 1, &region);
+
+        // видимость скопированных данных для чтения на CPU после fence'а
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = readbackBuffers[i]->getBuffer();
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            0, nullptr,
+            1, &bufferBarrier,
+            0, nullptr);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record readback command buffer!");
+        }
+    }
+}
+
+void WrpSwapChain::readImage(uint32_t imageIndex, std::vector<uint8_t>& rgba)
+{
+    if (wrpWindow != nullptr)
+    {
+        throw std::runtime_error("Only offscreen swap chain images can be read back!");
+    }
+    if (imagesInFlight[imageIndex] == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("Offscreen swap chain image has not been rendered yet!");
+    }
+
+    vkWaitForFences(wrpDevice.device(), 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    const auto* pixels = static_cast<const uint8_t*>(readbackBuffers[imageIndex]->getMappedMemory());
+    rgba.assign(pixels, pixels + readbackBuffers[imageIndex]->getBufferSize());
+}
+
 void WrpSwapChain::createImageViews()
 {
     swapChainImageViews.resize(swapChainImages.size());
@@ -168,6 +335,10 @@ void WrpSwapChain::createImageViews()
 // Создание изображений цвета для их использования в ходе мультисемплирования
 void WrpSwapChain::createColorResources()
 {
+    // без MSAA цвет пишется прямо в изображения цепи обмена
+    if (msaaSampleCount == VK_SAMPLE_COUNT_1_BIT)
+        return;
+
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -305,7 +476,7 @@ void WrpSwapChain::createRenderPass()
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachmentResolve.finalLayout = presentLayout();
 
     // Ссылка на привязку с индексом 2 (ColorResolveBuffer)
     VkAttachmentReference colorAttachmentResolveRef{};
@@ -320,22 +491,17 @@ void WrpSwapChain::createRenderPass()
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
     subpass.pResolveAttachments = &colorAttachmentResolveRef;   // this is enough for subpass to define a resolve operation
 
-    // Subpass dependencies are specifying transition properties between subpasses.
-    // Even if we have only one subpass we need to describe dependency from implicit external subpass.
-    // This dependency will prevent the image transition between subpasses from happening until we actually want to write to it.
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL; // implicit subpass which denote subpass from a previous/next renderpass
-    dependency.dstSubpass = 0;                   // 0 means our subpass
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;   // stages that needs to complete on the srcSubpass before moving to dstSubpass 
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;   // stages to wait on the dstSubpass untill srcSubpass is busy with srcStageMask
-    dependency.srcAccessMask = 0;                     // bitmask for memory access types used by srcSubpass 
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT; // memory access types to use in dstSubpass 
+    const std::array<VkSubpassDependency, 2> dependencies = renderPassDependencies();
 
     // указанные в reference'ах индексы вложений относятся именно к этому массиву
-    std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
+    std::vector<VkAttachmentDescription> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
+    if (msaaSampleCount == VK_SAMPLE_COUNT_1_BIT)
+    {
+        // без MSAA разрешать нечего: вложение цвета - само изображение цепи обмена
+        colorAttachment.finalLayout = presentLayout();
+        attachments = {colorAttachment, depthAttachment};
+        subpass.pResolveAttachments = nullptr;
+    }
 
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -343,8 +509,8 @@ void WrpSwapChain::createRenderPass()
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(wrpDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
     {
@@ -352,6 +518,40 @@ void WrpSwapChain::createRenderPass()
     }
 }
 
+VkImageLayout WrpSwapChain::presentLayout() const
+{
+    // без VK_KHR_swapchain схема PRESENT_SRC недоступна
+    return wrpWindow != nullptr ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+std::array<VkSubpassDependency, 2> WrpSwapChain::renderPassDependencies()
+{
+    std::array<VkSubpassDependency, 2> dependencies{};
+    // Subpass dependencies are specifying transition properties between subpasses.
+    // Even if we have only one subpass we need to describe dependency from implicit external subpass.
+    // This dependency will prevent the image transition between subpasses from happening until we actually want to write to it.
+    VkSubpassDependency& dependency = dependencies[0];
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL; // implicit subpass which denote subpass from a previous/next renderpass
+    dependency.dstSubpass = 0;                   // 0 means our subpass
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;   // stages that needs to complete on the srcSubpass before moving to dstSubpass 
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;   // stages to wait on the dstSubpass untill srcSubpass is busy with srcStageMask
+    dependency.srcAccessMask = 0;                     // bitmask for memory access types used by srcSubpass 
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT; // memory access types to use in dstSubpass 
+
+    // Чтение разрешённого цвета фрагментным шейдером после прохода. Swapchain'у она не нужна, но проход
+    // внеэкранной цели (WrpDynamicResolution) должен совпадать с ним, чтобы оставаться совместимым с пайплайнами систем.
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    return dependencies;
+}
+
 void WrpSwapChain::createFramebuffers()
 {
     swapChainFramebuffers.resize(imageCount);
@@ -361,7 +561,9 @@ void WrpSwapChain::createFramebuffers()
     {
         // swapChainImageViews для colorAttachment'ов, depthImageViews для depthAttachment'ов
         // данные ImageViews будут связываться с соответствующими VkAttachmentReference'ами сабпасса
-        std::array<VkImageView, 3> attachments = {colorImageView, depthImageViews[i], swapChainImageViews[i]};
+        std::vector<VkImageView> attachments = {colorImageView, depthImageViews[i], swapChainImageViews[i]};
+        if (msaaSampleCount == VK_SAMPLE_COUNT_1_BIT)
+            attachments = {swapChainImageViews[i], depthImageViews[i]};
 
         VkExtent2D swapChainExtent = getSwapChainExtent();
         // Указывая RenderPass для фреймбуфера, мы говорим, что данный буфер кадра должен быть с ним совместим,
@@ -416,6 +618,13 @@ VkResult WrpSwapChain::acquireNextImage(uint32_t* imageIndex)
         VK_TRUE,
         std::numeric_limits<uint64_t>::max()); // big timeout number to wait till end
 
+    // изображения внеэкранной цепи используются по кругу: изображение кадра свободно, как только пройден его fence
+    if (wrpWindow == nullptr)
+    {
+        *imageIndex = static_cast<uint32_t>(currentFrame);
+        return VK_SUCCESS;
+    }
+
     VkResult result = vkAcquireNextImageKHR(
         wrpDevice.device(),
         swapChain,
@@ -456,6 +665,23 @@ VkResult WrpSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint
     // Resetting N'th frame fence for further successful waiting
     vkResetFences(wrpDevice.device(), 1, &inFlightFences[currentFrame]);
 
+    // Без окна семафоров и показа нет: кадр отправляется вместе с копированием его изображения в буфер для чтения
+    if (wrpWindow == nullptr)
+    {
+        std::array<VkCommandBuffer, 2> commandBuffers{buffers[0], readbackCommandBuffers[*imageIndex]};
+        submitInfo.waitSemaphoreCount = 0;
+        submitInfo.signalSemaphoreCount = 0;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        if (vkQueueSubmit(wrpDevice.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit draw command buffer!");
+        }
+
+        currentFrame = (currentFrame + 1) % imageCount;
+        return VK_SUCCESS;
+    }
+
     // Command buffer is submitting to graphics queue.
     // The passed fence will be signaled once command buffer(s) has finished execution.
     if (vkQueueSubmit(wrpDevice.graphicsQueue(), 1, &submitInfo,
@@ -534,7 +760,7 @@ VkExtent2D WrpSwapChain::chooseSwapChainExtent(const VkSurfaceCapabilitiesKHR& c
     else
     {
         int width, height;
-        glfwGetFramebufferSize(wrpWindow.getGLFWwindow(), &width, &height);
+        glfwGetFramebufferSize(wrpWindow->getGLFWwindow(), &width, &height);
 
         VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
         actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
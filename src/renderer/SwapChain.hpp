@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Device.hpp"
+#include "Buffer.hpp"
 
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -9,8 +11,14 @@
 class WrpSwapChain
 {
 public:
-    WrpSwapChain(WrpDevice& device, WrpWindow& window);
-    WrpSwapChain(WrpDevice& device, WrpWindow& window, std::shared_ptr<WrpSwapChain> previous);
+    // msaaSampleCount - число выборок вложений цвета и глубины, с VK_SAMPLE_COUNT_1_BIT кадр рисуется прямо
+    // в изображение цепи обмена без разрешающего вложения
+    WrpSwapChain(WrpDevice& device, WrpWindow& window, VkSampleCountFlagBits msaaSampleCount);
+    WrpSwapChain(WrpDevice& device, WrpWindow& window, VkSampleCountFlagBits msaaSampleCount,
+        std::shared_ptr<WrpSwapChain> previous);
+    // Внеэкранная цепь для устройства без окна (WrpDevice::isHeadless): кадры размером extent рисуются в собственные
+    // изображения RGBA8 sRGB, которые вместо показа копируются в буферы для чтения на CPU (readImage)
+    WrpSwapChain(WrpDevice& device, VkExtent2D extent, VkSampleCountFlagBits msaaSampleCount);
     ~WrpSwapChain();
 
     WrpSwapChain(const WrpSwapChain&) = delete;
@@ -21,6 +29,7 @@ public:
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t getImageCount() { return imageCount; }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+    VkSampleCountFlagBits getMsaaSampleCount() { return msaaSampleCount; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
@@ -30,9 +39,14 @@ public:
         return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
     }
     VkFormat findDepthFormat();
+    // Зависимости прохода swapchain'а, их же использует совместимый с ним проход WrpDynamicResolution
+    static std::array<VkSubpassDependency, 2> renderPassDependencies();
 
     VkResult acquireNextImage(uint32_t* imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+    // Только внеэкранная цепь: дожидается кадра, отрисованного в изображение imageIndex, и копирует его пиксели
+    // (RGBA8 sRGB, строки сверху вниз без выравнивания)
+    void readImage(uint32_t imageIndex, std::vector<uint8_t>& rgba);
 
     bool compareSwapChainFormats(const WrpSwapChain& swapChain) const
     {
@@ -48,6 +62,10 @@ private:
     void createRenderPass();
     void createFramebuffers();
     void createSyncObjects();
+    void createOffscreenImages();
+    void createReadbackResources();
+    // итоговая схема изображения кадра: для показа или, без окна, для копирования в буфер
+    VkImageLayout presentLayout() const;
 
     // Helper functions that looks for necessary details for swap chain creation
     VkSurfaceFormatKHR chooseSwapChainSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -61,10 +79,10 @@ private:
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
 
-    // color buffer used for multisampling
-    VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
-    VkImageView colorImageView;
+    // color buffer used for multisampling (not created without MSAA)
+    VkImage colorImage = VK_NULL_HANDLE;
+    VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+    VkImageView colorImageView = VK_NULL_HANDLE;
     VkSampleCountFlagBits msaaSampleCount;
 
     std::vector<VkImage> depthImages;
@@ -75,9 +93,9 @@ private:
     std::vector<VkImageView> swapChainImageViews;
 
     WrpDevice& wrpDevice;
-    WrpWindow& wrpWindow;
+    WrpWindow* wrpWindow; // nullptr - внеэкранная цепь
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::shared_ptr<WrpSwapChain> oldSwapChain;
 
     uint32_t imageCount = 0; // also defines count of frame buffers and command buffers
@@ -86,4 +104,9 @@ private:
     std::vector<VkFence> inFlightFences; // fences to control command buffer recording (only after successful execution in the queue)
     std::vector<VkFence> imagesInFlight;
     size_t currentFrame = 0;
+
+    // внеэкранная цепь: память изображений кадров, буферы для чтения и заранее записанные копирования в них
+    std::vector<VkDeviceMemory> offscreenImageMemories;
+    std::vector<std::unique_ptr<WrpBuffer>> readbackBuffers;
+    std::vector<VkCommandBuffer> readbackCommandBuffers;
 };
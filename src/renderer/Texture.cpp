@@ -1,5 +1,6 @@
 #include "Texture.hpp"
 #include "Buffer.hpp"
+#include "RenderGraph.hpp"
 
 // libs
 #define STB_IMAGE_IMPLEMENTATION
@@ -130,34 +131,16 @@ void WrpTexture::transitionImageLayout(VkImage image, VkFormat format,
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = layerCount;
 
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    // setting up pipeline barrier options
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0;								// operations with the resource to happen before the barrier 
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;   // ops w/ the resource to wait on the barrier
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;		// on which stage to perform initial ops 
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;		// on which stage target ops need to wait
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else
-    {
-        throw std::invalid_argument("Unsupported layout transition!");
-    }
+    // stages and access masks typical for each layout: operations with the resource to happen before
+    // the barrier (old layout) and ops w/ the resource to wait on the barrier (new layout)
+    const WrpRenderGraph::ImageAccess source = WrpRenderGraph::layoutAccess(oldLayout);
+    const WrpRenderGraph::ImageAccess destination = WrpRenderGraph::layoutAccess(newLayout);
+    barrier.srcAccessMask = source.access;
+    barrier.dstAccessMask = destination.access;
 
     vkCmdPipelineBarrier(
         commandBuffer,
-        sourceStage, destinationStage,
+        source.stages, destination.stages,
         0,
         0, nullptr,	  // MemoryBarriers
         0, nullptr,   // BufferMemoryBarriers
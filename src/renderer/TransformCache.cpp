@@ -0,0 +1,396 @@
+#include "TransformCache.hpp"
+#include "Culling.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WRP_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr WrpBoundingSphere EMPTY_SPHERE{glm::vec3{0.f}, -1.f};
+
+#ifdef WRP_TRANSFORM_SSE
+    // sin и cos четырёх углов: приведение к [-pi/4, pi/4] по квадрантам (pi/2 разбито на три части
+    // по методу Коди-Уэйта) и минимаксные многочлены Cephes. Погрешность ~1e-7 для |x| < 8192.
+    void sinCos4(__m128 x, __m128& outSin, __m128& outCos)
+    {
+        const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772367581f))); // x * 2/pi
+        const __m128 q = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(1.5703125f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(4.837512969970703125e-4f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(7.54978995489188216e-8f)));
+        const __m128 r2 = _mm_mul_ps(r, r);
+
+        __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+        s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+        __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+        c = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, r2), r2), _mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(r2, _mm_set1_ps(.5f))));
+
+        // в нечётных квадрантах sin и cos меняются местами, знак sin меняется в квадрантах 2 и 3, cos - в 1 и 2
+        const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+        const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+            _mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+        outSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+        outCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+    }
+
+    // Столбец матрицы для 4 объектов: SoA строки (x, y, z, w) -> 4 vec4 (по одному на объект)
+    void storeColumns(__m128 x, __m128 y, __m128 z, __m128 w, glm::vec4* out0, glm::vec4* out1, glm::vec4* out2, glm::vec4* out3)
+    {
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(&out0->x, x);
+        _mm_storeu_ps(&out1->x, y);
+        _mm_storeu_ps(&out2->x, z);
+        _mm_storeu_ps(&out3->x, w);
+    }
+#endif
+}
+
+void WrpTransformCache::computeMatrices(const TransformComponent* const* transforms, size_t count,
+    glm::mat4* outModel, glm::mat3x4* outNormal)
+{
+    size_t i = 0;
+#ifdef WRP_TRANSFORM_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        const TransformComponent* const* t = transforms + i;
+        auto load = [t](float glm::vec3::* component, const glm::vec3 TransformComponent::* field) {
+            return _mm_setr_ps((t[0]->*field).*component, (t[1]->*field).*component,
+                (t[2]->*field).*component, (t[3]->*field).*component);
+        };
+
+        // YXZ углы Эйлера, как в TransformComponent::modelMatrix
+        __m128 s1, c1, s2, c2, s3, c3;
+        sinCos4(load(&glm::vec3::y, &TransformComponent::rotation), s1, c1);
+        sinCos4(load(&glm::vec3::x, &TransformComponent::rotation), s2, c2);
+        sinCos4(load(&glm::vec3::z, &TransformComponent::rotation), s3, c3);
+
+        const __m128 s1s2 = _mm_mul_ps(s1, s2);
+        const __m128 c1s2 = _mm_mul_ps(c1, s2);
+        const __m128 r00 = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+        const __m128 r01 = _mm_mul_ps(c2, s3);
+        const __m128 r02 = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+        const __m128 r10 = _mm_sub_ps(_mm_mul_ps(s1s2, c3), _mm_mul_ps(c1, s3));
+        const __m128 r11 = _mm_mul_ps(c2, c3);
+        const __m128 r12 = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+        const __m128 r20 = _mm_mul_ps(c2, s1);
+        const __m128 r21 = _mm_sub_ps(_mm_setzero_ps(), s2);
+        const __m128 r22 = _mm_mul_ps(c1, c2);
+
+        const __m128 scaleX = load(&glm::vec3::x, &TransformComponent::scale);
+        const __m128 scaleY = load(&glm::vec3::y, &TransformComponent::scale);
+        const __m128 scaleZ = load(&glm::vec3::z, &TransformComponent::scale);
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 invScaleX = _mm_div_ps(one, scaleX);
+        const __m128 invScaleY = _mm_div_ps(one, scaleY);
+        const __m128 invScaleZ = _mm_div_ps(one, scaleZ);
+
+        glm::mat4* m = outModel + i;
+        storeColumns(_mm_mul_ps(scaleX, r00), _mm_mul_ps(scaleX, r01), _mm_mul_ps(scaleX, r02), zero,
+            &m[0][0], &m[1][0], &m[2][0], &m[3][0]);
+        storeColumns(_mm_mul_ps(scaleY, r10), _mm_mul_ps(scaleY, r11), _mm_mul_ps(scaleY, r12), zero,
+            &m[0][1], &m[1][1], &m[2][1], &m[3][1]);
+        storeColumns(_mm_mul_ps(scaleZ, r20), _mm_mul_ps(scaleZ, r21), _mm_mul_ps(scaleZ, r22), zero,
+            &m[0][2], &m[1][2], &m[2][2], &m[3][2]);
+        storeColumns(load(&glm::vec3::x, &TransformComponent::translation), load(&glm::vec3::y, &TransformComponent::translation),
+            load(&glm::vec3::z, &TransformComponent::translation), one,
+            &m[0][3], &m[1][3], &m[2][3], &m[3][3]);
+
+        glm::mat3x4* n = outNormal + i;
+        storeColumns(_mm_mul_ps(invScaleX, r00), _mm_mul_ps(invScaleX, r01), _mm_mul_ps(invScaleX, r02), zero,
+            &n[0][0], &n[1][0], &n[2][0], &n[3][0]);
+        storeColumns(_mm_mul_ps(invScaleY, r10), _mm_mul_ps(invScaleY, r11), _mm_mul_ps(invScaleY, r12), zero,
+            &n[0][1], &n[1][1], &n[2][1], &n[3][1]);
+        storeColumns(_mm_mul_ps(invScaleZ, r20), _mm_mul_ps(invScaleZ, r21), _mm_mul_ps(invScaleZ, r22), zero,
+            &n[0][2], &n[1][2], &n[2][2], &n[3][2]);
+    }
+#endif
+    // хвост пачки (или всё без SSE)
+    for (; i < count; i++)
+    {
+        // методы TransformComponent не константные, но состояние не меняют
+        auto& transform = const_cast<TransformComponent&>(*transforms[i]);
+        outModel[i] = transform.modelMatrix();
+        outNormal[i] = glm::mat3x4(transform.normalMatrix());
+    }
+}
+
+uint32_t WrpTransformCache::allocateSlot(SceneObject::id_t id)
+{
+    orderDirty = true;
+    uint32_t slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(localModels.size());
+        localModels.emplace_back(1.f);
+        localNormals.emplace_back(1.f);
+        worldModels.emplace_back(1.f);
+        worldNormals.emplace_back(1.f);
+        localSpheres.push_back(EMPTY_SPHERE);
+        worldSpheres.push_back(EMPTY_SPHERE);
+        localBoxes.emplace_back();
+        bvhProxies.push_back(WrpBvh::NO_PROXY);
+        slotModels.push_back(nullptr);
+        slotIds.push_back(id);
+        slotParentIds.push_back(SceneObject::NO_PARENT);
+        parentSlots.push_back(NO_SLOT);
+        slotPositions.push_back(0);
+        slotAlive.push_back(0);
+    }
+    slotAlive[slot] = 1;
+    slotIds[slot] = id;
+    slotParentIds[slot] = SceneObject::NO_PARENT;
+    slotModels[slot] = nullptr;
+    localSpheres[slot] = EMPTY_SPHERE;
+    localBoxes[slot] = WrpAabb{};
+    return slot;
+}
+
+void WrpTransformCache::releaseSlot(uint32_t slot)
+{
+    orderDirty = true;
+    slotAlive[slot] = 0;
+    slotModels[slot] = nullptr;
+    if (bvhProxies[slot] != WrpBvh::NO_PROXY)
+    {
+        bvh.remove(bvhProxies[slot]);
+        bvhProxies[slot] = WrpBvh::NO_PROXY;
+    }
+    freeSlots.push_back(slot);
+}
+
+void WrpTransformCache::update(WrpScene& sceneObjects)
+{
+    dirtyTransforms.clear();
+    dirtySlots.clear();
+
+    for (uint32_t slot : sceneObjects.releasedSlots)
+        releaseSlot(slot);
+    sceneObjects.releasedSlots.clear();
+
+    // Обходятся только объекты из списка изменённых сцены (сеттеры TransformComponent, markDirty,
+    // SceneObject::setParent, WrpScene::add и setModel), а не вся сцена
+    for (SceneObject::id_t id : sceneObjects.dirtyObjects)
+    {
+        auto it = sceneObjects.find(id);
+        if (it == sceneObjects.end()) continue; // объект удалён после изменения
+        SceneObject& obj = it->second;
+        TransformComponent& transform = obj.transform;
+        if (!transform.dirty) continue;
+        transform.dirty = false;
+        if (transform.cacheSlot == NO_SLOT)
+            transform.cacheSlot = allocateSlot(id);
+        const uint32_t slot = transform.cacheSlot;
+
+        if (slotParentIds[slot] != obj.getParentId())
+        {
+            slotParentIds[slot] = obj.getParentId();
+            orderDirty = true;
+        }
+        const WrpModel* model = sceneObjects.findModel(id);
+        if (slotModels[slot] != model)
+        {
+            slotModels[slot] = model;
+            localSpheres[slot] = model != nullptr ? model->getBoundingSphere() : EMPTY_SPHERE;
+            localBoxes[slot] = model != nullptr ? model->getBounds() : WrpAabb{};
+        }
+        dirtyTransforms.push_back(&transform);
+        dirtySlots.push_back(slot);
+    }
+    sceneObjects.dirtyObjects.clear();
+
+    // Слоты изменённых объектов идут вразнобой, поэтому пачка считается в плотные буферы и затем раскладывается
+    const size_t dirtyCount = dirtyTransforms.size();
+    modelScratch.resize(dirtyCount);
+    normalScratch.resize(dirtyCount);
+    computeMatrices(dirtyTransforms.data(), dirtyCount, modelScratch.data(), normalScratch.data());
+    for (size_t i = 0; i < dirtyCount; i++)
+    {
+        localModels[dirtySlots[i]] = modelScratch[i];
+        localNormals[dirtySlots[i]] = normalScratch[i];
+    }
+
+    updatedCount = 0;
+    if (orderDirty)
+    {
+        // после изменения структуры иерархии мировые матрицы пересчитываются целиком
+        rebuildOrder();
+        orderDirty = false;
+        updateWorldRange(0, static_cast<uint32_t>(order.size()));
+    }
+    else
+    {
+        // Изменённый узел пересчитывается вместе со всем своим поддеревом (непрерывный диапазон порядка обхода),
+        // узлы внутри уже пересчитанного диапазона пропускаются
+        dirtyPositions.clear();
+        for (uint32_t slot : dirtySlots)
+            dirtyPositions.push_back(slotPositions[slot]);
+        std::sort(dirtyPositions.begin(), dirtyPositions.end());
+
+        uint32_t rangeEnd = 0;
+        for (uint32_t position : dirtyPositions)
+        {
+            if (position < rangeEnd) continue;
+            rangeEnd = position + subtreeSizes[position];
+            updateWorldRange(position, rangeEnd);
+        }
+    }
+    bvh.maintain();
+}
+
+void WrpTransformCache::rebuildOrder()
+{
+    const uint32_t slotCount = static_cast<uint32_t>(slotAlive.size());
+    idToSlot.clear();
+    uint32_t liveCount = 0;
+    for (uint32_t slot = 0; slot < slotCount; slot++)
+    {
+        if (!slotAlive[slot]) continue;
+        idToSlot[slotIds[slot]] = slot;
+        liveCount++;
+    }
+
+    // родитель, которого нет в сцене, не учитывается: объект становится корнем
+    childOffsets.assign(slotCount + 1, 0);
+    for (uint32_t slot = 0; slot < slotCount; slot++)
+    {
+        parentSlots[slot] = NO_SLOT;
+        if (!slotAlive[slot] || slotParentIds[slot] == SceneObject::NO_PARENT) continue;
+        auto it = idToSlot.find(slotParentIds[slot]);
+        if (it == idToSlot.end()) continue;
+        parentSlots[slot] = it->second;
+        childOffsets[it->second + 1]++;
+    }
+    for (uint32_t slot = 0; slot < slotCount; slot++)
+        childOffsets[slot + 1] += childOffsets[slot];
+    children.resize(childOffsets[slotCount]);
+    {
+        std::vector<uint32_t> cursor(childOffsets.begin(), childOffsets.end() - 1);
+        for (uint32_t slot = 0; slot < slotCount; slot++)
+        {
+            if (parentSlots[slot] != NO_SLOT)
+                children[cursor[parentSlots[slot]]++] = slot;
+        }
+    }
+
+    // Прямой обход в глубину от корней: родитель раньше детей, поддерево - непрерывный диапазон.
+    // Узлы цикла недостижимы из корней, поэтому цикл обнаруживается по количеству посещённых узлов.
+    order.clear();
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < slotCount; root++)
+    {
+        if (!slotAlive[root] || parentSlots[root] != NO_SLOT) continue;
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const uint32_t slot = stack.back();
+            stack.pop_back();
+            order.push_back(slot);
+            for (uint32_t c = childOffsets[slot + 1]; c > childOffsets[slot]; c--)
+                stack.push_back(children[c - 1]);
+        }
+    }
+    if (order.size() != liveCount)
+    {
+        orderDirty = true;
+        throw std::runtime_error("scene hierarchy contains a cycle");
+    }
+
+    subtreeSizes.assign(order.size(), 1);
+    for (uint32_t position = 0; position < order.size(); position++)
+        slotPositions[order[position]] = position;
+    for (uint32_t position = static_cast<uint32_t>(order.size()); position-- > 0;)
+    {
+        const uint32_t parent = parentSlots[order[position]];
+        if (parent != NO_SLOT)
+            subtreeSizes[slotPositions[parent]] += subtreeSizes[position];
+    }
+}
+
+void WrpTransformCache::updateWorldRange(uint32_t first, uint32_t end)
+{
+    for (uint32_t position = first; position < end; position++)
+    {
+        const uint32_t slot = order[position];
+        const uint32_t parent = parentSlots[slot];
+        if (parent == NO_SLOT)
+        {
+            worldModels[slot] = localModels[slot];
+            worldNormals[slot] = localNormals[slot];
+        }
+        else
+        {
+            // родитель стоит раньше в порядке обхода, поэтому его мировые матрицы уже актуальны.
+            // Матрица нормали композиции равна произведению матриц нормали: (P * L)^-T = P^-T * L^-T
+            worldModels[slot] = worldModels[parent] * localModels[slot];
+            worldNormals[slot] = glm::mat3x4(glm::mat3(worldNormals[parent]) * glm::mat3(localNormals[slot]));
+        }
+        worldSpheres[slot] = slotModels[slot] != nullptr
+            ? WrpFrustumCuller::transformSphere(worldModels[slot], localSpheres[slot])
+            : EMPTY_SPHERE;
+        updateSpatialIndex(slot);
+    }
+    updatedCount += end - first;
+}
+
+void WrpTransformCache::updateSpatialIndex(uint32_t slot)
+{
+    uint32_t& proxy = bvhProxies[slot];
+    if (slotModels[slot] == nullptr || !localBoxes[slot].isValid())
+    {
+        if (proxy != WrpBvh::NO_PROXY)
+        {
+            bvh.remove(proxy);
+            proxy = WrpBvh::NO_PROXY;
+        }
+        return;
+    }
+
+    const WrpAabb worldBox = localBoxes[slot].transformed(worldModels[slot]);
+    if (proxy == WrpBvh::NO_PROXY)
+        proxy = bvh.insert(worldBox, slot);
+    else
+        bvh.move(proxy, worldBox);
+}
+
+bool WrpTransformCache::raycast(const glm::vec3& origin, const glm::vec3& direction,
+    SceneObject::id_t& outId, float& outDistance) const
+{
+    // бокс прокси - грубая проверка, точнее попадание определяется по мировой сфере
+    auto hitSphere = [this, &origin, &direction](uint32_t slot, float maxDistance) {
+        const WrpBoundingSphere& sphere = worldSpheres[slot];
+        const glm::vec3 offset = origin - sphere.center;
+        const float a = glm::dot(direction, direction);
+        const float b = glm::dot(offset, direction);
+        const float c = glm::dot(offset, offset) - sphere.radius * sphere.radius;
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.f) return -1.f;
+        const float root = std::sqrt(discriminant);
+        float distance = (-b - root) / a;
+        if (distance < 0.f) distance = (-b + root) / a < 0.f ? -1.f : 0.f; // луч выходит из сферы
+        return distance <= maxDistance ? distance : -1.f;
+    };
+
+    uint32_t slot;
+    if (!bvh.raycast(origin, direction, std::numeric_limits<float>::max(), slot, outDistance, hitSphere))
+        return false;
+    outId = slotIds[slot];
+    return true;
+}
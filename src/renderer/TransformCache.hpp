@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Bounds.hpp"
+#include "Bvh.hpp"
+#include "Scene.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Кэш матриц мирового пространства объектов сцены с учётом иерархии (SceneObject::setParent).
+ * Данные лежат в непрерывных массивах по слотам (слот на объект), а порядок обхода - плоский массив узлов
+ * в прямом порядке обхода в глубину: родитель идёт раньше детей, и каждое поддерево занимает непрерывный диапазон.
+ * Локальные матрицы пересчитываются только для преобразований, помеченных как изменённые (сеттеры
+ * TransformComponent или markDirty), пачками по 4 штуки SIMD-инструкциями (SSE, включая sin/cos),
+ * а мировые - только в поддеревьях изменённых узлов. Изменённые объекты и слоты удалённых кэш берёт из списков
+ * WrpScene, поэтому кадр без изменений не обходит сцену. Порядок обхода перестраивается лишь при изменении
+ * состава сцены или связей родитель-потомок.
+ * Мировые AABB объектов с моделями поддерживаются в динамической BVH (WrpBvh) для отсечения, выбора лучом
+ * и других пространственных запросов: прокси обновляются только для пересчитанных слотов.
+ * Матрица нормали хранится как 3x4 (три столбца vec4), что совпадает с раскладкой mat3 в std430.
+ */
+class WrpTransformCache
+{
+public:
+    // Пересчёт изменённых преобразований, вызывается раз в кадр до отсечения и сборки списков отрисовки.
+    // Слоты удалённых из сцены объектов освобождаются. Цикл в иерархии - исключение.
+    void update(WrpScene& sceneObjects);
+
+    const glm::mat4& modelMatrix(const TransformComponent& transform) const { return worldModels[transform.cacheSlot]; }
+    const glm::mat3x4& normalMatrix(const TransformComponent& transform) const { return worldNormals[transform.cacheSlot]; }
+    // ограничивающая сфера модели объекта в мировом пространстве (пустая у объектов без модели)
+    const WrpBoundingSphere& worldSphere(const TransformComponent& transform) const { return worldSpheres[transform.cacheSlot]; }
+
+    // Пространственный индекс по мировым AABB объектов с моделями, пользовательские данные прокси - слоты
+    const WrpBvh& spatialIndex() const { return bvh; }
+    uint32_t slotIndex(const TransformComponent& transform) const { return transform.cacheSlot; }
+    uint32_t getSlotCount() const { return static_cast<uint32_t>(slotAlive.size()); }
+
+    // Ближайший объект с моделью на луче (попадание в мировую ограничивающую сферу), расстояние - в длинах direction
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, SceneObject::id_t& outId, float& outDistance) const;
+
+    // количество мировых матриц, пересчитанных последним update
+    uint32_t getUpdatedCount() const { return updatedCount; }
+
+    // Пересчёт пачки локальных преобразований (с SSE - по 4 за раз), результат пишется в outModel[i] и outNormal[i]
+    static void computeMatrices(const TransformComponent* const* transforms, size_t count,
+        glm::mat4* outModel, glm::mat3x4* outNormal);
+
+private:
+    static constexpr uint32_t NO_SLOT = TransformComponent::NO_CACHE_SLOT;
+
+    uint32_t allocateSlot(SceneObject::id_t id);
+    void releaseSlot(uint32_t slot);
+    void rebuildOrder();
+    void updateWorldRange(uint32_t first, uint32_t end);
+    void updateSpatialIndex(uint32_t slot);
+
+    // данные по слотам
+    std::vector<glm::mat4> localModels;
+    std::vector<glm::mat3x4> localNormals;
+    std::vector<glm::mat4> worldModels;
+    std::vector<glm::mat3x4> worldNormals;
+    std::vector<WrpBoundingSphere> localSpheres;   // сфера модели в её пространстве
+    std::vector<WrpBoundingSphere> worldSpheres;
+    std::vector<WrpAabb> localBoxes;               // бокс модели в её пространстве
+    std::vector<uint32_t> bvhProxies;
+    std::vector<const WrpModel*> slotModels;
+    std::vector<SceneObject::id_t> slotIds;
+    std::vector<SceneObject::id_t> slotParentIds;
+    std::vector<uint32_t> parentSlots;
+    std::vector<uint32_t> slotPositions;           // позиция слота в порядке обхода
+    std::vector<uint8_t> slotAlive;                // слот принадлежит объекту сцены
+    std::vector<uint32_t> freeSlots;
+    uint32_t updatedCount = 0;
+    bool orderDirty = true;
+    WrpBvh bvh;
+
+    // порядок обхода: позиция -> слот и размер поддерева с корнем в этой позиции (включая сам узел)
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> subtreeSizes;
+
+    // буферы текущего update, чтобы не выделять память каждый кадр
+    std::vector<const TransformComponent*> dirtyTransforms;
+    std::vector<uint32_t> dirtySlots;
+    std::vector<uint32_t> dirtyPositions;
+    std::vector<glm::mat4> modelScratch;
+    std::vector<glm::mat3x4> normalScratch;
+    std::unordered_map<SceneObject::id_t, uint32_t> idToSlot;
+    std::vector<uint32_t> childOffsets;
+    std::vector<uint32_t> children;
+};
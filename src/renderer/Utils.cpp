@@ -1,7 +1,11 @@
 #include "Utils.hpp"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <ctime>
+#include <fstream>
+#include <stdexcept>
 
 VkResult createSemaphore(VkDevice device, VkSemaphore* outSemaphore)
 {
@@ -17,3 +21,112 @@ std::string getTimeStampStr()
     std::time_t timeStamp = std::chrono::system_clock::to_time_t(timePoint);
     return std::string(std::ctime(&timeStamp));
 }
+
+namespace
+{
+    void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size)
+    {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                result[i] = c;
+            }
+            return result;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    // Чанк PNG: длина, тип, данные и CRC типа с данными
+    void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+    {
+        appendBigEndian(png, static_cast<uint32_t>(data.size()));
+        const size_t typeOffset = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        appendBigEndian(png, crc32(png.data() + typeOffset, png.size() - typeOffset));
+    }
+
+    // PNG RGB 8 бит, сжатие zlib из несжатых (stored) блоков deflate: кадр для сравнения важнее размера файла
+    std::vector<uint8_t> encodePng(uint32_t width, uint32_t height, const std::vector<uint8_t>& rgba)
+    {
+        // строки с фильтром 0 (None), альфа отбрасывается
+        std::vector<uint8_t> raw;
+        raw.reserve((size_t{width} * 3 + 1) * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            raw.push_back(0);
+            const uint8_t* row = rgba.data() + size_t{y} * width * 4;
+            for (uint32_t x = 0; x < width; x++)
+                raw.insert(raw.end(), row + x * 4, row + x * 4 + 3);
+        }
+
+        std::vector<uint8_t> zlib = {0x78, 0x01};
+        constexpr size_t MAX_STORED_BLOCK = 65535;
+        size_t offset = 0;
+        do
+        {
+            const size_t blockSize = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+            const bool last = offset + blockSize == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(blockSize));
+            zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+            zlib.push_back(static_cast<uint8_t>(~blockSize));
+            zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+            offset += blockSize;
+        } while (offset < raw.size());
+
+        uint32_t a = 1, b = 0; // Adler-32
+        for (uint8_t byte : raw)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(zlib, (b << 16) | a);
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 бит, RGB, deflate, фильтры по строкам, без интерлейса
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        appendChunk(png, "IHDR", header);
+        appendChunk(png, "IDAT", zlib);
+        appendChunk(png, "IEND", {});
+        return png;
+    }
+}
+
+void writeImageFile(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgba)
+{
+    if (rgba.size() < size_t{width} * height * 4)
+    {
+        throw std::runtime_error("Image data is smaller than " + std::to_string(width) + "x" +
+            std::to_string(height) + " RGBA8!");
+    }
+
+    const bool isPng = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+    const std::vector<uint8_t> png = isPng ? encodePng(width, height, rgba) : std::vector<uint8_t>{};
+    const std::vector<uint8_t>& bytes = isPng ? png : rgba;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write image file: " + path);
+    }
+}
@@ -3,8 +3,10 @@
 #include "HeaderCore.hpp"
 
 // std
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <vector>
 
 // from the answer on StackOverflow: https://stackoverflow.com/a/57595105
 template <typename T, typename... Rest>
@@ -17,3 +19,7 @@ void hashCombine(std::size_t& seed, const T& v, const Rest&... rest)
 VkResult createSemaphore(VkDevice device, VkSemaphore* outSemaphore);
 
 std::string getTimeStampStr();
+
+// Сохраняет кадр RGBA8 (строки сверху вниз): в PNG без сжатия, если путь оканчивается на .png, иначе - сырые байты
+// RGBA. При ошибке записи бросает std::runtime_error
+void writeImageFile(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgba);
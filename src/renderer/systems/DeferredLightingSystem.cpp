@@ -0,0 +1,75 @@
+#include "DeferredLightingSystem.hpp"
+
+// std
+#include <array>
+#include <stdexcept>
+
+DeferredLightingSystem::DeferredLightingSystem(WrpDevice& device, WrpRenderer& renderer,
+    VkDescriptorSetLayout globalSetLayout, WrpGBuffer& gBuffer)
+    : wrpDevice{device}, wrpRenderer{renderer}, gBuffer{gBuffer}, pipelineVariants{device, renderer, "DeferredLightingSystem"}
+{
+    createPipelineLayout(globalSetLayout);
+}
+
+DeferredLightingSystem::~DeferredLightingSystem()
+{
+    pipelineVariants.wait(); // фоновые задачи используют pipelineLayout
+    vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
+}
+
+void DeferredLightingSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+{
+    // set 0 - глобальные данные и источники света, set 1 - вложения G-buffer'а
+    std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts{globalSetLayout, gBuffer.getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    if (vkCreatePipelineLayout(wrpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+}
+
+PipelineVariantDesc DeferredLightingSystem::pipelineVariantDesc(const RenderingSettings& renderingSettings) const
+{
+    PipelineVariantDesc desc{};
+    desc.vertShader = "Fullscreen.vert";
+    desc.fragShader = "DeferredLighting.frag";
+    desc.fragDefines = ShaderPermutations::deferredLightingDefines(renderingSettings.reflectionModel);
+    desc.vertexInput = false; // вершины полноэкранного треугольника генерируются в шейдере
+    // шейдер переносит глубину G-buffer'а в проход swapchain'а для последующих прямых отрисовок
+    desc.depthTestEnable = true;
+    desc.depthWriteEnable = true;
+    desc.renderPass = wrpRenderer.getSwapChainRenderPass();
+    desc.samples = wrpRenderer.getMsaaSampleCount();
+    desc.minSampleShading = wrpRenderer.getMinSampleShading();
+    desc.pipelineLayout = pipelineLayout;
+    return desc;
+}
+
+void DeferredLightingSystem::prefetchPipelines(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.prefetch(pipelineVariantDesc(renderingSettings));
+}
+
+void DeferredLightingSystem::reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    pipelineVariants.reloadShaders(shaderWatcher, changedShaders);
+}
+
+void DeferredLightingSystem::render(FrameInfo& frameInfo)
+{
+    pipelineVariants.swapReloadedPipelines();
+    pipelineVariants.get(pipelineVariantDesc(frameInfo.renderingSettings))->bind(frameInfo.commandBuffer);
+
+    std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, gBuffer.getDescriptorSet()};
+    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+        0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+
+    vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+    frameInfo.renderStats.drawCalls++;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Pipeline.hpp"
+#include "../PipelineVariantCache.hpp"
+#include "../Device.hpp"
+#include "../FrameInfo.hpp"
+#include "../Renderer.hpp"
+#include "../ShaderWatcher.hpp"
+#include "../GBuffer.hpp"
+
+// std
+#include <string>
+#include <unordered_set>
+
+/*
+ * Проход освещения отложенного пути: полноэкранный треугольник в проходе swapchain'а читает G-buffer (set 1)
+ * и считает освещение по спискам источников кластеров (set 0). Модель отражения выбирается макросом шейдера,
+ * поэтому варианты пайплайна различаются так же, как у прямых систем рендера.
+ */
+class DeferredLightingSystem
+{
+public:
+    DeferredLightingSystem(WrpDevice& device, WrpRenderer& renderer, VkDescriptorSetLayout globalSetLayout, WrpGBuffer& gBuffer);
+    ~DeferredLightingSystem();
+
+    DeferredLightingSystem(const DeferredLightingSystem&) = delete;
+    DeferredLightingSystem& operator=(const DeferredLightingSystem&) = delete;
+
+    // Запись прохода освещения внутри прохода рендера swapchain'а, после прохода G-buffer'а
+    void render(FrameInfo& frameInfo);
+    // фоновая сборка варианта пайплайна для текущих настроек, чтобы первый кадр не собирал его сам
+    void prefetchPipelines(const RenderingSettings& renderingSettings);
+    // фоновая пересборка пайплайнов, использующих изменённые шейдеры
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
+
+private:
+    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+    PipelineVariantDesc pipelineVariantDesc(const RenderingSettings& renderingSettings) const;
+
+    WrpDevice& wrpDevice;
+    WrpRenderer& wrpRenderer;
+    WrpGBuffer& gBuffer;
+
+    VkPipelineLayout pipelineLayout;
+    // варианты пайплайна по модели отражения, создаются при первом использовании
+    WrpPipelineVariantCache pipelineVariants;
+};
@@ -1,4 +1,6 @@
 #include "PointLightSystem.hpp"
+#include "../Culling.hpp"
+#include "../LightClusters.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS			  // Функции GLM будут работать с радианами, а не градусами
@@ -8,68 +10,118 @@
 
 // std
 #include <stdexcept>
-#include <cassert>
 #include <array>
-#include <map>
+#include <cstring>
+#include <string>
 
-struct PointLightPushConstants
+namespace
 {
-    glm::vec4 position{};
-    glm::vec4 color{};
-    float radius{};
-};
+    // LSD radix sort по старшим 32 битам (ключ расстояния): 4 прохода по байту, устойчивый, O(n).
+    // Проходы, в которых у всех ключей одинаковый байт, пропускаются.
+    void radixSortByHighWord(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+    {
+        const size_t count = keys.size();
+        if (count < 2) return;
+        scratch.resize(count);
+        for (uint32_t shift = 32; shift < 64; shift += 8)
+        {
+            std::array<uint32_t, 256> offsets{};
+            for (uint64_t key : keys)
+                offsets[(key >> shift) & 0xFF]++;
+            if (offsets[(keys[0] >> shift) & 0xFF] == count) continue;
+
+            uint32_t sum = 0;
+            for (auto& offset : offsets)
+            {
+                const uint32_t bucketSize = offset;
+                offset = sum;
+                sum += bucketSize;
+            }
+            for (uint64_t key : keys)
+                scratch[offsets[(key >> shift) & 0xFF]++] = key;
+            keys.swap(scratch);
+        }
+    }
+}
 
-PointLightSystem::PointLightSystem(WrpDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-    : wrpDevice{device}
+PointLightSystem::PointLightSystem(WrpDevice& device, WrpRenderer& renderer, VkDescriptorSetLayout globalSetLayout)
+    : wrpDevice{device}, wrpRenderer{renderer}, pipelineVariants{device, renderer, "PointLightSystem"}
 {
+    createBillboardBuffers();
     createPipelineLayout(globalSetLayout);
-    createPipeline(renderPass);
+    pipelineVariants.prefetch(pipelineVariantDesc());
 }
 
 PointLightSystem::~PointLightSystem()
 {
+    pipelineVariants.wait(); // фоновая задача использует pipelineLayout
     vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
 }
 
-void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+void PointLightSystem::createBillboardBuffers()
 {
-    // описание диапазона пуш-констант
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // доступ к данным констант из обоих шейдеров
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PointLightPushConstants);
+    const uint32_t framesCount = wrpRenderer.getSwapChainImageCount();
+    billboardSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .build();
+    billboardPool = WrpDescriptorPool::Builder(wrpDevice)
+        .setMaxSets(framesCount)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesCount)
+        .build();
+
+    billboardSets.resize(framesCount);
+    for (uint32_t i = 0; i < framesCount; i++)
+    {
+        // HOST_COHERENT: билборды пишутся прямо в отображённую память перед записью команд кадра
+        billboardBuffers.push_back(std::make_unique<WrpBuffer>(
+            wrpDevice,
+            sizeof(Billboard),
+            MAX_BILLBOARDS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        ));
+        billboardBuffers[i]->map();
+
+        VkDescriptorBufferInfo bufferInfo = billboardBuffers[i]->descriptorInfo();
+        if (!WrpDescriptorWriter(*billboardSetLayout, *billboardPool).writeBuffer(0, &bufferInfo).build(billboardSets[i]))
+            throw std::runtime_error("Failed to allocate point light billboards descriptor set!");
+    }
+}
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout}; // вектор используемых схем для наборов дескрипторов
+void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+{
+    // set 0 - глобальный набор, set 1 - билборды кадра
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, billboardSetLayout->getDescriptorSetLayout()};
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
     if (vkCreatePipelineLayout(wrpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create pipeline layout!");
     }
 }
 
-void PointLightSystem::createPipeline(VkRenderPass renderPass)
+PipelineVariantDesc PointLightSystem::pipelineVariantDesc() const
 {
-    assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
-
-    PipelineConfigInfo pipelineConfig{};
-    WrpPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    WrpPipeline::enableAlphaBlending(pipelineConfig);
-    pipelineConfig.bindingDescriptions.clear();   // массивы с привязками и атрибутами буфера вершин очищаем, т.к.
-    pipelineConfig.attributeDescriptions.clear(); // они не нужны в PointLightSystem с билбордами
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-
-    wrpPipeline = std::make_unique<WrpPipeline>(
-        wrpDevice,
-        "PointLight.vert",
-        "PointLight.frag",
-        pipelineConfig);
+    PipelineVariantDesc desc{};
+    desc.vertShader = "PointLight.vert";
+    desc.fragShader = "PointLight.frag";
+    desc.alphaBlending = true;
+    desc.vertexInput = false; // вершины билбордов генерируются в шейдере, буфер вершин не нужен
+    desc.renderPass = wrpRenderer.getSwapChainRenderPass();
+    desc.samples = wrpRenderer.getMsaaSampleCount();
+    desc.minSampleShading = wrpRenderer.getMinSampleShading();
+    desc.pipelineLayout = pipelineLayout;
+    return desc;
+}
+
+void PointLightSystem::reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    pipelineVariants.reloadShaders(shaderWatcher, changedShaders);
 }
 
 void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
@@ -81,78 +133,88 @@ void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
         {0.f, -1.f, 0.f} // ось вращения (y == -1, значит вращение вокруг Up-вектора)
     );
 
-    int lightIndex = 0;
-    for (auto& kv : frameInfo.sceneObjects)
+    // Обходятся только компоненты точечных источников, а не все объекты сцены.
+    // Источники копируются в storage buffer кадра и распределяются по кластерам, число источников не ограничено UBO.
+    frameInfo.lightClusters.beginFrame(frameInfo.frameIndex);
+    for (auto& [id, pointLight] : frameInfo.sceneObjects.pointLights())
     {
-        auto& obj = kv.second;
-        if (obj.pointLight == nullptr) continue;
-
-        assert(lightIndex < MAX_LIGHTS && "Point Lights exceed maximum specified");
+        auto& obj = frameInfo.sceneObjects.at(id);
 
         // обновление позиции PointLight'а в карусели, если она включена
-        if (obj.pointLight->carouselEnabled == true)
-            obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
-
-        // копируем текущие данные об объекте Point Light'а в Ubo структуру
-        ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-        ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+        if (pointLight.carouselEnabled == true)
+            obj.transform.setTranslation(glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f)));
 
-        lightIndex += 1;
+        frameInfo.lightClusters.addLight(obj.transform.translation, obj.color, pointLight.lightIntensity);
     }
 
-    ubo.numLights = lightIndex;
+    frameInfo.lightClusters.assignLights(frameInfo.camera, frameInfo.renderExtent, ubo, frameInfo.renderStats);
 }
 
-void PointLightSystem::render(FrameInfo& frameInfo)
+uint32_t PointLightSystem::writeBillboards(FrameInfo& frameInfo)
 {
-    // Автоматическа сортировка PointLight'ов в мапе по их дистанции до камеры.
-    // Это нужно для поочерёдного порядка их отрисовки, начиная с дальних билбордов,
-    // а затем для их дальнейшего правильного смешивания цветов в ColorBlend этапе.
-    std::map<float, SceneObject::id_t> sorted;
-    for (auto& kv : frameInfo.sceneObjects)
+    billboards.clear();
+    billboardSpheres.clear();
+    for (auto& [id, pointLight] : frameInfo.sceneObjects.pointLights())
     {
-        auto& obj = kv.second;
-        if (obj.pointLight == nullptr) continue;
+        const auto& obj = frameInfo.sceneObjects.at(id);
+        const float radius = obj.transform.scale.x;
+        billboards.push_back({glm::vec4(obj.transform.translation, radius), glm::vec4(obj.color, pointLight.lightIntensity)});
+        billboardSpheres.push_back({obj.transform.translation, radius});
+    }
 
-        // вычисление дистанции до камеры
-        auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
-        float disSquared = glm::dot(offset, offset);
-        sorted[disSquared] = obj.getId();
+    // билборды вне пирамиды видимости не рисуются
+    visibleBillboards.resize(billboards.size());
+    WrpFrustumCuller{frameInfo.camera}.testSpheres(billboardSpheres.data(), billboardSpheres.size(), visibleBillboards.data());
+
+    // Квадрат расстояния неотрицателен, поэтому его биты как uint32 упорядочены так же, как сами числа;
+    // инверсия битов даёт порядок от дальних к ближним при сортировке по возрастанию
+    const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+    sortKeys.clear();
+    for (uint32_t i = 0; i < billboards.size(); i++)
+    {
+        if (!visibleBillboards[i]) continue;
+        const glm::vec3 offset = cameraPosition - glm::vec3(billboards[i].position);
+        const float distanceSquared = glm::dot(offset, offset);
+        uint32_t distanceBits;
+        std::memcpy(&distanceBits, &distanceSquared, sizeof(distanceBits));
+        sortKeys.push_back(static_cast<uint64_t>(~distanceBits) << 32 | i);
     }
+    if (sortKeys.size() > MAX_BILLBOARDS)
+    {
+        throw std::runtime_error("Point light billboard buffer overflow: capacity is " + std::to_string(MAX_BILLBOARDS) + " billboards!");
+    }
+    radixSortByHighWord(sortKeys, sortScratch);
+
+    auto* mapped = static_cast<Billboard*>(billboardBuffers[frameInfo.frameIndex]->getMappedMemory());
+    for (size_t i = 0; i < sortKeys.size(); i++)
+        mapped[i] = billboards[static_cast<uint32_t>(sortKeys[i])];
+    return static_cast<uint32_t>(sortKeys.size());
+}
+
+void PointLightSystem::render(FrameInfo& frameInfo)
+{
+    const uint32_t billboardCount = writeBillboards(frameInfo);
+
+    // подмена пересобранного пайплайна на границе кадра, старый удаляется после завершения кадров в полёте
+    pipelineVariants.swapReloadedPipelines();
+    if (billboardCount == 0) return;
 
     // render objects
-    wrpPipeline->bind(frameInfo.commandBuffer);  // прикрепление графического пайплайна к буферу команд
+    pipelineVariants.get(pipelineVariantDesc())->bind(frameInfo.commandBuffer);  // прикрепление графического пайплайна к буферу команд
 
-    // привязываем набор дескрипторов к пайплайну
+    // привязываем глобальный набор дескрипторов и билборды кадра к пайплайну
+    std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, billboardSets[frameInfo.frameIndex]};
     vkCmdBindDescriptorSets(
         frameInfo.commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
         0,
-        1,
-        &frameInfo.globalDescriptorSet,
+        static_cast<uint32_t>(descriptorSets.size()),
+        descriptorSets.data(),
         0,
         nullptr
     );
 
-    // Отрисовываем билборды поинт лайтов в обратном порядке (от самого дальнего, до самого близкого к камере)
-    for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
-    {
-        auto& obj = frameInfo.sceneObjects.at(it->second);
-
-        PointLightPushConstants push{};
-        push.position = glm::vec4(obj.transform.translation, 1.f);
-        push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-        push.radius = obj.transform.scale.x;
-
-        vkCmdPushConstants(
-            frameInfo.commandBuffer,
-            pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(PointLightPushConstants),
-            &push
-        );
-        vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-    }
+    // все билборды одним вызовом: 6 вершин на экземпляр, экземпляры уже отсортированы от дальних к ближним
+    vkCmdDraw(frameInfo.commandBuffer, 6, billboardCount, 0, 0);
 }
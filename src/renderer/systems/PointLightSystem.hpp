@@ -1,19 +1,35 @@
 #pragma once
 
 #include "../Pipeline.hpp"
+#include "../PipelineVariantCache.hpp"
 #include "../Device.hpp"
-#include "../SceneObject.hpp"
+#include "../Scene.hpp"
 #include "../FrameInfo.hpp"
 #include "../Camera.hpp"
+#include "../Renderer.hpp"
+#include "../ShaderWatcher.hpp"
+#include "../Buffer.hpp"
+#include "../Descriptors.hpp"
 
 // std
 #include <memory>
+#include <string>
+#include <unordered_set>
 #include <vector>
 
+/*
+ * Билборды точечных источников. Видимые источники (сфера билборда в пирамиде видимости) за кадр записываются
+ * в storage buffer кадра (set 1, binding 0) от дальних к ближним - для правильного смешивания прозрачных
+ * билбордов - и рисуются одним instanced вызовом: gl_InstanceIndex выбирает билборд, gl_VertexIndex - его вершину.
+ * Порядок строится поразрядной сортировкой (LSD radix sort) по квадрату расстояния до камеры, источники
+ * на одинаковом расстоянии сохраняют порядок сцены.
+ */
 class PointLightSystem
 {
 public:
-    PointLightSystem(WrpDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    static constexpr uint32_t MAX_BILLBOARDS = 65536;
+
+    PointLightSystem(WrpDevice& device, WrpRenderer& renderer, VkDescriptorSetLayout globalSetLayout);
     ~PointLightSystem();
 
     // Избавляемся от copy operator и copy constrcutor, т.к. PointLightSystem хранит в себе указатели
@@ -23,13 +39,39 @@ public:
 
     void update(FrameInfo& frameInfo, GlobalUbo& ubo);
     void render(FrameInfo& frameInfo);
+    // фоновая пересборка пайплайна при изменении его шейдеров
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
 
 private:
+    // билборд в storage buffer (std430), раскладка совпадает с PointLight.vert
+    struct Billboard
+    {
+        glm::vec4 position{}; // w - радиус билборда
+        glm::vec4 color{};    // w - интенсивность
+    };
+
+    void createBillboardBuffers();
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void createPipeline(VkRenderPass renderPass);
+    PipelineVariantDesc pipelineVariantDesc() const;
+    // сборка видимых билбордов кадра в порядке от дальних к ближним, возвращает их количество
+    uint32_t writeBillboards(FrameInfo& frameInfo);
 
     WrpDevice& wrpDevice;
+    WrpRenderer& wrpRenderer;
 
-    std::unique_ptr<WrpPipeline> wrpPipeline;
     VkPipelineLayout pipelineLayout;
+    WrpPipelineVariantCache pipelineVariants;
+
+    // покадровые буферы билбордов и их наборы дескрипторов
+    std::vector<std::unique_ptr<WrpBuffer>> billboardBuffers;
+    std::unique_ptr<WrpDescriptorPool> billboardPool;
+    std::unique_ptr<WrpDescriptorSetLayout> billboardSetLayout;
+    std::vector<VkDescriptorSet> billboardSets;
+
+    // буферы текущего кадра, чтобы не выделять память каждый кадр
+    std::vector<Billboard> billboards; // в порядке обхода источников сцены
+    std::vector<WrpBoundingSphere> billboardSpheres;
+    std::vector<uint8_t> visibleBillboards;
+    std::vector<uint64_t> sortKeys; // старшие 32 бита - ключ расстояния, младшие - индекс источника
+    std::vector<uint64_t> sortScratch;
 };
@@ -1,4 +1,7 @@
 #include "SimpleRenderSystem.hpp"
+#include "../Culling.hpp"
+#include "../OcclusionCulling.hpp"
+#include "../IndirectDrawBuffer.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS			  // Функции GLM будут работать с радианами, а не градусами
@@ -7,22 +10,22 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
 #include <array>
 
 SimpleRenderSystem::SimpleRenderSystem(WrpDevice& device, WrpRenderer& renderer,
-    VkDescriptorSetLayout globalDescriptorSetLayout)
-    : wrpDevice{device}, wrpRenderer{renderer}
+    VkDescriptorSetLayout globalDescriptorSetLayout, VkRenderPass gBufferRenderPass)
+    : wrpDevice{device}, wrpRenderer{renderer}, gBufferRenderPass{gBufferRenderPass}, pipelineVariants{device, renderer, "SimpleRenderSystem"}
 {
     createPipelineLayout(globalDescriptorSetLayout);
-    wrpPipelineLambertian = createPipeline(renderer.getSwapChainRenderPass(), 0, 0);
-    wrpPipelineBlinnPhong = createPipeline(renderer.getSwapChainRenderPass(), 1, 0);
-    wrpPipelineTorranceSparrow = createPipeline(renderer.getSwapChainRenderPass(), 2, 0);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem()
 {
+    // фоновые задачи используют pipelineLayout, поэтому дожидаемся их перед его уничтожением
+    pipelineVariants.wait();
     vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
 }
 
@@ -30,9 +33,9 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalDescri
 {
     // описание диапазона пуш-констант
     VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // доступ к данным констант из обоих шейдеров
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // смещение пачки indirect-отрисовок нужно только вершинному шейдеру
     pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(SimplePushConstantData);
+    pushConstantRange.size = sizeof(IndirectDrawPushConstants);
 
     // используемые схемы наборов дескрипторов
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalDescriptorSetLayout};
@@ -54,78 +57,150 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalDescri
     }
 }
 
-std::unique_ptr<WrpPipeline>
-SimpleRenderSystem::createPipeline(VkRenderPass renderPass, int reflectionModel, int polygonFillMode)
+PipelineVariantDesc SimpleRenderSystem::pipelineVariantDesc(const RenderingSettings& renderingSettings) const
 {
-    assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout.");
-
-    PipelineConfigInfo pipelineConfig{};
-    WrpPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    pipelineConfig.rasterizationInfo.polygonMode = (VkPolygonMode)polygonFillMode;
+    PipelineVariantDesc desc{};
+    desc.vertShader = "NoTexture.vert";
+    desc.vertDefines = ShaderPermutations::meshVertDefines(wrpDevice.supportsMultiDrawIndirect());
+    desc.fragShader = ShaderPermutations::noTextureFragShader(renderingSettings.reflectionModel);
+    desc.polygonMode = (VkPolygonMode)renderingSettings.polygonFillMode;
+    desc.renderPass = wrpRenderer.getSwapChainRenderPass();
+    desc.samples = wrpRenderer.getMsaaSampleCount();
+    desc.minSampleShading = wrpRenderer.getMinSampleShading();
+    desc.pipelineLayout = pipelineLayout;
+    if (renderingSettings.deferredShading)
+    {
+        // в G-buffer пишутся только свойства поверхности, модель отражения применяет проход освещения
+        desc.fragShader = ShaderPermutations::gBufferFragShader(false);
+        desc.renderPass = gBufferRenderPass;
+        desc.samples = VK_SAMPLE_COUNT_1_BIT;
+        desc.minSampleShading = 0.f;
+        desc.colorAttachmentCount = WrpGBuffer::COLOR_ATTACHMENTS_COUNT;
+    }
+    return desc;
+}
 
-    std::string vertPath = "NoTexture.vert";
-    std::string fragPath;
-    if (reflectionModel == 0) fragPath = "NoTextureLambertian.frag";
-    else if (reflectionModel == 1) fragPath = "NoTextureBlinnPhong.frag";
-    else if (reflectionModel == 2) fragPath = "NoTextureTorranceSparrow.frag";
+void SimpleRenderSystem::prefetchPipelines(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.prefetch(pipelineVariantDesc(renderingSettings));
+}
 
-    return std::make_unique<WrpPipeline>(wrpDevice, vertPath, fragPath, pipelineConfig);
+void SimpleRenderSystem::reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    pipelineVariants.reloadShaders(shaderWatcher, changedShaders);
 }
 
-void SimpleRenderSystem::renderSceneObjects(FrameInfo& frameInfo)
+void SimpleRenderSystem::prepareSceneObjects(FrameInfo& frameInfo)
 {
-    // recreate pipelines with rendering settings changes
-    if (curPlgnFillMode != frameInfo.renderingSettings.polygonFillMode) {
-        // wait for graphics queue to complete before recreating new pipelines
-        vkQueueWaitIdle(wrpDevice.graphicsQueue());
-        int polygonFillMode = frameInfo.renderingSettings.polygonFillMode;
-        wrpPipelineLambertian = createPipeline(wrpRenderer.getSwapChainRenderPass(), 0, polygonFillMode);
-        wrpPipelineBlinnPhong = createPipeline(wrpRenderer.getSwapChainRenderPass(), 1, polygonFillMode);
-        wrpPipelineTorranceSparrow = createPipeline(wrpRenderer.getSwapChainRenderPass(), 2, polygonFillMode);
-        curPlgnFillMode = polygonFillMode;
+    // В данной системе рендерятся только объекты с моделями без материала (и, соответственно, текстур)
+    // (обходится только плотный массив компонентов моделей, данные объекта находятся по id)
+    std::vector<WrpRenderObject> objects;
+    for (auto& [id, component] : frameInfo.sceneObjects.models())
+    {
+        WrpModel* model = component.model.get();
+        if (model->hasTextures == true) continue;
+        objects.push_back({id, &frameInfo.sceneObjects.at(id).transform, model});
     }
 
-    // прикрепление графического пайплайна к буферу команд
-    if (frameInfo.renderingSettings.reflectionModel == 0)
-        wrpPipelineLambertian->bind(frameInfo.commandBuffer);
-    else if (frameInfo.renderingSettings.reflectionModel == 1)
-        wrpPipelineBlinnPhong->bind(frameInfo.commandBuffer);
-    else if (frameInfo.renderingSettings.reflectionModel == 2)
-        wrpPipelineTorranceSparrow->bind(frameInfo.commandBuffer);
+    // Отсечение по пирамиде видимости до записи команд отрисовки. При GPU отсечении в список попадают все объекты,
+    // а видимые экземпляры отбирает compute шейдер (WrpGpuCulling) перед проходом рендера.
+    WrpFrustumCuller culler{frameInfo.camera};
+    const bool gpuCulling = frameInfo.renderingSettings.gpuCulling;
+    std::vector<uint8_t> visibleObjects;
+    if (!gpuCulling)
+        visibleObjects = culler.cullObjects(objects, frameInfo.transformCache, frameInfo.renderStats);
+    // перекрытые объекты отсекаются по буферу глубины окклюдеров, если он растеризован в этом кадре
+    const WrpOcclusionCuller* occlusionCuller =
+        !gpuCulling && frameInfo.occlusionCuller.isActive() ? &frameInfo.occlusionCuller : nullptr;
+    if (occlusionCuller)
+        occlusionCuller->cullObjects(objects, frameInfo.transformCache, visibleObjects, frameInfo.renderStats);
+
+    // Сначала собирается список отрисовки видимых подобъектов (объекты с одной моделью объединяются
+    // в instanced-группы), а команды записываются уже после его сортировки.
+    // Группы моделей делятся на части по числу потоков записи, иначе у сцены из одной модели делить нечего.
+    const uint32_t recordingParts = static_cast<uint32_t>(std::max(frameInfo.renderingSettings.recordingThreads, 1));
+    drawList.clear();
+    drawList.addInstanced(objects, visibleObjects, gpuCulling ? nullptr : &culler, occlusionCuller,
+        frameInfo.camera.getView(), frameInfo.transformCache, frameInfo.instanceBuffer, frameInfo.renderStats,
+        frameInfo.renderingSettings.instancing, recordingParts);
+    drawList.sort();
+
+    // Подобъекты одной модели идут подряд после сортировки и отправляются одним multi-draw indirect вызовом,
+    // поэтому число вызовов отрисовки зависит от количества разных моделей, а не объектов.
+    // Упакованную GPU отсечением пачку нельзя разделить между потоками записи, поэтому при параллельной записи
+    // у каждой группы экземпляров (части группы модели) своя пачка.
+    auto& indirectDraws = frameInfo.indirectDrawBuffer;
+    const bool batchPerGroup = indirectDraws.compactsDraws() && recordingParts > 1;
+    drawBatches.clear();
+    WrpModel* batchModel = nullptr;
+    uint32_t batchGroup = 0;
+    for (const auto& command : drawList.getCommands())
+    {
+        if (command.model != batchModel || (batchPerGroup && command.instanceGroup != batchGroup))
+        {
+            if (batchModel)
+                drawBatches.push_back(indirectDraws.endBatch());
+            indirectDraws.beginBatch(command.model);
+            batchModel = command.model;
+            batchGroup = command.instanceGroup;
+        }
+
+        const auto& info = command.model->getSubMeshesInfos()[command.subMeshIndex];
+        DrawData drawData{};
+        drawData.diffuseColor = glm::vec4(info.diffuseColor, 1.f);
+        indirectDraws.addDraw({info.indexCount, command.instanceCount, info.indexStart, 0, command.firstInstance},
+            drawData, command.instanceGroup);
+    }
+    if (batchModel)
+        drawBatches.push_back(indirectDraws.endBatch());
+}
+
+WrpPipeline* SimpleRenderSystem::currentPipeline(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.swapReloadedPipelines();
+    // Вариант для текущих настроек собирается только при первом использовании,
+    // дальше переключение настроек ничего не стоит.
+    return pipelineVariants.get(pipelineVariantDesc(renderingSettings));
+}
+
+void SimpleRenderSystem::recordDraws(VkCommandBuffer commandBuffer, WrpPipeline& pipeline, FrameInfo& frameInfo,
+    uint32_t firstDraw, uint32_t drawCount, RenderStats& stats)
+{
+    // Прикрепление графического пайплайна к буферу команд
+    pipeline.bind(commandBuffer);
 
     // привязываем набор дескрипторов к пайплайну
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
 
-    for (auto& kv : frameInfo.sceneObjects)
-    {
-        auto& obj = kv.second; // ссылка на объект из мапы
+    frameInfo.indirectDrawBuffer.drawRange(commandBuffer, pipelineLayout, firstDraw, drawCount, stats);
+}
 
-        // В данной системе рендерятся только объекты с моделями без материала (и, соответственно, текстур)
-        if (obj.model == nullptr || obj.model->hasTextures == true) continue;
+std::pair<uint32_t, uint32_t> SimpleRenderSystem::drawSpan(const WrpIndirectDrawBuffer& indirectDraws) const
+{
+    // пачки системы записаны подряд, поэтому их отрисовки образуют один непрерывный диапазон
+    if (drawBatches.empty())
+        return {0, 0};
+    const uint32_t firstDraw = indirectDraws.getBatchFirstDraw(drawBatches.front());
+    return {firstDraw, indirectDraws.getBatchEndDraw(drawBatches.back()) - firstDraw};
+}
 
-        SimplePushConstantData push{};
-        push.modelMatrix = obj.transform.modelMatrix();
-        push.normalMatrix = obj.transform.normalMatrix();
+void SimpleRenderSystem::renderSceneObjects(FrameInfo& frameInfo)
+{
+    WrpPipeline* pipeline = currentPipeline(frameInfo.renderingSettings);
+    const auto [firstDraw, drawCount] = drawSpan(frameInfo.indirectDrawBuffer);
+    recordDraws(frameInfo.commandBuffer, *pipeline, frameInfo, firstDraw, drawCount, frameInfo.renderStats);
+}
 
-        for (auto& info : obj.model->getSubMeshesInfos())
-        {
-            push.diffuseColor = info.diffuseColor;
-
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(SimplePushConstantData),
-                &push);
-
-            // прикрепление буфера вершин (модели) и буфера индексов к буферу команд (создание привязки)
-            obj.model->bind(frameInfo.commandBuffer);
-            // отрисовка буфера вершин
-            obj.model->drawIndexed(frameInfo.commandBuffer, info.indexCount, info.indexStart);
-        }
-    }
+std::vector<VkCommandBuffer> SimpleRenderSystem::renderSceneObjects(FrameInfo& frameInfo, WrpCommandRecorder& recorder)
+{
+    // пайплайн берётся до раздачи работы потокам: кэш вариантов не рассчитан на параллельные обращения
+    WrpPipeline* pipeline = currentPipeline(frameInfo.renderingSettings);
+    // делятся отрисовки, а не пачки; экземпляры каждой модели prepareSceneObjects уже разбил на части по потокам
+    const auto [firstDraw, drawCount] = drawSpan(frameInfo.indirectDrawBuffer);
+    return recorder.recordParallel(drawCount, frameInfo.renderingSettings.recordingThreads, frameInfo.renderStats,
+        [this, pipeline, &frameInfo, firstDraw = firstDraw](VkCommandBuffer commandBuffer, uint32_t first, uint32_t count,
+            RenderStats& stats) {
+            recordDraws(commandBuffer, *pipeline, frameInfo, firstDraw + first, count, stats);
+        });
 }
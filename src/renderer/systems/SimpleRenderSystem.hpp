@@ -1,40 +1,67 @@
 #pragma once
 
 #include "../Pipeline.hpp"
+#include "../PipelineVariantCache.hpp"
 #include "../Device.hpp"
-#include "../SceneObject.hpp"
+#include "../Scene.hpp"
 #include "../Camera.hpp"
 #include "../FrameInfo.hpp"
 #include "../Renderer.hpp"
+#include "../ShaderWatcher.hpp"
+#include "../DrawList.hpp"
+#include "../CommandRecorder.hpp"
+#include "../GBuffer.hpp"
 
 // std
 #include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 class SimpleRenderSystem
 {
 public:
     SimpleRenderSystem(WrpDevice& device, WrpRenderer& renderer,
-        VkDescriptorSetLayout globalSetLayout);
+        VkDescriptorSetLayout globalSetLayout, VkRenderPass gBufferRenderPass);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem&) = delete;
     SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+    // Отсечение и запись indirect-команд кадра, вызывается до начала прохода рендера
+    // (результаты GPU отсечения должны быть готовы к началу прохода)
+    void prepareSceneObjects(FrameInfo& frameInfo);
+    // Запись отрисовок, подготовленных в prepareSceneObjects, внутри прохода рендера
     void renderSceneObjects(FrameInfo& frameInfo);
+    // То же, но отрисовки делятся между потоками поровну и записываются во вторичные буферы (их нужно выполнить
+    // в первичном буфере в возвращённом порядке). Экземпляры каждой модели prepareSceneObjects делит на диапазоны
+    // по числу потоков, поэтому работа делится и в сцене из одной повторяющейся модели
+    std::vector<VkCommandBuffer> renderSceneObjects(FrameInfo& frameInfo, WrpCommandRecorder& recorder);
+    // фоновая сборка варианта пайплайна для текущих настроек, чтобы первый кадр не собирал его сам
+    void prefetchPipelines(const RenderingSettings& renderingSettings);
+    // фоновая пересборка пайплайнов, использующих изменённые шейдеры
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
 
 private:
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    std::unique_ptr<WrpPipeline> createPipeline(
-        VkRenderPass renderPass, int reflectionModel, int polygonFillMode);
+    PipelineVariantDesc pipelineVariantDesc(const RenderingSettings& renderingSettings) const;
+    WrpPipeline* currentPipeline(const RenderingSettings& renderingSettings);
+    // отрисовки [firstDraw, firstDraw + drawCount) из пачек системы (WrpIndirectDrawBuffer::drawRange)
+    void recordDraws(VkCommandBuffer commandBuffer, WrpPipeline& pipeline, FrameInfo& frameInfo,
+        uint32_t firstDraw, uint32_t drawCount, RenderStats& stats);
+    // диапазон отрисовок всех пачек системы в текущем кадре
+    std::pair<uint32_t, uint32_t> drawSpan(const WrpIndirectDrawBuffer& indirectDraws) const;
 
     WrpDevice& wrpDevice;
     WrpRenderer& wrpRenderer;
+    VkRenderPass gBufferRenderPass; // проход WrpGBuffer для отложенного освещения
 
-    int curPlgnFillMode = 0;
-
-    std::unique_ptr<WrpPipeline> wrpPipelineLambertian;
-    std::unique_ptr<WrpPipeline> wrpPipelineBlinnPhong;
-    std::unique_ptr<WrpPipeline> wrpPipelineTorranceSparrow;
     VkPipelineLayout pipelineLayout;
+    // варианты пайплайна по модели отражения и режиму полигонов, создаются при первом использовании
+    WrpPipelineVariantCache pipelineVariants;
+
+    // список отрисовки и пачки indirect-отрисовок текущего кадра, переиспользуются между кадрами
+    WrpDrawList drawList;
+    std::vector<uint32_t> drawBatches;
 };
@@ -1,4 +1,7 @@
 #include "TextureRenderSystem.hpp"
+#include "../Culling.hpp"
+#include "../OcclusionCulling.hpp"
+#include "../IndirectDrawBuffer.hpp"
 #include "../Buffer.hpp"
 
 // libs
@@ -6,29 +9,49 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE   // GLM будет ожидать интервал нашего буфера глубины от 0 до 1 (например, для OpenGL используется интервал от -1 до 1)
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#include "shaderc/shaderc.h"
 
 // std
 #include <stdexcept>
 #include <cassert>
+#include <algorithm>
 #include <array>
 #include <iostream>
-#include <fstream>
+#include <limits>
+
+namespace
+{
+#ifdef WRP_RUNTIME_SHADER_COMPILATION
+    // вариант фрагментного шейдера под любой размер массива собирается при первом использовании
+    constexpr size_t LEGACY_TEXTURES_LIMIT = std::numeric_limits<int>::max();
+#else
+    // без компилятора доступны только варианты из бандла
+    constexpr size_t LEGACY_TEXTURES_LIMIT = LEGACY_TEXTURES_COUNT_MAX;
+#endif
+}
 
 TextureRenderSystem::TextureRenderSystem(WrpDevice& device, WrpRenderer& renderer,
-    VkDescriptorSetLayout globalSetLayout, FrameInfo frameInfo) : wrpDevice{device}, wrpRenderer{renderer}, globalSetLayout{globalSetLayout}
+    VkDescriptorSetLayout globalSetLayout, VkRenderPass gBufferRenderPass, FrameInfo frameInfo)
+    : wrpDevice{device}, wrpRenderer{renderer}, gBufferRenderPass{gBufferRenderPass}, globalSetLayout{globalSetLayout}, pipelineVariants{device, renderer, "TextureRenderSystem"}
 {
     prevModelCount = fillModelsIds(frameInfo.sceneObjects);
-    systemDescriptorSets.resize(wrpRenderer.getSwapChainImageCount());
-    createDescriptorSets(frameInfo);
+    bindless = wrpDevice.supportsBindlessTextures();
+    if (bindless)
+    {
+        createBindlessDescriptorSet();
+        updateBindlessTextures(frameInfo);
+    }
+    else
+    {
+        systemDescriptorSets.resize(wrpRenderer.getSwapChainImageCount());
+        createDescriptorSets(frameInfo);
+    }
     createPipelineLayout(globalSetLayout);
-    wrpPipelineLambertian = createPipeline(wrpRenderer.getSwapChainRenderPass(), 0, 0);
-    wrpPipelineBlinnPhong = createPipeline(wrpRenderer.getSwapChainRenderPass(), 1, 0);
-    wrpPipelineTorranceSparrow = createPipeline(wrpRenderer.getSwapChainRenderPass(), 2, 0);
 }
 
 TextureRenderSystem::~TextureRenderSystem()
 {
+    // фоновые задачи используют pipelineLayout, поэтому дожидаемся их перед его уничтожением
+    pipelineVariants.wait();
     vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
 }
 
@@ -38,9 +61,9 @@ void TextureRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLa
     if (pipelineLayout != nullptr) vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
 
     VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // access to push constant from both VS and FS 
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // смещение пачки indirect-отрисовок нужно только вершинному шейдеру
     pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(TextureSystemPushConstantData);
+    pushConstantRange.size = sizeof(IndirectDrawPushConstants);
 
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, systemDescriptorSetLayout->getDescriptorSetLayout()};
 
@@ -56,34 +79,49 @@ void TextureRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLa
     }
 }
 
-std::unique_ptr<WrpPipeline>
-TextureRenderSystem::createPipeline(VkRenderPass renderPass, int reflectionModel, int polygonFillMode)
+PipelineVariantDesc TextureRenderSystem::pipelineVariantDesc(const RenderingSettings& renderingSettings) const
 {
-    assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
-
-    PipelineConfigInfo pipelineConfig{};
-    WrpPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    pipelineConfig.rasterizationInfo.polygonMode = (VkPolygonMode)polygonFillMode;
+    PipelineVariantDesc desc{};
+    desc.vertShader = "Texture.vert";
+    desc.vertDefines = ShaderPermutations::meshVertDefines(wrpDevice.supportsMultiDrawIndirect());
+    desc.fragShader = ShaderPermutations::textureFragShader(renderingSettings.reflectionModel);
+    // Размер массива текстур передаётся в шейдер макросом, поэтому исходник шейдера не переписывается.
+    // В bindless варианте массив безразмерный, и шейдер от количества текстур не зависит вовсе.
+    desc.fragDefines = ShaderPermutations::textureFragDefines(bindless, texturesCount);
+    desc.polygonMode = (VkPolygonMode)renderingSettings.polygonFillMode;
+    desc.renderPass = wrpRenderer.getSwapChainRenderPass();
+    desc.samples = wrpRenderer.getMsaaSampleCount();
+    desc.minSampleShading = wrpRenderer.getMinSampleShading();
+    desc.pipelineLayout = pipelineLayout;
+    if (renderingSettings.deferredShading)
+    {
+        // в G-buffer пишутся только свойства поверхности, модель отражения применяет проход освещения
+        desc.fragShader = ShaderPermutations::gBufferFragShader(true);
+        desc.renderPass = gBufferRenderPass;
+        desc.samples = VK_SAMPLE_COUNT_1_BIT;
+        desc.minSampleShading = 0.f;
+        desc.colorAttachmentCount = WrpGBuffer::COLOR_ATTACHMENTS_COUNT;
+    }
+    return desc;
+}
 
-    std::string vertPath = "Texture.vert";
-    ShaderModule* fragShaderModule;
-    if (reflectionModel == 0) fragShaderModule = fsModuleLambertian;
-    else if (reflectionModel == 1) fragShaderModule = fsModuleBlinnPhong;
-    else if (reflectionModel == 2) fragShaderModule = fsModuleTorranceSparrow;
+void TextureRenderSystem::prefetchPipelines(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.prefetch(pipelineVariantDesc(renderingSettings));
+}
 
-    return std::make_unique<WrpPipeline>(wrpDevice, vertPath, "", pipelineConfig, nullptr, fragShaderModule);
+void TextureRenderSystem::reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    pipelineVariants.reloadShaders(shaderWatcher, changedShaders);
 }
 
-int TextureRenderSystem::fillModelsIds(SceneObject::Map& sceneObjects)
+int TextureRenderSystem::fillModelsIds(WrpScene& sceneObjects)
 {
     modelObjectsIds.clear();
-    for (auto& kv : sceneObjects)
+    for (auto& [id, component] : sceneObjects.models())
     {
-        auto& obj = kv.second; // ссылка на объект из мапы
-        if (obj.model != nullptr && obj.model->hasTextures == true) {
-            modelObjectsIds.push_back(kv.first); // в этой системе рендерятся только объекты с текстурами
+        if (component.model->hasTextures == true) {
+            modelObjectsIds.push_back(id); // в этой системе рендерятся только объекты с текстурами
         }
     }
     return static_cast<int>(modelObjectsIds.size());
@@ -91,21 +129,33 @@ int TextureRenderSystem::fillModelsIds(SceneObject::Map& sceneObjects)
 
 void TextureRenderSystem::createDescriptorSets(FrameInfo& frameInfo)
 {
-    int texturesCount = 0;
+    texturesCount = 0;
     std::vector<VkDescriptorImageInfo> descriptorImageInfos;
 
     for (auto& id : modelObjectsIds)
     {
-        texturesCount += frameInfo.sceneObjects[id].model->getTextures().size();
+        WrpModel* model = frameInfo.sceneObjects.models().at(id).model.get();
+        texturesCount += model->getTextures().size();
 
         // Заполнение информации по дескрипторам текстур для каждой модели
-        for (auto& texture : frameInfo.sceneObjects.at(id).model->getTextures())
+        for (auto& texture : model->getTextures())
         {
             VkDescriptorImageInfo imageInfo = texture->descriptorInfo();
             descriptorImageInfos.push_back(imageInfo);
         }
     }
 
+    // Текстуры сверх размера массива, под который есть вариант шейдера, не попадают в набор дескрипторов:
+    // их подобъекты рисуются цветом материала (textureSlot)
+    if (descriptorImageInfos.size() > LEGACY_TEXTURES_LIMIT)
+    {
+        std::cout << "TextureRenderSystem: " << descriptorImageInfos.size() << " textures exceed the "
+            << LEGACY_TEXTURES_LIMIT << " supported without descriptor indexing, the rest fall back to material colors"
+            << std::endl;
+        descriptorImageInfos.resize(LEGACY_TEXTURES_LIMIT);
+        texturesCount = static_cast<int>(LEGACY_TEXTURES_LIMIT);
+    }
+
     // wait for all of commands in graphics queue to complete before creating new descriptor pool and graphics pipeline eventually
     vkQueueWaitIdle(wrpDevice.graphicsQueue());
 
@@ -130,140 +180,249 @@ void TextureRenderSystem::createDescriptorSets(FrameInfo& frameInfo)
         }
         descriptorWriter.build(systemDescriptorSets[i]);
     }
+}
+
+void TextureRenderSystem::createBindlessDescriptorSet()
+{
+    uint32_t capacity = std::min(MAX_BINDLESS_TEXTURES, wrpDevice.getMaxBindlessTextures());
+
+    systemDescriptorPool = WrpDescriptorPool::Builder(wrpDevice)
+        .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+        .setMaxSets(1)
+        .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity)
+        .build();
+
+    // partially bound: незаписанные ячейки допустимы, пока шейдер к ним не обращается;
+    // update unused while pending: в свободные ячейки можно писать, пока набор используется кадрами в полёте
+    systemDescriptorSetLayout = WrpDescriptorSetLayout::Builder(wrpDevice)
+        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, capacity,
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
+        .build();
+
+    if (!systemDescriptorPool->allocateDescriptorSet(
+        systemDescriptorSetLayout->getDescriptorSetLayout(), bindlessDescriptorSet, capacity))
+    {
+        throw std::runtime_error("Failed to allocate bindless texture descriptor set!");
+    }
 
-    std::string name0 = "TextureLambertian.frag";
-    std::string name1 = "TextureBlinnPhong.frag";
-    std::string name2 = "TextureTorranceSparrow.frag";
-    rewriteAndRecompileFragShader(fsModuleLambertian, name0, texturesCount);
-    rewriteAndRecompileFragShader(fsModuleBlinnPhong, name1, texturesCount);
-    rewriteAndRecompileFragShader(fsModuleTorranceSparrow, name2, texturesCount);
+    // ячейки раздаются с конца вектора, поэтому первыми будут заняты младшие индексы
+    freeTextureSlots = std::make_shared<std::vector<uint32_t>>(capacity);
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        (*freeTextureSlots)[i] = capacity - 1 - i;
+    }
 }
 
-void TextureRenderSystem::rewriteAndRecompileFragShader(
-    ShaderModule*& shaderModule, std::string fragShaderName, int texturesCount)
+// Раздача ячеек текстурам моделей, появившихся в сцене, и освобождение ячеек удалённых моделей
+void TextureRenderSystem::updateBindlessTextures(FrameInfo& frameInfo)
 {
-    std::string fragShaderPath = SHADERS_DIR + fragShaderName;
-    std::fstream shaderFile;
-    std::string shaderContent;
-    std::string line;
-    std::string macros = "#define TEXTURES_COUNT ";
-    bool isTexturesDefined = false;
-
-    shaderFile.open(fragShaderPath, std::ios::in | std::ios::app);
-    if (shaderFile.is_open())
+    std::unordered_set<WrpModel*> presentModels;
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<uint32_t> imageSlots;
+
+    for (auto& id : modelObjectsIds)
     {
-        while (std::getline(shaderFile, line))
+        const std::shared_ptr<WrpModel>& model = frameInfo.sceneObjects.models().at(id).model;
+        presentModels.insert(model.get());
+        if (modelTextureSlots.count(model.get()) != 0)
+            continue;
+
+        ModelTextureSlots entry{model, {}};
+        for (auto& texture : model->getTextures())
+        {
+            if (freeTextureSlots->empty())
+                throw std::runtime_error("Bindless texture array is full!");
+            entry.slots.push_back(freeTextureSlots->back());
+            freeTextureSlots->pop_back();
+            imageInfos.push_back(texture->descriptorInfo());
+            imageSlots.push_back(entry.slots.back());
+        }
+        modelTextureSlots.emplace(model.get(), std::move(entry));
+    }
+
+    if (!imageInfos.empty())
+    {
+        WrpDescriptorWriter descriptorWriter = WrpDescriptorWriter(*systemDescriptorSetLayout, *systemDescriptorPool);
+        for (size_t i = 0; i < imageInfos.size(); i++)
         {
-            if (!isTexturesDefined && line.find(macros) != std::string::npos)
-            {
-                // replacing TEXTURES_COUNT
-                macros += std::to_string(texturesCount);
-                line.replace(0, line.length(), macros);
-                shaderContent += line + '\n';
-
-                // single-time adding TEXTURES define and sampler2D array to activate code with texturing
-                if (texturesCount != 0) {
-                    shaderContent += "#define TEXTURES\n";
-                    shaderContent += "layout(set = 1, binding = 0) uniform sampler2D texSampler[TEXTURES_COUNT]; // Combined Image Sampler descriptors\n";
-                }
-
-                std::cout << line << std::endl;
-                isTexturesDefined = true;
-            }
-            else
-            {
-                shaderContent += line + '\n';
-            }
+            descriptorWriter.writeImage(0, &imageInfos[i], 1, imageSlots[i]);
         }
+        descriptorWriter.overwrite(bindlessDescriptorSet);
     }
-    else std::cerr << "Shader rewriting: Your shader file couldn't be opened.";
-    shaderFile.close();
 
-    // generated shader are rewriting every time with the new textures count
-    shaderFile.open(ENGINE_DIR"src/shaders/Texture_Generated.frag", std::ios::out | std::ios::trunc);
-    if (shaderFile.is_open())
+    for (auto it = modelTextureSlots.begin(); it != modelTextureSlots.end();)
     {
-        shaderFile << shaderContent;
+        if (presentModels.count(it->first) != 0)
+        {
+            ++it;
+            continue;
+        }
+
+        // Ячейки (и сами текстуры) ещё могут читаться кадрами в полёте, поэтому они
+        // возвращаются в свободный список только после завершения этих кадров.
+        wrpRenderer.retireResource(std::shared_ptr<void>(nullptr,
+            [freeSlots = freeTextureSlots, entry = std::move(it->second)](void*) {
+                freeSlots->insert(freeSlots->end(), entry.slots.begin(), entry.slots.end());
+            }));
+        it = modelTextureSlots.erase(it);
     }
-    shaderFile.close();
+}
 
-    shaderModule = new ShaderModule(wrpDevice, "Texture_Generated.frag");
+// Индекс в массиве texSampler шейдера для текстуры модели (-1, если текстуры нет или она не уместилась в массив)
+int TextureRenderSystem::textureSlot(WrpModel* model, int textureIndex, int textureIndexOffset) const
+{
+    if (textureIndex == -1)
+        return -1;
+    if (bindless)
+        return static_cast<int>(modelTextureSlots.at(model).slots[textureIndex]);
+    const int slot = textureIndexOffset + textureIndex;
+    return slot < texturesCount ? slot : -1;
 }
 
-void TextureRenderSystem::renderSceneObjects(FrameInfo& frameInfo)
+void TextureRenderSystem::prepareSceneObjects(FrameInfo& frameInfo)
 {
-    // Заполняется вектор идентификаторов объектов с текстурами, и если их кол-во изменилось, то
-    // наборы дескрипторов для этих объектов пересоздаются, а вместе с ними и пайплайн, т.к. изменяется его схема.
-    if (prevModelCount != fillModelsIds(frameInfo.sceneObjects) ||
-        curPlgnFillMode != frameInfo.renderingSettings.polygonFillMode)
+    int modelCount = fillModelsIds(frameInfo.sceneObjects);
+    if (bindless)
     {
-        int polygonFillMode = frameInfo.renderingSettings.polygonFillMode;
-
+        // добавление и удаление моделей сводится к записи дескрипторов в свободные ячейки массива
+        updateBindlessTextures(frameInfo);
+    }
+    // Без descriptor indexing при изменении кол-ва объектов с текстурами наборы дескрипторов для них
+    // пересоздаются, а вместе с ними и все варианты пайплайна, т.к. изменяется его схема.
+    else if (prevModelCount != modelCount)
+    {
+        pipelineVariants.wait();
         createDescriptorSets(frameInfo);
+        pipelineVariants.clear();
         createPipelineLayout(globalSetLayout);
-        wrpPipelineLambertian = createPipeline(wrpRenderer.getSwapChainRenderPass(), 0, polygonFillMode);
-        wrpPipelineBlinnPhong = createPipeline(wrpRenderer.getSwapChainRenderPass(), 1, polygonFillMode);
-        wrpPipelineTorranceSparrow = createPipeline(wrpRenderer.getSwapChainRenderPass(), 2, polygonFillMode);
 
-        curPlgnFillMode = polygonFillMode;
         prevModelCount = modelObjectsIds.size();
     }
 
-    // прикрепление графического пайплайна к буферу команд
-    if (frameInfo.renderingSettings.reflectionModel == 0) {
-        wrpPipelineLambertian->bind(frameInfo.commandBuffer);
+    std::vector<WrpRenderObject> objects;
+    objects.reserve(modelObjectsIds.size());
+    for (auto& id : modelObjectsIds)
+    {
+        objects.push_back({id, &frameInfo.sceneObjects.at(id).transform, frameInfo.sceneObjects.models().at(id).model.get()});
     }
-    else if (frameInfo.renderingSettings.reflectionModel == 1) {
-        wrpPipelineBlinnPhong->bind(frameInfo.commandBuffer);
+
+    // Без bindless каждый объект занимает свой диапазон массива текстур, отступ считается по всем объектам,
+    // включая отсечённые. Экземпляры одной модели содержат одинаковые текстуры, поэтому группа использует отступ первого.
+    objectTextureOffsets.resize(objects.size());
+    int textureIndexOffset = 0;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        objectTextureOffsets[i] = textureIndexOffset;
+        textureIndexOffset += objects[i].model->getTextures().size();
     }
-    else if (frameInfo.renderingSettings.reflectionModel == 2) {
-        wrpPipelineTorranceSparrow->bind(frameInfo.commandBuffer);
+
+    // Отсечение по пирамиде видимости, затем сборка списка отрисовки видимых подобъектов
+    // (объекты с одной моделью объединяются в instanced-группы) и его сортировка.
+    // При GPU отсечении в список попадают все объекты, а видимые экземпляры отбирает WrpGpuCulling.
+    WrpFrustumCuller culler{frameInfo.camera};
+    const bool gpuCulling = frameInfo.renderingSettings.gpuCulling;
+    std::vector<uint8_t> visibleObjects;
+    if (!gpuCulling)
+        visibleObjects = culler.cullObjects(objects, frameInfo.transformCache, frameInfo.renderStats);
+    // перекрытые объекты отсекаются по буферу глубины окклюдеров, если он растеризован в этом кадре
+    const WrpOcclusionCuller* occlusionCuller =
+        !gpuCulling && frameInfo.occlusionCuller.isActive() ? &frameInfo.occlusionCuller : nullptr;
+    if (occlusionCuller)
+        occlusionCuller->cullObjects(objects, frameInfo.transformCache, visibleObjects, frameInfo.renderStats);
+    // группы моделей делятся на части по числу потоков записи, иначе у сцены из одной модели делить нечего
+    const uint32_t recordingParts = static_cast<uint32_t>(std::max(frameInfo.renderingSettings.recordingThreads, 1));
+    drawList.clear();
+    drawList.addInstanced(objects, visibleObjects, gpuCulling ? nullptr : &culler, occlusionCuller,
+        frameInfo.camera.getView(), frameInfo.transformCache, frameInfo.instanceBuffer, frameInfo.renderStats,
+        frameInfo.renderingSettings.instancing, recordingParts);
+    drawList.sort();
+
+    // Подобъекты одной модели идут подряд после сортировки и отправляются одним multi-draw indirect вызовом,
+    // поэтому число вызовов отрисовки зависит от количества разных моделей, а не объектов.
+    // Упакованную GPU отсечением пачку нельзя разделить между потоками записи, поэтому при параллельной записи
+    // у каждой группы экземпляров (части группы модели) своя пачка.
+    auto& indirectDraws = frameInfo.indirectDrawBuffer;
+    const bool batchPerGroup = indirectDraws.compactsDraws() && recordingParts > 1;
+    drawBatches.clear();
+    WrpModel* batchModel = nullptr;
+    uint32_t batchGroup = 0;
+    for (const auto& command : drawList.getCommands())
+    {
+        if (command.model != batchModel || (batchPerGroup && command.instanceGroup != batchGroup))
+        {
+            if (batchModel)
+                drawBatches.push_back(indirectDraws.endBatch());
+            indirectDraws.beginBatch(command.model);
+            batchModel = command.model;
+            batchGroup = command.instanceGroup;
+        }
+
+        // Каждый подобъект .obj модели получает свои индексы текстур через DrawData
+        const auto& subMesh = command.model->getSubMeshesInfos()[command.subMeshIndex];
+        const int offset = objectTextureOffsets[command.objectIndex];
+        DrawData drawData{};
+        drawData.diffTexIndex = textureSlot(command.model, subMesh.diffuseTextureIndex, offset);
+        drawData.specTexIndex = textureSlot(command.model, subMesh.specularTextureIndex, offset);
+        drawData.diffuseColor = glm::vec4(subMesh.diffuseColor, 1.f);
+        indirectDraws.addDraw({subMesh.indexCount, command.instanceCount, subMesh.indexStart, 0, command.firstInstance},
+            drawData, command.instanceGroup);
     }
+    if (batchModel)
+        drawBatches.push_back(indirectDraws.endBatch());
+}
 
-    std::vector<VkDescriptorSet> descriptorSets{ frameInfo.globalDescriptorSet, systemDescriptorSets[frameInfo.frameIndex] };
+WrpPipeline* TextureRenderSystem::currentPipeline(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.swapReloadedPipelines();
+    // Вариант для текущих настроек собирается только при первом использовании,
+    // дальше переключение настроек ничего не стоит.
+    return pipelineVariants.get(pipelineVariantDesc(renderingSettings));
+}
+
+void TextureRenderSystem::recordDraws(VkCommandBuffer commandBuffer, WrpPipeline& pipeline, FrameInfo& frameInfo,
+    uint32_t firstDraw, uint32_t drawCount, RenderStats& stats)
+{
+    // Прикрепление графического пайплайна к буферу команд
+    pipeline.bind(commandBuffer);
+
+    std::array<VkDescriptorSet, 2> descriptorSets{ frameInfo.globalDescriptorSet,
+        bindless ? bindlessDescriptorSet : systemDescriptorSets[frameInfo.frameIndex] };
     // Привязываем наборы дескрипторов к пайплайну
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
         0, 2, descriptorSets.data(), 0, nullptr
     );
 
-    int textureIndexOffset = 0; // отступ в массиве текстур для текущего объекта
-    for (auto& id : modelObjectsIds)
-    {
-        auto& obj = frameInfo.sceneObjects[id];
+    frameInfo.indirectDrawBuffer.drawRange(commandBuffer, pipelineLayout, firstDraw, drawCount, stats);
+}
 
-        TextureSystemPushConstantData push{};
-        push.modelMatrix = obj.transform.modelMatrix();
-        push.normalMatrix = obj.transform.normalMatrix();
+std::pair<uint32_t, uint32_t> TextureRenderSystem::drawSpan(const WrpIndirectDrawBuffer& indirectDraws) const
+{
+    // пачки системы записаны подряд, поэтому их отрисовки образуют один непрерывный диапазон
+    if (drawBatches.empty())
+        return {0, 0};
+    const uint32_t firstDraw = indirectDraws.getBatchFirstDraw(drawBatches.front());
+    return {firstDraw, indirectDraws.getBatchEndDraw(drawBatches.back()) - firstDraw};
+}
 
-        // прикрепление буфера вершин (модели) и буфера индексов к буферу команд (создание привязки)
-        obj.model->bind(frameInfo.commandBuffer);
+void TextureRenderSystem::renderSceneObjects(FrameInfo& frameInfo)
+{
+    WrpPipeline* pipeline = currentPipeline(frameInfo.renderingSettings);
+    const auto [firstDraw, drawCount] = drawSpan(frameInfo.indirectDrawBuffer);
+    recordDraws(frameInfo.commandBuffer, *pipeline, frameInfo, firstDraw, drawCount, frameInfo.renderStats);
+}
 
-        // Отрисовка каждого подобъекта .obj модели по отдельности с передачей своего индекса текстуры
-        for (auto& subMesh : obj.model->getSubMeshesInfos())
-        {
-            if (subMesh.diffuseTextureIndex != -1) {
-                push.diffTexIndex = textureIndexOffset + subMesh.diffuseTextureIndex;
-            }
-            else {
-                push.diffTexIndex = -1;
-            }
-
-            if (subMesh.specularTextureIndex != -1) {
-                push.specTexIndex = textureIndexOffset + subMesh.specularTextureIndex;
-            }
-            else {
-                push.specTexIndex = -1;
-            }
-            push.diffuseColor = subMesh.diffuseColor;	
-
-            vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0, sizeof(TextureSystemPushConstantData), &push
-            );
-
-            // отрисовка буфера вершин
-            obj.model->drawIndexed(frameInfo.commandBuffer, subMesh.indexCount, subMesh.indexStart);
-        }
-        textureIndexOffset += obj.model->getTextures().size();
-    }
+std::vector<VkCommandBuffer> TextureRenderSystem::renderSceneObjects(FrameInfo& frameInfo, WrpCommandRecorder& recorder)
+{
+    // пайплайн берётся до раздачи работы потокам: кэш вариантов не рассчитан на параллельные обращения
+    WrpPipeline* pipeline = currentPipeline(frameInfo.renderingSettings);
+    // делятся отрисовки, а не пачки; экземпляры каждой модели prepareSceneObjects уже разбил на части по потокам
+    const auto [firstDraw, drawCount] = drawSpan(frameInfo.indirectDrawBuffer);
+    return recorder.recordParallel(drawCount, frameInfo.renderingSettings.recordingThreads, frameInfo.renderStats,
+        [this, pipeline, &frameInfo, firstDraw = firstDraw](VkCommandBuffer commandBuffer, uint32_t first, uint32_t count,
+            RenderStats& stats) {
+            recordDraws(commandBuffer, *pipeline, frameInfo, firstDraw + first, count, stats);
+        });
 }
@@ -1,56 +1,104 @@
 #pragma once
 
 #include "../Pipeline.hpp"
+#include "../PipelineVariantCache.hpp"
 #include "../Device.hpp"
 #include "../Renderer.hpp"
-#include "../SceneObject.hpp"
+#include "../Scene.hpp"
 #include "../Camera.hpp"
 #include "../FrameInfo.hpp"
 #include "../SwapChain.hpp"
 #include "../Descriptors.hpp"
 #include "../ShaderModule.hpp"
+#include "../ShaderWatcher.hpp"
+#include "../DrawList.hpp"
+#include "../CommandRecorder.hpp"
+#include "../GBuffer.hpp"
 
 // std
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 class TextureRenderSystem
 {
 public:
     TextureRenderSystem(WrpDevice& device, WrpRenderer& renderer,
-        VkDescriptorSetLayout globalSetLayout, FrameInfo frameInfo);
+        VkDescriptorSetLayout globalSetLayout, VkRenderPass gBufferRenderPass, FrameInfo frameInfo);
     ~TextureRenderSystem();
 
     TextureRenderSystem(const TextureRenderSystem&) = delete;
     TextureRenderSystem& operator=(const TextureRenderSystem&) = delete;
 
+    // Обновление дескрипторов текстур, отсечение и запись indirect-команд кадра, вызывается до начала прохода рендера
+    void prepareSceneObjects(FrameInfo& frameInfo);
+    // Запись отрисовок, подготовленных в prepareSceneObjects, внутри прохода рендера
     void renderSceneObjects(FrameInfo& frameInfo);
+    // То же, но отрисовки делятся между потоками поровну и записываются во вторичные буферы (их нужно выполнить
+    // в первичном буфере в возвращённом порядке). Экземпляры каждой модели prepareSceneObjects делит на диапазоны
+    // по числу потоков, поэтому работа делится и в сцене из одной повторяющейся модели
+    std::vector<VkCommandBuffer> renderSceneObjects(FrameInfo& frameInfo, WrpCommandRecorder& recorder);
+    // фоновая сборка варианта пайплайна для текущих настроек, чтобы первый кадр не собирал его сам
+    void prefetchPipelines(const RenderingSettings& renderingSettings);
+    // фоновая пересборка пайплайнов, использующих изменённые шейдеры
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
 
 private:
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    std::unique_ptr<WrpPipeline> createPipeline(VkRenderPass renderPass, int reflectionModel, int polygonFillMode);
+    PipelineVariantDesc pipelineVariantDesc(const RenderingSettings& renderingSettings) const;
+    WrpPipeline* currentPipeline(const RenderingSettings& renderingSettings);
+    // отрисовки [firstDraw, firstDraw + drawCount) из пачек системы (WrpIndirectDrawBuffer::drawRange)
+    void recordDraws(VkCommandBuffer commandBuffer, WrpPipeline& pipeline, FrameInfo& frameInfo,
+        uint32_t firstDraw, uint32_t drawCount, RenderStats& stats);
+    // диапазон отрисовок всех пачек системы в текущем кадре
+    std::pair<uint32_t, uint32_t> drawSpan(const WrpIndirectDrawBuffer& indirectDraws) const;
 
-    int fillModelsIds(SceneObject::Map& sceneObjects);
+    int fillModelsIds(WrpScene& sceneObjects);
     void createDescriptorSets(FrameInfo& frameInfo);
-    void rewriteAndRecompileFragShader(ShaderModule*& shaderModule, std::string fragShaderName, int texturesCount);
+    void createBindlessDescriptorSet();
+    void updateBindlessTextures(FrameInfo& frameInfo);
+    int textureSlot(WrpModel* model, int textureIndex, int textureIndexOffset) const;
 
     WrpDevice& wrpDevice;
     WrpRenderer& wrpRenderer;
+    VkRenderPass gBufferRenderPass; // проход WrpGBuffer для отложенного освещения
     VkDescriptorSetLayout globalSetLayout;
 
-    ShaderModule* fsModuleLambertian;
-    ShaderModule* fsModuleBlinnPhong;
-    ShaderModule* fsModuleTorranceSparrow;
-    std::unique_ptr<WrpPipeline> wrpPipelineLambertian;
-    std::unique_ptr<WrpPipeline> wrpPipelineBlinnPhong;
-    std::unique_ptr<WrpPipeline> wrpPipelineTorranceSparrow;
     VkPipelineLayout pipelineLayout = nullptr;
+    // варианты пайплайна по модели отражения и режиму полигонов, создаются при первом использовании
+    WrpPipelineVariantCache pipelineVariants;
+    int texturesCount = 0;
 
     std::vector<SceneObject::id_t> modelObjectsIds{};
     size_t prevModelCount = 0;
-    int curPlgnFillMode = 0;
 
     std::unique_ptr<WrpDescriptorPool> systemDescriptorPool;
     std::unique_ptr<WrpDescriptorSetLayout> systemDescriptorSetLayout;
     std::vector<VkDescriptorSet> systemDescriptorSets;
+
+    // Bindless путь (descriptor indexing): один update-after-bind набор с большим массивом сэмплеров на все кадры.
+    // Каждая текстура занимает свою ячейку массива, поэтому добавление модели - это только запись дескрипторов
+    // в свободные ячейки, без пересоздания пула, лэйаута и пайплайнов.
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+    struct ModelTextureSlots
+    {
+        std::shared_ptr<WrpModel> model; // текстуры модели должны жить, пока их ячейки заняты
+        std::vector<uint32_t> slots;     // индекс = индекс текстуры в модели
+    };
+
+    bool bindless = false;
+    VkDescriptorSet bindlessDescriptorSet = VK_NULL_HANDLE;
+    std::unordered_map<WrpModel*, ModelTextureSlots> modelTextureSlots;
+    // свободные ячейки; освобождённые ячейки возвращаются сюда через WrpRenderer::retireResource,
+    // т.е. уже после завершения кадров, которые могли их читать
+    std::shared_ptr<std::vector<uint32_t>> freeTextureSlots;
+
+    // список отрисовки и отступы объектов в массиве текстур (без bindless), переиспользуются между кадрами
+    WrpDrawList drawList;
+    std::vector<int> objectTextureOffsets;
+    std::vector<uint32_t> drawBatches; // пачки indirect-отрисовок текущего кадра
 };
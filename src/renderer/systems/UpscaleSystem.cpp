@@ -0,0 +1,100 @@
+#include "UpscaleSystem.hpp"
+
+// std
+#include <stdexcept>
+
+namespace
+{
+    // блок пуш-констант Upscale.frag
+    struct UpscalePushConstants
+    {
+        glm::vec2 outputTexelSize;
+        glm::vec2 uvScale;
+        glm::vec2 texelSize;
+        float sharpness;
+    };
+}
+
+UpscaleSystem::UpscaleSystem(WrpDevice& device, WrpRenderer& renderer, WrpDynamicResolution& dynamicResolution)
+    : wrpDevice{device}, wrpRenderer{renderer}, dynamicResolution{dynamicResolution}, pipelineVariants{device, renderer, "UpscaleSystem"}
+{
+    createPipelineLayout();
+}
+
+UpscaleSystem::~UpscaleSystem()
+{
+    pipelineVariants.wait(); // фоновые задачи используют pipelineLayout
+    vkDestroyPipelineLayout(wrpDevice.device(), pipelineLayout, nullptr);
+}
+
+void UpscaleSystem::createPipelineLayout()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(UpscalePushConstants);
+
+    // set 0 - разрешённый цвет внеэкранной цели
+    VkDescriptorSetLayout descriptorSetLayout = dynamicResolution.getDescriptorSetLayout();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(wrpDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+}
+
+PipelineVariantDesc UpscaleSystem::pipelineVariantDesc(bool fxaa) const
+{
+    PipelineVariantDesc desc{};
+    desc.vertShader = "Fullscreen.vert";
+    desc.fragShader = "Upscale.frag";
+    desc.fragDefines = ShaderPermutations::upscaleFragDefines(fxaa);
+    desc.vertexInput = false; // вершины полноэкранного треугольника генерируются в шейдере
+    // кадр сцены уже прошёл тест глубины во внеэкранной цели, в проходе swapchain'а после него рисуется только GUI
+    desc.depthTestEnable = false;
+    desc.depthWriteEnable = false;
+    desc.renderPass = wrpRenderer.getSwapChainRenderPass();
+    desc.samples = wrpRenderer.getMsaaSampleCount();
+    desc.minSampleShading = 0.f; // полноэкранному проходу достаточно одного вызова шейдера на пиксель
+    desc.pipelineLayout = pipelineLayout;
+    return desc;
+}
+
+void UpscaleSystem::prefetchPipelines(const RenderingSettings& renderingSettings)
+{
+    pipelineVariants.prefetch(pipelineVariantDesc(renderingSettings.fxaa));
+}
+
+void UpscaleSystem::reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders)
+{
+    pipelineVariants.reloadShaders(shaderWatcher, changedShaders);
+}
+
+void UpscaleSystem::render(FrameInfo& frameInfo)
+{
+    pipelineVariants.swapReloadedPipelines();
+    pipelineVariants.get(pipelineVariantDesc(frameInfo.renderingSettings.fxaa))->bind(frameInfo.commandBuffer);
+
+    VkDescriptorSet descriptorSet = dynamicResolution.getDescriptorSet();
+    vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+        0, 1, &descriptorSet, 0, nullptr);
+
+    const VkExtent2D outputExtent = wrpRenderer.getSwapChainExtent();
+    const VkExtent2D extent = dynamicResolution.getExtent();
+    const VkExtent2D renderExtent = dynamicResolution.getRenderExtent();
+    UpscalePushConstants push{};
+    push.outputTexelSize = 1.f / glm::vec2{outputExtent.width, outputExtent.height};
+    push.uvScale = glm::vec2{renderExtent.width, renderExtent.height} / glm::vec2{extent.width, extent.height};
+    push.texelSize = 1.f / glm::vec2{extent.width, extent.height};
+    push.sharpness = frameInfo.renderingSettings.sharpness;
+    vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+
+    vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+    frameInfo.renderStats.drawCalls++;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../Pipeline.hpp"
+#include "../PipelineVariantCache.hpp"
+#include "../Device.hpp"
+#include "../FrameInfo.hpp"
+#include "../Renderer.hpp"
+#include "../ShaderWatcher.hpp"
+#include "../DynamicResolution.hpp"
+
+// std
+#include <string>
+#include <unordered_set>
+
+/*
+ * Перенос кадра сцены из внеэкранной цели динамического разрешения в проход swapchain'а: полноэкранный треугольник
+ * растягивает область getRenderExtent на весь кадр билинейной выборкой с повышением резкости (Upscale.frag),
+ * а с RenderingSettings::fxaa - со сглаживанием FXAA вместо неё.
+ */
+class UpscaleSystem
+{
+public:
+    UpscaleSystem(WrpDevice& device, WrpRenderer& renderer, WrpDynamicResolution& dynamicResolution);
+    ~UpscaleSystem();
+
+    UpscaleSystem(const UpscaleSystem&) = delete;
+    UpscaleSystem& operator=(const UpscaleSystem&) = delete;
+
+    // Запись внутри прохода рендера swapchain'а, после завершения прохода внеэкранной цели
+    void render(FrameInfo& frameInfo);
+    // фоновая сборка пайплайнов, чтобы первое включение динамического разрешения или FXAA не собирало их само
+    void prefetchPipelines(const RenderingSettings& renderingSettings);
+    // фоновая пересборка пайплайнов, использующих изменённые шейдеры
+    void reloadShaders(WrpShaderWatcher& shaderWatcher, const std::unordered_set<std::string>& changedShaders);
+
+private:
+    void createPipelineLayout();
+    PipelineVariantDesc pipelineVariantDesc(bool fxaa) const;
+
+    WrpDevice& wrpDevice;
+    WrpRenderer& wrpRenderer;
+    WrpDynamicResolution& dynamicResolution;
+
+    VkPipelineLayout pipelineLayout;
+    WrpPipelineVariantCache pipelineVariants;
+};
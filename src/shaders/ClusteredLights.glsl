@@ -0,0 +1,39 @@
+// Точечные источники света и их списки по кластерам пирамиды видимости (заполняются WrpLightClusters на CPU).
+// Подключается после блока GlobalUBO, объявленного с именем globalUbo.
+
+struct PointLight {
+    vec4 position; // w - радиус влияния источника
+    vec4 color;    // w - интенсивность цвета
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer PointLights {
+    PointLight pointLights[];
+};
+
+// для каждого кластера: x - начало списка в lightIndices, y - количество источников
+layout(std430, set = 0, binding = 6) readonly buffer LightClusters {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+// Кластер фрагмента: плитка - по gl_FragCoord, срез - по глубине в пространстве камеры.
+// clusterGrid.xyz - размеры сетки, clusterParams.xy - размер кадра в пикселях, zw - scale и bias номера среза.
+uvec2 fragmentCluster(vec3 fragPosWorld) {
+    uvec3 grid = globalUbo.clusterGrid.xyz;
+    float viewDepth = (globalUbo.view * vec4(fragPosWorld, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / globalUbo.clusterParams.xy * vec2(grid.xy)), grid.xy - 1u);
+    float slice = log(max(viewDepth, 1e-4)) * globalUbo.clusterParams.z + globalUbo.clusterParams.w;
+    uint z = uint(clamp(slice, 0.0, float(grid.z - 1u)));
+    return clusters[(z * grid.y + tile.y) * grid.x + tile.x];
+}
+
+// Ослабевание по обратному квадрату расстояния, плавно сведённое к нулю на радиусе влияния:
+// за его пределами источник не попадает в списки кластеров, поэтому его вклад там должен быть нулевым.
+float pointLightAttenuation(float distanceSquared, float radius) {
+    float ratio = distanceSquared / (radius * radius);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    return window * window / distanceSquared;
+}
@@ -0,0 +1,89 @@
+#version 450
+
+// Проход освещения отложенного пути: полноэкранный треугольник, для каждого пикселя позиция восстанавливается
+// по глубине G-buffer'а, а освещение считается теми же моделями отражения (ReflectionModels.glsl) и по тем же
+// спискам источников кластеров (ClusteredLights.glsl), что и в прямом пути.
+// REFLECTION_MODEL передаётся макросом: 0 - Ламберт, 1 - Блинн-Фонг, 2 - Кука-Торранса.
+#ifndef REFLECTION_MODEL
+#define REFLECTION_MODEL 0
+#endif
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor;
+    float directionalLightIntensity;
+    vec4 directionalLightPosition;
+    float diffuseProportion;
+    float roughness;
+    float indexOfRefraction;
+    uvec4 clusterGrid;   // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    vec4 clusterParams;  // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
+} globalUbo;
+
+// вложения G-buffer'а (WrpGBuffer), размер совпадает с кадром, поэтому читаются по gl_FragCoord без фильтрации
+layout(set = 1, binding = 0) uniform sampler2D gBufferAlbedo;
+layout(set = 1, binding = 1) uniform sampler2D gBufferSpecular;
+layout(set = 1, binding = 2) uniform sampler2D gBufferNormal;
+layout(set = 1, binding = 3) uniform sampler2D gBufferDepth;
+
+#include <ClusteredLights.glsl>
+#include <ReflectionModels.glsl>
+
+// Source of directional light
+vec3 DIRECTION_TO_LIGHT = normalize(globalUbo.directionalLightPosition.xyz);
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gBufferDepth, pixel, 0).r;
+    if (depth >= 1.0) discard; // фон: в G-buffer ничего не рисовалось
+
+    // Позиция в пространстве камеры по глубине: d = P[2][2] + P[3][2] / z (P[2][3] = 1, w = z),
+    // x и y - из ndc пикселя (проекция симметрична, y вниз, как и в кадре Vulkan)
+    mat4 P = globalUbo.projection;
+    vec2 ndc = gl_FragCoord.xy / globalUbo.clusterParams.xy * 2.0 - 1.0;
+    float viewZ = P[3][2] / (depth - P[2][2]);
+    vec3 fragPosView = vec3(ndc.x * viewZ / P[0][0], ndc.y * viewZ / P[1][1], viewZ);
+    vec3 fragPosWorld = (globalUbo.invView * vec4(fragPosView, 1.0)).xyz;
+
+    vec3 albedo = texelFetch(gBufferAlbedo, pixel, 0).rgb;
+    vec4 specular = texelFetch(gBufferSpecular, pixel, 0); // a - шероховатость
+    vec3 surfaceNormal = normalize(texelFetch(gBufferNormal, pixel, 0).xyz);
+
+    vec3 diffuseLight = globalUbo.ambientLightColor.xyz * globalUbo.ambientLightColor.w;
+    vec3 specularLight = vec3(0.0);
+    vec3 cameraPosWorld = globalUbo.invView[3].xyz;
+    vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+    // Вклад направленного источника света в рассеянное освещение
+    diffuseLight += max(dot(surfaceNormal, DIRECTION_TO_LIGHT), 0) * globalUbo.directionalLightIntensity;
+
+    // обходятся только источники, сфера влияния которых пересекает кластер пикселя
+    uvec2 cluster = fragmentCluster(fragPosWorld);
+    for (uint i = 0; i < cluster.y; ++i) {
+        PointLight light = pointLights[lightIndices[cluster.x + i]];
+
+        vec3 directionToLight = light.position.xyz - fragPosWorld;
+        float attenuation = pointLightAttenuation(dot(directionToLight, directionToLight), light.position.w);
+        directionToLight = normalize(directionToLight);
+        vec3 intensity = light.color.xyz * light.color.w * attenuation;
+
+#if REFLECTION_MODEL == 0
+        lambertian(surfaceNormal, directionToLight, intensity, diffuseLight);
+#elif REFLECTION_MODEL == 1
+        blinnPhong(surfaceNormal, directionToLight, viewDirection, intensity, globalUbo.diffuseProportion,
+            diffuseLight, specularLight);
+#else
+        torranceSparrow(surfaceNormal, directionToLight, viewDirection, intensity, specular.a,
+            globalUbo.indexOfRefraction, diffuseLight, specularLight);
+#endif
+    }
+
+    outColor = vec4(diffuseLight * albedo + specularLight * specular.rgb, 1.0);
+    // глубина G-buffer'а переносится в проход swapchain'а, чтобы билборды источников и прочие прямые
+    // отрисовки после прохода освещения перекрывались геометрией сцены
+    gl_FragDepth = depth;
+}
@@ -0,0 +1,35 @@
+#version 450
+
+// Заполнение G-buffer'а для моделей без текстур (отложенное освещение, DeferredLighting.frag).
+// Входы совпадают с выходами NoTexture.vert.
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPosWorld;
+layout(location = 2) in vec3 fragNormalWorld;
+layout(location = 3) in vec2 fragUv;
+
+layout(location = 0) out vec4 outAlbedo;   // rgb - цвет рассеянного отражения
+layout(location = 1) out vec4 outSpecular; // rgb - цвет зеркального отражения, a - шероховатость
+layout(location = 2) out vec4 outNormal;   // xyz - нормаль в мировом пространстве
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor;
+    float directionalLightIntensity;
+    vec4 directionalLightPosition;
+    float diffuseProportion;
+    float roughness;
+    float indexOfRefraction;
+    uvec4 clusterGrid;   // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    vec4 clusterParams;  // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
+} globalUbo;
+
+void main() {
+    // как и в прямом пути, модели без цвета получают тёмно-серый цвет, чтобы было видно влияние освещения
+    vec3 color = fragColor == vec3(0.0) ? vec3(0.02) : fragColor;
+
+    outAlbedo = vec4(color, 1.0);
+    outSpecular = vec4(color, globalUbo.roughness);
+    outNormal = vec4(normalize(fragNormalWorld), 1.0);
+}
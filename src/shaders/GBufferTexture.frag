@@ -0,0 +1,79 @@
+#version 450
+
+// Заполнение G-buffer'а для моделей с текстурами (отложенное освещение, DeferredLighting.frag).
+// Входы и массив текстур совпадают с прямыми Texture*.frag шейдерами.
+
+#ifdef BINDLESS
+// Bindless path: one update-after-bind array shared by all models, texture indices are global slots
+#extension GL_EXT_nonuniform_qualifier : require
+#define TEXTURES
+layout(set = 1, binding = 0) uniform sampler2D texSampler[]; // variable count Combined Image Sampler descriptors
+// one multi-draw indirect call covers draws with different materials, so the index may differ between invocations
+#define TEXTURE_INDEX(index) nonuniformEXT(index)
+#else
+// TEXTURES_COUNT is passed by TextureRenderSystem as a compiler macro
+#ifndef TEXTURES_COUNT
+#define TEXTURES_COUNT 0
+#endif
+
+#if TEXTURES_COUNT > 0
+#define TEXTURES
+layout(set = 1, binding = 0) uniform sampler2D texSampler[TEXTURES_COUNT]; // Combined Image Sampler descriptors
+#endif
+#define TEXTURE_INDEX(index) index
+#endif
+
+// Input variables interpolated from 3 vertcies
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragPosWorld;
+layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
+// Material of the current draw, fetched by the vertex shader from DrawData. It is constant within one draw
+// of a multi-draw indirect call but not across the call, so bindless indexing goes through TEXTURE_INDEX
+layout (location = 4) flat in int fragDiffTexIndex;
+layout (location = 5) flat in int fragSpecTexIndex;
+layout (location = 6) flat in vec3 fragDiffuseColor;
+
+layout (location = 0) out vec4 outAlbedo;   // rgb - цвет рассеянного отражения
+layout (location = 1) out vec4 outSpecular; // rgb - цвет зеркального отражения, a - шероховатость
+layout (location = 2) out vec4 outNormal;   // xyz - нормаль в мировом пространстве
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor;
+    float directionalLightIntensity;
+    vec4 directionalLightPosition;
+    float diffuseProportion;
+    float roughness;
+    float indexOfRefraction;
+    uvec4 clusterGrid;   // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    vec4 clusterParams;  // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
+} globalUbo;
+
+void main() {
+    // Фрагмент получает цвет по координатам текстуры,
+    // либо диффузный цвет своего материала, если для него текструра отсутствует.
+    vec4 sampleTextureColor = vec4(0.8, 0.1, 0.1, 1);
+    vec4 specularColor = vec4(0.0, 0.0, 0.0, 1);
+    if (fragDiffTexIndex != -1) {
+#ifdef TEXTURES
+        sampleTextureColor = texture(texSampler[TEXTURE_INDEX(fragDiffTexIndex)], fragUv);
+#endif
+    } else {
+        sampleTextureColor = vec4(fragDiffuseColor, 1.0);
+    }
+
+    if (fragSpecTexIndex != -1) {
+#ifdef TEXTURES
+        specularColor = texture(texSampler[TEXTURE_INDEX(fragSpecTexIndex)], fragUv);
+#endif
+    } else {
+        specularColor = sampleTextureColor;
+    }
+
+    outAlbedo = vec4(sampleTextureColor.rgb, 1.0);
+    outSpecular = vec4(specularColor.rgb, globalUbo.roughness);
+    outNormal = vec4(normalize(fragNormalWorld), 1.0);
+}
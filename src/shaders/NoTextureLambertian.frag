@@ -7,17 +7,6 @@ layout(location = 3) in vec2 fragUv;
 
 layout(location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position; // w - ignored
-    vec4 color;    // w - color intensity
-};
-
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-    vec3 diffuseColor;
-} push;
-
 layout(set = 0, binding = 0) uniform GlobalUBO {
     mat4 projection;
     mat4 view;
@@ -25,13 +14,16 @@ layout(set = 0, binding = 0) uniform GlobalUBO {
     vec4 ambientLightColor;
     float directionalLightIntensity;
     vec4 directionalLightPosition;
-    PointLight pointLights[10];
-    int numLights;
     float diffuseProportion;
     float roughness;
     float indexOfRefraction;
+    uvec4 clusterGrid;   // cluster grid size (xyz) and point light count (w)
+    vec4 clusterParams;  // frame size in pixels (xy), depth slice scale and bias (zw)
 } globalUbo;
 
+#include <ClusteredLights.glsl>
+#include <ReflectionModels.glsl>
+
 // Source of directional light
 vec3 DIRECTION_TO_LIGHT = normalize(globalUbo.directionalLightPosition.xyz);
 
@@ -42,17 +34,17 @@ void main() {
     // Directional light contribution
     diffuseLight += max(dot(surfaceNormal, DIRECTION_TO_LIGHT), 0) * globalUbo.directionalLightIntensity;
 
-    for (int i = 0; i < globalUbo.numLights; ++i) {
-        PointLight light = globalUbo.pointLights[i];
+    // only the lights whose influence spheres intersect the fragment cluster
+    uvec2 cluster = fragmentCluster(fragPosWorld);
+    for (uint i = 0; i < cluster.y; ++i) {
+        PointLight light = pointLights[lightIndices[cluster.x + i]];
 
         vec3 directionToLight = light.position.xyz - fragPosWorld;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight); // intensity attenuation factor
+        float attenuation = pointLightAttenuation(dot(directionToLight, directionToLight), light.position.w); // intensity attenuation factor
         directionToLight = normalize(directionToLight);
-
-        float NdotL = max(dot(surfaceNormal, directionToLight), 0); // cosine of the angle of incidence 
         vec3 intensity = light.color.xyz * light.color.w * attenuation;
 
-        diffuseLight += intensity * NdotL;
+        lambertian(surfaceNormal, directionToLight, intensity, diffuseLight);
     }
 
     // using dark grey for black (no color) models to see light impact
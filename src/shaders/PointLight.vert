@@ -13,42 +13,41 @@ const vec2 OFFSETS[6] = vec2[](
 
 // Выходная переменная отступа, которая будет линейно интерполирована во frag шейдере
 layout (location = 0) out vec2 fragOffset;
+layout (location = 1) flat out vec4 fragColor; // цвет источника (w - интенсивность)
  
-struct PointLight {
-    vec4 position; // w - игнорируется
-    vec4 color;    // w - интенсивность цвета
-};
-
 // Ubo объект такой же как и в simple shader
 layout(set = 0, binding = 0) uniform GlobalUBO {
     mat4 projection;
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
     float diffuseProportion;
     float roughness;
     float indexOfRefraction;
 } ubo;
 
-// Пришедшая структура пуш-констант
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
+// Билборды кадра, отсортированные от дальних к ближним (PointLightSystem), один экземпляр - один билборд
+struct Billboard {
+    vec4 position; // w - радиус билборда
+    vec4 color;    // w - интенсивность
+};
+layout(std430, set = 1, binding = 0) readonly buffer Billboards {
+    Billboard billboards[];
+};
 
 void main() {
     fragOffset = OFFSETS[gl_VertexIndex]; // gl_VertexIndex хранит индекс текущей обрабатываемой вершины
+    Billboard billboard = billboards[gl_InstanceIndex];
+    fragColor = billboard.color;
 
     // Извелечение векторов "вверх" и "вправо" из View матрицы (в данный момент это World Space)
     vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
     vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
     // Вычисление позиции вершины билборда в мировом пространстве
-    vec3 positionWorld = push.position.xyz + push.radius * fragOffset.x * cameraRightWorld
-        + push.radius * fragOffset.y * cameraUpWorld;
+    float radius = billboard.position.w;
+    vec3 positionWorld = billboard.position.xyz + radius * fragOffset.x * cameraRightWorld
+        + radius * fragOffset.y * cameraUpWorld;
 
     // Перевод положения полученной вершины Point Light билборда в каноническое пространство
     gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
@@ -0,0 +1,116 @@
+// Модели отражения точечных источников, общие для прямого (NoTexture*/Texture* шейдеры) и отложенного
+// (DeferredLighting.frag) освещения. N, L и V - нормализованные нормаль, направления к источнику и к наблюдателю,
+// intensity - цвет источника с учётом его интенсивности и ослабевания.
+
+// --- Functions ---
+// Geometrical attenuation - Schlick-GGX
+float G1(float alpha, float NdotX);             // Schlick-Beckmann geometry shadowing function
+float G(float alpha, float NdotE, float NdotL); // Smith model
+// Schlick's Fresnel factor approximation
+float FresnelSchlick(float n, float HdotE);
+
+// Geometrical attenuation from [Jim Blinn, 1977] paper
+float geometricalAttenuation_Blinn1977(float NdotL, float NdotH, float NdotE, float HdotE);
+// Fresnel function from [Jim Blinn, 1977] paper
+float Fresnel_Blinn1977(float n, float HdotE);
+// Torrance-Sparrow microfacet model, source: [Blinn, 1977]
+float Specular_TorranceSparrow_Blinn1977(float alpha, float n, float NdotL, float NdotH, float NdotE, float HdotE);
+// ---    ---
+
+// Ламберт: только рассеянный свет
+void lambertian(vec3 N, vec3 L, vec3 intensity, inout vec3 diffuseLight) {
+    float NdotL = max(dot(N, L), 0.0); // cosine of the angle of incidence
+    diffuseLight += intensity * NdotL;
+}
+
+// Блинн-Фонг: доли рассеянного и зеркального света задаются вручную (diffuseProportion)
+void blinnPhong(vec3 N, vec3 L, vec3 V, vec3 intensity, float diffuseProportion,
+    inout vec3 diffuseLight, inout vec3 specularLight) {
+    float specularProportion = 1.0 - diffuseProportion; // energy conservation rule
+    float NdotL = max(dot(N, L), 0.0);
+    diffuseLight += diffuseProportion * intensity * NdotL;
+
+    vec3 H = normalize(L + V);
+    float blinnTerm = clamp(dot(N, H), 0.0, 1.0); // источник или наблюдатель с другой стороны поверхности не дают блика
+    blinnTerm = pow(blinnTerm, 60.0);              // больше степень => резче блик отражённого света
+    specularLight += specularProportion * intensity * blinnTerm;
+}
+
+// Кука-Торранса (Torrance-Sparrow): доли рассеянного и зеркального света задаёт коэффициент Френеля
+void torranceSparrow(vec3 N, vec3 L, vec3 V, vec3 intensity, float roughness, float indexOfRefraction,
+    inout vec3 diffuseLight, inout vec3 specularLight) {
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 H = normalize(L + V); // Halfway direction
+    float HdotE = max(dot(H, V), 0.0);
+    float F = FresnelSchlick(indexOfRefraction, HdotE);
+    float specularProportion = F;
+    float diffuseProportion = 1.0 - specularProportion;
+
+    float alpha = pow(roughness, 2); // roughness [0;1] <=> [specular;diffuse]
+    float NdotH = max(dot(N, H), 0.0);
+    float D = pow(alpha / (pow(NdotH, 2) * (alpha - 1) + 1), 2);
+
+    float NdotE = max(dot(N, V), 0.0); // (N * E) - cosine of inclination angle
+    float geometry = G(alpha, NdotE, NdotL);
+
+    diffuseLight += diffuseProportion * intensity * NdotL;
+    // Cook-Torrance specular reflection model
+    specularLight += specularProportion * intensity * D * geometry * F / 4 * max(NdotL, 0.000001) * max(NdotE, 0.000001);
+    // Torrance-Sparrow [Blinn, 1977]
+    //specularLight += specularProportion * intensity * Specular_TorranceSparrow_Blinn1977(alpha, indexOfRefraction, NdotL, NdotH, NdotE, HdotE);
+}
+
+float Specular_TorranceSparrow_Blinn1977(float alpha, float n, float NdotL, float NdotH, float NdotE, float HdotE)
+{
+    // D - Facet distribution function (D3 - Trowbridge-Reitz (GGX) function)
+    float D = pow(alpha / (pow(NdotH,2) * (alpha-1)+1), 2);
+    // G - geometrical attenuation factor.
+    float G = geometricalAttenuation_Blinn1977(NdotL, NdotH, NdotE, HdotE);
+    // F - Frenel reflection
+    float F = Fresnel_Blinn1977(n, HdotE);
+    // 1 / NdotE is used in G factor so its omitted
+    return D * G * F; // Torrance-Sparrow equation for [Blinn, 1977] (1/NdotE in G variant).
+}
+
+float G1(float alpha, float NdotX)
+{
+    float numerator = NdotX;
+    float k = alpha / 2.0;
+    float denominator = NdotX * (1.0 - k) + k;
+    denominator = max(denominator, 0.000001);
+    return numerator / denominator;
+}
+
+float G(float alpha, float NdotE, float NdotL)
+{
+    return G1(alpha, NdotE) * G1(alpha, NdotL);
+}
+
+float FresnelSchlick(float n, float HdotE)
+{
+    float F0 = pow(n-1, 2)/pow(n+1, 2);
+    return F0 + (1 - F0) * pow(1 - HdotE, 5);
+}
+
+float geometricalAttenuation_Blinn1977(float NdotL, float NdotH, float NdotE, float HdotE)
+{
+    // 1/NdotE factor from main equation is combined here, therefore
+    // it's not needed in the final equasion for specular light.
+    float G = 0;
+    if (NdotE < NdotL) {
+        if (2 * NdotE * NdotH < HdotE) G = 2 * NdotH / HdotE;
+        else G = 1 / NdotE;
+    }
+    else {
+        if (2 * NdotL * NdotH < HdotE) G = 2 * NdotH * NdotL / HdotE * NdotE;
+        else G = 1 / NdotE;
+    }
+    return G;
+}
+
+float Fresnel_Blinn1977(float n, float HdotE)
+{
+    float c = HdotE;
+    float g = sqrt(pow(n,2) + pow(c,2) - 1);
+    return pow(g-c,2)/pow(g+c,2) * (1 + pow(c * (g+c) - 1, 2)/pow(c * (g-c) + 1, 2));
+}
@@ -1,5 +1,14 @@
 #version 450
 
+#ifdef MULTI_DRAW_INDIRECT
+// Несколько отрисовок в одном vkCmdDrawIndexedIndirect различаются по gl_DrawIDARB
+#extension GL_ARB_shader_draw_parameters : require
+#define DRAW_ID gl_DrawIDARB
+#else
+// без multi-draw indirect каждая indirect-команда отправляется отдельным вызовом со своим drawOffset
+#define DRAW_ID 0
+#endif
+
 /*
 vec2 positions[3] = vec2[] (
     vec2(0.0, -0.5),
@@ -21,11 +30,9 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUv;
-
-struct PointLight {
-    vec4 position; // w - игнорируется
-    vec4 color;    // w - интенсивность цвета
-};
+layout(location = 4) flat out int fragDiffTexIndex;
+layout(location = 5) flat out int fragSpecTexIndex;
+layout(location = 6) flat out vec3 fragDiffuseColor;
 
 // Тип, который получает данные из унифицированного буфера с ubo объектом внутри.
 // Такой read only buffer передаётся через набор дескрипторов, в котором он содержится
@@ -37,26 +44,64 @@ layout(set = 0, binding = 0) uniform GlobalUBO {
     vec4 ambientLightColor;
     float directionalLightIntensity;
     vec4 directionalLightPosition;
-    PointLight pointLights[10];
-    int numLights;
     float diffuseProportion;
     float roughness;
     float indexOfRefraction;
+    uvec4 clusterGrid;   // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    vec4 clusterParams;  // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
 } globalUbo;
 
+// Матрицы объектов лежат в storage buffer экземпляров. Объекты с одной моделью рисуются одним
+// instanced-вызовом, и gl_InstanceIndex (с учётом firstInstance, либо DrawData::firstInstance без
+// drawIndirectFirstInstance) указывает на данные текущего экземпляра.
+struct InstanceData {
+    mat4 modelMatrix;
+    mat3 normalMatrix;
+    vec4 boundingSphere;
+    uint group;
+    uint groupFirst;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// Данные подобъекта (материал) для каждой отрисовки, индекс = drawOffset + gl_DrawID
+struct DrawData {
+    vec4 diffuseColor;
+    int diffTexIndex;
+    int specTexIndex;
+    uint firstInstance; // начало экземпляров, если его нет в gl_InstanceIndex (без drawIndirectFirstInstance)
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+} drawDataBuffer;
+
+// Индексы видимых экземпляров, упакованные в начало диапазона группы (при GPU отсечении их пишет compute шейдер),
+// и индекс DrawData для каждой indirect-команды (после упаковки команд GPU отсечением порядок меняется)
+layout(std430, set = 0, binding = 3) readonly buffer VisibleInstances {
+    uint visibleInstances[];
+} visibleInstanceBuffer;
+
+layout(std430, set = 0, binding = 4) readonly buffer DrawRemap {
+    uint drawRemap[];
+} drawRemapBuffer;
+
 // Блок, который получает значения из структуры пуш-констант. Блок пуш-констант должен быть
 // только один для одного шейдера, а его порядок полей должен совпадать со структурой, записанной в буфере команд.
 layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-    int textureIndex;
-    vec3 diffuseColor;
+    uint drawOffset; // начало текущей пачки indirect-отрисовок в массиве DrawData
 } push;
 
 void main() {
+    DrawData draw = drawDataBuffer.draws[drawRemapBuffer.drawRemap[push.drawOffset + uint(DRAW_ID)]];
+    InstanceData instance =
+        instanceBuffer.instances[visibleInstanceBuffer.visibleInstances[draw.firstInstance + uint(gl_InstanceIndex)]];
+
     // Если вектор обозначает направление, то однородную координату нужно заменить на 0,
     // чтобы на вектор не применился сдвиг (translation).
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0); // перевод позиции вершины в мировое пространство
+    vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0); // перевод позиции вершины в мировое пространство
 
     // Дополнительное применение аффинного преобразования (projectionViewMatrix * positionWorld).
     gl_Position = globalUbo.projection * globalUbo.view * positionWorld;
@@ -67,14 +112,17 @@ void main() {
 
     // Для осуществления корректных преобразований нормали, матрица модели сначала инвертируется,
     // а затем транспонируется.
-    //mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
+    //mat3 normalMatrix = transpose(inverse(mat3(instance.modelMatrix)));
     //vec3 normalWorldSpace = normalize(normalMatrix * normal);
     // Нахождение матрицы нормали было вынесено на сторону хоста.
 
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld = normalize(instance.normalMatrix * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
     fragUv = uv;
+    fragDiffTexIndex = draw.diffTexIndex;
+    fragSpecTexIndex = draw.specTexIndex;
+    fragDiffuseColor = draw.diffuseColor.rgb;
 
     // прежние строки
     //gl_Position = vec4(push.transform * position + push.offset, 0.0, 1.0);
@@ -1,28 +1,38 @@
 #version 450
 
+#ifdef BINDLESS
+// Bindless path: one update-after-bind array shared by all models, texture indices are global slots
+#extension GL_EXT_nonuniform_qualifier : require
+#define TEXTURES
+layout(set = 1, binding = 0) uniform sampler2D texSampler[]; // variable count Combined Image Sampler descriptors
+// one multi-draw indirect call covers draws with different materials, so the index may differ between invocations
+#define TEXTURE_INDEX(index) nonuniformEXT(index)
+#else
+// TEXTURES_COUNT is passed by TextureRenderSystem as a compiler macro
+#ifndef TEXTURES_COUNT
 #define TEXTURES_COUNT 0
+#endif
+
+#if TEXTURES_COUNT > 0
+#define TEXTURES
+layout(set = 1, binding = 0) uniform sampler2D texSampler[TEXTURES_COUNT]; // Combined Image Sampler descriptors
+#endif
+#define TEXTURE_INDEX(index) index
+#endif
 
 // Input variables interpolated from 3 vertcies
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragUv;
+// Material of the current draw, fetched by the vertex shader from DrawData. It is constant within one draw
+// of a multi-draw indirect call but not across the call, so bindless indexing goes through TEXTURE_INDEX
+layout (location = 4) flat in int fragDiffTexIndex;
+layout (location = 5) flat in int fragSpecTexIndex;
+layout (location = 6) flat in vec3 fragDiffuseColor;
 
 layout (location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position; // w - ignored
-    vec4 color;    // w - color intensity
-};
-
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-    int diffTexIndex;
-    int specTexIndex;
-    vec3 diffuseColor;
-} push;
-
 layout(set = 0, binding = 0) uniform GlobalUBO {
     mat4 projection;
     mat4 view;
@@ -30,20 +40,22 @@ layout(set = 0, binding = 0) uniform GlobalUBO {
     vec4 ambientLightColor;
     float directionalLightIntensity;
     vec4 directionalLightPosition;
-    PointLight pointLights[10];
-    int numLights;
     float diffuseProportion;
     float roughness;
     float indexOfRefraction;
+    uvec4 clusterGrid;   // размеры сетки кластеров (xyz) и количество точечных источников (w)
+    vec4 clusterParams;  // размер кадра в пикселях (xy), scale и bias номера среза по глубине (zw)
 } globalUbo;
 
+#include <ClusteredLights.glsl>
+#include <ReflectionModels.glsl>
+
 // Source of directional light
 vec3 DIRECTION_TO_LIGHT = normalize(globalUbo.directionalLightPosition.xyz);
 
 void main() {
     vec3 diffuseLight = globalUbo.ambientLightColor.xyz * globalUbo.ambientLightColor.w;
     vec3 specularLight = vec3(0.0);
-    float specularProportion = 1.0 - globalUbo.diffuseProportion; // energy conservation rule
     vec3 surfaceNormal = normalize(fragNormalWorld);
 
     vec3 cameraPosWorld = globalUbo.invView[3].xyz;
@@ -51,42 +63,36 @@ void main() {
 
     diffuseLight += max(dot(surfaceNormal, DIRECTION_TO_LIGHT), 0) * globalUbo.directionalLightIntensity;
 
-    for (int i = 0; i < globalUbo.numLights; ++i) {
-        PointLight light = globalUbo.pointLights[i];
+    // обходятся только источники, сфера влияния которых пересекает кластер фрагмента
+    uvec2 cluster = fragmentCluster(fragPosWorld);
+    for (uint i = 0; i < cluster.y; ++i) {
+        PointLight light = pointLights[lightIndices[cluster.x + i]];
 
         // --- diffuse term ---
         vec3 directionToLight = light.position.xyz - fragPosWorld;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight);
+        float attenuation = pointLightAttenuation(dot(directionToLight, directionToLight), light.position.w);
         directionToLight = normalize(directionToLight);
-        float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
         vec3 intensity = light.color.xyz * light.color.w * attenuation;
 
-        diffuseLight += globalUbo.diffuseProportion * intensity * cosAngIncidence;
-
-        // --- specular term ---
-        vec3 halfAngleVec = normalize(directionToLight + viewDirection);
-        float blinnTerm = dot(surfaceNormal, halfAngleVec); // фактор-член влияния зеркального света по Блинн-Фонгу на интенсивность отражённого света
-        blinnTerm = clamp(blinnTerm, 0, 1);  // отбросить случаи, когда источник света или наблюдатель находятся с другой стороны поверхности
-        blinnTerm = pow(blinnTerm, 60.0);  // больше степень => резче блик отражённого света
-
-        specularLight += specularProportion * intensity * blinnTerm;
+        blinnPhong(surfaceNormal, directionToLight, viewDirection, intensity, globalUbo.diffuseProportion,
+            diffuseLight, specularLight);
     }
 
     // Фрагмент получает цвет по координатам текстуры,
     // либо диффузный цвет своего материала, если для него текструра отсутствует.
     vec4 sampleTextureColor = vec4(0.8, 0.1, 0.1, 1);
     vec4 specularColor = vec4(0.0, 0.0, 0.0, 1);
-    if (push.diffTexIndex != -1) {
+    if (fragDiffTexIndex != -1) {
 #ifdef TEXTURES
-        sampleTextureColor = texture(texSampler[push.diffTexIndex], fragUv);
+        sampleTextureColor = texture(texSampler[TEXTURE_INDEX(fragDiffTexIndex)], fragUv);
 #endif
     } else {
-        sampleTextureColor = vec4(push.diffuseColor, 1.0);
+        sampleTextureColor = vec4(fragDiffuseColor, 1.0);
     }
 
-    if (push.specTexIndex != -1) {
+    if (fragSpecTexIndex != -1) {
 #ifdef TEXTURES
-        specularColor = texture(texSampler[push.specTexIndex], fragUv);
+        specularColor = texture(texSampler[TEXTURE_INDEX(fragSpecTexIndex)], fragUv);
 #endif
     } else {
         specularColor = sampleTextureColor;
@@ -0,0 +1,87 @@
+#version 450
+
+// Масштабирование кадра сцены из внеэкранной цели динамического разрешения (WrpDynamicResolution) в кадр swapchain'а.
+// Билинейная выборка размывает увеличенный кадр, поэтому к ней добавляется адаптивное повышение резкости
+// в духе AMD FidelityFX CAS: вес отрицательного "креста" соседей зависит от локального контраста, так что
+// на резких границах, где запаса до 0 или 1 нет, резкость слабее и не даёт ореолов.
+// С FXAA вместо повышения резкости сглаживаются ступеньки на границах (кадр без MSAA или с малым числом выборок).
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(push_constant) uniform Push {
+    vec2 outputTexelSize; // 1 / размер кадра swapchain'а
+    vec2 uvScale;         // доля вложения, занятая кадром сцены
+    vec2 texelSize;       // 1 / размер вложения
+    float sharpness;      // [0; 1]
+} push;
+
+vec3 fetch(vec2 uv) {
+    // крайние тексели кадра сцены: выборка не должна захватывать неотрисованную часть вложения
+    return texture(sceneColor, clamp(uv, 0.5 * push.texelSize, push.uvScale - 0.5 * push.texelSize)).rgb;
+}
+
+#ifdef FXAA
+float luma(vec3 color) {
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+// FXAA в варианте "console" (T. Lottes): направление границы по яркости четырёх диагональных соседей,
+// размытие вдоль него двумя парами выборок. Широкая пара отбрасывается, если выходит за диапазон яркости
+// окрестности (граница короче её шага).
+vec3 fxaa(vec2 uv) {
+    const float REDUCE_MIN = 1.0 / 128.0;
+    const float REDUCE_MUL = 1.0 / 8.0;
+    const float SPAN_MAX = 8.0;
+    // пороги контраста, ниже которых пиксель не сглаживается
+    const float EDGE_THRESHOLD = 1.0 / 8.0;
+    const float EDGE_THRESHOLD_MIN = 1.0 / 16.0;
+
+    vec3 center = fetch(uv);
+    float lumaNW = luma(fetch(uv + vec2(-0.5, -0.5) * push.texelSize));
+    float lumaNE = luma(fetch(uv + vec2(0.5, -0.5) * push.texelSize));
+    float lumaSW = luma(fetch(uv + vec2(-0.5, 0.5) * push.texelSize));
+    float lumaSE = luma(fetch(uv + vec2(0.5, 0.5) * push.texelSize));
+    float lumaM = luma(center);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+        return center;
+
+    // направление вдоль границы (перпендикулярно градиенту яркости)
+    vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float directionReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+    direction = clamp(direction * scale, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * push.texelSize;
+
+    vec3 colorA = 0.5 * (fetch(uv + direction * (1.0 / 3.0 - 0.5)) + fetch(uv + direction * (2.0 / 3.0 - 0.5)));
+    vec3 colorB = 0.5 * colorA + 0.25 * (fetch(uv - direction * 0.5) + fetch(uv + direction * 0.5));
+    float lumaB = luma(colorB);
+    return (lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB;
+}
+#endif
+
+void main() {
+    vec2 uv = gl_FragCoord.xy * push.outputTexelSize * push.uvScale;
+
+#ifdef FXAA
+    outColor = vec4(fxaa(uv), 1.0);
+#else
+    vec3 center = fetch(uv);
+    vec3 north = fetch(uv - vec2(0.0, push.texelSize.y));
+    vec3 south = fetch(uv + vec2(0.0, push.texelSize.y));
+    vec3 west = fetch(uv - vec2(push.texelSize.x, 0.0));
+    vec3 east = fetch(uv + vec2(push.texelSize.x, 0.0));
+
+    vec3 minColor = min(center, min(min(north, south), min(west, east)));
+    vec3 maxColor = max(center, max(max(north, south), max(west, east)));
+    // запас контраста: 0 - соседи уже достигают 0 или 1, 1 - плавная область
+    vec3 amplitude = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, 1e-4), 0.0, 1.0));
+    // вес соседей до -1/5 при наибольшей резкости; нормировка сохраняет яркость плоских областей
+    vec3 weight = amplitude * (-0.2 * push.sharpness);
+    vec3 color = (center + (north + south + west + east) * weight) / (1.0 + 4.0 * weight);
+
+    outColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+#endif
+}
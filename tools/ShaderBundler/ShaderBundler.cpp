@@ -0,0 +1,155 @@
+// Офлайн компилятор перестановок шейдеров.
+// Собирает все варианты из ShaderPermutations в оптимизированный SPIR-V параллельно на потоках WrpJobSystem
+// и записывает их в один индексированный бандл, который ShaderModule загружает по ключу без shaderc.
+//
+// Usage: ShaderBundler <shaders dir> <output bundle path>
+
+#include "renderer/JobSystem.hpp"
+#include "renderer/ShaderBundle.hpp"
+#include "renderer/ShaderPermutations.hpp"
+
+#include "shaderc/shaderc.h"
+
+// std
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Исходник с раскрытыми #include <name> (include-файлы ищутся в директории шейдеров, как и в ShaderModule)
+    std::string readShaderSource(const std::string& shadersDir, const std::string& shaderName)
+    {
+        std::ifstream file(shadersDir + shaderName, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open file: " + shadersDir + shaderName);
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string code = buffer.str();
+
+        static constexpr unsigned char BOM[] = {0xEF, 0xBB, 0xBF};
+        if (code.size() > 3 && !std::memcmp(code.data(), BOM, 3))
+            code.replace(0, 3, "   ");
+
+        while (code.find("#include ") != code.npos)
+        {
+            const auto pos = code.find("#include ");
+            const auto p1 = code.find('<', pos);
+            const auto p2 = code.find('>', pos);
+            if (p1 == code.npos || p2 == code.npos || p2 <= p1)
+                throw std::runtime_error("Failed to handle #include directive in " + shaderName);
+            code.replace(pos, p2 - pos + 1, readShaderSource(shadersDir, code.substr(p1 + 1, p2 - p1 - 1)));
+        }
+        return code;
+    }
+
+    shaderc_shader_kind shaderKindFromFileName(const std::string& shaderName)
+    {
+        const std::string extension = std::filesystem::path(shaderName).extension().string();
+        if (extension == ".frag") return shaderc_glsl_fragment_shader;
+        if (extension == ".geom") return shaderc_glsl_geometry_shader;
+        if (extension == ".comp") return shaderc_glsl_compute_shader;
+        if (extension == ".tesc") return shaderc_glsl_tess_control_shader;
+        if (extension == ".tese") return shaderc_glsl_tess_evaluation_shader;
+        return shaderc_glsl_vertex_shader;
+    }
+
+    std::string permutationName(const ShaderPermutation& permutation)
+    {
+        std::string name = permutation.shaderName;
+        for (const auto& [define, value] : permutation.defines) name += " " + define + "=" + value;
+        return name;
+    }
+
+    ShaderBundle::Entry compilePermutation(const std::string& shadersDir, const ShaderPermutation& permutation)
+    {
+        // компилятор shaderc не потокобезопасен для одновременных вызовов, поэтому у каждого потока свой
+        struct ThreadLocalShaderCompiler
+        {
+            shaderc_compiler_t compiler = shaderc_compiler_initialize();
+            ~ThreadLocalShaderCompiler() { shaderc_compiler_release(compiler); }
+        };
+        static thread_local ThreadLocalShaderCompiler threadCompiler;
+
+        const std::string source = readShaderSource(shadersDir, permutation.shaderName);
+
+        shaderc_compile_options_t options = shaderc_compile_options_initialize();
+        shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+        for (const auto& [name, value] : permutation.defines)
+        {
+            shaderc_compile_options_add_macro_definition(options, name.c_str(), name.size(), value.c_str(), value.size());
+        }
+
+        shaderc_compilation_result_t result = shaderc_compile_into_spv(threadCompiler.compiler, source.data(), source.size(),
+            shaderKindFromFileName(permutation.shaderName), permutation.shaderName.c_str(), "main", options);
+        shaderc_compile_options_release(options);
+
+        if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+        {
+            std::string errorMessage = shaderc_result_get_error_message(result);
+            shaderc_result_release(result);
+            throw std::runtime_error(errorMessage);
+        }
+
+        ShaderBundle::Entry entry{ShaderBundle::permutationKey(permutation.shaderName, permutation.defines), {}};
+        entry.spirv.resize(shaderc_result_get_length(result) / sizeof(uint32_t));
+        std::memcpy(entry.spirv.data(), shaderc_result_get_bytes(result), entry.spirv.size() * sizeof(uint32_t));
+        shaderc_result_release(result);
+        return entry;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: ShaderBundler <shaders dir> <output bundle path>" << std::endl;
+        return 1;
+    }
+    std::string shadersDir = argv[1];
+    if (!shadersDir.empty() && shadersDir.back() != '/' && shadersDir.back() != '\\')
+        shadersDir += '/';
+    const std::filesystem::path outputPath = argv[2];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const std::vector<ShaderPermutation> permutations = ShaderPermutations::all();
+
+    std::vector<std::future<ShaderBundle::Entry>> futures;
+    futures.reserve(permutations.size());
+    for (const auto& permutation : permutations)
+    {
+        futures.push_back(WrpJobSystem::instance().submit(
+            [&shadersDir, &permutation]() { return compilePermutation(shadersDir, permutation); }));
+    }
+
+    std::vector<ShaderBundle::Entry> entries;
+    entries.reserve(permutations.size());
+    bool failed = false;
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        try
+        {
+            entries.push_back(futures[i].get());
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << "[ShaderBundler] " << permutationName(permutations[i]) << ":\n" << ex.what() << std::endl;
+            failed = true;
+        }
+    }
+    if (failed || !ShaderBundle::write(outputPath, std::move(entries)))
+        return 1;
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "[ShaderBundler] " << permutations.size() << " permutations compiled in " << elapsed << " ms on "
+        << WrpJobSystem::instance().getWorkerCount() << " worker threads -> " << outputPath << std::endl;
+    return 0;
+}